@@ -0,0 +1,151 @@
+#ifndef DB_CONNECTION_H
+#define DB_CONNECTION_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <ctime>
+#include <cstring>
+#include "ap/result_set.h"
+// 根据系统配置可能需要调整MySQL头文件路径
+#ifdef _WIN32
+#include <mysql.h>
+#include <errmsg.h>
+#include <mysqld_error.h>
+#else
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#endif
+
+/**
+ * 预处理语句参数
+ * 字符串参数只保存指针和长度，不复制数据，调用方需保证语句执行期间字符串有效
+ * （因此禁止从临时std::string构造）
+ */
+struct DBParam {
+    enum class Type { NULL_VALUE, INTEGER, DOUBLE, STRING };
+
+    Type type;
+    long long intValue;
+    double doubleValue;
+    const char* data;
+    unsigned long length;
+
+    DBParam() : type(Type::NULL_VALUE), intValue(0), doubleValue(0), data(nullptr), length(0) {}
+    DBParam(int value) : DBParam(static_cast<long long>(value)) {}
+    DBParam(long value) : DBParam(static_cast<long long>(value)) {}
+    DBParam(long long value) : type(Type::INTEGER), intValue(value), doubleValue(0), data(nullptr), length(0) {}
+    DBParam(double value) : type(Type::DOUBLE), intValue(0), doubleValue(value), data(nullptr), length(0) {}
+    DBParam(const std::string& value)
+        : type(Type::STRING), intValue(0), doubleValue(0), data(value.data()), length(value.length()) {}
+    DBParam(std::string&&) = delete;
+    DBParam(const char* value)
+        : type(Type::STRING), intValue(0), doubleValue(0), data(value), length(strlen(value)) {}
+
+    static DBParam null() { return DBParam(); }
+};
+
+/**
+ * 单个MySQL连接
+ * 同一时刻只能被一个线程使用，由DBConnectionPool负责分配。
+ * 不使用已废弃的MYSQL_OPT_RECONNECT：连接断开时标记为失效，由连接池在下次取出前重连。
+ * 预处理语句按SQL模板缓存在连接上，重复执行时服务端无需重新解析
+ */
+class DBConnection {
+public:
+    DBConnection();
+    ~DBConnection();
+    DBConnection(const DBConnection&) = delete;
+    DBConnection& operator=(const DBConnection&) = delete;
+
+    // 连接数据库
+    bool connect(const std::string& host, const std::string& user,
+                 const std::string& password, const std::string& database,
+                 unsigned int port = 3306);
+
+    // 断开连接
+    void disconnect();
+
+    // 使用上次的连接参数重新连接
+    bool reconnect();
+
+    // 检查连接是否可用（mysql_ping），不会自动重连
+    bool ping();
+
+    // 连接是否已建立且未被标记为失效
+    bool isUsable() const { return connected && !broken; }
+
+    // 执行查询
+    bool executeQuery(const std::string& query);
+
+    // 执行查询并获取结果，NULL值在结果集中单独标记
+    ResultSet executeSelect(const std::string& query);
+
+    /**
+     * 执行预处理语句（INSERT/UPDATE/DELETE）
+     * @param sql 以?作为参数占位符的SQL模板，同一模板的语句在连接上只准备一次
+     */
+    bool executePrepared(const std::string& sql, const std::vector<DBParam>& params);
+
+    // 执行预处理查询并获取结果，结果格式与executeSelect一致
+    ResultSet selectPrepared(const std::string& sql, const std::vector<DBParam>& params);
+
+    // 获取最后插入的ID
+    unsigned long long getLastInsertId();
+
+    // 获取受影响的行数
+    unsigned long long getAffectedRows();
+
+    // 事务操作
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+
+    // 转义字符串
+    std::string escapeString(const std::string& str);
+
+    // 获取错误信息
+    std::string getLastError();
+
+    // 最近一次归还连接池的时间，用于决定取出时是否需要探测
+    time_t getLastUsed() const { return lastUsed; }
+    void touch() { lastUsed = time(nullptr); }
+
+private:
+    // 连接上缓存的预处理语句数上限，超过后关闭最早准备的语句
+    static const size_t MAX_CACHED_STATEMENTS = 128;
+
+    // 根据错误码判断连接是否已断开
+    void checkConnectionError(unsigned int error);
+
+    // 从缓存中取出语句，没有时准备新语句
+    MYSQL_STMT* prepareStatement(const std::string& sql);
+
+    // 绑定参数并执行；语句因错误失效时从缓存中移除，主键冲突等数据错误后语句仍可用，继续缓存
+    bool bindAndExecute(MYSQL_STMT* stmt, const std::string& sql, const std::vector<DBParam>& params);
+
+    // 关闭缓存的语句
+    void discardStatement(const std::string& sql);
+    void closeStatements();
+
+    MYSQL* mysql;
+    bool connected;
+    bool broken;
+    time_t lastUsed;
+    unsigned long long lastInsertId;
+    unsigned long long affectedRows;
+
+    std::unordered_map<std::string, MYSQL_STMT*> statements;  // SQL模板 -> 预处理语句
+    std::vector<std::string> statementOrder;                   // 准备顺序，用于淘汰
+
+    // 重连使用的参数
+    std::string host;
+    std::string user;
+    std::string password;
+    std::string database;
+    unsigned int port;
+};
+
+#endif // DB_CONNECTION_H
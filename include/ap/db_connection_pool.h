@@ -0,0 +1,135 @@
+#ifndef DB_CONNECTION_POOL_H
+#define DB_CONNECTION_POOL_H
+
+#include "ap/db_connection.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * MySQL连接池
+ * 启动时建立min个连接，按需增长到max个；取连接时最多等待checkout超时时间。
+ * 空闲超过探测间隔或被标记为失效的连接在取出前先ping，失败则重连，
+ * 超过min的连接空闲超时后关闭
+ */
+class DBConnectionPool {
+public:
+    static DBConnectionPool& getInstance();
+
+    /**
+     * 借出的连接，析构时自动归还连接池
+     */
+    class Handle {
+    public:
+        Handle() : pool(nullptr) {}
+        Handle(DBConnectionPool* pool, std::unique_ptr<DBConnection> conn)
+            : pool(pool), conn(std::move(conn)) {}
+        ~Handle() { release(); }
+        Handle(Handle&& other) noexcept = default;
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool = other.pool;
+                conn = std::move(other.conn);
+            }
+            return *this;
+        }
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        DBConnection* operator->() const { return conn.get(); }
+        DBConnection& operator*() const { return *conn; }
+        explicit operator bool() const { return conn != nullptr; }
+
+        // 提前归还连接
+        void release() {
+            if (pool && conn) {
+                pool->release(std::move(conn));
+            }
+        }
+
+    private:
+        DBConnectionPool* pool;
+        std::unique_ptr<DBConnection> conn;
+    };
+
+    // 连接池统计
+    struct Metrics {
+        size_t total;             // 已建立的连接数
+        size_t idle;              // 空闲连接数
+        size_t inUse;             // 借出的连接数
+        uint64_t checkouts;       // 成功借出次数
+        uint64_t exhausted;       // 等待超时（连接池耗尽）次数
+        uint64_t reconnects;      // 重连次数
+        uint64_t totalWaitUs;     // 借出连接的累计等待时间（微秒）
+        uint64_t maxWaitUs;       // 单次最长等待时间（微秒）
+    };
+
+    /**
+     * 初始化连接池并建立minSize个连接
+     * @param checkoutTimeoutMs 连接池耗尽时取连接的最长等待时间
+     * @param pingIntervalSec 连接空闲超过该时间后，取出前先探测
+     * @param idleTimeoutSec 超过minSize的空闲连接超过该时间后关闭
+     * @return 至少建立了一个连接时返回true
+     */
+    bool init(const std::string& host, const std::string& user,
+              const std::string& password, const std::string& database, unsigned int port,
+              int minSize, int maxSize, int checkoutTimeoutMs, int pingIntervalSec, int idleTimeoutSec);
+
+    // 关闭所有空闲连接，借出的连接归还时关闭
+    void shutdown();
+
+    /**
+     * 借出连接，连接池耗尽时等待直到超时
+     * @return 失败时返回空Handle
+     */
+    Handle acquire();
+
+    Metrics getMetrics() const;
+
+    int getMaxSize() const { return maxSize; }
+
+private:
+    DBConnectionPool();
+    ~DBConnectionPool();
+    DBConnectionPool(const DBConnectionPool&) = delete;
+    DBConnectionPool& operator=(const DBConnectionPool&) = delete;
+
+    void release(std::unique_ptr<DBConnection> conn);
+    std::unique_ptr<DBConnection> createConnection();
+    bool validate(DBConnection& conn);
+    void recordWait(std::chrono::steady_clock::time_point start);
+
+    // 连接参数
+    std::string host;
+    std::string user;
+    std::string password;
+    std::string database;
+    unsigned int port;
+
+    int minSize;
+    int maxSize;
+    int checkoutTimeoutMs;
+    int pingInterval;
+    int idleTimeout;
+
+    mutable std::mutex poolMutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<DBConnection>> idle;  // 空闲连接，末尾为最近归还的
+    size_t total;                                     // 已建立和正在建立的连接数
+    bool running;
+
+    std::atomic<uint64_t> checkouts;
+    std::atomic<uint64_t> exhausted;
+    std::atomic<uint64_t> reconnects;
+    std::atomic<uint64_t> totalWaitUs;
+    std::atomic<uint64_t> maxWaitUs;
+    std::mutex metricsMutex;                          // 导出指标时同步计数器
+};
+
+#endif // DB_CONNECTION_POOL_H
@@ -4,8 +4,18 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <ctime>
+#include <cstdint>
 #include <nlohmann/json.hpp>
+#include "ap/worker_pool.h"
+#include "common/metrics.h"
+#include "common/http_parser.h"
 
 class Processor {
 public:
@@ -24,15 +34,27 @@ public:
     // 启动处理服务
     bool startService(int port);
     
-    // 停止处理服务
+    // 停止处理服务（只设置标志，可在信号处理函数中调用）
     void stopService();
+    
+    // 等待服务线程退出，此后不再有请求访问数据库
+    void waitForStop();
 
     // 获取ap运行状态
     bool isRunning();
     
+    // 列表查询的分页参数：按id倒序，afterId为上一页最后一条记录的id，0表示第一页
+    struct PageRequest {
+        long long limit;
+        long long afterId;
+    };
+    
+    // 从请求中读取limit和after_id，limit超过上限时按上限处理；参数无效时error为错误响应
+    bool parsePageRequest(const nlohmann::json& request, PageRequest& page, std::string& error) const;
+    
 private:
-    Processor() = default;
-    ~Processor() = default;
+    Processor();
+    ~Processor();
     Processor(const Processor&) = delete;
     Processor& operator=(const Processor&) = delete;
     
@@ -42,10 +64,80 @@ private:
     // 请求ID生成
     std::string generateRequestId();
     
-    // 服务相关
-    int servicePort;
-    bool running;
+    // 列表查询的默认和最大单页条数
+    int defaultPageLimit = 20;
+    int maxPageLimit = 100;
+    
+    // 连接使用的协议，由连接上收到的第一个字节决定
+    enum class SessionProtocol {
+        UNKNOWN,     // 尚未收到数据
+        FRAME,       // ApProtocol长度前缀帧
+        LINE,        // 旧版DISP的按行JSON
+        HTTP         // 指标采集的HTTP GET，响应后关闭
+    };
+    
+    // 长连接会话：DISP在一个连接上发送多个请求，帧协议下可以不等响应连续发送
+    struct Session {
+        uint64_t id;                 // 会话ID，fd被复用后用于丢弃旧连接的处理结果
+        std::string clientIp;
+        std::string readBuffer;
+        HttpParser httpParser;       // HTTP协议的会话使用
+        std::string writeBuffer;
+        size_t writePos;
+        time_t lastActivity;
+        int64_t lastReceive;         // 最后一次收到数据的单调时钟（纳秒），判断旧版DISP的请求是否发送完毕
+        SessionProtocol protocol;
+        int inFlight;                // 已提交给工作线程尚未完成的请求数
+        bool wantWrite;              // 是否已注册EPOLLOUT
+        bool closeAfterWrite;        // 响应发送完后关闭（旧版DISP的单次请求和HTTP请求）
+    };
+    
+    // 工作线程处理完成的响应，由事件循环线程写回连接
+    struct Completion {
+        int fd;
+        uint64_t sessionId;
+        std::string data;
+    };
+    
+    // 服务相关：事件循环线程负责接受连接和收发数据，业务处理（含数据库访问）交给工作线程池
+    static const int MAX_EVENTS = 256;
+    // 旧版DISP的请求不带结束符，停止发送超过该间隔（毫秒）后才按完整JSON解析
+    static const int LINE_IDLE_GAP_MS = 20;
+    int servicePort = 0;
+    std::atomic<bool> running{false};
+    int keepAliveTimeout = 120;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::thread serviceThread;
+    std::unordered_map<int, Session> sessions;      // 仅由事件循环线程访问
+    std::unordered_set<int> pendingLines;           // 收到不带结束符的按行请求、等待发送间隔的连接
+    uint64_t nextSessionId = 1;
+    WorkerPool workers;
+    std::mutex completionMutex;
+    std::vector<Completion> completions;
+    
     void serviceLoop(int serverSocket);
+    void acceptConnections(int serverSocket);
+    void handleSessionEvent(int clientSocket, uint32_t events);
+    bool readSession(int clientSocket, Session& session);
+    bool handleFrames(int clientSocket, Session& session);
+    bool handleLines(int clientSocket, Session& session);
+    void checkPendingLines();
+    bool handleHttp(Session& session);
+    void dispatchRequest(int clientSocket, Session& session, std::string request, uint32_t frameId, uint8_t version);
+    void postCompletion(Completion completion);
+    void processCompletions();
+    bool flushSession(int clientSocket, Session& session);
+    void closeSession(int clientSocket);
+    void closeIdleSessions();
+    std::string handleMessage(const std::string& request, const std::string& clientIp, std::string& requestId);
+    
+    // 运行指标
+    Counter& acceptedConnections;
+    Gauge& activeConnections;
+    Counter& rejectedRequests;
+    Gauge& queueDepth;
+    MetricFamily<Histogram>& requestDuration;   // 按请求类型，只记录已注册的类型
 };
 
 #endif // PROCESSOR_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef RESULT_SET_H
+#define RESULT_SET_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+
+/**
+ * 查询结果集
+ * 所有单元格的值按行优先连续存放在一块缓冲区中，另用偏移/长度数组定位每个单元格，
+ * NULL用位图标记。读取时返回指向缓冲区的string_view，遍历和取值都不产生复制。
+ * 每个值后附加'\0'，可直接作为C字符串使用。
+ * 返回的string_view在ResultSet析构或继续追加数据之前有效
+ */
+class ResultSet {
+public:
+    /**
+     * 结果集中的一行，只是对ResultSet的引用，复制开销很小
+     */
+    class Row {
+    public:
+        Row(const ResultSet* resultSet, size_t row) : resultSet(resultSet), row(row) {}
+
+        std::string_view operator[](size_t column) const { return resultSet->get(row, column); }
+        bool isNull(size_t column) const { return resultSet->isNull(row, column); }
+        size_t size() const { return resultSet->columnCount(); }
+        size_t index() const { return row; }
+
+        long long getInt(size_t column, long long defaultValue = 0) const {
+            return resultSet->getInt(row, column, defaultValue);
+        }
+        double getDouble(size_t column, double defaultValue = 0) const {
+            return resultSet->getDouble(row, column, defaultValue);
+        }
+        bool getDecimal(size_t column, int scale, long long& value) const {
+            return resultSet->getDecimal(row, column, scale, value);
+        }
+        bool getDateTime(size_t column, std::tm& value) const {
+            return resultSet->getDateTime(row, column, value);
+        }
+
+    private:
+        const ResultSet* resultSet;
+        size_t row;
+    };
+
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Row;
+
+        Iterator(const ResultSet* resultSet, size_t row) : resultSet(resultSet), row(row) {}
+
+        Row operator*() const { return Row(resultSet, row); }
+        Iterator& operator++() { ++row; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++row; return old; }
+        bool operator==(const Iterator& other) const { return row == other.row; }
+        bool operator!=(const Iterator& other) const { return row != other.row; }
+
+    private:
+        const ResultSet* resultSet;
+        size_t row;
+    };
+
+    ResultSet();
+
+    // 清空数据并设置列数，已分配的内存保留复用
+    void reset(size_t columnCount);
+
+    // 按预计的行数和数据量预分配，避免追加时反复扩容
+    void reserve(size_t rows, size_t bytes);
+
+    void setColumnName(size_t column, const std::string& name);
+
+    // 追加一个单元格，按行优先顺序依次追加
+    void appendValue(const char* data, size_t length);
+
+    // 追加一个长度为length的单元格并返回其存储位置，由调用方直接写入（在下次追加前有效）
+    char* appendValue(size_t length);
+
+    void appendNull();
+
+    size_t rowCount() const { return columns == 0 ? 0 : lengths.size() / columns; }
+    size_t columnCount() const { return columns; }
+    bool empty() const { return rowCount() == 0; }
+    const std::string& columnName(size_t column) const { return columnNames[column]; }
+
+    // 按列名查找列下标，不存在时返回npos
+    size_t findColumn(std::string_view name) const;
+    static const size_t npos = static_cast<size_t>(-1);
+
+    Row operator[](size_t row) const { return Row(this, row); }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, rowCount()); }
+
+    // 单元格的原始值，NULL返回空串
+    std::string_view get(size_t row, size_t column) const {
+        size_t cell = row * columns + column;
+        return std::string_view(buffer.data() + offsets[cell], lengths[cell]);
+    }
+
+    bool isNull(size_t row, size_t column) const {
+        size_t cell = row * columns + column;
+        return (nullBitmap[cell / 64] >> (cell % 64)) & 1;
+    }
+
+    // 按整数读取，NULL或无法解析时返回defaultValue
+    long long getInt(size_t row, size_t column, long long defaultValue = 0) const;
+
+    // 按浮点数读取，NULL或无法解析时返回defaultValue
+    double getDouble(size_t row, size_t column, double defaultValue = 0) const;
+
+    /**
+     * 按定点数读取DECIMAL列，结果放大10^scale倍，例如scale=2时"12.345"得到1235（四舍五入）
+     * @return NULL或无法解析时返回false
+     */
+    bool getDecimal(size_t row, size_t column, int scale, long long& value) const;
+
+    /**
+     * 读取DATETIME/DATE列（"YYYY-MM-DD HH:MM:SS"或"YYYY-MM-DD"）
+     * @return NULL或格式不正确时返回false
+     */
+    bool getDateTime(size_t row, size_t column, std::tm& value) const;
+
+    // 数据缓冲区占用的字节数
+    size_t bufferSize() const { return buffer.size(); }
+
+private:
+    // 记录新单元格的位置，返回单元格序号
+    size_t addCell(size_t length);
+
+    std::string buffer;                    // 所有单元格的值，每个值后跟'\0'
+    std::vector<uint32_t> offsets;         // 单元格在buffer中的起始位置
+    std::vector<uint32_t> lengths;         // 单元格长度（不含'\0'）
+    std::vector<uint64_t> nullBitmap;      // 每个单元格一位，置位表示NULL
+    std::vector<std::string> columnNames;
+    size_t columns;
+};
+
+#endif // RESULT_SET_H
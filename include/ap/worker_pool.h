@@ -0,0 +1,63 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+
+/**
+ * AP业务处理线程池
+ * 固定数量的工作线程从有界队列中取任务执行；队列已满时拒绝提交，
+ * 由调用方立即返回繁忙响应，避免请求在队列中堆积到超时
+ */
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    WorkerPool();
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * 启动工作线程
+     * @param threads 工作线程数
+     * @param maxQueue 等待执行的任务数上限
+     */
+    void start(int threads, size_t maxQueue);
+
+    /**
+     * 停止线程池：不再接受新任务，已入队的任务执行完后工作线程退出
+     */
+    void stop();
+
+    /**
+     * 提交任务
+     * @return 队列已满或线程池未运行时返回false，任务不会被执行
+     */
+    bool submit(Task task);
+
+    // 当前排队的任务数
+    size_t queueDepth() const;
+
+    // 累计被拒绝的任务数
+    size_t rejectedCount() const { return rejected; }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> threads;
+    std::deque<Task> tasks;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCv;
+    size_t maxQueue;
+    bool accepting;
+    std::atomic<size_t> rejected;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,71 @@
+#ifndef AP_PROTOCOL_H
+#define AP_PROTOCOL_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * DISP↔AP帧协议
+ *
+ * 每帧由固定12字节头部和负载组成（多字节字段均为网络字节序）：
+ *   magic(2) = "AP" | version(1) | type(1) | requestId(4) | length(4) | payload(length)
+ *
+ * requestId由请求方在连接内分配，响应帧原样带回，因此同一连接上可以有多个未完成的请求，
+ * 响应也可以乱序返回。头部布局在各版本之间保持不变，接收方总能根据length跳过无法识别的帧；
+ * 收到高于自身支持版本的请求时回复ERROR帧，负载中携带自身支持的版本号。
+ */
+namespace ApProtocol {
+    const uint16_t MAGIC = 0x4150;                       // "AP"
+    const uint8_t VERSION = 1;                           // 当前协议版本
+    const size_t HEADER_SIZE = 12;
+    const uint32_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;  // 单帧负载上限，超过视为非法数据
+
+    enum class FrameType : uint8_t {
+        REQUEST = 1,     // 业务请求，负载为JSON
+        RESPONSE = 2,    // 业务响应，负载为JSON
+        PING = 3,        // 连接探测
+        PONG = 4,        // 探测响应
+        ERROR = 5        // 协议错误或拒绝处理，负载为JSON；AP繁忙拒绝请求时负载带"code":503
+    };
+
+    struct Frame {
+        uint8_t version;
+        FrameType type;
+        uint32_t requestId;
+        std::string payload;
+
+        Frame() : version(VERSION), type(FrameType::REQUEST), requestId(0) {}
+    };
+
+    enum class DecodeResult {
+        COMPLETE,        // 解析出一帧
+        INCOMPLETE,      // 数据不足，需要继续接收
+        INVALID          // 魔数错误或长度超限，连接应关闭
+    };
+
+    // 编码一帧并追加到out末尾
+    void encode(std::string& out, FrameType type, uint32_t requestId,
+                const std::string& payload, uint8_t version = VERSION);
+
+    // 编码一帧
+    std::string encode(FrameType type, uint32_t requestId,
+                       const std::string& payload, uint8_t version = VERSION);
+
+    /**
+     * 从data开始处解析一帧
+     * @param consumed 解析成功时为该帧占用的字节数
+     */
+    DecodeResult decode(const char* data, size_t size, Frame& frame, size_t& consumed);
+
+    /**
+     * 只解析帧头部，不要求负载已全部到达（用于边接收边转发较大的负载）
+     * @param length 负载长度，frame.payload不会被填充
+     */
+    DecodeResult decodeHeader(const char* data, size_t size, Frame& frame, uint32_t& length);
+
+    // 判断数据是否以帧魔数开头（用于区分旧版按行JSON协议），数据不足2字节时返回false
+    bool startsWithMagic(const char* data, size_t size);
+}
+
+#endif // AP_PROTOCOL_H
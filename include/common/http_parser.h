@@ -0,0 +1,129 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;      // 已去除首尾空白
+};
+
+/**
+ * 解析完成的HTTP请求
+ * 各字段直接指向连接的读缓冲区，不复制数据；缓冲区被修改（追加数据、清空）后全部失效，
+ * 需要保留的内容由调用方自行复制
+ */
+struct HttpRequest {
+    std::string_view method;
+    std::string_view target;     // 请求目标，路径加查询字符串
+    std::string_view path;
+    std::string_view query;      // 不含'?'
+    std::string_view version;    // HTTP/1.0或HTTP/1.1
+    std::vector<HttpHeader> headers;
+    std::string_view body;
+    std::string_view raw;        // 从请求行到请求体末尾的完整请求
+    bool keepAlive = false;      // HTTP/1.1默认保持连接，HTTP/1.0需要Connection: keep-alive
+
+    // 按名称查找头部（不区分大小写），不存在时返回空
+    std::string_view header(std::string_view name) const;
+
+    // 查询参数，取值经过URL解码，不存在时返回false
+    bool queryParam(std::string_view name, std::string& value) const;
+};
+
+/**
+ * 增量HTTP/1.1请求解析器
+ * 每次收到数据后用连接的整个读缓冲区调用parse()，解析器记住已扫描的位置，
+ * 只处理新到达的字节，请求行和头部按行校验，不会重复扫描整个缓冲区。
+ * 解析过程中只记录偏移，请求完整后才生成指向缓冲区的string_view，期间缓冲区扩容不影响解析。
+ * 不支持请求体的分块编码（Transfer-Encoding），按501拒绝
+ */
+class HttpParser {
+public:
+    enum class Result {
+        INCOMPLETE,   // 需要更多数据
+        COMPLETE,     // 请求完整，request()可用
+        ERROR         // 请求格式错误或超过限制，errorStatus()给出应答的状态码
+    };
+
+    static const size_t MAX_HEADER_SIZE = 8192;        // 请求行加头部的最大字节数
+    static const size_t MAX_HEADERS = 64;
+    static const size_t MAX_BODY_SIZE = 1024 * 1024;
+
+    HttpParser();
+
+    // data必须是上次调用时的同一段数据追加新字节后的结果（地址可以变化）
+    Result parse(const char* data, size_t length);
+    Result parse(const std::string& buffer) { return parse(buffer.data(), buffer.length()); }
+
+    // 开始解析下一个请求，已分配的头部存储保留复用
+    void reset();
+
+    // 最近一个完整请求，返回COMPLETE之后有效
+    const HttpRequest& request() const { return current; }
+
+    // 请求行和头部已完整收到（正在接收请求体或请求已完整）
+    bool headersComplete() const { return state == State::BODY || state == State::COMPLETE; }
+
+    // 完整请求占用的字节数，之后的数据属于下一个请求
+    size_t consumed() const { return messageEnd; }
+
+    int errorStatus() const { return status; }
+    const char* errorMessage() const { return error; }
+
+    // 解析器给出的错误状态码对应的原因短语
+    static const char* reasonPhrase(int statusCode);
+
+private:
+    enum class State {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        COMPLETE,
+        ERROR
+    };
+
+    struct Range {
+        size_t offset;
+        size_t length;
+    };
+
+    struct HeaderRange {
+        Range name;
+        Range value;
+    };
+
+    Result fail(int statusCode, const char* message);
+    bool parseRequestLine(const char* data, size_t begin, size_t end);
+    bool parseHeaderLine(const char* data, size_t begin, size_t end);
+    void buildRequest(const char* data);
+
+    static std::string_view view(const char* data, Range range) {
+        return std::string_view(data + range.offset, range.length);
+    }
+
+    State state;
+    size_t lineStart;            // 当前行的起始位置
+    size_t scanPos;              // 当前行已扫描到的位置（尚未找到换行）
+    size_t messageStart;         // 请求行起始位置（跳过请求之间的空行）
+    size_t bodyStart;
+    size_t contentLength;
+    size_t messageEnd;
+    bool hasContentLength;
+    bool http10;
+    int connectionToken;         // Connection头部：0未指定，1 close，2 keep-alive
+
+    Range methodRange;
+    Range targetRange;
+    Range versionRange;
+    std::vector<HeaderRange> headerRanges;
+
+    int status;
+    const char* error;
+    HttpRequest current;
+};
+
+#endif // HTTP_PARSER_H
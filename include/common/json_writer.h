@@ -0,0 +1,126 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <type_traits>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * 流式JSON写入器
+ * 直接向输出字符串追加JSON文本，不构造中间的DOM对象，逗号由写入器自动插入。
+ * 调用方负责保证begin/end配对、对象内先key后value
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out(out), afterKey(false) {}
+
+    JsonWriter& beginObject() { return open('{'); }
+    JsonWriter& endObject() { return close('}'); }
+    JsonWriter& beginArray() { return open('['); }
+    JsonWriter& endArray() { return close(']'); }
+
+    JsonWriter& key(std::string_view name) {
+        separator();
+        appendString(out, name);
+        out += ':';
+        afterKey = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separator();
+        appendString(out, text);
+        return *this;
+    }
+
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+
+    JsonWriter& value(bool flag) {
+        separator();
+        out += flag ? "true" : "false";
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                  !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter& value(T number) {
+        separator();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, result.ptr - buffer);
+        return *this;
+    }
+
+    // 非有限值（NaN、无穷大）写为null
+    JsonWriter& value(double number) {
+        separator();
+        if (!std::isfinite(number)) {
+            out += "null";
+            return *this;
+        }
+        // 优先用15位有效数字，读回不相等时再用17位保证精确
+        char buffer[32];
+        int length = snprintf(buffer, sizeof(buffer), "%.15g", number);
+        if (strtod(buffer, nullptr) != number) {
+            length = snprintf(buffer, sizeof(buffer), "%.17g", number);
+        }
+        out.append(buffer, length);
+        return *this;
+    }
+
+    JsonWriter& null() {
+        separator();
+        out += "null";
+        return *this;
+    }
+
+    // 写入已经序列化好的JSON值
+    JsonWriter& raw(std::string_view json) {
+        separator();
+        out.append(json.data(), json.size());
+        return *this;
+    }
+
+    // 追加带引号并转义的JSON字符串
+    static void appendString(std::string& out, std::string_view text);
+
+private:
+    JsonWriter& open(char bracket) {
+        separator();
+        out += bracket;
+        hasElements.push_back(false);
+        return *this;
+    }
+
+    JsonWriter& close(char bracket) {
+        out += bracket;
+        hasElements.pop_back();
+        return *this;
+    }
+
+    // 同一层级的第二个及之后的元素前插入逗号，key之后的值不需要
+    void separator() {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (!hasElements.empty()) {
+            if (hasElements.back()) {
+                out += ',';
+            }
+            hasElements.back() = true;
+        }
+    }
+
+    std::string& out;
+    std::vector<bool> hasElements;  // 每层对象/数组是否已写入元素
+    bool afterKey;
+};
+
+#endif // JSON_WRITER_H
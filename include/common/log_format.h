@@ -0,0 +1,103 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * 二进制日志格式
+ *
+ * 文件以8字节魔数开头，之后是连续的记录（多字节字段均为本机字节序）：
+ *   length(4) | event(2) | level(1) | argCount(1) | timestamp(8) | threadId(4) |
+ *   requestId | clientIp | userId | operation | args
+ * length为整条记录的字节数，timestamp为单调时钟纳秒。上下文字段为uint16长度+内容，
+ * 每个参数为type(1)+内容：INT为int64，DOUBLE为8字节double，STRING为uint32长度+内容。
+ *
+ * 记录中只保存事件ID和参数，不保存渲染后的文本，文本由render()在解码时生成，
+ * 与文本格式日志的消息内容一致。每次打开文件先写一条ANCHOR记录，参数为同一时刻的
+ * 系统时间（纳秒）和进程名，解码时据此把单调时钟换算为日历时间。
+ */
+namespace LogFormat {
+    extern const char MAGIC[8];
+    const size_t MAGIC_SIZE = 8;
+    const size_t HEADER_SIZE = 20;                      // length到threadId
+    const size_t CONTEXT_FIELDS = 4;
+    const uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;  // 单条记录上限，超过视为文件损坏
+
+    // 事件ID，对应EnhancedLogger中固定格式的日志方法
+    enum EventId : uint16_t {
+        TEXT = 0,           // 普通消息：message
+        REQUEST = 1,        // logRequest：method, path, clientIp
+        RESPONSE = 2,       // logResponse：statusCode, message, responseTime
+        API_CALL = 3,       // logApiCall：apiType, operation, params
+        DATABASE = 4,       // logDatabase：operation, table, query, execTime
+        ERROR_DETAIL = 5,   // logError：errorType, errorMessage
+        PERFORMANCE = 6,    // logPerformance：operation, duration, details
+        SYSTEM = 7,         // logSystem：component, event, details
+        ANCHOR = 0xFFFF     // 时钟锚点：realtimeNanos, processName
+    };
+
+    struct Arg {
+        enum Type : uint8_t {
+            INT = 1,
+            DOUBLE = 2,
+            STRING = 3
+        };
+
+        Type type;
+        long long intValue;
+        double doubleValue;
+        std::string_view text;
+
+        Arg(long long value) : type(INT), intValue(value), doubleValue(0) {}
+        Arg(int value) : type(INT), intValue(value), doubleValue(0) {}
+        Arg(double value) : type(DOUBLE), intValue(0), doubleValue(value) {}
+        Arg(std::string_view value) : type(STRING), intValue(0), doubleValue(0), text(value) {}
+        Arg(const std::string& value) : Arg(std::string_view(value)) {}
+        Arg(const char* value) : Arg(std::string_view(value)) {}
+    };
+
+    struct Record {
+        uint16_t event;
+        int level;
+        int64_t timestamp;
+        uint32_t threadId;
+        std::string_view context[CONTEXT_FIELDS];  // requestId, clientIp, userId, operation
+        std::vector<Arg> args;
+    };
+
+    enum class DecodeResult {
+        COMPLETE,        // 解析出一条记录
+        INCOMPLETE,      // 数据不足
+        INVALID          // 长度或参数非法，文件已损坏
+    };
+
+    /**
+     * 编码一条记录并追加到out末尾
+     * @param context 4个上下文字段，依次为requestId, clientIp, userId, operation
+     */
+    void encode(std::string& out, uint16_t event, int level, int64_t timestamp, uint32_t threadId,
+                const std::string_view* context, const Arg* args, size_t count);
+
+    /**
+     * 从data开始处解析一条记录，record中的字符串指向data
+     * @param consumed 解析成功时为该记录占用的字节数
+     */
+    DecodeResult decode(const char* data, size_t size, Record& record, size_t& consumed);
+
+    // 按事件ID把参数渲染为与文本日志一致的消息内容
+    std::string render(uint16_t event, const Arg* args, size_t count);
+
+    const char* levelName(int level);
+    const char* eventName(uint16_t event);
+
+    // 单调时钟纳秒
+    int64_t monotonicNanos();
+    // 系统时间纳秒
+    int64_t realtimeNanos();
+}
+
+#endif // LOG_FORMAT_H
@@ -2,11 +2,16 @@
 #define LOGGER_ENHANCED_H
 
 #include <string>
-#include <fstream>
 #include <mutex>
 #include <memory>
 #include <thread>
 #include <map>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include "common/mpsc_queue.h"
+#include "common/log_format.h"
 
 enum class LogLevel {
     DEBUG,
@@ -16,6 +21,19 @@ enum class LogLevel {
     FATAL
 };
 
+// 异步模式下日志队列满时的处理方式
+enum class LogOverflowPolicy {
+    BLOCK,       // 等待写线程腾出空间
+    DROP,        // 丢弃新日志
+    DROP_DEBUG   // 只丢弃DEBUG日志，其他级别等待
+};
+
+// 日志文件格式
+enum class LogFileFormat {
+    TEXT,        // 逐行文本
+    BINARY       // 紧凑二进制记录，用logdecode工具转换为文本或JSON（见common/log_format.h）
+};
+
 // 日志上下文信息
 struct LogContext {
     std::string requestId;
@@ -29,16 +47,90 @@ struct LogContext {
         : requestId(reqId), clientIp(ip), userId(uid), operation(op) {}
 };
 
+/**
+ * 单个日志调用点的限流器
+ * 按GCRA（令牌桶的等价形式）计算：每秒最多放行perSecond条，允许一次突发perSecond条，
+ * 超出的只计数不输出，由EnhancedLogger定期汇总为一条WARNING。无锁，多线程共用一个实例。
+ * 由LOG_*_LIMITED宏以静态局部变量的形式为每个调用点创建
+ */
+class LogRateLimiter {
+public:
+    LogRateLimiter(const char* file, int line, int perSecond);
+    ~LogRateLimiter();
+    
+    bool allow();
+    
+    // 取出并清零被抑制的条数
+    uint64_t takeSuppressed() { return suppressed.exchange(0, std::memory_order_relaxed); }
+    
+    // 调用点，"文件名:行号"
+    const std::string& getSite() const { return site; }
+    
+private:
+    LogRateLimiter(const LogRateLimiter&) = delete;
+    LogRateLimiter& operator=(const LogRateLimiter&) = delete;
+    
+    std::string site;
+    int64_t interval;                      // 每条日志占用的时间（纳秒）
+    std::atomic<int64_t> theoreticalTime;  // 下一条日志的理论放行时间
+    std::atomic<uint64_t> suppressed;
+};
+
 class EnhancedLogger {
 public:
     static EnhancedLogger& getInstance();
     
     void setLogLevel(LogLevel level);
+    
+    // 该级别的日志是否会输出，日志宏据此决定是否求值消息参数
+    bool isEnabled(LogLevel level) const {
+        return level >= currentLevel.load(std::memory_order_relaxed);
+    }
+    
     void setLogFile(const std::string& filename);
     void setProcessName(const std::string& name);
     void enableConsoleOutput(bool enable);
     void enableColorOutput(bool enable);
     
+    // 设置日志文件格式，已打开的日志文件会换成对应格式的新文件
+    void setFileFormat(LogFileFormat format);
+    
+    /**
+     * 启用异步写日志：调用线程格式化后放入无锁队列立即返回，
+     * 由后台写线程批量用writev写出
+     * @param queueSize 队列容量（条）
+     * @param policy 队列满时的处理方式
+     */
+    void startAsync(size_t queueSize, LogOverflowPolicy policy);
+    
+    // 写出队列中剩余的日志并停止写线程，之后恢复同步写
+    void stopAsync();
+    
+    // 等待调用前产生的日志全部写出
+    void flush();
+    
+    // 因队列满被丢弃的日志条数
+    uint64_t getDroppedCount() const;
+    uint64_t getDroppedCount(LogLevel level) const;
+    
+    /**
+     * 请求日志采样：成功的LOG_REQUEST/LOG_RESPONSE每N个请求只输出1个，错误响应总是输出。
+     * 按请求ID的哈希决定，同一请求在DISP和AP中的请求、响应日志同时保留或同时跳过
+     * @param everyN 1表示全部输出
+     */
+    void setRequestSampling(int everyN);
+    bool sampleRequest(const std::string& requestId);
+    
+    // 限流和采样跳过的条数的汇总间隔（秒）
+    void setSuppressedReportInterval(int seconds);
+    
+    // 供LogRateLimiter登记/注销，用于定期汇总被抑制的条数
+    void registerLimiter(LogRateLimiter* limiter);
+    void unregisterLimiter(LogRateLimiter* limiter);
+    
+    // 解析配置中的队列满处理方式：block / drop / drop_debug
+    static bool parseOverflowPolicy(const std::string& value, LogOverflowPolicy& policy);
+    
     // 基础日志方法
     void debug(const std::string& message, const LogContext& context = LogContext());
     void info(const std::string& message, const LogContext& context = LogContext());
@@ -72,49 +164,162 @@ private:
     EnhancedLogger(const EnhancedLogger&) = delete;
     EnhancedLogger& operator=(const EnhancedLogger&) = delete;
     
+    // 格式化好的一条日志
+    struct LogRecord {
+        LogLevel level;
+        std::string text;      // 文本格式（不含换行），二进制格式且不输出到控制台时为空
+        std::string binary;    // 二进制格式的记录，文本格式时为空
+    };
+    
     void log(LogLevel level, const std::string& message, const LogContext& context = LogContext());
-    std::string getCurrentTime() const;
-    std::string levelToString(LogLevel level) const;
-    std::string levelToColorString(LogLevel level) const;
+    void logEvent(LogLevel level, uint16_t event, const LogFormat::Arg* args, size_t count,
+                  const LogContext& context);
+    void makeRecord(LogRecord& record, LogLevel level, uint16_t event,
+                    const LogFormat::Arg* args, size_t count, const LogContext& context);
+    void enqueue(LogRecord& record);
+    void writerLoop();
+    void wakeWriter();
+    // 写出一批日志，调用方需持有logMutex
+    void writeRecords(const LogRecord* records, size_t count);
+    void reportDropped();
+    // 到了汇总时间时取出限流和采样跳过的条数，生成汇总消息
+    bool collectSuppressed(std::vector<std::string>& messages);
+    // 追加"YYYY-MM-DD HH:MM:SS.mmm"格式的当前时间
+    void appendCurrentTime(std::string& out) const;
+    const char* levelToString(LogLevel level) const;
+    const char* levelToColorString(LogLevel level) const;
     std::string formatLogMessage(LogLevel level, const std::string& message, const LogContext& context) const;
+    bool openLogFile();
+    // 写入二进制日志的时钟锚点，调用方需持有logMutex
+    void writeAnchor();
     bool checkAndRotateLogFile();
     void createLogDirectory(const std::string& path);
     std::string generateLogFilename(const std::string& baseFilename);
-    std::string getThreadId() const;
+    const std::string& getThreadId() const;
     
-    LogLevel currentLevel;
-    std::ofstream logFile;
+    std::atomic<LogLevel> currentLevel;
+    int logFd;
+    size_t logFileSize;            // 当前日志文件大小，按写入字节累计，不逐条stat
     std::mutex logMutex;
     bool consoleOutput;
     bool colorOutput;
+    bool binaryFormat;
     std::string currentLogFilename;
     std::string logDirectory;
     std::string logBaseName;
     std::string processName;
     const size_t maxLogFileSize = 200 * 1024 * 1024; // 200MB
+    
+    // 异步模式
+    std::unique_ptr<MpscQueue<LogRecord>> queue;
+    std::thread writerThread;
+    std::atomic<bool> asyncMode;
+    std::atomic<int> asyncProducers;     // 已看到异步模式、尚未完成入队的线程数
+    std::atomic<bool> writerRunning;
+    std::atomic<bool> writerIdle;        // 写线程正在等待唤醒
+    std::atomic<size_t> writtenCount;    // 写线程已写出的条数
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    LogOverflowPolicy overflowPolicy;
+    std::atomic<uint64_t> droppedCounts[5];
+    uint64_t reportedDropped;            // 已经在日志中报告过的丢弃总数
+    
+    // 限流和采样
+    std::mutex limiterMutex;
+    std::vector<LogRateLimiter*> limiters;
+    std::atomic<int> requestSampleRate;
+    std::atomic<uint64_t> sampledOut;        // 采样跳过的请求日志条数
+    std::atomic<int64_t> nextSuppressedReport;
+    std::atomic<int64_t> suppressedReportInterval;  // 纳秒
 };
 
+// 编译期日志级别下限（对应LogLevel的值，0=DEBUG ... 4=FATAL），由CMake的LOG_MIN_LEVEL选项设置，
+// 低于该级别的日志语句条件恒为假，整条语句连同参数的构造在编译时被移除
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// 日志宏先判断级别，只有会输出时才求值消息参数，关闭的级别不产生字符串拼接开销
+#define LOG_ENABLED(level) \
+    (static_cast<int>(level) >= LOG_MIN_LEVEL && EnhancedLogger::getInstance().isEnabled(level))
+
+#define LOG_AT_LEVEL(level, call) \
+    do { \
+        if (LOG_ENABLED(level)) { \
+            EnhancedLogger::getInstance().call; \
+        } \
+    } while (0)
+
 // 便捷宏 - 增强版
-#define LOG_DEBUG_CTX(msg, ctx) EnhancedLogger::getInstance().debug(msg, ctx)
-#define LOG_INFO_CTX(msg, ctx) EnhancedLogger::getInstance().info(msg, ctx)
-#define LOG_WARNING_CTX(msg, ctx) EnhancedLogger::getInstance().warning(msg, ctx)
-#define LOG_ERROR_CTX(msg, ctx) EnhancedLogger::getInstance().error(msg, ctx)
-#define LOG_FATAL_CTX(msg, ctx) EnhancedLogger::getInstance().fatal(msg, ctx)
+#define LOG_DEBUG_CTX(msg, ctx) LOG_AT_LEVEL(LogLevel::DEBUG, debug(msg, ctx))
+#define LOG_INFO_CTX(msg, ctx) LOG_AT_LEVEL(LogLevel::INFO, info(msg, ctx))
+#define LOG_WARNING_CTX(msg, ctx) LOG_AT_LEVEL(LogLevel::WARNING, warning(msg, ctx))
+#define LOG_ERROR_CTX(msg, ctx) LOG_AT_LEVEL(LogLevel::ERROR, error(msg, ctx))
+#define LOG_FATAL_CTX(msg, ctx) LOG_AT_LEVEL(LogLevel::FATAL, fatal(msg, ctx))
 
 // 兼容性宏
-#define LOG_DEBUG(msg) EnhancedLogger::getInstance().debug(msg)
-#define LOG_INFO(msg) EnhancedLogger::getInstance().info(msg)
-#define LOG_WARNING(msg) EnhancedLogger::getInstance().warning(msg)
-#define LOG_ERROR(msg) EnhancedLogger::getInstance().error(msg)
-#define LOG_FATAL(msg) EnhancedLogger::getInstance().fatal(msg)
-
-// 专用日志宏
-#define LOG_REQUEST(reqId, method, path, ip) EnhancedLogger::getInstance().logRequest(reqId, method, path, ip)
-#define LOG_RESPONSE(reqId, code, msg, time) EnhancedLogger::getInstance().logResponse(reqId, code, msg, time)
-#define LOG_API_CALL(reqId, type, op, params) EnhancedLogger::getInstance().logApiCall(reqId, type, op, params)
-#define LOG_DATABASE(reqId, op, table, query, time) EnhancedLogger::getInstance().logDatabase(reqId, op, table, query, time)
-#define LOG_ERROR_DETAIL(reqId, type, msg, stack) EnhancedLogger::getInstance().logError(reqId, type, msg, stack)
-#define LOG_PERFORMANCE(op, duration, details) EnhancedLogger::getInstance().logPerformance(op, duration, details)
-#define LOG_SYSTEM(component, event, details) EnhancedLogger::getInstance().logSystem(component, event, details)
+#define LOG_DEBUG(msg) LOG_AT_LEVEL(LogLevel::DEBUG, debug(msg))
+#define LOG_INFO(msg) LOG_AT_LEVEL(LogLevel::INFO, info(msg))
+#define LOG_WARNING(msg) LOG_AT_LEVEL(LogLevel::WARNING, warning(msg))
+#define LOG_ERROR(msg) LOG_AT_LEVEL(LogLevel::ERROR, error(msg))
+#define LOG_FATAL(msg) LOG_AT_LEVEL(LogLevel::FATAL, fatal(msg))
+
+// 专用日志宏，级别与对应方法内部使用的级别一致
+#define LOG_API_CALL(reqId, type, op, params) \
+    LOG_AT_LEVEL(LogLevel::DEBUG, logApiCall(reqId, type, op, params))
+#define LOG_DATABASE(reqId, op, table, query, time) \
+    LOG_AT_LEVEL(LogLevel::DEBUG, logDatabase(reqId, op, table, query, time))
+#define LOG_ERROR_DETAIL(reqId, type, msg, stack) \
+    LOG_AT_LEVEL(LogLevel::ERROR, logError(reqId, type, msg, stack))
+#define LOG_SYSTEM(component, event, details) \
+    LOG_AT_LEVEL(LogLevel::INFO, logSystem(component, event, details))
+
+// 请求日志按setRequestSampling采样
+#define LOG_REQUEST(reqId, method, path, ip) \
+    do { \
+        if (LOG_ENABLED(LogLevel::INFO)) { \
+            const std::string& logRequestId_ = (reqId); \
+            if (EnhancedLogger::getInstance().sampleRequest(logRequestId_)) { \
+                EnhancedLogger::getInstance().logRequest(logRequestId_, method, path, ip); \
+            } \
+        } \
+    } while (0)
+
+// 响应状态码>=400时按ERROR输出且不参与采样，否则按INFO输出并采样
+#define LOG_RESPONSE(reqId, code, msg, time) \
+    do { \
+        int logStatusCode_ = (code); \
+        if (LOG_ENABLED(logStatusCode_ >= 400 ? LogLevel::ERROR : LogLevel::INFO)) { \
+            const std::string& logRequestId_ = (reqId); \
+            if (logStatusCode_ >= 400 || EnhancedLogger::getInstance().sampleRequest(logRequestId_)) { \
+                EnhancedLogger::getInstance().logResponse(logRequestId_, logStatusCode_, msg, time); \
+            } \
+        } \
+    } while (0)
+
+// 耗时超过1秒按WARNING输出，否则按DEBUG
+#define LOG_PERFORMANCE(op, duration, details) \
+    do { \
+        double logDuration_ = (duration); \
+        if (LOG_ENABLED(logDuration_ > 1000 ? LogLevel::WARNING : LogLevel::DEBUG)) { \
+            EnhancedLogger::getInstance().logPerformance(op, logDuration_, details); \
+        } \
+    } while (0)
+
+// 限流宏：该调用点每秒最多输出perSecond条，超出的计数后定期汇总输出（用于过载时可能刷屏的日志）
+#define LOG_LIMITED(level, perSecond, call) \
+    do { \
+        if (LOG_ENABLED(level)) { \
+            static LogRateLimiter logLimiter_(__FILE__, __LINE__, perSecond); \
+            if (logLimiter_.allow()) { \
+                EnhancedLogger::getInstance().call; \
+            } \
+        } \
+    } while (0)
+
+#define LOG_INFO_LIMITED(msg, perSecond) LOG_LIMITED(LogLevel::INFO, perSecond, info(msg))
+#define LOG_WARNING_LIMITED(msg, perSecond) LOG_LIMITED(LogLevel::WARNING, perSecond, warning(msg))
+#define LOG_ERROR_LIMITED(msg, perSecond) LOG_LIMITED(LogLevel::ERROR, perSecond, error(msg))
+#define LOG_WARNING_CTX_LIMITED(msg, ctx, perSecond) LOG_LIMITED(LogLevel::WARNING, perSecond, warning(msg, ctx))
 
 #endif // LOGGER_ENHANCED_H
\ No newline at end of file
@@ -0,0 +1,317 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * 运行指标：计数器、仪表和延迟直方图，按Prometheus文本格式导出
+ *
+ * 更新指标只做relaxed原子加法。计数器和直方图按线程分片，每个分片独占缓存行，
+ * 多个反应堆和工作线程同时更新时不争用同一缓存行，导出时再把各分片相加。
+ * 指标族在启动时注册，注册后地址不变，调用方保存引用反复使用；
+ * 带标签的指标族按标签值无锁查找，只有第一次出现的标签值需要加锁创建。
+ */
+
+const size_t METRIC_SHARDS = 8;
+
+// 当前线程使用的分片，线程第一次更新指标时轮流分配
+inline size_t metricShardIndex() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+// 单调递增的计数器
+class Counter {
+public:
+    static const char* const TYPE_NAME;
+
+    Counter();
+
+    void inc(uint64_t count = 1) {
+        shards[metricShardIndex()].value.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const;
+
+    void appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value;
+    };
+
+    Shard shards[METRIC_SHARDS];
+};
+
+// 可增可减的当前值，如活跃连接数、队列深度
+class Gauge {
+public:
+    static const char* const TYPE_NAME;
+
+    void set(int64_t value) { current.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { current.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+    void appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const;
+
+private:
+    std::atomic<int64_t> current{0};
+};
+
+/**
+ * 延迟直方图（单位微秒）
+ * 桶按对数线性划分：小于8微秒每微秒一个桶，之后每个2的幂区间平分为8个桶，
+ * 相对误差不超过12.5%，覆盖到约19小时。导出时折算到固定的秒级边界（le）
+ */
+class Histogram {
+public:
+    static const char* const TYPE_NAME;
+    static const size_t SUB_BUCKETS = 8;
+    static const size_t MAX_EXPONENT = 35;  // 超过2^36微秒的值计入最后一个桶
+    static const size_t BUCKETS = (MAX_EXPONENT - 1) * SUB_BUCKETS;
+
+    Histogram();
+
+    void observeMicros(uint64_t micros) {
+        Shard& shard = shards[metricShardIndex()];
+        shard.buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    template <typename Rep, typename Period>
+    void observe(std::chrono::duration<Rep, Period> elapsed) {
+        long long micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        observeMicros(micros > 0 ? static_cast<uint64_t>(micros) : 0);
+    }
+
+    // 各分片相加后的结果，分片之间不是同一时刻的快照，导出用足够
+    struct Snapshot {
+        uint64_t buckets[BUCKETS];
+        uint64_t count;
+        uint64_t sumMicros;
+    };
+
+    void snapshot(Snapshot& result) const;
+
+    static size_t bucketIndex(uint64_t micros) {
+        if (micros < SUB_BUCKETS) {
+            return static_cast<size_t>(micros);
+        }
+        size_t exponent = 63 - __builtin_clzll(micros);
+        if (exponent > MAX_EXPONENT) {
+            return BUCKETS - 1;
+        }
+        return (exponent - 2) * SUB_BUCKETS + ((micros >> (exponent - 3)) & (SUB_BUCKETS - 1));
+    }
+
+    // 桶的上界（不含）
+    static uint64_t bucketUpperBound(size_t index);
+
+    void appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> buckets[BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+};
+
+// 在作用域结束时把经过的时间记入直方图
+class HistogramTimer {
+public:
+    explicit HistogramTimer(Histogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+    ~HistogramTimer() { histogram.observe(std::chrono::steady_clock::now() - start); }
+
+    HistogramTimer(const HistogramTimer&) = delete;
+    HistogramTimer& operator=(const HistogramTimer&) = delete;
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+class MetricFamilyBase {
+public:
+    MetricFamilyBase(std::string name, std::string help, std::string labelName)
+        : name(std::move(name)), help(std::move(help)), labelName(std::move(labelName)) {}
+    virtual ~MetricFamilyBase() = default;
+
+    const std::string& getName() const { return name; }
+    const std::string& getHelp() const { return help; }
+    virtual const char* getType() const = 0;
+
+    // 输出该指标族所有序列的样本行（不含HELP和TYPE）
+    virtual void appendSamples(std::string& out) const = 0;
+
+protected:
+    // 按Prometheus格式转义标签值，返回"name=\"value\""
+    std::string formatLabel(std::string_view value) const;
+
+    const std::string name;
+    const std::string help;
+    const std::string labelName;  // 为空表示不带标签
+};
+
+/**
+ * 同名指标按一个标签区分的一组序列（如按路由区分的请求耗时）
+ * 标签值存放在开放寻址表中，序列创建后不再移动也不删除，查找时只读原子指针。
+ * 标签值超过MAX_SERIES个时，新出现的值都计入"other"序列，避免标签基数失控
+ */
+template <typename T>
+class MetricFamily : public MetricFamilyBase {
+public:
+    static const size_t MAX_SERIES = 64;
+
+    MetricFamily(std::string name, std::string help, std::string labelName)
+        : MetricFamilyBase(std::move(name), std::move(help), std::move(labelName)) {
+        for (auto& slot : slots) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // 不带标签的指标
+    T& get() { return get(std::string_view()); }
+
+    T& get(std::string_view labelValue) {
+        size_t hash = std::hash<std::string_view>()(labelValue);
+        for (size_t i = 0; i < SLOTS; ++i) {
+            Series* series = slots[(hash + i) & (SLOTS - 1)].load(std::memory_order_acquire);
+            if (!series) {
+                break;
+            }
+            if (series->value == labelValue) {
+                return series->metric;
+            }
+        }
+        return create(labelValue, hash);
+    }
+
+    const char* getType() const override { return T::TYPE_NAME; }
+
+    void appendSamples(std::string& out) const override {
+        std::vector<const Series*> sorted;
+        {
+            std::lock_guard<std::mutex> lock(createMutex);
+            for (const auto& series : allSeries) {
+                sorted.push_back(series.get());
+            }
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Series* a, const Series* b) {
+            return a->value < b->value;
+        });
+        for (const Series* series : sorted) {
+            series->metric.appendPrometheus(out, name, series->labels);
+        }
+    }
+
+private:
+    static const size_t SLOTS = MAX_SERIES * 2;  // 装载率不超过一半，查找必然遇到空槽结束
+
+    struct Series {
+        std::string value;
+        std::string labels;
+        T metric;
+    };
+
+    T& create(std::string_view labelValue, size_t hash) {
+        std::lock_guard<std::mutex> lock(createMutex);
+
+        size_t freeSlot = SLOTS;
+        for (size_t i = 0; i < SLOTS; ++i) {
+            size_t index = (hash + i) & (SLOTS - 1);
+            Series* series = slots[index].load(std::memory_order_relaxed);
+            if (!series) {
+                freeSlot = index;
+                break;
+            }
+            if (series->value == labelValue) {
+                return series->metric;  // 其他线程刚刚创建
+            }
+        }
+
+        if (allSeries.size() >= MAX_SERIES) {
+            if (!overflow) {
+                overflow = newSeries("other");
+            }
+            return overflow->metric;
+        }
+
+        Series* series = newSeries(labelValue);
+        slots[freeSlot].store(series, std::memory_order_release);
+        return series->metric;
+    }
+
+    // 调用方持有createMutex
+    Series* newSeries(std::string_view labelValue) {
+        std::unique_ptr<Series> series(new Series());
+        series->value.assign(labelValue.data(), labelValue.size());
+        if (!labelName.empty()) {
+            series->labels = formatLabel(labelValue);
+        }
+        allSeries.push_back(std::move(series));
+        return allSeries.back().get();
+    }
+
+    std::atomic<Series*> slots[SLOTS];
+    mutable std::mutex createMutex;
+    std::vector<std::unique_ptr<Series>> allSeries;  // 拥有所有序列，受createMutex保护
+    Series* overflow = nullptr;
+};
+
+/**
+ * 指标注册表
+ * 同名指标重复注册返回同一个指标族（类型不同时抛出std::logic_error）。
+ * 导出前先调用采集函数，用于把连接数、队列深度这类已有的状态同步到仪表
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance();
+
+    MetricFamily<Counter>& counter(const std::string& name, const std::string& help,
+                                   const std::string& labelName = "");
+    MetricFamily<Gauge>& gauge(const std::string& name, const std::string& help,
+                               const std::string& labelName = "");
+    MetricFamily<Histogram>& histogram(const std::string& name, const std::string& help,
+                                       const std::string& labelName = "");
+
+    // 注册导出前调用的采集函数
+    void addCollector(std::function<void()> collector);
+
+    // Prometheus文本格式（text/plain; version=0.0.4）
+    std::string exportPrometheus();
+
+    static const char* const CONTENT_TYPE;
+
+private:
+    MetricsRegistry() = default;
+    ~MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    template <typename T>
+    MetricFamily<T>& getOrCreate(const std::string& name, const std::string& help, const std::string& labelName);
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<MetricFamilyBase>> families;   // 按注册顺序导出
+    std::vector<std::function<void()>> collectors;
+};
+
+#endif // METRICS_H
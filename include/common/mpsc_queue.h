@@ -0,0 +1,97 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 有界多生产者单消费者无锁队列
+ * 每个槽位带一个序号：序号等于入队位置时槽位空闲，等于入队位置+1时数据可读。
+ * 生产者用CAS抢占入队位置，消费者只有一个，出队位置不需要原子操作。
+ * 容量向上取整为2的幂
+ */
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t requestedCapacity)
+        : capacity(roundUp(requestedCapacity)), mask(capacity - 1),
+          slots(new Slot[capacity]), enqueuePos(0), dequeuePos(0) {
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 队列已满时返回false，value保持不变
+    bool tryPush(T& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->value = std::move(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由消费者线程调用，队列为空（或队首槽位还在写入）时返回false
+    bool tryPop(T& value) {
+        Slot* slot = &slots[dequeuePos & mask];
+        if (slot->sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+            return false;
+        }
+
+        value = std::move(slot->value);
+        slot->sequence.store(dequeuePos + capacity, std::memory_order_release);
+        ++dequeuePos;
+        return true;
+    }
+
+    // 已入队的元素总数（包括已出队的），用于等待消费者处理到某个位置
+    size_t pushedCount() const { return enqueuePos.load(std::memory_order_acquire); }
+
+    // 已出队的元素总数，只能由消费者线程调用；小于pushedCount()而tryPop失败说明队首槽位还在写入
+    size_t poppedCount() const { return dequeuePos; }
+
+    size_t getCapacity() const { return capacity; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUp(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    // 生产者和消费者的位置分开放在不同缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;
+};
+
+#endif // MPSC_QUEUE_H
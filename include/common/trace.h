@@ -0,0 +1,156 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+struct HttpRequest;
+
+/**
+ * 请求追踪
+ *
+ * 一次请求在本进程内经过的各个阶段记录为span（名称、起止时间、附加信息），按请求ID归为一条追踪。
+ * DISP生成请求ID并随请求发给AP，两边各自记录本进程内的阶段：
+ *   DISP: http.parse, route, ap.connect, ap.wait, serialize, http.write
+ *   AP:   ap.queue, ap.parse, ap.handler, db.acquire, db.select, db.execute, ap.serialize
+ * 请求结束时总耗时超过阈值的追踪保存在有界环形缓冲区中，通过/api/admin/traces导出为JSON
+ * 或Chrome trace-event格式（chrome://tracing、Perfetto）。导出时间戳换算为日历时间，
+ * DISP和AP导出的事件合并后落在同一条时间线上。
+ *
+ * 一条追踪同一时刻只由一个线程更新：DISP中挂在客户端连接上由反应堆线程更新，
+ * AP中由处理请求的工作线程通过Trace::current()访问。
+ */
+class Trace {
+public:
+    struct Span {
+        const char* name;        // 阶段名称，必须是静态字符串
+        int64_t start;           // 单调时钟纳秒
+        int64_t end;
+        uint32_t threadId;
+        std::string detail;      // 附加信息，如请求类型、SQL
+    };
+
+    static const size_t MAX_DETAIL = 200;
+
+    explicit Trace(int64_t start = now());
+
+    // 单调时钟纳秒
+    static int64_t now();
+
+    void setRequestId(const std::string& id) { requestId = id; }
+    const std::string& getRequestId() const { return requestId; }
+
+    void addSpan(const char* name, int64_t spanStart, int64_t spanEnd, std::string_view detail = std::string_view());
+
+    // 记下结束时间并把span按开始时间排序（嵌套的span结束得早，记录顺序与开始顺序不同），提交前调用
+    void finish();
+
+    int64_t getStart() const { return start; }
+    int64_t getDuration() const { return end - start; }
+    // 单调时钟时间换算为系统时间（纳秒）
+    int64_t toWallTime(int64_t monotonic) const { return wallStart + (monotonic - start); }
+    const std::vector<Span>& getSpans() const { return spans; }
+
+    // 当前线程正在处理的追踪，没有时为nullptr
+    static Trace* current();
+
+private:
+    friend class CurrentTrace;
+    static void setCurrent(Trace* trace);
+
+    std::string requestId;
+    int64_t start;
+    int64_t end;
+    int64_t wallStart;           // start时刻对应的系统时间
+    std::vector<Span> spans;
+};
+
+// 在作用域内把trace设为当前线程的追踪，结束时恢复
+class CurrentTrace {
+public:
+    explicit CurrentTrace(Trace* trace) : previous(Trace::current()) { Trace::setCurrent(trace); }
+    ~CurrentTrace() { Trace::setCurrent(previous); }
+
+    CurrentTrace(const CurrentTrace&) = delete;
+    CurrentTrace& operator=(const CurrentTrace&) = delete;
+
+private:
+    Trace* previous;
+};
+
+// 作用域结束时把经过的时间记为一个span，trace为nullptr（未启用追踪）时只有一次判断
+class ScopedSpan {
+public:
+    ScopedSpan(Trace* trace, const char* name, std::string_view detail = std::string_view());
+
+    // 记录到当前线程的追踪
+    explicit ScopedSpan(const char* name, std::string_view detail = std::string_view())
+        : ScopedSpan(Trace::current(), name, detail) {}
+
+    ~ScopedSpan();
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+private:
+    Trace* trace;
+    const char* name;
+    int64_t start;
+    std::string detail;
+};
+
+/**
+ * 慢请求追踪收集器
+ * 保存最近capacity条总耗时超过阈值的追踪，写满后覆盖最旧的一条
+ */
+class TraceCollector {
+public:
+    static TraceCollector& getInstance();
+
+    void configure(const std::string& processName, bool enabled, int slowThresholdMs, size_t capacity);
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // /api/admin/traces与业务接口在同一端口，会暴露请求ID、SQL文本和内部耗时，只有显式启用时才提供
+    void setAdminEnabled(bool enabled) { adminEnabled.store(enabled, std::memory_order_relaxed); }
+    bool isAdminEnabled() const { return adminEnabled.load(std::memory_order_relaxed); }
+
+    // 请求结束时调用，没有请求ID（如连接探测）或耗时低于阈值的追踪直接丢弃
+    void submit(std::unique_ptr<Trace> trace);
+
+    /**
+     * 处理/api/admin/traces请求
+     * 查询参数：format=chrome输出Chrome trace-event格式，request_id=...只输出该请求
+     */
+    std::string handleAdminRequest(const HttpRequest& request) const;
+
+    std::string exportJson(const std::string& requestId) const;
+    std::string exportChrome(const std::string& requestId) const;
+
+private:
+    TraceCollector() = default;
+    ~TraceCollector() = default;
+    TraceCollector(const TraceCollector&) = delete;
+    TraceCollector& operator=(const TraceCollector&) = delete;
+
+    // 按从新到旧的顺序取出匹配的追踪，requestId为空表示全部
+    std::vector<std::shared_ptr<const Trace>> collect(const std::string& requestId) const;
+
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> adminEnabled{false};
+    std::atomic<int64_t> slowThreshold{0};   // 纳秒
+
+    mutable std::mutex ringMutex;
+    std::string processName = "Unknown";
+    std::vector<std::shared_ptr<const Trace>> ring;
+    size_t capacity = 0;
+    size_t nextSlot = 0;
+};
+
+#endif // TRACE_H
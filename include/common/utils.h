@@ -29,6 +29,9 @@ namespace Utils {
     
     // JSON处理函数
     std::string escapeJson(const std::string& input);
+    
+    // URL处理函数：解码%XX和'+'（查询字符串中表示空格）
+    std::string urlDecode(const std::string& input);
 }
 
 #endif // UTILS_H
\ No newline at end of file
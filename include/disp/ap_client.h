@@ -0,0 +1,138 @@
+#ifndef AP_CLIENT_H
+#define AP_CLIENT_H
+
+#include "common/ap_protocol.h"
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 一次DISP→AP调用的上下文
+ * 由RequestHandler准备，由服务器（同步或在事件循环中异步）完成
+ */
+struct ApCall {
+    std::string requestId;           // 请求ID
+    std::string clientIp;            // 客户端IP
+    std::string path;                // 请求路径
+    std::string requestType;         // AP请求类型，如order.get
+    std::string host;                // AP地址
+    int port;                        // AP端口
+    uint32_t wireId;                 // 帧请求ID，AP响应帧据此与请求对应
+    std::string payload;             // 发往AP的请求JSON
+    std::string response;            // AP响应，失败时为错误JSON
+    bool success;                    // 调用是否成功
+    std::string errorType;           // 失败时的错误类型，如TimeoutError、ConnectionError
+    std::chrono::high_resolution_clock::time_point requestStart;  // 请求开始时间
+    std::chrono::high_resolution_clock::time_point apStart;       // AP调用开始时间
+
+    ApCall() : port(0), wireId(0), success(false) {}
+};
+
+/**
+ * AP客户端
+ * 封装与AP之间的socket操作和消息格式，同步调用和事件驱动调用共用相同的错误处理。
+ * 连接优先从ApConnectionPool中复用，消息使用ApProtocol长度前缀帧在长连接上区分边界；
+ * 协议版本配置为0时退回按行JSON，用于在AP升级之前先行发布DISP
+ */
+class ApClient {
+public:
+    // AP调用超时时间（秒）
+    static const int CALL_TIMEOUT_SEC = 5;
+    // 连接探测超时时间（毫秒）
+    static const int PROBE_TIMEOUT_MS = 1000;
+
+    /**
+     * 同步调用AP：取得连接、发送请求并读取完整响应，复用的连接失效时自动重连一次
+     * @return 调用是否成功，结果写入call.response
+     */
+    static bool forward(ApCall& call);
+
+    /**
+     * 取得到AP的连接：优先复用连接池中的空闲连接，否则发起非阻塞连接
+     * @param reused 输出参数，是否为复用的（已建立的）连接
+     * @return 非阻塞socket，失败返回-1并设置错误响应
+     */
+    static int openConnection(ApCall& call, bool& reused);
+
+    /**
+     * 发起非阻塞连接
+     * @return 非阻塞socket（连接可能仍在进行中），失败返回-1并设置错误响应
+     */
+    static int connectNonBlocking(ApCall& call);
+
+    /**
+     * 检查非阻塞连接是否已成功建立
+     */
+    static bool checkConnected(ApCall& call, int sockfd);
+
+    /**
+     * 将完成请求的连接归还连接池
+     */
+    static void releaseConnection(const ApCall& call, int sockfd);
+
+    /**
+     * 设置与AP通信的协议版本
+     * @param version 0为按行JSON（兼容旧版AP），其余取ApProtocol::VERSION
+     */
+    static void setProtocolVersion(int version);
+
+    /**
+     * 是否使用旧版按行JSON协议
+     */
+    static bool isLineProtocol();
+
+    /**
+     * 编码发往AP的请求，为调用分配帧请求ID
+     */
+    static std::string encodeRequest(ApCall& call,
+                                     ApProtocol::FrameType type = ApProtocol::FrameType::REQUEST);
+
+    /**
+     * 从接收缓冲区中取出调用的响应，已解析的数据从缓冲区中移除
+     * @return COMPLETE时响应写入call.response（AP返回协议错误时call.success为false），
+     *         INVALID表示数据无法解析或请求ID不匹配，连接不可再用
+     */
+    static ApProtocol::DecodeResult decodeResponse(ApCall& call, std::string& buffer);
+
+    /**
+     * 缓冲区开头是否已是本次调用的完整响应帧头部（负载可能尚未到达），
+     * 是则返回负载长度，供调用方决定是否边接收边转发。按行协议下总是返回false
+     */
+    static bool peekResponseLength(const ApCall& call, const std::string& buffer, uint32_t& length);
+
+    /**
+     * 在空闲连接上发送探测请求并等待响应
+     */
+    static bool probe(int sockfd);
+
+    /**
+     * 调用结果对应的HTTP状态码：成功200，AP繁忙拒绝503，AP调用超时504，其他失败（连接、协议、接收错误）502
+     */
+    static int httpStatus(const ApCall& call);
+
+    /**
+     * 记录调用失败并设置返回给客户端的错误响应
+     */
+    static void fail(ApCall& call, const std::string& errorType, const std::string& message,
+                     const std::string& details, const std::string& errorResponse);
+
+private:
+    ApClient() = delete;  // 静态工具类，禁止实例化
+
+    // 单次请求/响应交换的结果
+    enum class ExchangeResult {
+        SUCCESS,     // 收到完整响应
+        RETRY,       // 复用的连接已失效，可以换新连接重试
+        FAILED       // 调用失败，错误响应已设置
+    };
+
+    static ExchangeResult exchange(ApCall& call, ApProtocol::FrameType type, int sockfd, bool reused,
+                                   bool& reusable, std::chrono::steady_clock::time_point deadline);
+    static bool waitFor(int sockfd, short events, std::chrono::steady_clock::time_point deadline);
+
+    static std::atomic<int> protocolVersion;     // 与AP通信的协议版本
+    static std::atomic<uint32_t> nextWireId;     // 帧请求ID计数器
+};
+
+#endif // AP_CLIENT_H
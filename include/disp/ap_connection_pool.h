@@ -0,0 +1,78 @@
+#ifndef AP_CONNECTION_POOL_H
+#define AP_CONNECTION_POOL_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+
+/**
+ * DISP→AP长连接池
+ * 按端点（host:port）缓存空闲的非阻塞连接，取出时做存活检查，
+ * 后台线程负责回收超时空闲连接并对长时间未使用的连接发送探测请求
+ */
+class ApConnectionPool {
+public:
+    static ApConnectionPool& getInstance();
+
+    /**
+     * 设置连接池参数
+     * @param maxIdle 每个端点最多保留的空闲连接数
+     * @param idleTimeoutSec 空闲连接超过该时间后关闭
+     * @param probeIntervalSec 空闲连接超过该时间未使用时发送探测请求
+     */
+    void configure(int maxIdle, int idleTimeoutSec, int probeIntervalSec);
+
+    // 启动/停止后台维护线程
+    void startMaintenance();
+    void stopMaintenance();
+
+    /**
+     * 取出一个可用的空闲连接
+     * @return 已通过存活检查的非阻塞socket，没有可用连接时返回-1
+     */
+    int acquire(const std::string& host, int port);
+
+    /**
+     * 归还一个已完成请求、可以继续复用的连接
+     */
+    void release(const std::string& host, int port, int fd);
+
+    // 当前空闲连接总数
+    size_t idleCount() const;
+
+private:
+    ApConnectionPool();
+    ~ApConnectionPool();
+    ApConnectionPool(const ApConnectionPool&) = delete;
+    ApConnectionPool& operator=(const ApConnectionPool&) = delete;
+
+    struct IdleConnection {
+        int fd;
+        time_t lastUsed;             // 最后一次处理请求的时间，空闲超时从此计算，探测不更新
+        time_t lastProbed;           // 最后一次放回或探测成功的时间
+    };
+
+    static std::string endpointKey(const std::string& host, int port);
+    bool isAlive(int fd) const;
+    void maintenanceLoop();
+    void maintain();
+
+    std::unordered_map<std::string, std::vector<IdleConnection>> idle;
+    mutable std::mutex poolMutex;
+
+    int maxIdlePerEndpoint;
+    int idleTimeout;
+    int probeInterval;
+
+    std::thread maintenanceThread;
+    std::atomic<bool> maintaining;
+    std::mutex maintenanceMutex;
+    std::condition_variable maintenanceCv;
+};
+
+#endif // AP_CONNECTION_POOL_H
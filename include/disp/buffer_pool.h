@@ -0,0 +1,36 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/**
+ * 按容量分档的缓冲区池
+ * 连接的读写缓冲区在空闲（等待下一个请求、延迟关闭、连接关闭）时归还，需要时再取出，
+ * 空闲的长连接不占用缓冲区内存。每档保留的缓冲区数量有上限，超出上限或容量超过最大一档两倍的
+ * 缓冲区（大请求体、未流式转发的大响应）直接释放，池占用的内存有确定的上界。
+ * 每个反应堆一个，只在反应堆线程中使用，不加锁
+ */
+class BufferPool {
+public:
+    static const size_t CLASS_COUNT = 3;
+    static const size_t CLASS_SIZES[CLASS_COUNT];      // 4KB、16KB、64KB
+    static const size_t CLASS_LIMITS[CLASS_COUNT];     // 每档最多保留的缓冲区数
+
+    BufferPool();
+
+    // 保证缓冲区容量不小于minCapacity：优先取池中合适档位的缓冲区，已有内容会保留
+    void acquire(std::string& buffer, size_t minCapacity);
+
+    // 清空并归还缓冲区，之后buffer不再占用堆内存
+    void release(std::string& buffer);
+
+    size_t pooledBytes() const { return bytes; }
+
+private:
+    std::vector<std::string> pools[CLASS_COUNT];
+    size_t bytes;                    // 池中缓冲区的总容量
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,100 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * 按fd索引的连接对象池
+ * 连接对象按块（SLAB_SIZE个）分配，关闭后放回空闲列表，下次接受连接时调用reset(fd)复用，
+ * 对象内部已分配的存储（如解析器的头部数组）随对象保留，接受连接时不再分配内存。
+ * 查找直接以fd为下标访问数组，不做哈希。对象块只增不减，占用内存由连接数峰值决定。
+ * T需要可默认构造并提供reset(int fd)。每个反应堆一个，只在反应堆线程中使用，不加锁
+ */
+template <typename T>
+class ConnectionPool {
+public:
+    static const size_t SLAB_SIZE = 64;
+
+    ConnectionPool() : count(0) {}
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // 取出一个对象并登记到fd下
+    T* acquire(int fd) {
+        if (freeList.empty()) {
+            grow();
+        }
+        T* conn = freeList.back();
+        freeList.pop_back();
+        conn->reset(fd);
+
+        size_t index = static_cast<size_t>(fd);
+        if (index >= table.size()) {
+            table.resize(std::max(index + 1, table.size() * 2), nullptr);
+        }
+        table[index] = conn;
+        ++count;
+        return conn;
+    }
+
+    // 取消fd的登记并归还对象，对象持有的外部资源由调用方先行释放
+    bool release(int fd) {
+        T* conn = find(fd);
+        if (!conn) {
+            return false;
+        }
+        table[fd] = nullptr;
+        freeList.push_back(conn);
+        --count;
+        return true;
+    }
+
+    T* find(int fd) const {
+        size_t index = static_cast<size_t>(fd);
+        return fd >= 0 && index < table.size() ? table[index] : nullptr;
+    }
+
+    // 按fd顺序访问所有在用的对象，回调中不能增删对象
+    template <typename Func>
+    void forEach(Func func) const {
+        for (T* conn : table) {
+            if (conn) {
+                func(conn);
+            }
+        }
+    }
+
+    // 全部归还（对象保留在池中）
+    void clear() {
+        for (T*& conn : table) {
+            if (conn) {
+                freeList.push_back(conn);
+                conn = nullptr;
+            }
+        }
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slabs.size() * SLAB_SIZE; }
+
+private:
+    void grow() {
+        slabs.emplace_back(new T[SLAB_SIZE]);
+        T* slab = slabs.back().get();
+        // 倒序放入，先取出块中靠前的对象
+        for (size_t i = SLAB_SIZE; i-- > 0;) {
+            freeList.push_back(&slab[i]);
+        }
+    }
+
+    std::vector<std::unique_ptr<T[]>> slabs;
+    std::vector<T*> freeList;
+    std::vector<T*> table;           // 下标为fd
+    size_t count;
+};
+
+#endif // CONNECTION_POOL_H
@@ -0,0 +1,128 @@
+#ifndef HTTP_DISPATCHER_H
+#define HTTP_DISPATCHER_H
+
+#include "disp/iserver.h"
+#include "common/metrics.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 客户端连接状态
+enum class ClientState {
+    READING_REQUEST,    // 正在读取请求
+    PROCESSING,         // 正在处理请求
+    WRITING_RESPONSE,   // 正在写入响应
+    CLOSING             // 最后一个响应已发出，等待客户端关闭（丢弃后续数据）
+};
+
+/**
+ * 事件驱动服务器（EpollServer、IoUringServer）共用的协议层逻辑
+ * 路由匹配和处理函数调用、长连接的保持和Connection头部、各阶段的超时规则、AP转发的准备和结果
+ * 在这里统一决定，服务器只负责按各自的IO方式收发数据。路由和配置在启动前设置，运行期间只读，
+ * 各反应堆线程可以同时使用
+ */
+class HttpDispatcher {
+public:
+    // 路由：本地路由只设置handler，转发路由只设置prepare和complete
+    struct Route {
+        IServer::RequestHandler handler;
+        std::string contentType;
+        IServer::ForwardPrepare prepare;
+        IServer::ForwardComplete complete;
+    };
+
+    // 待发送的响应：状态行片段取自HttpResponse，contentType指向路由表或常量（空字符串表示不发送）
+    struct Response {
+        const std::string* statusBlock;
+        int statusCode;
+        std::string content;
+        const std::string* contentType;
+
+        Response(int status = 200, std::string body = std::string(), const std::string* type = &JSON_TYPE);
+        static Response options();    // OPTIONS预检响应
+    };
+
+    // 请求处理结果：route非空时需要调用AP（转发路由），否则直接发送response
+    struct Dispatch {
+        const Route* route = nullptr;
+        RouteParams params;
+        Response response;
+    };
+
+    static const std::string JSON_TYPE;      // "application/json"
+    static const int LINGER_TIMEOUT = 2;     // 延迟关闭时最多等待客户端关闭的秒数
+
+    /**
+     * @param serverName 服务器名称，用于日志
+     */
+    explicit HttpDispatcher(const std::string& serverName);
+
+    // 路由注册
+    void addRoute(const std::string& pattern, IServer::RequestHandler handler, const std::string& contentType);
+    void addForwardRoute(const std::string& method, const std::string& pattern,
+                         IServer::ForwardPrepare prepare, IServer::ForwardComplete complete);
+
+    // 超时和长连接配置，含义见IServer
+    void setTimeout(int timeoutSec);
+    void setHeaderTimeout(int timeoutSec);
+    void setKeepAlive(int idleTimeoutSec, int maxRequests);
+    int connectionTimeout() const { return writeTimeout; }
+    int headerTimeout() const { return requestHeaderTimeout; }
+
+    // 客户端要求保持连接（HTTP/1.1默认）时，未达到单连接请求数上限且服务器未在停止则保持
+    bool keepAlive(const HttpRequest& request, int requestCount, bool running) const;
+
+    // 最后一个响应发出后还有未处理的数据或客户端要求保持连接时延迟关闭：直接关闭会因接收缓冲区
+    // 有未读数据而发送RST，客户端可能丢失尚未读取的响应
+    static bool shouldLinger(const std::string& readBuffer, const HttpParser& parser);
+
+    // 追加响应的动态头部（Content-Type、Date、连接方式和Content-Length）
+    void appendHeaders(std::string& out, const Response& response, bool keepAlive) const;
+
+    // 按keepAlive选择Connection头部
+    const std::string& connectionHeader(bool keepAlive) const;
+
+    // 处理完整解析的请求：OPTIONS、未匹配的路由和本地路由直接得到响应，转发路由返回路由和参数
+    Dispatch dispatch(const HttpRequest& request) const;
+
+    // 格式错误的请求：剩余数据无法再按请求边界划分，调用方须在响应后关闭连接
+    static Response reject(const HttpParser& parser, int fd);
+
+    /**
+     * 准备AP调用：调用路由的prepare
+     * @return true表示需要调用AP（call已填充，开始时间已记录）；false表示response即为最终响应
+     */
+    static bool prepareForward(const Route& route, const HttpRequest& request, const RouteParams& params,
+                               ApCall& call, Response& response);
+
+    // AP调用结束后生成最终响应，AP不可用或超时时以502/504返回，负载均衡器据此感知AP故障
+    static Response completeForward(const IServer::ForwardComplete& complete, ApCall& call);
+
+    // 复用的连接可能已被AP关闭，尚未收到任何响应时换新连接重试一次
+    static bool shouldRetry(const ApCall& call, bool reused, bool received);
+
+    // AP调用到达截止时间
+    static void failTimeout(ApCall& call);
+
+    // 客户端连接当前阶段的超时（毫秒）；等待AP响应期间返回-1，超时由AP调用的截止时间控制
+    int64_t clientTimeoutMs(ClientState state, bool buffered) const;
+
+    // 统计并记录一次客户端超时，buffered为读缓冲区中是否有未处理的数据
+    void recordTimeout(ClientState state, bool buffered, int requestCount, bool headersComplete,
+                       int fd, int reactorId);
+
+private:
+    std::string name;
+    Router router;                      // 值为routeTable下标
+    std::vector<Route> routeTable;
+
+    int writeTimeout;                   // 发送响应的超时（秒）
+    int requestHeaderTimeout;           // 读取请求头部的超时（秒），慢速发送头部的连接到期关闭
+    int keepAliveTimeout;               // 长连接空闲超时（秒），0表示不保持连接
+    int maxKeepAliveRequests;           // 每个连接最多处理的请求数，0表示不限制
+    std::string keepAliveHeader;        // 保持连接时的Connection和Keep-Alive头部
+
+    MetricFamily<Counter>& connectionTimeouts;  // 按原因统计的超时关闭
+};
+
+#endif // HTTP_DISPATCHER_H
@@ -0,0 +1,58 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <string>
+#include <cstddef>
+#include <sys/types.h>
+
+struct iovec;
+
+/**
+ * HTTP响应的分段构造和发送
+ * 响应分为三段：按状态码预先生成的状态行和CORS头部（只读，所有连接共用）、每个响应生成的少量动态头部
+ * （Content-Type、Date、连接方式、Content-Length）以及处理函数返回的响应体（移入，不复制）。
+ * 三段以一次sendmsg（分散/聚集写）发出，较大的列表响应不再为拼接头部整体复制一次
+ */
+class HttpResponse {
+public:
+    // 一段待发送的数据，pos为该段已发送的字节数；data为空表示该段没有数据
+    struct Part {
+        const std::string* data;
+        size_t* pos;
+    };
+
+    // 状态行和CORS头部；常用状态码预先生成，其他状态码首次使用时生成（原因短语为Error或Unknown）
+    static const std::string& statusBlock(int statusCode);
+
+    // OPTIONS预检响应的状态行和CORS头部（含Access-Control-Max-Age）
+    static const std::string& optionsBlock();
+
+    // 当前时间的Date头部行，每秒生成一次，按线程缓存
+    static const std::string& dateHeader();
+
+    /**
+     * 追加动态头部：Content-Type（contentType为空时省略）、Date和连接方式
+     * @param connection 完整的连接头部行，如"Connection: close\r\n"
+     */
+    static void appendHeaders(std::string& out, const std::string& contentType, const std::string& connection);
+
+    // 追加Content-Length头部和结束头部的空行
+    static void appendContentLength(std::string& out, size_t length);
+
+    /**
+     * 以一次sendmsg发送各段剩余的数据，按实际发送的字节数推进各段的pos
+     * @return 发送的字节数，出错返回-1（errno由sendmsg设置）
+     */
+    static ssize_t send(int fd, const Part* parts, size_t count);
+
+    // 各段是否都已发送完毕
+    static bool complete(const Part* parts, size_t count);
+
+    // 把各段剩余的数据依次填入iov（最多maxIov项），返回使用的项数；供异步提交sendmsg的调用方使用
+    static size_t fillIov(const Part* parts, size_t count, struct iovec* iov, size_t maxIov);
+
+    // 按发送的字节数依次推进各段的pos
+    static void advance(const Part* parts, size_t count, size_t sent);
+};
+
+#endif // HTTP_RESPONSE_H
@@ -0,0 +1,146 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 系统头文件缺少多次接收（6.0）等接口时不编译io_uring服务器，ServerFactory改用EpollServer
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT)
+#define DISP_HAS_IO_URING 1
+#else
+#define DISP_HAS_IO_URING 0
+#endif
+
+#if DISP_HAS_IO_URING
+
+/**
+ * io_uring的最小封装
+ * 直接使用io_uring_setup/io_uring_enter/io_uring_register系统调用和共享内存环形队列，不依赖liburing。
+ * 提供提交队列项的获取与批量提交、完成队列的遍历、稀疏的注册文件表，以及接收用的缓冲区环
+ * （provided buffer ring：内核在数据到达时才从环中取缓冲区，空闲连接不占用接收缓冲区）。
+ * 每个实例只在一个线程中使用，不加锁
+ */
+class IoUring {
+public:
+    IoUring();
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * 创建环形队列
+     * @param entries 提交队列长度，完成队列为其cqMultiple倍（多次接收等请求会产生多个完成项）
+     * @return 失败返回false，error()给出原因
+     */
+    bool init(unsigned entries, unsigned cqMultiple = 4);
+    void destroy();
+
+    // 内核是否支持该操作码（IORING_OP_*）
+    bool supports(uint8_t opcode) const;
+    // 内核是否提供该特性（IORING_FEAT_*）
+    bool hasFeature(uint32_t feature) const { return (features & feature) != 0; }
+
+    // 取得一个已清零的提交队列项；队列已满时先提交再取，仍失败返回nullptr
+    struct io_uring_sqe* getSqe();
+
+    // 确保提交队列中至少有count个空位（链接的请求必须在同一次提交中），不足时先提交已填写的项
+    bool reserve(unsigned count);
+
+    // 提交已填写的提交队列项，返回提交的数量，出错返回负的errno
+    int submit();
+
+    /**
+     * 提交并等待至少一个完成项，最多等待timeoutMs毫秒（完成队列非空时不等待）
+     * @return 出错返回负的errno，超时和被信号中断返回0
+     */
+    int submitAndWait(int timeoutMs);
+
+    // 依次处理已到达的完成项，回调参数为const io_uring_cqe&，返回处理的数量
+    template <typename Callback>
+    unsigned forEachCqe(Callback onCqe);
+
+    // 注册count个空槽的文件表，接受连接时由内核分配槽位（IORING_FILE_INDEX_ALLOC）
+    bool registerSparseFiles(unsigned count);
+
+    /**
+     * 注册接收用的缓冲区环：count个（2的幂）大小为bufferSize的缓冲区，组号为groupId。
+     * 使用IOSQE_BUFFER_SELECT的接收请求从中取缓冲区，完成项flags的高16位为缓冲区编号
+     */
+    bool setupBufferRing(uint16_t groupId, unsigned count, unsigned bufferSize);
+    const char* buffer(uint16_t bufferId) const { return bufferBase + static_cast<size_t>(bufferId) * bufferSize; }
+    // 数据取出后把缓冲区放回环中
+    void recycleBuffer(uint16_t bufferId);
+
+    const std::string& error() const { return lastError; }
+
+private:
+    bool fail(const std::string& what, int err);
+
+    int ringFd;
+    uint32_t features;
+    std::string lastError;
+
+    // 映射的内存
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    // 提交队列
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned* sqArray;
+    unsigned sqeTail;                // 本地已填写的尾部，submit时发布给内核
+    unsigned sqeSubmitted;
+
+    // 完成队列
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+
+    // 支持的操作码（IORING_REGISTER_PROBE）
+    uint8_t opSupported[256];
+
+    // 缓冲区环，按io_uring_buf数组访问：内核头文件中io_uring_buf_ring的柔性数组在C++下偏移8字节，与内核布局不一致
+    struct io_uring_buf* bufRing;
+    size_t bufRingSize;
+    char* bufferBase;
+    size_t bufferAreaSize;
+    unsigned bufferSize;
+    unsigned bufferMask;
+    uint16_t bufferTail;
+};
+
+template <typename Callback>
+unsigned IoUring::forEachCqe(Callback onCqe) {
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    while (head != tail) {
+        // 回调中可能提交新请求，但不会读取完成队列，逐项推进头部即可
+        const struct io_uring_cqe& cqe = cqes[head & cqMask];
+        onCqe(cqe);
+        ++count;
+        ++head;
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        if (head == tail) {
+            tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        }
+    }
+    return count;
+}
+
+#endif // DISP_HAS_IO_URING
+
+#endif // IO_URING_H
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <functional>
+#include "disp/ap_client.h"
+#include "common/http_parser.h"
+#include "disp/router.h"
 
 /**
  * 服务器接口抽象类
@@ -17,14 +20,43 @@ public:
     virtual void stop() = 0;
     virtual bool isRunning() const = 0;
     
-    // 路由管理
-    using RequestHandler = std::function<std::string(const std::string&)>;
-    virtual void setRoute(const std::string& path, RequestHandler handler) = 0;
+    // 路由管理：模式格式见Router，如/api/order/{id}；本地路由匹配任意方法。
+    // 处理函数返回响应内容，默认按JSON返回。request和params指向连接的读缓冲区，只在调用期间有效
+    using RequestHandler = std::function<std::string(const HttpRequest& request, const RouteParams& params)>;
+    virtual void setRoute(const std::string& pattern, RequestHandler handler,
+                          const std::string& contentType = "application/json") = 0;
+    
+    // 转发路由（按方法注册）：prepare返回true表示需要调用AP（call已填充），否则content即为响应内容；
+    // AP调用结束后由complete生成最终响应内容。事件驱动实现在事件循环中异步完成AP调用
+    using ForwardPrepare = std::function<bool(const HttpRequest& request, const RouteParams& params,
+                                              std::string& content, ApCall& call)>;
+    using ForwardComplete = std::function<std::string(ApCall& call)>;
+    virtual void setForwardRoute(const std::string& method, const std::string& pattern,
+                                 ForwardPrepare prepare, ForwardComplete complete) = 0;
     
     // 服务器配置
     virtual void setMaxConnections(int maxConn) = 0;
     virtual void setTimeout(int timeoutSec) = 0;
     
+    // IO线程数（事件驱动实现的反应堆数量），默认实现忽略该配置
+    virtual void setIoThreads(int threads) { (void)threads; }
+    
+    // AP响应超过该字节数时以HTTP分块编码边接收边发送（0表示不启用），默认实现忽略该配置
+    virtual void setStreamThreshold(size_t bytes) { (void)bytes; }
+    
+    // HTTP长连接：空闲超时（秒，0表示每个请求后关闭连接）和每个连接最多处理的请求数（0表示不限制），
+    // 默认实现忽略该配置，每个请求后关闭连接
+    virtual void setKeepAlive(int idleTimeoutSec, int maxRequests) { (void)idleTimeoutSec; (void)maxRequests; }
+    
+    // 从连接建立或新请求的第一个字节开始，必须在该时间内收到完整的请求头部，默认实现忽略该配置
+    virtual void setHeaderTimeout(int timeoutSec) { (void)timeoutSec; }
+    
+    // io_uring实现：客户端连接放入注册文件表，提交请求时不再逐次查找和引用文件，默认实现忽略该配置
+    virtual void setRegisteredFiles(bool enabled) { (void)enabled; }
+    
+    // 线程池实现：处理连接的工作线程数和等待处理的连接数上限，默认实现忽略该配置
+    virtual void setWorkerPool(int threads, size_t queueLimit) { (void)threads; (void)queueLimit; }
+
     // 服务器信息
     virtual std::string getServerType() const = 0;
     virtual int getPort() const = 0;
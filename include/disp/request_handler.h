@@ -3,39 +3,51 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <unordered_map>
 #include <functional>
+#include "disp/ap_client.h"
+#include "common/http_parser.h"
+#include "disp/router.h"
+#include "common/metrics.h"
 
 class RequestHandler {
 public:
-    // HTTP请求结构体
-    struct HttpRequest {
-        std::string method;
-        std::string path;
-        std::string query;
-        std::string body;
-        std::unordered_map<std::string, std::string> headers;
+    // 转发到AP的路由：方法和路径模式直接确定AP服务和请求类型
+    struct ApRoute {
+        const char* method;
+        const char* pattern;       // 路由模式，同时作为请求耗时指标的route标签
+        const char* service;       // AP服务名，对应ap.endpoints.<service>
+        const char* requestType;   // AP请求类型，如order.get
     };
     
+    // 全部AP路由，由服务器按方法和模式注册
+    static const std::vector<ApRoute>& apRoutes();
+    
     static RequestHandler& getInstance();
     
     // 初始化处理器
     bool init();
     
-    // 处理请求
-    std::string handleRequest(const std::string& path, const std::string& requestData);
+    // 使用本地处理函数处理请求
+    std::string handleRequest(const std::string& path, const HttpRequest& request);
+    
+    // 准备AP请求：返回true表示需要转发到AP（call已填充），否则response即为响应内容
+    bool prepareRequest(const ApRoute& route, const HttpRequest& request, const RouteParams& params,
+                        std::string& response, ApCall& call);
+    
+    // AP调用结束后生成最终响应内容
+    std::string completeRequest(ApCall& call);
     
     // 注册处理函数
-    using HandlerFunc = std::function<std::string(const std::string&)>;
+    using HandlerFunc = std::function<std::string(const HttpRequest&)>;
     void registerHandler(const std::string& path, HandlerFunc handler);
     
-    // 转发请求到AP
-    std::string forwardToAp(const std::string& requestId, const std::string& apEndpoint,
-                           const std::string& requestType, const HttpRequest& httpRequest,
-                           const std::string& clientIp);
+    // 同步转发请求到AP
+    std::string forwardToAp(ApCall& call);
     
 private:
-    RequestHandler() = default;
+    RequestHandler();
     ~RequestHandler() = default;
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
@@ -44,25 +56,30 @@ private:
     std::string generateRequestId();
     
     // 提取客户端IP
-    std::string extractClientIp(const std::string& requestData);
+    std::string extractClientIp(const HttpRequest& request);
     
-    // 处理API请求
-    std::string handleApiRequest(const std::string& requestId, const std::string& path,
-                                const std::string& requestData, const std::string& clientIp);
+    // 请求开始和在DISP本地结束时的日志与指标，route为指标的route标签
+    void beginRequest(const std::string& route, const HttpRequest& httpRequest, ApCall& call);
+    void finishRequest(const ApCall& call, int statusCode);
     
-    // HTTP请求解析
-    HttpRequest parseHttpRequest(const std::string& request);
+    // 处理API请求：确定AP端点，返回false时response为错误信息
+    bool prepareApiRequest(const ApRoute& route, const HttpRequest& httpRequest, const RouteParams& params,
+                           std::string& response, ApCall& call);
     
-    // 确定请求类型的方法
-    std::string determineUserRequestType(const std::string& method, const std::string& path);
-    std::string determineOrderRequestType(const std::string& method, const std::string& path);
-    std::string determineProductRequestType(const std::string& method, const std::string& path);
+    // 构造发往AP的请求，路径参数无效时返回false
+    bool buildApCall(const std::string& apEndpoint, const HttpRequest& httpRequest, const RouteParams& params,
+                     std::string& response, ApCall& call);
     
     // 路径到处理函数的映射
     std::unordered_map<std::string, HandlerFunc> handlers;
     
     // AP服务地址映射
     std::unordered_map<std::string, std::string> apEndpoints;
+    
+    // 运行指标：路由模式和请求类型都来自路由表，标签取值是有限的
+    MetricFamily<Histogram>& requestDuration;   // 按路由
+    MetricFamily<Histogram>& apCallDuration;    // 按AP请求类型
+    MetricFamily<Counter>& apCallFailures;      // 按AP请求类型
 };
 
 #endif // REQUEST_HANDLER_H
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// 路由匹配得到的路径参数，名称和取值都指向路由表和请求路径，不复制
+class RouteParams {
+public:
+    static const size_t MAX_PARAMS = 4;
+
+    // 不存在时返回空
+    std::string_view get(std::string_view name) const {
+        for (size_t i = 0; i < count; ++i) {
+            if (params[i].name == name) {
+                return params[i].value;
+            }
+        }
+        return std::string_view();
+    }
+
+    size_t size() const { return count; }
+
+private:
+    friend class Router;
+
+    struct Param {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    Param params[MAX_PARAMS];
+    size_t count = 0;
+};
+
+/**
+ * 基数树路由
+ * 模式由静态部分和{name}参数组成，如/api/order/{id}/status，参数匹配一个非空路径段。
+ * 相同前缀的模式共用节点，查找沿请求路径逐段下降，耗时与路径长度成正比，不分配内存；
+ * 静态部分优先于参数，静态分支匹配失败时回退尝试参数分支。
+ * 每个模式可以按HTTP方法注册不同的值，方法"*"匹配任意方法（具体方法优先）。
+ * 路由在启动前注册，运行期间只读，多个线程可以同时查找
+ */
+class Router {
+public:
+    enum class MatchResult {
+        FOUND,
+        NOT_FOUND,
+        METHOD_NOT_ALLOWED     // 路径匹配但没有为该方法注册
+    };
+
+    /**
+     * 注册路由，value由调用方定义（通常是路由表下标）。同一方法和模式重复注册时覆盖。
+     * 模式格式错误、参数超过MAX_PARAMS个或同一位置的参数名称不同时抛出std::invalid_argument
+     */
+    void add(const std::string& method, const std::string& pattern, int value);
+
+    // 末尾的'/'忽略（根路径除外）
+    MatchResult match(std::string_view method, std::string_view path, int& value, RouteParams& params) const;
+
+private:
+    struct Node {
+        std::string prefix;                  // 静态边上的字符，参数节点为空
+        std::string paramName;               // 参数节点的参数名
+        std::string childFirst;              // 各静态子节点前缀的首字符，与children一一对应
+        std::vector<int> children;           // 静态子节点
+        int paramChild = -1;                 // 参数子节点
+        std::vector<std::pair<std::string, int>> methods;  // 在本节点结束的路由
+        int anyMethod = -1;                  // 方法"*"注册的值
+    };
+
+    int insertStatic(int node, std::string_view text);
+    int insertParam(int node, std::string_view name, const std::string& pattern);
+    bool matchNode(int node, std::string_view path, size_t pos, RouteParams& params, int& found) const;
+
+    std::vector<Node> nodes{Node()};         // nodes[0]为根节点
+};
+
+#endif // ROUTER_H
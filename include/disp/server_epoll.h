@@ -2,34 +2,104 @@
 #define SERVER_EPOLL_H
 
 #include "disp/iserver.h"
+#include "common/metrics.h"
+#include "common/trace.h"
+#include "disp/timer_wheel.h"
+#include "disp/connection_pool.h"
+#include "disp/buffer_pool.h"
+#include "disp/http_response.h"
+#include "disp/http_dispatcher.h"
 #include <string>
 #include <atomic>
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <thread>
 #include <sys/epoll.h>
 
-// 客户端连接状态
-enum class ClientState {
-    READING_REQUEST,    // 正在读取请求
-    PROCESSING,         // 正在处理请求
-    WRITING_RESPONSE,   // 正在写入响应
-    CLOSING             // 准备关闭
-};
-
-// 客户端连接信息
+// 客户端连接信息，对象由ConnectionPool复用
 struct ClientConnection {
     int fd;                          // 客户端socket文件描述符
     ClientState state;               // 连接状态
-    std::string readBuffer;          // 读缓冲区
-    std::string writeBuffer;         // 写缓冲区
+    std::string readBuffer;          // 读缓冲区（空闲时归还BufferPool）
+    HttpParser parser;               // 随数据到达增量解析readBuffer中的请求
+    // 响应分三段发送：预先生成的状态行和CORS头部、写缓冲区（动态头部或流式转发的分块数据）、响应体
+    const std::string* statusBlock;  // HttpResponse中共用的头部片段（nullptr表示没有）
+    size_t statusPos;                // 头部片段的发送位置
+    std::string writeBuffer;         // 写缓冲区（空闲时归还BufferPool）
     size_t writePos;                 // 写入位置
-    time_t lastActivity;             // 最后活动时间
-    bool keepAlive;                  // 是否保持连接
+    std::string body;                // 响应体，从处理函数移入
+    size_t bodyPos;                  // 响应体的发送位置
+    TimerWheel::Timer timer;         // 当前阶段的超时：读取请求、空闲长连接、发送响应或延迟关闭
+    bool keepAlive;                  // 当前请求的响应发送完毕后是否保持连接
+    int requestCount;                // 该连接上已收到的请求数
+    int upstreamFd;                  // 正在进行的AP调用socket（-1表示没有）
+    std::unique_ptr<Trace> trace;    // 当前转发请求的追踪（未启用追踪时为空）
+    int64_t writeStart;              // 开始发送响应的时间，用于追踪
+    
+    ClientConnection()
+        : fd(-1), state(ClientState::READING_REQUEST), statusBlock(nullptr), statusPos(0),
+          writePos(0), bodyPos(0), keepAlive(false), requestCount(0), upstreamFd(-1), writeStart(0) {}
+    
+    // 从对象池取出时重置为新连接，缓冲区在上一个连接关闭时已经归还
+    void reset(int clientFd) {
+        fd = clientFd;
+        state = ClientState::READING_REQUEST;
+        parser.reset();
+        statusBlock = nullptr;
+        statusPos = 0;
+        writePos = 0;
+        bodyPos = 0;
+        timer.fd = clientFd;
+        keepAlive = false;
+        requestCount = 0;
+        upstreamFd = -1;
+        trace.reset();
+        writeStart = 0;
+    }
+};
+
+// 上游AP连接：与客户端连接注册在同一个epoll实例中，
+// 客户端连接在AP响应到达前处于PROCESSING状态
+struct UpstreamConnection {
+    int fd;                                  // AP socket
+    int clientFd;                            // 等待该响应的客户端连接
+    ApCall call;                             // 调用上下文，响应写入call.response
+    const IServer::ForwardComplete* complete;  // 生成最终响应内容（指向路由表中的处理函数）
+    std::string writeBuffer;                 // 编码后的请求
+    size_t writePos;                         // 请求发送位置
+    std::string readBuffer;                  // 响应接收缓冲区
+    bool connected;                          // 连接是否已建立
+    bool reused;                             // 是否为连接池中复用的连接
+    TimerWheel::Timer deadline;              // 调用截止时间
+    bool streaming;                          // 响应正以分块编码边接收边转发给客户端
+    bool paused;                             // 客户端积压过多，暂停读取AP响应
+    uint32_t streamRemaining;                // 流式转发时尚未收到的负载字节数
+    Trace* trace;                            // 客户端连接上的追踪，客户端连接关闭前会先取消AP调用
+    int64_t phaseStart;                      // 当前阶段（连接、等待响应）的开始时间
+    
+    UpstreamConnection(int client, const IServer::ForwardComplete* completeFunc)
+        : fd(-1), clientFd(client), complete(completeFunc), writePos(0),
+          connected(false), reused(false),
+          streaming(false), paused(false), streamRemaining(0), trace(nullptr), phaseStart(0) {}
+};
+
+// 反应堆：每个反应堆拥有独立的epoll实例、监听socket和连接表，
+// 运行在自己的线程上，彼此之间不共享任何连接状态
+struct Reactor {
+    int id;                          // 反应堆编号
+    int epollFd;                     // epoll实例
+    int listenFd;                    // 监听socket（SO_REUSEPORT）
+    int wakeFd;                      // eventfd，用于stop()时唤醒epoll_wait
+    TimerWheel timers;               // 连接和AP调用的超时，须在连接表之前构造、之后析构
+    BufferPool buffers;              // 客户端连接的读写缓冲区
+    ConnectionPool<ClientConnection> clients;
+    std::unordered_map<int, std::unique_ptr<UpstreamConnection>> upstreams;  // 进行中的AP调用
+    std::atomic<int> connectionCount;  // 供其他线程读取的连接数
+    std::thread thread;              // 反应堆线程（0号反应堆运行在调用start()的线程上）
     
-    ClientConnection(int clientFd) 
-        : fd(clientFd), state(ClientState::READING_REQUEST), 
-          writePos(0), lastActivity(time(nullptr)), keepAlive(false) {}
+    Reactor(int reactorId)
+        : id(reactorId), epollFd(-1), listenFd(-1), wakeFd(-1), connectionCount(0) {}
 };
 
 class EpollServer : public IServer {
@@ -41,43 +111,77 @@ public:
     bool start() override;
     void stop() override;
     bool isRunning() const override;
-    void setRoute(const std::string& path, RequestHandler handler) override;
+    void setRoute(const std::string& pattern, RequestHandler handler,
+                  const std::string& contentType = "application/json") override;
+    void setForwardRoute(const std::string& method, const std::string& pattern,
+                         ForwardPrepare prepare, ForwardComplete complete) override;
     void setMaxConnections(int maxConn) override;
     void setTimeout(int timeoutSec) override;
+    void setIoThreads(int threads) override;
+    void setStreamThreshold(size_t bytes) override;
+    void setKeepAlive(int idleTimeoutSec, int maxRequests) override;
+    void setHeaderTimeout(int timeoutSec) override;
     
     // 服务器信息
     std::string getServerType() const override { return "EpollServer"; }
     int getPort() const override { return port; }
-    int getCurrentConnections() const override { return static_cast<int>(clients.size()); }
+    int getCurrentConnections() const override;
     
 private:
+    // 反应堆生命周期
+    bool setupReactor(Reactor& reactor);
+    void teardownReactor(Reactor& reactor);
+    int createListenSocket(bool reusePort);
+    
     // 核心epoll事件循环
-    void eventLoop();
+    void eventLoop(Reactor& reactor);
     
     // 连接管理
-    bool acceptNewConnection();
-    void closeConnection(int clientFd);
-    void cleanupTimeoutConnections();
+    bool acceptNewConnection(Reactor& reactor);
+    void closeConnection(Reactor& reactor, int clientFd);
+    
+    // 超时：每个连接和AP调用各有一个定时器，到期回调按所属对象和连接状态处理
+    void armClientTimer(Reactor& reactor, ClientConnection* conn);
+    void handleTimer(Reactor& reactor, TimerWheel::Timer& timer);
+    void handleClientTimeout(Reactor& reactor, ClientConnection* conn);
     
     // IO处理
-    bool handleRead(int clientFd);
-    bool handleWrite(int clientFd);
+    bool handleRead(Reactor& reactor, int clientFd);
+    bool handleWrite(Reactor& reactor, int clientFd);
+    bool continueAfterResponse(Reactor& reactor, int clientFd);
     
-    // 请求处理
-    bool processCompleteRequest(int clientFd);
-    std::string processRequest(const std::string& request);
-    bool isRequestComplete(const std::string& buffer);
+    // 请求处理，路由和响应内容由HttpDispatcher决定
+    bool processCompleteRequest(Reactor& reactor, ClientConnection* conn, int64_t parseStart);
+    bool rejectRequest(Reactor& reactor, ClientConnection* conn);
     
-    // HTTP协议处理
-    void parseRequest(const std::string& request, std::string& method, std::string& path);
-    std::string createOptionsResponse();
-    std::string createResponse(const std::string& content, int statusCode = 200, 
-                              const std::string& contentType = "application/json");
+    // 动态头部生成在连接的写缓冲区（取自BufferPool）中，响应体移入连接，然后开始发送
+    bool beginResponse(Reactor& reactor, ClientConnection* conn, HttpDispatcher::Response response);
+    bool sendResponse(Reactor& reactor, ClientConnection* conn);
+    void releaseBuffers(Reactor& reactor, ClientConnection* conn);
+    void finishTrace(ClientConnection* conn);
+    
+    // 异步AP转发
+    bool startForward(Reactor& reactor, ClientConnection* conn, const HttpDispatcher::Route& route,
+                      const RouteParams& params);
+    void handleUpstreamEvent(Reactor& reactor, int upstreamFd, uint32_t events);
+    void failUpstream(Reactor& reactor, int upstreamFd, const std::string& errorType,
+                      const std::string& message, const std::string& details,
+                      const std::string& errorResponse);
+    bool retryForward(Reactor& reactor, int upstreamFd);
+    void finishForward(Reactor& reactor, int upstreamFd, bool reusable);
+    void closeUpstream(Reactor& reactor, int upstreamFd);
+    void handleUpstreamTimeout(Reactor& reactor, int upstreamFd);
+    
+    // 大响应流式转发：收到AP响应头部后即向客户端发送分块编码的响应，负载边收边发
+    bool startStream(Reactor& reactor, UpstreamConnection* upstream);
+    bool relayStream(Reactor& reactor, int upstreamFd);
+    void resumeStream(Reactor& reactor, int clientFd);
+    void appendChunk(ClientConnection* conn, const char* data, size_t length);
     
     // epoll操作
-    bool addToEpoll(int fd, uint32_t events);
-    bool modifyEpoll(int fd, uint32_t events);
-    bool removeFromEpoll(int fd);
+    bool addToEpoll(int epollFd, int fd, uint32_t events);
+    bool modifyEpoll(int epollFd, int fd, uint32_t events);
+    bool removeFromEpoll(int epollFd, int fd);
     
     // 设置非阻塞模式
     bool setNonBlocking(int fd);
@@ -85,21 +189,27 @@ private:
     // 服务器配置
     int port;
     int maxConnections;
-    int connectionTimeout;
+    int reactorCount;
+    size_t streamThreshold;
+    HttpDispatcher dispatcher;          // 路由、长连接和超时规则（启动前配置，运行期间只读）
     
-    // epoll相关
-    int epollFd;
-    int serverSocket;
     std::atomic<bool> running;
     
-    // 连接管理
-    std::unordered_map<int, std::unique_ptr<ClientConnection>> clients;
-    std::unordered_map<std::string, RequestHandler> routes;
+    // 反应堆（每个反应堆一个线程）
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    std::atomic<int> totalConnections;  // 所有反应堆的连接总数，用于最大连接数限制
+    Counter& acceptedConnections;
+    Counter& rejectedConnections;        // 超过最大连接数被拒绝的连接
     
     // 常量
     static const int MAX_EVENTS = 1024;
     static const int BUFFER_SIZE = 4096;
     static const int LISTEN_BACKLOG = 128;
+    static const int MAX_WAIT_MS = 1000;                    // epoll_wait最长等待时间
+    static const size_t STREAM_HIGH_WATER = 256 * 1024;  // 流式转发时客户端积压超过该值暂停读取AP
+    static const size_t PIPELINE_BUFFER_LIMIT = 64 * 1024;  // 处理请求期间缓存的后续请求超过该值暂停读取客户端
+    static const size_t RESPONSE_HEADER_RESERVE = 512;      // 构造响应时为动态头部预留的缓冲区大小
+    static const size_t STREAM_BUFFER_RESERVE = 16 * 1024;  // 开始流式转发时客户端写缓冲区的初始容量
 };
 
 #endif // SERVER_EPOLL_H
\ No newline at end of file
@@ -12,7 +12,8 @@ class ServerFactory {
 public:
     enum class ServerType {
         THREADED,   // 传统多线程服务器
-        EPOLL       // Epoll事件驱动服务器
+        EPOLL,      // Epoll事件驱动服务器
+        IO_URING    // io_uring服务器，内核不支持时改用EPOLL
     };
     
     /**
@@ -25,7 +26,7 @@ public:
     
     /**
      * 根据配置字符串创建服务器
-     * @param typeStr 服务器类型字符串 ("threaded" 或 "epoll")
+     * @param typeStr 服务器类型字符串 ("threaded"、"epoll" 或 "io_uring")
      * @param port 监听端口
      * @return 服务器实例的智能指针
      */
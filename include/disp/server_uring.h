@@ -0,0 +1,251 @@
+#ifndef SERVER_URING_H
+#define SERVER_URING_H
+
+#include "disp/io_uring.h"
+
+#if DISP_HAS_IO_URING
+
+#include "disp/iserver.h"
+#include "common/metrics.h"
+#include "disp/timer_wheel.h"
+#include "disp/connection_pool.h"
+#include "disp/buffer_pool.h"
+#include "disp/http_response.h"
+#include "disp/http_dispatcher.h"
+#include <string>
+#include <atomic>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// io_uring服务器的客户端连接，对象由ConnectionPool复用。
+// 提交给内核的请求引用连接中的缓冲区，pendingOps归零前连接对象和fd都不能释放
+struct UringConnection {
+    int fd;                          // 客户端socket，启用注册文件时为文件表中的槽位
+    ClientState state;               // 连接状态
+    std::string readBuffer;          // 读缓冲区（空闲时归还BufferPool）
+    HttpParser parser;               // 增量解析readBuffer中的请求
+    const std::string* statusBlock;  // HttpResponse中共用的状态行和CORS头部
+    size_t statusPos;
+    std::string writeBuffer;         // 动态头部（取自BufferPool）
+    size_t writePos;
+    std::string body;                // 响应体，从处理函数移入
+    size_t bodyPos;
+    struct iovec iov[3];             // 进行中的sendmsg引用的数据，完成前不能修改
+    struct msghdr msg;
+    TimerWheel::Timer timer;         // 当前阶段的超时：读取请求、空闲长连接、发送响应或延迟关闭
+    bool keepAlive;                  // 当前请求的响应发送完毕后是否保持连接
+    int requestCount;                // 该连接上已收到的请求数
+    int upstreamFd;                  // 正在进行的AP调用socket（-1表示没有）
+    bool receiving;                  // 多次接收请求仍在进行
+    bool recvCancelled;              // 积压过多，已请求取消接收
+    int pendingOps;                  // 尚未结束的请求数
+    bool closing;                    // 已决定关闭，等待进行中的请求结束后释放
+
+    UringConnection()
+        : fd(-1), state(ClientState::READING_REQUEST), statusBlock(nullptr), statusPos(0), writePos(0), bodyPos(0),
+          keepAlive(false), requestCount(0), upstreamFd(-1), receiving(false), recvCancelled(false),
+          pendingOps(0), closing(false) {}
+
+    // 从对象池取出时重置为新连接，缓冲区在上一个连接关闭时已经归还
+    void reset(int clientFd) {
+        fd = clientFd;
+        state = ClientState::READING_REQUEST;
+        parser.reset();
+        statusBlock = nullptr;
+        statusPos = 0;
+        writePos = 0;
+        bodyPos = 0;
+        timer.fd = clientFd;
+        keepAlive = false;
+        requestCount = 0;
+        upstreamFd = -1;
+        receiving = false;
+        recvCancelled = false;
+        pendingOps = 0;
+        closing = false;
+    }
+};
+
+// 上游AP连接：同一时间只有一个请求在进行（等待连接、发送或接收），
+// 放弃的调用（客户端断开或超时）等该请求结束后再关闭socket
+struct UringUpstream {
+    int fd;                                  // AP socket
+    int clientFd;                            // 等待该响应的客户端连接
+    ApCall call;                             // 调用上下文，响应写入call.response
+    const IServer::ForwardComplete* complete;  // 生成最终响应内容（指向路由表中的处理函数）
+    std::string writeBuffer;                 // 编码后的请求
+    size_t writePos;                         // 请求发送位置
+    std::string readBuffer;                  // 响应接收缓冲区
+    bool reused;                             // 是否为连接池中复用的连接
+    TimerWheel::Timer deadline;              // 调用截止时间
+    int pendingOps;                          // 尚未结束的请求数
+    bool abandoned;                          // 已放弃，请求结束后关闭
+
+    UringUpstream(int client, const IServer::ForwardComplete* completeFunc)
+        : fd(-1), clientFd(client), complete(completeFunc), writePos(0), reused(false),
+          pendingOps(0), abandoned(false) {}
+};
+
+// io_uring反应堆：独立的环形队列、监听socket和连接表，运行在自己的线程上
+struct UringReactor {
+    int id;                          // 反应堆编号
+    int listenFd;                    // 监听socket（SO_REUSEPORT）
+    int wakeFd;                      // eventfd，用于stop()时唤醒等待
+    uint64_t wakeValue;              // 读取eventfd的缓冲区（读请求进行中时由内核写入）
+    bool fixedFiles;                 // 客户端连接使用注册文件
+    bool accepting;                  // 多次接受连接请求仍在进行
+    IoUring ring;
+    TimerWheel timers;               // 客户端连接的超时，须在连接表之前构造、之后析构
+    TimerWheel deadlines;            // AP调用的截止时间（注册文件的槽位可能与AP socket的fd相同，分开存放）
+    BufferPool buffers;              // 客户端连接的读写缓冲区
+    ConnectionPool<UringConnection> clients;  // 下标为fd或注册文件的槽位
+    std::unordered_map<int, std::unique_ptr<UringUpstream>> upstreams;  // 进行中的AP调用
+    std::atomic<int> connectionCount;  // 供其他线程读取的连接数
+    std::thread thread;              // 反应堆线程（0号反应堆运行在调用start()的线程上）
+
+    UringReactor(int reactorId)
+        : id(reactorId), listenFd(-1), wakeFd(-1), wakeValue(0), fixedFiles(false), accepting(false),
+          connectionCount(0) {}
+};
+
+/**
+ * 基于io_uring的服务器实现
+ * 与EpollServer相同的多反应堆结构，请求处理和超时规则同样由HttpDispatcher决定，区别在于IO以提交/完成方式进行：
+ * 监听socket上一个多次接受连接（multishot accept）的请求持续产生新连接；每个连接一个多次接收请求，
+ * 数据到达时内核才从缓冲区环中取接收缓冲区；响应以一次sendmsg提交，最后一个响应之后链接一个
+ * shutdown请求关闭写方向；AP调用的连接等待、发送和接收同样提交到环形队列。
+ * 可选使用注册文件（disp.uring_registered_files），减少每次请求查找和引用文件的开销。
+ * 不支持请求追踪和大响应的流式转发，配置了其中之一时启动时给出警告，需要时使用EpollServer。
+ * 需要Linux 6.0及以上，内核不支持时由ServerFactory改用EpollServer
+ */
+class IoUringServer : public IServer {
+public:
+    IoUringServer(int port);
+    virtual ~IoUringServer();
+
+    // 当前内核是否支持所需的io_uring功能，结果缓存，不支持时reason给出原因
+    static bool isSupported(std::string* reason = nullptr);
+
+    // 实现IServer接口
+    bool start() override;
+    void stop() override;
+    bool isRunning() const override;
+    void setRoute(const std::string& pattern, RequestHandler handler,
+                  const std::string& contentType = "application/json") override;
+    void setForwardRoute(const std::string& method, const std::string& pattern,
+                         ForwardPrepare prepare, ForwardComplete complete) override;
+    void setMaxConnections(int maxConn) override;
+    void setTimeout(int timeoutSec) override;
+    void setIoThreads(int threads) override;
+    void setStreamThreshold(size_t bytes) override;
+    void setKeepAlive(int idleTimeoutSec, int maxRequests) override;
+    void setHeaderTimeout(int timeoutSec) override;
+    void setRegisteredFiles(bool enabled) override;
+
+    // 服务器信息
+    std::string getServerType() const override { return "IoUringServer"; }
+    int getPort() const override { return port; }
+    int getCurrentConnections() const override;
+
+private:
+    // 完成项的user_data：高32位为请求类型，低32位为fd
+    enum class Op : uint32_t {
+        ACCEPT = 1,
+        WAKE,
+        CLIENT_RECV,
+        CLIENT_SEND,
+        CLIENT_SHUTDOWN,
+        UPSTREAM_CONNECT,
+        UPSTREAM_SEND,
+        UPSTREAM_RECV,
+        IGNORE                       // 取消和关闭请求，完成项不需要处理
+    };
+    static uint64_t tag(Op op, int fd) { return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd); }
+
+    // 反应堆生命周期
+    bool setupReactor(UringReactor& reactor);
+    void teardownReactor(UringReactor& reactor);
+    int createListenSocket(bool reusePort);
+
+    // 事件循环和完成项分发
+    void eventLoop(UringReactor& reactor);
+    void handleCompletion(UringReactor& reactor, const struct io_uring_cqe& cqe);
+    bool armAccept(UringReactor& reactor);
+    bool armWake(UringReactor& reactor);
+    void handleAccept(UringReactor& reactor, const struct io_uring_cqe& cqe);
+
+    // 连接管理：closeConnection取消进行中的请求，全部结束后由releaseConnection关闭fd并归还对象
+    void handleClientCompletion(UringReactor& reactor, Op op, int clientFd, const struct io_uring_cqe& cqe);
+    void closeConnection(UringReactor& reactor, UringConnection* conn);
+    void releaseConnection(UringReactor& reactor, UringConnection* conn);
+    void cancelRequests(UringReactor& reactor, int fd, bool fixed);
+    void closeClientFd(UringReactor& reactor, int clientFd);
+
+    // 超时
+    void armClientTimer(UringReactor& reactor, UringConnection* conn);
+    void handleClientTimeout(UringReactor& reactor, UringConnection* conn);
+
+    // IO处理
+    bool armRecv(UringReactor& reactor, UringConnection* conn);
+    bool handleRecv(UringReactor& reactor, UringConnection* conn, const struct io_uring_cqe& cqe);
+    bool processBuffered(UringReactor& reactor, UringConnection* conn);
+    bool submitSend(UringReactor& reactor, UringConnection* conn);
+    bool handleSend(UringReactor& reactor, UringConnection* conn, const struct io_uring_cqe& cqe);
+
+    // 请求处理，路由和响应内容由HttpDispatcher决定
+    bool processCompleteRequest(UringReactor& reactor, UringConnection* conn);
+    bool rejectRequest(UringReactor& reactor, UringConnection* conn);
+    bool beginResponse(UringReactor& reactor, UringConnection* conn, HttpDispatcher::Response response);
+    bool sendResponse(UringReactor& reactor, UringConnection* conn);
+    void releaseBuffers(UringReactor& reactor, UringConnection* conn);
+
+    // 异步AP转发
+    bool startForward(UringReactor& reactor, UringConnection* conn, const HttpDispatcher::Route& route,
+                      const RouteParams& params);
+    void handleUpstreamCompletion(UringReactor& reactor, Op op, int upstreamFd, const struct io_uring_cqe& cqe);
+    bool submitUpstreamConnect(UringReactor& reactor, UringUpstream* upstream);
+    bool submitUpstreamSend(UringReactor& reactor, UringUpstream* upstream);
+    bool submitUpstreamRecv(UringReactor& reactor, UringUpstream* upstream);
+    void failUpstream(UringReactor& reactor, UringUpstream* upstream, const std::string& errorType,
+                      const std::string& message, const std::string& details,
+                      const std::string& errorResponse);
+    bool retryForward(UringReactor& reactor, UringUpstream* upstream);
+    void finishForward(UringReactor& reactor, UringUpstream* upstream, bool reusable);
+    void releaseUpstream(UringReactor& reactor, UringUpstream* upstream, bool reusable);
+    void handleUpstreamTimeout(UringReactor& reactor, int upstreamFd);
+
+    // 服务器配置
+    int port;
+    int maxConnections;
+    int reactorCount;
+    size_t streamThreshold;             // 只用于启动时提示不支持流式转发
+    bool registeredFiles;               // 客户端连接使用注册文件
+    HttpDispatcher dispatcher;          // 路由、长连接和超时规则（启动前配置，运行期间只读）
+
+    std::atomic<bool> running;
+
+    // 反应堆（每个反应堆一个线程）
+    std::vector<std::unique_ptr<UringReactor>> reactors;
+    std::atomic<int> totalConnections;  // 所有反应堆的连接总数，用于最大连接数限制
+    Counter& acceptedConnections;
+    Counter& rejectedConnections;        // 超过最大连接数被拒绝的连接
+
+    // 常量
+    static const unsigned RING_ENTRIES = 1024;               // 提交队列长度
+    static const unsigned RECV_BUFFER_COUNT = 1024;          // 缓冲区环中的接收缓冲区数（2的幂）
+    static const uint16_t RECV_BUFFER_GROUP = 0;
+    static const int BUFFER_SIZE = 4096;                     // 接收缓冲区大小
+    static const int LISTEN_BACKLOG = 128;
+    static const int MAX_WAIT_MS = 1000;                     // 最长等待时间
+    static const size_t PIPELINE_BUFFER_LIMIT = 64 * 1024;   // 处理请求期间缓存的后续请求超过该值暂停接收
+    static const size_t RESPONSE_HEADER_RESERVE = 512;       // 构造响应时为动态头部预留的缓冲区大小
+    static const int FILE_TABLE_RESERVE = 64;                // 注册文件表在最大连接数之外预留的槽位
+};
+
+#endif // DISP_HAS_IO_URING
+
+#endif // SERVER_URING_H
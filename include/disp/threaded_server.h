@@ -2,15 +2,18 @@
 #define THREADED_SERVER_H
 
 #include "disp/iserver.h"
+#include "common/metrics.h"
+#include "disp/http_response.h"
+#include "disp/work_stealing_pool.h"
 #include <string>
 #include <thread>
 #include <vector>
 #include <atomic>
-#include <unordered_map>
 
 /**
  * 传统多线程服务器实现
- * 采用"一连接一线程"模型
+ * 接受线程把连接提交给固定大小的工作线程池，每个连接由一个工作线程阻塞处理；
+ * 等待处理的连接数达到上限时直接关闭新连接
  */
 class ThreadedServer : public IServer {
 public:
@@ -21,9 +24,13 @@ public:
     bool start() override;
     void stop() override;
     bool isRunning() const override;
-    void setRoute(const std::string& path, RequestHandler handler) override;
+    void setRoute(const std::string& pattern, RequestHandler handler,
+                  const std::string& contentType = "application/json") override;
+    void setForwardRoute(const std::string& method, const std::string& pattern,
+                         ForwardPrepare prepare, ForwardComplete complete) override;
     void setMaxConnections(int maxConn) override;
     void setTimeout(int timeoutSec) override;
+    void setWorkerPool(int threads, size_t queueLimit) override;
     
     // 服务器信息
     std::string getServerType() const override { return "ThreadedServer"; }
@@ -35,29 +42,47 @@ private:
     void acceptLoop();
     void handleClient(int clientSocket);
     
+    // 响应：预先生成的状态行和CORS头部、动态头部、响应体（从处理函数移入）分段发送
+    struct Response {
+        const std::string* statusBlock = nullptr;
+        std::string headers;
+        std::string body;
+    };
+    
     // HTTP处理
-    std::string processRequest(const std::string& request);
-    void parseRequest(const std::string& request, std::string& method, std::string& path);
-    std::string createOptionsResponse();
-    std::string createResponse(const std::string& content, int statusCode = 200, 
-                              const std::string& contentType = "application/json");
+    void processRequest(const HttpRequest& request, Response& response);
+    void createOptionsResponse(Response& response);
+    void createResponse(Response& response, std::string content, int statusCode = 200,
+                        const std::string& contentType = "application/json");
+    bool sendResponse(int clientSocket, const Response& response);
     
     // 配置参数
     int port;
     int maxConnections;
     int connectionTimeout;
+    int workerThreads;
+    size_t workerQueueLimit;
     
     // 网络相关
     int serverSocket;
     std::atomic<bool> running;
     std::atomic<int> currentConnections;
+    Counter& acceptedConnections;
+    Counter& rejectedConnections;        // 超过最大连接数被拒绝的连接
     
     // 线程管理
     std::thread acceptThread;
-    std::vector<std::thread> clientThreads;
+    WorkStealingPool workers;
     
     // 路由管理
-    std::unordered_map<std::string, RequestHandler> routes;
+    struct Route {
+        RequestHandler handler;
+        std::string contentType;
+        ForwardPrepare prepare;         // 转发路由的准备和完成函数，本地路由为空
+        ForwardComplete complete;
+    };
+    Router router;                      // 值为routeTable下标
+    std::vector<Route> routeTable;
     
     // 常量
     static const int LISTEN_BACKLOG = 10;
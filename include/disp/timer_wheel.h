@@ -0,0 +1,147 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * 分层时间轮
+ * 第0层256个槽，每槽一个刻度；第1至3层各64个槽，每槽覆盖下一层的一整圈。
+ * 定时器按到期时间与当前刻度的距离放入对应层的槽，上层槽在下一层转完一圈时整体下移重新分配，
+ * 添加、重设和取消都是O(1)，与定时器数量无关。
+ * 定时器节点嵌在使用方的对象中（侵入式链表），不单独分配内存；对象析构时自动取消。
+ * 只在所属事件循环的线程中使用，不加锁
+ */
+class TimerWheel {
+public:
+    class Timer {
+    public:
+        Timer() = default;
+        ~Timer() { if (wheel) wheel->cancel(*this); }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool active() const { return wheel != nullptr; }
+
+        int fd = -1;                 // 由使用方定义，到期回调据此找到所属对象
+
+    private:
+        friend class TimerWheel;
+
+        void unlink() {
+            prev->next = next;
+            next->prev = prev;
+            prev = next = nullptr;
+        }
+
+        TimerWheel* wheel = nullptr; // 所在的时间轮，未设置时为空
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t expireTick = 0;
+    };
+
+    explicit TimerWheel(int tickMs = 10);
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // delayMs毫秒后到期（按刻度向上取整）；已在时间轮中时重新设置到期时间
+    void schedule(Timer& timer, int64_t delayMs);
+    void cancel(Timer& timer);
+
+    /**
+     * 处理到nowMs为止到期的定时器，依次调用onExpire(Timer&)。
+     * 回调中可以重新设置或取消任意定时器（包括同一批中尚未处理的），调用前定时器已移出时间轮
+     */
+    template <typename Callback>
+    void advance(int64_t nowMs, Callback onExpire);
+
+    // 距离下一个可能到期的时间（毫秒），用作epoll_wait的超时，不超过maxMs
+    int nextTimeout(int64_t nowMs, int maxMs) const;
+
+    size_t size() const { return count; }
+
+    // 单调时钟（毫秒）
+    static int64_t nowMs();
+
+private:
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 4;
+    static const size_t LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const size_t LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const uint64_t MAX_DELAY_TICKS = (uint64_t(1) << (LEVEL0_BITS + LEVEL_BITS * (LEVELS - 1))) - 1;
+
+    // 槽是循环链表的哨兵节点，空槽的prev和next指向自身
+    struct Slot {
+        Timer head;
+        Slot() { head.prev = head.next = &head; }
+        bool empty() const { return head.next == &head; }
+    };
+
+    void insert(Timer& timer);
+    void cascade(int level, size_t index);
+    uint64_t toTick(int64_t ms) const { return static_cast<uint64_t>(ms - baseMs) / tickMs; }
+
+    static void append(Slot& slot, Timer& timer) {
+        timer.prev = slot.head.prev;
+        timer.next = &slot.head;
+        slot.head.prev->next = &timer;
+        slot.head.prev = &timer;
+    }
+
+    int tickMs;
+    int64_t baseMs;                  // 刻度0对应的时间
+    uint64_t nextTick;               // 下一个待处理的刻度
+    size_t count;
+    Slot level0[LEVEL0_SIZE];
+    Slot levels[LEVELS - 1][LEVEL_SIZE];
+};
+
+template <typename Callback>
+void TimerWheel::advance(int64_t nowMs, Callback onExpire) {
+    uint64_t now = nowMs < baseMs ? 0 : toTick(nowMs);
+    if (count == 0) {
+        // 没有定时器时直接跳到当前刻度，避免长时间空闲后逐个刻度追赶
+        if (now >= nextTick) {
+            nextTick = now + 1;
+        }
+        return;
+    }
+
+    while (nextTick <= now) {
+        size_t index = nextTick & (LEVEL0_SIZE - 1);
+        // 第0层转完一圈，上一层当前槽下移；逐层进位
+        if (index == 0) {
+            for (int level = 0; level < LEVELS - 1; ++level) {
+                size_t upper = (nextTick >> (LEVEL0_BITS + LEVEL_BITS * level)) & (LEVEL_SIZE - 1);
+                cascade(level, upper);
+                if (upper != 0) {
+                    break;
+                }
+            }
+        }
+        ++nextTick;
+
+        Slot& slot = level0[index];
+        if (slot.empty()) {
+            continue;
+        }
+
+        // 先把整个槽摘到本地链表，回调中新设置的定时器不会在本轮被处理
+        Slot expired;
+        expired.head.next = slot.head.next;
+        expired.head.prev = slot.head.prev;
+        expired.head.next->prev = &expired.head;
+        expired.head.prev->next = &expired.head;
+        slot.head.prev = slot.head.next = &slot.head;
+
+        while (!expired.empty()) {
+            Timer& timer = *expired.head.next;
+            cancel(timer);
+            onExpire(timer);
+        }
+    }
+}
+
+#endif // TIMER_WHEEL_H
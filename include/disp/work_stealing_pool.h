@@ -0,0 +1,83 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+
+/**
+ * 带任务窃取的固定大小线程池（ThreadedServer处理客户端连接）
+ * 每个工作线程有自己的任务队列，提交的任务轮流放入各队列；工作线程先从自己队列的头部取任务，
+ * 为空时从其他队列的尾部窃取，某个连接处理较慢时排在它后面的任务由空闲线程接手。
+ * 所有队列中等待的任务总数有上限，达到上限时拒绝提交，由调用方直接关闭连接
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    WorkStealingPool();
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * 启动工作线程
+     * @param threads 工作线程数
+     * @param maxQueue 等待执行的任务总数上限
+     */
+    void start(int threads, size_t maxQueue);
+
+    /**
+     * 停止线程池：不再接受新任务，已入队的任务执行完后工作线程退出
+     */
+    void stop();
+
+    /**
+     * 提交任务
+     * @return 队列已满或线程池未运行时返回false，任务不会被执行
+     */
+    bool submit(Task task);
+
+    // 当前排队的任务数
+    size_t queueDepth() const { return pending; }
+
+    // 正在执行任务的线程数
+    int activeCount() const { return active; }
+
+    // 累计被拒绝的任务数和被窃取执行的任务数
+    size_t rejectedCount() const { return rejected; }
+    size_t stolenCount() const { return stolen; }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    // 先取自己队列的头部，再依次从其他队列的尾部窃取
+    bool takeTask(size_t index, Task& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextQueue;
+    std::atomic<size_t> pending;
+    std::atomic<int> active;
+    size_t maxQueue;
+
+    // 空闲线程在此等待新任务
+    std::mutex idleMutex;
+    std::condition_variable idleCv;
+    bool accepting;
+
+    std::atomic<size_t> rejected;
+    std::atomic<size_t> stolen;
+};
+
+#endif // WORK_STEALING_POOL_H
@@ -0,0 +1,448 @@
+#include "ap/db_connection.h"
+#include "common/logger_enhanced.h"
+#include "common/metrics.h"
+#include "common/trace.h"
+#include <sstream>
+#include <algorithm>
+#include <type_traits>
+
+namespace {
+    // MySQL 8.0起MYSQL_BIND::is_null为bool*，更早版本和MariaDB为my_bool*
+    using BindFlag = std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type;
+
+    // 结果列的初始缓冲区大小，更长的值截断后用mysql_stmt_fetch_column补取
+    const unsigned long MIN_COLUMN_BUFFER = 64;
+    const unsigned long MAX_COLUMN_BUFFER = 64 * 1024;
+    
+    // 执行失败后语句是否已不可用：需要重新准备（表结构变化等）、服务端已没有该语句或客户端错误。
+    // 主键冲突、外键约束等数据错误后语句仍然有效；连接断开由checkConnectionError处理，重连时关闭全部语句
+    bool invalidatesStatement(unsigned int error) {
+        return error == ER_NEED_REPREPARE || error == ER_UNKNOWN_STMT_HANDLER ||
+               (error >= CR_MIN_ERROR && error <= CR_MAX_ERROR);
+    }
+
+    // 语句执行耗时（含取回结果），按是否返回结果集区分
+    Histogram& queryDuration(const char* operation) {
+        static MetricFamily<Histogram>& family = MetricsRegistry::getInstance().histogram(
+            "ap_db_query_duration_seconds", "数据库语句执行耗时（含取回结果）", "op");
+        return family.get(operation);
+    }
+}
+
+DBConnection::DBConnection()
+    : mysql(nullptr), connected(false), broken(false), lastUsed(time(nullptr)),
+      lastInsertId(0), affectedRows(0), port(3306) {
+}
+
+DBConnection::~DBConnection() {
+    disconnect();
+}
+
+bool DBConnection::connect(const std::string& host, const std::string& user, 
+                           const std::string& password, const std::string& database, 
+                           unsigned int port) {
+    if (connected) {
+        LOG_WARNING("数据库已连接");
+        return true;
+    }
+    
+    this->host = host;
+    this->user = user;
+    this->password = password;
+    this->database = database;
+    this->port = port;
+    
+    // 初始化MySQL
+    mysql = mysql_init(nullptr);
+    if (!mysql) {
+        LOG_ERROR("MySQL初始化失败");
+        return false;
+    }
+    
+    // 设置连接超时，避免数据库不可达时工作线程长时间阻塞；断线重连由连接池负责
+    unsigned int connectTimeout = 3;
+    mysql_options(mysql, MYSQL_OPT_CONNECT_TIMEOUT, &connectTimeout);
+    
+    // 连接数据库
+    if (!mysql_real_connect(mysql, host.c_str(), user.c_str(), password.c_str(), 
+                           database.c_str(), port, nullptr, 0)) {
+        LOG_ERROR("连接数据库失败: " + std::string(mysql_error(mysql)));
+        mysql_close(mysql);
+        mysql = nullptr;
+        return false;
+    }
+    
+    // 设置字符集
+    mysql_set_character_set(mysql, "utf8mb4");
+    
+    connected = true;
+    broken = false;
+    touch();
+    LOG_INFO("数据库连接成功: " + host + ":" + std::to_string(port) + "/" + database);
+    return true;
+}
+
+void DBConnection::disconnect() {
+    closeStatements();
+    if (mysql) {
+        mysql_close(mysql);
+        mysql = nullptr;
+        LOG_INFO("数据库连接已关闭");
+    }
+    connected = false;
+}
+
+bool DBConnection::reconnect() {
+    disconnect();
+    return connect(host, user, password, database, port);
+}
+
+bool DBConnection::ping() {
+    if (!connected || !mysql) {
+        return false;
+    }
+    
+    if (mysql_ping(mysql) != 0) {
+        LOG_WARNING("数据库连接探测失败: " + std::string(mysql_error(mysql)));
+        broken = true;
+        return false;
+    }
+    return true;
+}
+
+void DBConnection::checkConnectionError(unsigned int error) {
+    if (error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST) {
+        broken = true;
+    }
+}
+
+bool DBConnection::executeQuery(const std::string& query) {
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return false;
+    }
+    
+    LOG_INFO("执行SQL: " + query);
+    HistogramTimer timer(queryDuration("execute"));
+    ScopedSpan span("db.execute", query);
+    
+    int result = mysql_query(mysql, query.c_str());
+    if (result != 0) {
+        LOG_ERROR("SQL执行失败: " + std::string(mysql_error(mysql)));
+        checkConnectionError(mysql_errno(mysql));
+        return false;
+    }
+    
+    lastInsertId = mysql_insert_id(mysql);
+    affectedRows = mysql_affected_rows(mysql);
+    return true;
+}
+
+ResultSet DBConnection::executeSelect(const std::string& query) {
+    ResultSet results;
+    
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return results;
+    }
+    
+    LOG_INFO("执行SQL查询: " + query);
+    HistogramTimer timer(queryDuration("select"));
+    ScopedSpan span("db.select", query);
+    
+    if (mysql_query(mysql, query.c_str()) != 0) {
+        LOG_ERROR("SQL查询失败: " + std::string(mysql_error(mysql)));
+        checkConnectionError(mysql_errno(mysql));
+        return results;
+    }
+    
+    MYSQL_RES* res = mysql_store_result(mysql);
+    if (!res) {
+        LOG_ERROR("获取查询结果失败: " + std::string(mysql_error(mysql)));
+        checkConnectionError(mysql_errno(mysql));
+        return results;
+    }
+    
+    unsigned int numFields = mysql_num_fields(res);
+    MYSQL_FIELD* fields = mysql_fetch_fields(res);
+    results.reset(numFields);
+    for (unsigned int i = 0; i < numFields; ++i) {
+        results.setColumnName(i, fields[i].name);
+    }
+    
+    // 结果已全部取回客户端，先按行数和列宽预分配
+    unsigned long long numRows = mysql_num_rows(res);
+    unsigned long rowWidth = 0;
+    for (unsigned int i = 0; i < numFields; ++i) {
+        rowWidth += std::min(static_cast<unsigned long>(fields[i].length), MIN_COLUMN_BUFFER);
+    }
+    results.reserve(numRows, numRows * rowWidth);
+    
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res))) {
+        unsigned long* lengths = mysql_fetch_lengths(res);
+        for (unsigned int i = 0; i < numFields; i++) {
+            if (row[i]) {
+                results.appendValue(row[i], lengths[i]);
+            } else {
+                results.appendNull();
+            }
+        }
+    }
+    
+    mysql_free_result(res);
+    return results;
+}
+
+MYSQL_STMT* DBConnection::prepareStatement(const std::string& sql) {
+    auto it = statements.find(sql);
+    if (it != statements.end()) {
+        return it->second;
+    }
+    
+    MYSQL_STMT* stmt = mysql_stmt_init(mysql);
+    if (!stmt) {
+        LOG_ERROR("创建预处理语句失败: " + std::string(mysql_error(mysql)));
+        return nullptr;
+    }
+    
+    if (mysql_stmt_prepare(stmt, sql.c_str(), sql.length()) != 0) {
+        LOG_ERROR("准备SQL语句失败: " + std::string(mysql_stmt_error(stmt)) + ", SQL: " + sql);
+        checkConnectionError(mysql_stmt_errno(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    
+    // 缓存已满时关闭最早准备的语句
+    if (statements.size() >= MAX_CACHED_STATEMENTS) {
+        discardStatement(statementOrder.front());
+    }
+    
+    statements[sql] = stmt;
+    statementOrder.push_back(sql);
+    return stmt;
+}
+
+void DBConnection::discardStatement(const std::string& sql) {
+    auto it = statements.find(sql);
+    if (it == statements.end()) {
+        return;
+    }
+    
+    mysql_stmt_close(it->second);
+    statements.erase(it);
+    statementOrder.erase(std::find(statementOrder.begin(), statementOrder.end(), sql));
+}
+
+void DBConnection::closeStatements() {
+    for (auto& pair : statements) {
+        mysql_stmt_close(pair.second);
+    }
+    statements.clear();
+    statementOrder.clear();
+}
+
+bool DBConnection::bindAndExecute(MYSQL_STMT* stmt, const std::string& sql, const std::vector<DBParam>& params) {
+    if (mysql_stmt_param_count(stmt) != params.size()) {
+        LOG_ERROR("SQL参数个数不匹配: 需要" + std::to_string(mysql_stmt_param_count(stmt)) +
+                  "个, 实际" + std::to_string(params.size()) + "个, SQL: " + sql);
+        return false;
+    }
+    
+    std::vector<MYSQL_BIND> binds(params.size());
+    for (size_t i = 0; i < params.size(); ++i) {
+        const DBParam& param = params[i];
+        MYSQL_BIND& bind = binds[i];
+        memset(&bind, 0, sizeof(bind));
+        
+        switch (param.type) {
+            case DBParam::Type::INTEGER:
+                bind.buffer_type = MYSQL_TYPE_LONGLONG;
+                bind.buffer = const_cast<long long*>(&param.intValue);
+                break;
+            case DBParam::Type::DOUBLE:
+                bind.buffer_type = MYSQL_TYPE_DOUBLE;
+                bind.buffer = const_cast<double*>(&param.doubleValue);
+                break;
+            case DBParam::Type::STRING:
+                bind.buffer_type = MYSQL_TYPE_STRING;
+                bind.buffer = const_cast<char*>(param.data);
+                bind.buffer_length = param.length;
+                break;
+            case DBParam::Type::NULL_VALUE:
+                bind.buffer_type = MYSQL_TYPE_NULL;
+                break;
+        }
+    }
+    
+    if ((!binds.empty() && mysql_stmt_bind_param(stmt, binds.data())) || mysql_stmt_execute(stmt) != 0) {
+        unsigned int error = mysql_stmt_errno(stmt);
+        LOG_ERROR("SQL执行失败: " + std::string(mysql_stmt_error(stmt)));
+        checkConnectionError(error);
+        if (invalidatesStatement(error)) {
+            discardStatement(sql);
+        }
+        return false;
+    }
+    
+    return true;
+}
+
+bool DBConnection::executePrepared(const std::string& sql, const std::vector<DBParam>& params) {
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return false;
+    }
+    
+    LOG_DEBUG("执行预处理SQL: " + sql);
+    HistogramTimer timer(queryDuration("execute"));
+    ScopedSpan span("db.execute", sql);
+    
+    MYSQL_STMT* stmt = prepareStatement(sql);
+    if (!stmt || !bindAndExecute(stmt, sql, params)) {
+        return false;
+    }
+    
+    lastInsertId = mysql_stmt_insert_id(stmt);
+    affectedRows = mysql_stmt_affected_rows(stmt);
+    return true;
+}
+
+ResultSet DBConnection::selectPrepared(const std::string& sql, const std::vector<DBParam>& params) {
+    ResultSet results;
+    
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return results;
+    }
+    
+    LOG_DEBUG("执行预处理SQL查询: " + sql);
+    HistogramTimer timer(queryDuration("select"));
+    ScopedSpan span("db.select", sql);
+    
+    MYSQL_STMT* stmt = prepareStatement(sql);
+    if (!stmt || !bindAndExecute(stmt, sql, params)) {
+        return results;
+    }
+    
+    MYSQL_RES* meta = mysql_stmt_result_metadata(stmt);
+    if (!meta) {
+        LOG_ERROR("获取查询结果失败: " + std::string(mysql_stmt_error(stmt)));
+        return results;
+    }
+    
+    // 所有列按字符串取回，与executeSelect的结果格式一致
+    unsigned int numFields = mysql_num_fields(meta);
+    MYSQL_FIELD* fields = mysql_fetch_fields(meta);
+    std::vector<MYSQL_BIND> binds(numFields);
+    std::vector<std::vector<char>> buffers(numFields);
+    std::vector<unsigned long> lengths(numFields);
+    std::unique_ptr<BindFlag[]> nulls(new BindFlag[numFields]());  // 不能用vector<bool>
+    
+    results.reset(numFields);
+    unsigned long rowWidth = 0;
+    for (unsigned int i = 0; i < numFields; ++i) {
+        results.setColumnName(i, fields[i].name);
+        rowWidth += std::min(static_cast<unsigned long>(fields[i].length), MIN_COLUMN_BUFFER);
+        
+        buffers[i].resize(std::min(std::max(static_cast<unsigned long>(fields[i].length), MIN_COLUMN_BUFFER),
+                                   MAX_COLUMN_BUFFER));
+        memset(&binds[i], 0, sizeof(MYSQL_BIND));
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = buffers[i].data();
+        binds[i].buffer_length = buffers[i].size();
+        binds[i].length = &lengths[i];
+        binds[i].is_null = &nulls[i];
+    }
+    
+    if (mysql_stmt_bind_result(stmt, binds.data()) || mysql_stmt_store_result(stmt) != 0) {
+        LOG_ERROR("获取查询结果失败: " + std::string(mysql_stmt_error(stmt)));
+        checkConnectionError(mysql_stmt_errno(stmt));
+        mysql_free_result(meta);
+        discardStatement(sql);
+        return results;
+    }
+    
+    unsigned long long numRows = mysql_stmt_num_rows(stmt);
+    results.reserve(numRows, numRows * rowWidth);
+    
+    int status;
+    while ((status = mysql_stmt_fetch(stmt)) == 0 || status == MYSQL_DATA_TRUNCATED) {
+        for (unsigned int i = 0; i < numFields; ++i) {
+            if (nulls[i]) {
+                results.appendNull();
+            } else if (lengths[i] <= buffers[i].size()) {
+                results.appendValue(buffers[i].data(), lengths[i]);
+            } else {
+                // 值超过缓冲区，直接把完整的列取回到结果集中
+                MYSQL_BIND column;
+                memset(&column, 0, sizeof(column));
+                column.buffer_type = MYSQL_TYPE_STRING;
+                column.buffer = results.appendValue(lengths[i]);
+                column.buffer_length = lengths[i];
+                mysql_stmt_fetch_column(stmt, &column, i, 0);
+            }
+        }
+    }
+    
+    if (status != MYSQL_NO_DATA) {
+        LOG_ERROR("读取查询结果失败: " + std::string(mysql_stmt_error(stmt)));
+        checkConnectionError(mysql_stmt_errno(stmt));
+    }
+    
+    mysql_stmt_free_result(stmt);
+    mysql_free_result(meta);
+    return results;
+}
+
+unsigned long long DBConnection::getLastInsertId() {
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return 0;
+    }
+    
+    return lastInsertId;
+}
+
+unsigned long long DBConnection::getAffectedRows() {
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return 0;
+    }
+    
+    return affectedRows;
+}
+
+bool DBConnection::beginTransaction() {
+    return executeQuery("START TRANSACTION");
+}
+
+bool DBConnection::commitTransaction() {
+    return executeQuery("COMMIT");
+}
+
+bool DBConnection::rollbackTransaction() {
+    return executeQuery("ROLLBACK");
+}
+
+std::string DBConnection::escapeString(const std::string& str) {
+    if (!connected || !mysql) {
+        LOG_ERROR("数据库未连接");
+        return str;
+    }
+    
+    char* buffer = new char[str.length() * 2 + 1];
+    mysql_real_escape_string(mysql, buffer, str.c_str(), str.length());
+    std::string result(buffer);
+    delete[] buffer;
+    
+    return result;
+}
+
+std::string DBConnection::getLastError() {
+    if (!mysql) {
+        return "MySQL未初始化";
+    }
+    
+    return mysql_error(mysql);
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "ap/db_connection_pool.h"
+#include "common/logger_enhanced.h"
+#include "common/trace.h"
+#include "common/metrics.h"
+#include <algorithm>
+
+DBConnectionPool::DBConnectionPool()
+    : port(3306), minSize(1), maxSize(1), checkoutTimeoutMs(1000), pingInterval(30), idleTimeout(300),
+      total(0), running(false), checkouts(0), exhausted(0), reconnects(0), totalWaitUs(0), maxWaitUs(0) {
+    // 导出时同步连接池状态：连接数设置到仪表，累计值按与计数器当前值的差补齐
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    Gauge& inUseGauge = registry.gauge("ap_db_connections_in_use", "借出的数据库连接数").get();
+    Gauge& idleGauge = registry.gauge("ap_db_connections_idle", "空闲的数据库连接数").get();
+    Counter& checkoutCounter = registry.counter("ap_db_checkouts_total", "成功借出数据库连接的次数").get();
+    Counter& exhaustedCounter = registry.counter(
+        "ap_db_pool_exhausted_total", "连接池耗尽、等待超时的次数").get();
+    Counter& reconnectCounter = registry.counter("ap_db_reconnects_total", "数据库连接失效后重连的次数").get();
+    Counter& waitCounter = registry.counter(
+        "ap_db_checkout_wait_microseconds_total", "借出数据库连接的累计等待时间（微秒）").get();
+    registry.addCollector([this, &inUseGauge, &idleGauge, &checkoutCounter, &exhaustedCounter,
+                           &reconnectCounter, &waitCounter]() {
+        // 并发导出时补齐计数器须串行，否则同一段差值会被重复累加
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        Metrics metrics = getMetrics();
+        inUseGauge.set(static_cast<int64_t>(metrics.inUse));
+        idleGauge.set(static_cast<int64_t>(metrics.idle));
+        checkoutCounter.inc(metrics.checkouts - checkoutCounter.value());
+        exhaustedCounter.inc(metrics.exhausted - exhaustedCounter.value());
+        reconnectCounter.inc(metrics.reconnects - reconnectCounter.value());
+        waitCounter.inc(metrics.totalWaitUs - waitCounter.value());
+    });
+}
+
+DBConnectionPool::~DBConnectionPool() {
+    shutdown();
+}
+
+DBConnectionPool& DBConnectionPool::getInstance() {
+    static DBConnectionPool instance;
+    return instance;
+}
+
+bool DBConnectionPool::init(const std::string& host, const std::string& user,
+                            const std::string& password, const std::string& database, unsigned int port,
+                            int minSize, int maxSize, int checkoutTimeoutMs, int pingIntervalSec, int idleTimeoutSec) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        this->host = host;
+        this->user = user;
+        this->password = password;
+        this->database = database;
+        this->port = port;
+        this->maxSize = maxSize > 0 ? maxSize : 1;
+        this->minSize = minSize > 0 ? std::min(minSize, this->maxSize) : 1;
+        this->checkoutTimeoutMs = checkoutTimeoutMs > 0 ? checkoutTimeoutMs : 1000;
+        this->pingInterval = pingIntervalSec > 0 ? pingIntervalSec : 30;
+        this->idleTimeout = idleTimeoutSec > 0 ? idleTimeoutSec : 300;
+        running = true;
+    }
+
+    LOG_SYSTEM("DBConnectionPool", "初始化数据库连接池",
+               "最小连接数: " + std::to_string(this->minSize) +
+               ", 最大连接数: " + std::to_string(this->maxSize) +
+               ", 取连接超时: " + std::to_string(this->checkoutTimeoutMs) + "毫秒");
+
+    // 预先建立最小连接数
+    for (int i = 0; i < this->minSize; ++i) {
+        std::unique_ptr<DBConnection> conn = createConnection();
+        if (!conn) {
+            break;
+        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        total++;
+        idle.push_back(std::move(conn));
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (idle.empty()) {
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void DBConnectionPool::shutdown() {
+    std::vector<std::unique_ptr<DBConnection>> closing;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        total -= idle.size();
+        closing.swap(idle);
+    }
+    available.notify_all();
+
+    Metrics metrics = getMetrics();
+    LOG_SYSTEM("DBConnectionPool", "关闭数据库连接池",
+               "借出次数: " + std::to_string(metrics.checkouts) +
+               ", 耗尽次数: " + std::to_string(metrics.exhausted) +
+               ", 重连次数: " + std::to_string(metrics.reconnects) +
+               ", 最长等待: " + std::to_string(metrics.maxWaitUs / 1000) + "毫秒");
+}
+
+std::unique_ptr<DBConnection> DBConnectionPool::createConnection() {
+    std::unique_ptr<DBConnection> conn(new DBConnection());
+    if (!conn->connect(host, user, password, database, port)) {
+        return nullptr;
+    }
+    return conn;
+}
+
+bool DBConnectionPool::validate(DBConnection& conn) {
+    // 近期使用过且未出错的连接直接使用，避免每次取出都多一次往返
+    if (conn.isUsable() && time(nullptr) - conn.getLastUsed() < pingInterval) {
+        return true;
+    }
+    if (conn.isUsable() && conn.ping()) {
+        return true;
+    }
+
+    reconnects++;
+    LOG_WARNING("数据库连接已失效，重新连接");
+    return conn.reconnect();
+}
+
+void DBConnectionPool::recordWait(std::chrono::steady_clock::time_point start) {
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    checkouts++;
+    totalWaitUs += waitUs;
+
+    uint64_t currentMax = maxWaitUs.load();
+    while (waitUs > currentMax && !maxWaitUs.compare_exchange_weak(currentMax, waitUs)) {
+    }
+}
+
+DBConnectionPool::Handle DBConnectionPool::acquire() {
+    ScopedSpan span("db.acquire");
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(checkoutTimeoutMs);
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    while (running) {
+        // 1. 优先使用最近归还的空闲连接
+        if (!idle.empty()) {
+            std::unique_ptr<DBConnection> conn = std::move(idle.back());
+            idle.pop_back();
+            lock.unlock();
+
+            if (validate(*conn)) {
+                recordWait(start);
+                return Handle(this, std::move(conn));
+            }
+
+            // 重连失败，丢弃该连接后继续等待其他连接
+            conn.reset();
+            lock.lock();
+            total--;
+            continue;
+        }
+
+        // 2. 未达到上限时新建连接
+        if (total < static_cast<size_t>(maxSize)) {
+            total++;
+            lock.unlock();
+
+            std::unique_ptr<DBConnection> conn = createConnection();
+            if (conn) {
+                recordWait(start);
+                return Handle(this, std::move(conn));
+            }
+
+            lock.lock();
+            total--;
+            available.notify_one();
+            return Handle();
+        }
+
+        // 3. 连接池耗尽，等待归还
+        if (available.wait_until(lock, deadline) == std::cv_status::timeout &&
+            idle.empty() && total >= static_cast<size_t>(maxSize)) {
+            exhausted++;
+            LOG_WARNING_LIMITED("数据库连接池耗尽，等待超时 (最大连接数: " + std::to_string(maxSize) + ")", 1);
+            return Handle();
+        }
+    }
+
+    return Handle();
+}
+
+void DBConnectionPool::release(std::unique_ptr<DBConnection> conn) {
+    conn->touch();
+
+    std::unique_ptr<DBConnection> expired;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!running) {
+            total--;
+            return;  // 连接池已关闭，连接在锁外析构
+        }
+
+        idle.push_back(std::move(conn));
+
+        // 超过最小连接数时，关闭空闲最久的一个超时连接
+        if (total > static_cast<size_t>(minSize) && idle.size() > 1 &&
+            time(nullptr) - idle.front()->getLastUsed() >= idleTimeout) {
+            expired = std::move(idle.front());
+            idle.erase(idle.begin());
+            total--;
+        }
+    }
+    available.notify_one();
+}
+
+DBConnectionPool::Metrics DBConnectionPool::getMetrics() const {
+    Metrics metrics;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        metrics.total = total;
+        metrics.idle = idle.size();
+        metrics.inUse = total - idle.size();
+    }
+    metrics.checkouts = checkouts;
+    metrics.exhausted = exhausted;
+    metrics.reconnects = reconnects;
+    metrics.totalWaitUs = totalWaitUs;
+    metrics.maxWaitUs = maxWaitUs;
+    return metrics;
+}
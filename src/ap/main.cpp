@@ -1,7 +1,8 @@
 #include "ap/processor.h"
-#include "ap/db_manager.h"
+#include "ap/db_connection_pool.h"
 #include "common/config.h"
 #include "common/logger_enhanced.h"
+#include "common/trace.h"
 #include <iostream>
 #include <signal.h>
 #include <unistd.h>
@@ -22,6 +23,33 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // 日志文件格式和控制台输出（二进制格式用logdecode工具查看）
+    EnhancedLogger::getInstance().enableConsoleOutput(Config::getInstance().getBool("log.console", true));
+    if (Config::getInstance().getString("log.format", "text") == "binary") {
+        EnhancedLogger::getInstance().setFileFormat(LogFileFormat::BINARY);
+    }
+    
+    // 过载保护：成功请求的日志按1/N采样，刷屏的日志按调用点限流，定期汇总被跳过的条数
+    EnhancedLogger::getInstance().setRequestSampling(Config::getInstance().getInt("log.sample.requests", 1));
+    EnhancedLogger::getInstance().setSuppressedReportInterval(Config::getInstance().getInt("log.rate_limit.report_interval", 10));
+    
+    // 异步日志：业务线程只负责格式化和入队，由后台线程批量写出
+    if (Config::getInstance().getBool("log.async", false)) {
+        LogOverflowPolicy policy = LogOverflowPolicy::DROP_DEBUG;
+        std::string policyName = Config::getInstance().getString("log.overflow_policy", "drop_debug");
+        if (!EnhancedLogger::parseOverflowPolicy(policyName, policy)) {
+            LOG_ERROR("log.overflow_policy配置无效: " + policyName + "，使用drop_debug");
+        }
+        EnhancedLogger::getInstance().startAsync(Config::getInstance().getInt("log.queue_size", 65536), policy);
+    }
+    
+    // 请求追踪：总耗时超过阈值的请求保留各阶段耗时，通过AP端口的/api/admin/traces查看
+    TraceCollector::getInstance().configure("AP",
+        Config::getInstance().getBool("trace.enabled", false),
+        Config::getInstance().getInt("trace.slow_threshold_ms", 100),
+        Config::getInstance().getInt("trace.buffer_size", 100));
+    TraceCollector::getInstance().setAdminEnabled(Config::getInstance().getBool("trace.admin_enabled", false));
+    
     // 获取配置
     int port = Config::getInstance().getInt("ap.port", 8081);
     std::string dbHost = Config::getInstance().getString("db.host", "localhost");
@@ -30,8 +58,13 @@ int main(int argc, char* argv[]) {
     std::string dbName = Config::getInstance().getString("db.name", "myapp");
     int dbPort = Config::getInstance().getInt("db.port", 3306);
     
-    // 连接数据库
-    if (!DBManager::getInstance().connect(dbHost, dbUser, dbPassword, dbName, dbPort)) {
+    // 初始化数据库连接池
+    if (!DBConnectionPool::getInstance().init(dbHost, dbUser, dbPassword, dbName, dbPort,
+            Config::getInstance().getInt("db.pool.min", 2),
+            Config::getInstance().getInt("db.pool.max", 8),
+            Config::getInstance().getInt("db.pool.checkout_timeout_ms", 1000),
+            Config::getInstance().getInt("db.pool.ping_interval", 30),
+            Config::getInstance().getInt("db.pool.idle_timeout", 300))) {
         LOG_ERROR("连接数据库失败");
         return 1;
     }
@@ -50,9 +83,13 @@ int main(int argc, char* argv[]) {
     Processor::getInstance().registerProcessor("user.create", [](const std::string& data) -> std::string {
         // 这里应该解析data，然后插入数据库
         // 简化示例：
+        DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+        if (!db) {
+            return "{\"error\":\"数据库连接繁忙，请稍后重试\",\"success\":false}";
+        }
         std::string query = "INSERT INTO users (name, email) VALUES ('测试用户', 'test@example.com')";
-        if (DBManager::getInstance().executeQuery(query)) {
-            unsigned long long id = DBManager::getInstance().getLastInsertId();
+        if (db->executePrepared(query, {})) {
+            unsigned long long id = db->getLastInsertId();
             return "{\"id\":" + std::to_string(id) + ",\"success\":true}";
         } else {
             return "{\"error\":\"创建用户失败\",\"success\":false}";
@@ -61,8 +98,12 @@ int main(int argc, char* argv[]) {
     
     Processor::getInstance().registerProcessor("user.update", [](const std::string& data) -> std::string {
         // 简化示例：
+        DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+        if (!db) {
+            return "{\"error\":\"数据库连接繁忙，请稍后重试\",\"success\":false}";
+        }
         std::string query = "UPDATE users SET name = '更新用户' WHERE id = 1";
-        if (DBManager::getInstance().executeQuery(query)) {
+        if (db->executePrepared(query, {})) {
             return "{\"success\":true}";
         } else {
             return "{\"error\":\"更新用户失败\",\"success\":false}";
@@ -71,8 +112,12 @@ int main(int argc, char* argv[]) {
     
     Processor::getInstance().registerProcessor("user.delete", [](const std::string& data) -> std::string {
         // 简化示例：
+        DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+        if (!db) {
+            return "{\"error\":\"数据库连接繁忙，请稍后重试\",\"success\":false}";
+        }
         std::string query = "DELETE FROM users WHERE id = 1";
-        if (DBManager::getInstance().executeQuery(query)) {
+        if (db->executePrepared(query, {})) {
             return "{\"success\":true}";
         } else {
             return "{\"error\":\"删除用户失败\",\"success\":false}";
@@ -92,9 +137,13 @@ int main(int argc, char* argv[]) {
         sleep(1);
     }
     
-    // 断开数据库连接
-    DBManager::getInstance().disconnect();
+    // 等待事件循环和工作线程退出后再断开数据库
+    Processor::getInstance().waitForStop();
+    
+    // 关闭数据库连接池
+    DBConnectionPool::getInstance().shutdown();
     
     LOG_INFO("AP处理服务已停止");
+    EnhancedLogger::getInstance().stopAsync();
     return 0;
 }
\ No newline at end of file
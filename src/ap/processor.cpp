@@ -1,27 +1,150 @@
 #include "ap/processor.h"
-#include "ap/db_manager.h"
+#include "ap/db_connection_pool.h"
 #include "common/logger_enhanced.h"
 #include "common/config.h"
+#include "common/ap_protocol.h"
+#include "common/json_writer.h"
+#include "common/trace.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <thread>
+#include <vector>
 #include <cstring>
 #include <sstream>
 #include <chrono>
 #include <random>
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
+namespace {
+    // 向UPDATE语句的SET子句追加一个字段，参数值引用调用方的字符串
+    void addUpdateField(std::string& fields, std::vector<DBParam>& params,
+                        const char* column, const std::string& value) {
+        if (!params.empty()) {
+            fields += ", ";
+        }
+        fields += column;
+        fields += " = ?";
+        params.emplace_back(value);
+    }
+    
+    // 结果集单元格转为JSON字符串，NULL列保持原来输出的"NULL"
+    nlohmann::json columnValue(const ResultSet::Row& row, size_t column) {
+        if (row.isNull(column)) {
+            return "NULL";
+        }
+        return row[column];
+    }
+    
+    // 读取非负整数参数，支持JSON数字和数字字符串（来自DISP的查询参数），参数不存在时使用默认值
+    bool readCountParam(const nlohmann::json& request, const char* name, long long defaultValue, long long& value) {
+        if (!request.contains(name) || request[name].is_null()) {
+            value = defaultValue;
+            return true;
+        }
+        
+        const nlohmann::json& param = request[name];
+        if (param.is_number_unsigned() || param.is_number_integer()) {
+            value = param.get<long long>();
+            return value >= 0;
+        }
+        if (param.is_string()) {
+            const std::string& text = param.get_ref<const std::string&>();
+            if (text.empty()) {
+                value = defaultValue;
+                return true;
+            }
+            if (text.length() > 18 || text.find_first_not_of("0123456789") != std::string::npos) {
+                return false;
+            }
+            value = std::stoll(text);
+            return true;
+        }
+        return false;
+    }
+    
+    // 按id倒序的键集分页查询，多取一行用于判断是否还有下一页
+    ResultSet selectPage(DBConnection& db, const std::string& query, const Processor::PageRequest& page) {
+        if (page.afterId > 0) {
+            return db.selectPrepared(query + " WHERE id < ? ORDER BY id DESC LIMIT ?", {page.afterId, page.limit + 1});
+        }
+        return db.selectPrepared(query + " ORDER BY id DESC LIMIT ?", {page.limit + 1});
+    }
+    
+    // 结果集单元格写为JSON字符串，NULL列保持原来输出的"NULL"
+    void writeColumn(JsonWriter& writer, const ResultSet::Row& row, size_t column) {
+        if (row.isNull(column)) {
+            writer.value("NULL");
+        } else {
+            writer.value(row[column]);
+        }
+    }
+    
+    /**
+     * 分页响应：{"items":[...],"limit":"N","next_cursor":"id"}
+     * 每行以列名为键直接从结果集写入响应字符串，不构造中间的JSON对象；
+     * 还有下一页时next_cursor为本页最后一条记录的id，作为下次请求的after_id
+     */
+    std::string writePage(const ResultSet& result, const Processor::PageRequest& page) {
+        size_t count = std::min(result.rowCount(), static_cast<size_t>(page.limit));
+        
+        std::string response;
+        response.reserve(result.bufferSize() + count * result.columnCount() * 16 + 64);
+        
+        JsonWriter writer(response);
+        writer.beginObject().key("items").beginArray();
+        for (size_t i = 0; i < count; ++i) {
+            ResultSet::Row row = result[i];
+            writer.beginObject();
+            for (size_t column = 0; column < result.columnCount(); ++column) {
+                writer.key(result.columnName(column));
+                writeColumn(writer, row, column);
+            }
+            writer.endObject();
+        }
+        writer.endArray();
+        
+        writer.key("limit").value(std::to_string(page.limit));
+        writer.key("next_cursor");
+        if (result.rowCount() > count) {
+            writeColumn(writer, result[count - 1], 0);
+        } else {
+            writer.null();
+        }
+        writer.endObject();
+        return response;
+    }
+}
+
+Processor::Processor()
+    : acceptedConnections(MetricsRegistry::getInstance().counter(
+          "ap_connections_accepted_total", "AP已接受的连接数").get()),
+      activeConnections(MetricsRegistry::getInstance().gauge(
+          "ap_active_connections", "AP当前的连接数").get()),
+      rejectedRequests(MetricsRegistry::getInstance().counter(
+          "ap_requests_rejected_total", "请求队列已满时拒绝的请求数").get()),
+      queueDepth(MetricsRegistry::getInstance().gauge(
+          "ap_queue_depth", "等待工作线程处理的请求数").get()),
+      requestDuration(MetricsRegistry::getInstance().histogram(
+          "ap_request_duration_seconds", "AP业务处理耗时（含数据库访问）", "type")) {
+    MetricsRegistry::getInstance().addCollector([this]() {
+        queueDepth.set(static_cast<int64_t>(workers.queueDepth()));
+    });
+}
+
 Processor& Processor::getInstance() {
     static Processor instance;
     return instance;
 }
 
 std::string Processor::generateRequestId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(1000, 9999);
+    // 工作线程并发生成请求ID，每个线程使用独立的随机数引擎
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> dis(1000, 9999);
     
     auto now = std::chrono::system_clock::now();
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
@@ -36,29 +159,39 @@ bool Processor::init() {
     EnhancedLogger::getInstance().setProcessName("AP");
     
     LOG_SYSTEM("Processor", "初始化开始", "");
+    
+    maxPageLimit = std::max(Config::getInstance().getInt("ap.page.max_limit", 100), 1);
+    defaultPageLimit = std::min(std::max(Config::getInstance().getInt("ap.page.default_limit", 20), 1), maxPageLimit);
+    
     // 注册用户相关的处理函数（更新为包含新字段）
     registerProcessor("user.get", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"用户ID不能为空\"}";
             }
             
-            std::string query = "SELECT id, name, email, phone, role, status, created_at FROM users WHERE id = " + id;
-            auto result = DBManager::getInstance().executeSelect(query);
+            auto result = db->selectPrepared(
+                "SELECT id, name, email, phone, role, status, created_at FROM users WHERE id = ?", {id});
             
             if (result.empty()) {
                 return "{\"error\":\"用户不存在\"}";
             }
             
+            ResultSet::Row row = result[0];
             nlohmann::json user;
-            user["id"] = result[0][0];
-            user["name"] = result[0][1];
-            user["email"] = result[0][2];
-            user["phone"] = result[0][3];
-            user["role"] = result[0][4];
-            user["status"] = result[0][5];
-            user["created_at"] = result[0][6];
+            user["id"] = columnValue(row, 0);
+            user["name"] = columnValue(row, 1);
+            user["email"] = columnValue(row, 2);
+            user["phone"] = columnValue(row, 3);
+            user["role"] = columnValue(row, 4);
+            user["status"] = columnValue(row, 5);
+            user["created_at"] = columnValue(row, 6);
             
             return user.dump();
         } catch (const std::exception& e) {
@@ -66,25 +199,22 @@ bool Processor::init() {
         }
     });
     
-    registerProcessor("user.list", [](const nlohmann::json& request) -> std::string {
+    registerProcessor("user.list", [this](const nlohmann::json& request) -> std::string {
         try {
-            std::string query = "SELECT id, name, email, phone, role, status, created_at FROM users ORDER BY id DESC";
-            auto result = DBManager::getInstance().executeSelect(query);
+            PageRequest page;
+            std::string error;
+            if (!parsePageRequest(request, page, error)) {
+                return error;
+            }
             
-            nlohmann::json users = nlohmann::json::array();
-            for (const auto& row : result) {
-                nlohmann::json user;
-                user["id"] = row[0];
-                user["name"] = row[1];
-                user["email"] = row[2];
-                user["phone"] = row[3];
-                user["role"] = row[4];
-                user["status"] = row[5];
-                user["created_at"] = row[6];
-                users.push_back(user);
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
             }
             
-            return users.dump();
+            ResultSet result = selectPage(*db, "SELECT id, name, email, phone, role, status, created_at FROM users", page);
+            
+            return writePage(result, page);
         } catch (const std::exception& e) {
             return "{\"error\":\"获取用户列表失败: " + std::string(e.what()) + "\"}";
         }
@@ -92,6 +222,11 @@ bool Processor::init() {
     
     registerProcessor("user.create", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string name = request.value("name", "");
             std::string email = request.value("email", "");
             std::string phone = request.value("phone", "");
@@ -103,20 +238,11 @@ bool Processor::init() {
                 return "{\"error\":\"用户名和邮箱不能为空\"}";
             }
             
-            // 转义字符串防止SQL注入
-            name = DBManager::getInstance().escapeString(name);
-            email = DBManager::getInstance().escapeString(email);
-            phone = DBManager::getInstance().escapeString(phone);
-            role = DBManager::getInstance().escapeString(role);
-            status = DBManager::getInstance().escapeString(status);
-            password = DBManager::getInstance().escapeString(password);
-            
-            std::string query = "INSERT INTO users (name, email, phone, password, role, status, created_at) VALUES ('" +
-                               name + "', '" + email + "', '" + phone + "', '" + password + "', '" + 
-                               role + "', '" + status + "', NOW())";
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                unsigned long long id = DBManager::getInstance().getLastInsertId();
+            // 参数绑定，无需转义
+            if (db->executePrepared(
+                    "INSERT INTO users (name, email, phone, password, role, status, created_at) VALUES (?, ?, ?, ?, ?, ?, NOW())",
+                    {name, email, phone, password, role, status})) {
+                unsigned long long id = db->getLastInsertId();
                 nlohmann::json user;
                 user["id"] = id;
                 user["name"] = request["name"];
@@ -136,44 +262,42 @@ bool Processor::init() {
     
     registerProcessor("user.update", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"用户ID不能为空\"}";
             }
             
-            // 构建更新字段
-            std::vector<std::string> updates;
+            // 构建更新字段，参数值直接引用请求中的字符串
+            std::string updateFields;
+            std::vector<DBParam> params;
             if (request.contains("name") && !request["name"].get<std::string>().empty()) {
-                updates.push_back("name = '" + DBManager::getInstance().escapeString(request["name"]) + "'");
+                addUpdateField(updateFields, params, "name", request["name"].get_ref<const std::string&>());
             }
             if (request.contains("email") && !request["email"].get<std::string>().empty()) {
-                updates.push_back("email = '" + DBManager::getInstance().escapeString(request["email"]) + "'");
+                addUpdateField(updateFields, params, "email", request["email"].get_ref<const std::string&>());
             }
             if (request.contains("phone")) {
-                updates.push_back("phone = '" + DBManager::getInstance().escapeString(request["phone"]) + "'");
+                addUpdateField(updateFields, params, "phone", request["phone"].get_ref<const std::string&>());
             }
             if (request.contains("role") && !request["role"].get<std::string>().empty()) {
-                updates.push_back("role = '" + DBManager::getInstance().escapeString(request["role"]) + "'");
+                addUpdateField(updateFields, params, "role", request["role"].get_ref<const std::string&>());
             }
             if (request.contains("status") && !request["status"].get<std::string>().empty()) {
-                updates.push_back("status = '" + DBManager::getInstance().escapeString(request["status"]) + "'");
+                addUpdateField(updateFields, params, "status", request["status"].get_ref<const std::string&>());
             }
             
-            if (updates.empty()) {
+            if (params.empty()) {
                 return "{\"error\":\"没有要更新的字段\"}";
             }
+            params.emplace_back(id);
             
-            std::string updateFields;
-            for (size_t i = 0; i < updates.size(); ++i) {
-                if (i > 0) updateFields += ", ";
-                updateFields += updates[i];
-            }
-            
-            std::string query = "UPDATE users SET " + updateFields +
-                               ", updated_at = NOW() WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("UPDATE users SET " + updateFields + ", updated_at = NOW() WHERE id = ?", params)) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"用户更新成功\"}";
                 } else {
                     return "{\"error\":\"用户不存在\"}";
@@ -188,15 +312,18 @@ bool Processor::init() {
     
     registerProcessor("user.delete", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"用户ID不能为空\"}";
             }
             
-            std::string query = "DELETE FROM users WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("DELETE FROM users WHERE id = ?", {id})) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"用户删除成功\"}";
                 } else {
                     return "{\"error\":\"用户不存在\"}";
@@ -210,26 +337,22 @@ bool Processor::init() {
     });
     
     // 注册产品相关的处理函数（更新为包含新字段）
-    registerProcessor("product.list", [](const nlohmann::json& request) -> std::string {
+    registerProcessor("product.list", [this](const nlohmann::json& request) -> std::string {
         try {
-            std::string query = "SELECT id, name, category, description, price, stock, status, created_at FROM products ORDER BY id DESC";
-            auto result = DBManager::getInstance().executeSelect(query);
+            PageRequest page;
+            std::string error;
+            if (!parsePageRequest(request, page, error)) {
+                return error;
+            }
             
-            nlohmann::json products = nlohmann::json::array();
-            for (const auto& row : result) {
-                nlohmann::json product;
-                product["id"] = row[0];
-                product["name"] = row[1];
-                product["category"] = row[2];
-                product["description"] = row[3];
-                product["price"] = row[4];
-                product["stock"] = row[5];
-                product["status"] = row[6];
-                product["created_at"] = row[7];
-                products.push_back(product);
-            }
-            
-            return products.dump();
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
+            ResultSet result = selectPage(*db, "SELECT id, name, category, description, price, stock, status, created_at FROM products", page);
+            
+            return writePage(result, page);
         } catch (const std::exception& e) {
             return "{\"error\":\"获取产品列表失败: " + std::string(e.what()) + "\"}";
         }
@@ -237,27 +360,33 @@ bool Processor::init() {
     
     registerProcessor("product.get", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"产品ID不能为空\"}";
             }
             
-            std::string query = "SELECT id, name, category, description, price, stock, status, created_at FROM products WHERE id = " + id;
-            auto result = DBManager::getInstance().executeSelect(query);
+            auto result = db->selectPrepared(
+                "SELECT id, name, category, description, price, stock, status, created_at FROM products WHERE id = ?", {id});
             
             if (result.empty()) {
                 return "{\"error\":\"产品不存在\"}";
             }
             
+            ResultSet::Row row = result[0];
             nlohmann::json product;
-            product["id"] = result[0][0];
-            product["name"] = result[0][1];
-            product["category"] = result[0][2];
-            product["description"] = result[0][3];
-            product["price"] = result[0][4];
-            product["stock"] = result[0][5];
-            product["status"] = result[0][6];
-            product["created_at"] = result[0][7];
+            product["id"] = columnValue(row, 0);
+            product["name"] = columnValue(row, 1);
+            product["category"] = columnValue(row, 2);
+            product["description"] = columnValue(row, 3);
+            product["price"] = columnValue(row, 4);
+            product["stock"] = columnValue(row, 5);
+            product["status"] = columnValue(row, 6);
+            product["created_at"] = columnValue(row, 7);
             
             return product.dump();
         } catch (const std::exception& e) {
@@ -267,6 +396,11 @@ bool Processor::init() {
     
     registerProcessor("product.create", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string name = request.value("name", "");
             std::string category = request.value("category", "electronics");
             std::string description = request.value("description", "");
@@ -288,17 +422,10 @@ bool Processor::init() {
                 return "{\"error\":\"价格格式无效\"}";
             }
             
-            name = DBManager::getInstance().escapeString(name);
-            category = DBManager::getInstance().escapeString(category);
-            description = DBManager::getInstance().escapeString(description);
-            status = DBManager::getInstance().escapeString(status);
-            
-            std::string query = "INSERT INTO products (name, category, description, price, stock, status, created_at) VALUES ('" +
-                               name + "', '" + category + "', '" + description + "', '" + price +
-                               "', '" + stock + "', '" + status + "', NOW())";
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                unsigned long long id = DBManager::getInstance().getLastInsertId();
+            if (db->executePrepared(
+                    "INSERT INTO products (name, category, description, price, stock, status, created_at) VALUES (?, ?, ?, ?, ?, ?, NOW())",
+                    {name, category, description, price, stock, status})) {
+                unsigned long long id = db->getLastInsertId();
                 nlohmann::json product;
                 product["id"] = id;
                 product["name"] = request["name"];
@@ -319,49 +446,45 @@ bool Processor::init() {
     
     registerProcessor("product.update", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"产品ID不能为空\"}";
             }
             
-            std::vector<std::string> updates;
+            std::string updateFields;
+            std::vector<DBParam> params;
             
             if (request.contains("name") && !request["name"].get<std::string>().empty()) {
-                updates.push_back("name = '" + DBManager::getInstance().escapeString(request["name"]) + "'");
+                addUpdateField(updateFields, params, "name", request["name"].get_ref<const std::string&>());
             }
             if (request.contains("category") && !request["category"].get<std::string>().empty()) {
-                updates.push_back("category = '" + DBManager::getInstance().escapeString(request["category"]) + "'");
+                addUpdateField(updateFields, params, "category", request["category"].get_ref<const std::string&>());
             }
             if (request.contains("description")) {
-                updates.push_back("description = '" + DBManager::getInstance().escapeString(request["description"]) + "'");
+                addUpdateField(updateFields, params, "description", request["description"].get_ref<const std::string&>());
             }
             if (request.contains("price") && !request["price"].get<std::string>().empty()) {
-                std::string price = request["price"].get<std::string>();
-                updates.push_back("price = '" + DBManager::getInstance().escapeString(price) + "'");
+                addUpdateField(updateFields, params, "price", request["price"].get_ref<const std::string&>());
             }
             if (request.contains("stock") && !request["stock"].get<std::string>().empty()) {
-                std::string stock = request["stock"].get<std::string>();
-                updates.push_back("stock = '" + DBManager::getInstance().escapeString(stock) + "'");
+                addUpdateField(updateFields, params, "stock", request["stock"].get_ref<const std::string&>());
             }
             if (request.contains("status") && !request["status"].get<std::string>().empty()) {
-                updates.push_back("status = '" + DBManager::getInstance().escapeString(request["status"]) + "'");
+                addUpdateField(updateFields, params, "status", request["status"].get_ref<const std::string&>());
             }
             
-            if (updates.empty()) {
+            if (params.empty()) {
                 return "{\"error\":\"没有要更新的字段\"}";
             }
+            params.emplace_back(id);
             
-            std::string updateFields;
-            for (size_t i = 0; i < updates.size(); ++i) {
-                if (i > 0) updateFields += ", ";
-                updateFields += updates[i];
-            }
-            
-            std::string query = "UPDATE products SET " + updateFields +
-                               ", updated_at = NOW() WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("UPDATE products SET " + updateFields + ", updated_at = NOW() WHERE id = ?", params)) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"产品更新成功\"}";
                 } else {
                     return "{\"error\":\"产品不存在\"}";
@@ -376,15 +499,18 @@ bool Processor::init() {
     
     registerProcessor("product.delete", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"产品ID不能为空\"}";
             }
             
-            std::string query = "DELETE FROM products WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("DELETE FROM products WHERE id = ?", {id})) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"产品删除成功\"}";
                 } else {
                     return "{\"error\":\"产品不存在\"}";
@@ -398,26 +524,22 @@ bool Processor::init() {
     });
     
     // 注册订单相关的处理函数（更新为简化的结构）
-    registerProcessor("order.list", [](const nlohmann::json& request) -> std::string {
+    registerProcessor("order.list", [this](const nlohmann::json& request) -> std::string {
         try {
-            std::string query = "SELECT id, user_id, customer_name, product_name, quantity, total_amount, status, created_at FROM orders ORDER BY id DESC";
-            auto result = DBManager::getInstance().executeSelect(query);
+            PageRequest page;
+            std::string error;
+            if (!parsePageRequest(request, page, error)) {
+                return error;
+            }
             
-            nlohmann::json orders = nlohmann::json::array();
-            for (const auto& row : result) {
-                nlohmann::json order;
-                order["id"] = row[0];
-                order["user_id"] = row[1];
-                order["customer_name"] = row[2];
-                order["product_name"] = row[3];
-                order["quantity"] = row[4];
-                order["total_amount"] = row[5];
-                order["status"] = row[6];
-                order["created_at"] = row[7];
-                orders.push_back(order);
-            }
-            
-            return orders.dump();
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
+            ResultSet result = selectPage(*db, "SELECT id, user_id, customer_name, product_name, quantity, total_amount, status, created_at FROM orders", page);
+            
+            return writePage(result, page);
         } catch (const std::exception& e) {
             return "{\"error\":\"获取订单列表失败: " + std::string(e.what()) + "\"}";
         }
@@ -425,27 +547,33 @@ bool Processor::init() {
     
     registerProcessor("order.get", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"订单ID不能为空\"}";
             }
             
-            std::string query = "SELECT id, user_id, customer_name, product_name, quantity, total_amount, status, created_at FROM orders WHERE id = " + id;
-            auto result = DBManager::getInstance().executeSelect(query);
+            auto result = db->selectPrepared(
+                "SELECT id, user_id, customer_name, product_name, quantity, total_amount, status, created_at FROM orders WHERE id = ?", {id});
             
             if (result.empty()) {
                 return "{\"error\":\"订单不存在\"}";
             }
             
+            ResultSet::Row row = result[0];
             nlohmann::json order;
-            order["id"] = result[0][0];
-            order["user_id"] = result[0][1];
-            order["customer_name"] = result[0][2];
-            order["product_name"] = result[0][3];
-            order["quantity"] = result[0][4];
-            order["total_amount"] = result[0][5];
-            order["status"] = result[0][6];
-            order["created_at"] = result[0][7];
+            order["id"] = columnValue(row, 0);
+            order["user_id"] = columnValue(row, 1);
+            order["customer_name"] = columnValue(row, 2);
+            order["product_name"] = columnValue(row, 3);
+            order["quantity"] = columnValue(row, 4);
+            order["total_amount"] = columnValue(row, 5);
+            order["status"] = columnValue(row, 6);
+            order["created_at"] = columnValue(row, 7);
             
             return order.dump();
         } catch (const std::exception& e) {
@@ -455,6 +583,11 @@ bool Processor::init() {
     
     registerProcessor("order.create", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string customerName = request.value("customer_name", "");
             std::string productName = request.value("product_name", "");
             std::string quantity = request.value("quantity", "1");
@@ -466,16 +599,10 @@ bool Processor::init() {
                 return "{\"error\":\"客户名称、产品名称、数量和总金额不能为空\"}";
             }
             
-            customerName = DBManager::getInstance().escapeString(customerName);
-            productName = DBManager::getInstance().escapeString(productName);
-            status = DBManager::getInstance().escapeString(status);
-            
-            std::string query = "INSERT INTO orders (user_id, customer_name, product_name, quantity, total_amount, status, created_at) VALUES ('" +
-                               userId + "', '" + customerName + "', '" + productName + "', '" +
-                               quantity + "', '" + totalAmount + "', '" + status + "', NOW())";
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                unsigned long long id = DBManager::getInstance().getLastInsertId();
+            if (db->executePrepared(
+                    "INSERT INTO orders (user_id, customer_name, product_name, quantity, total_amount, status, created_at) VALUES (?, ?, ?, ?, ?, ?, NOW())",
+                    {userId, customerName, productName, quantity, totalAmount, status})) {
+                unsigned long long id = db->getLastInsertId();
                 nlohmann::json order;
                 order["id"] = id;
                 order["user_id"] = userId;
@@ -496,46 +623,42 @@ bool Processor::init() {
     
     registerProcessor("order.update", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"订单ID不能为空\"}";
             }
             
-            std::vector<std::string> updates;
+            std::string updateFields;
+            std::vector<DBParam> params;
             
             if (request.contains("customer_name") && !request["customer_name"].get<std::string>().empty()) {
-                updates.push_back("customer_name = '" + DBManager::getInstance().escapeString(request["customer_name"]) + "'");
+                addUpdateField(updateFields, params, "customer_name", request["customer_name"].get_ref<const std::string&>());
             }
             if (request.contains("product_name") && !request["product_name"].get<std::string>().empty()) {
-                updates.push_back("product_name = '" + DBManager::getInstance().escapeString(request["product_name"]) + "'");
+                addUpdateField(updateFields, params, "product_name", request["product_name"].get_ref<const std::string&>());
             }
             if (request.contains("quantity") && !request["quantity"].get<std::string>().empty()) {
-                std::string quantity = request["quantity"].get<std::string>();
-                updates.push_back("quantity = '" + DBManager::getInstance().escapeString(quantity) + "'");
+                addUpdateField(updateFields, params, "quantity", request["quantity"].get_ref<const std::string&>());
             }
             if (request.contains("total_amount") && !request["total_amount"].get<std::string>().empty()) {
-                std::string totalAmount = request["total_amount"].get<std::string>();
-                updates.push_back("total_amount = '" + DBManager::getInstance().escapeString(totalAmount) + "'");
+                addUpdateField(updateFields, params, "total_amount", request["total_amount"].get_ref<const std::string&>());
             }
             if (request.contains("status") && !request["status"].get<std::string>().empty()) {
-                updates.push_back("status = '" + DBManager::getInstance().escapeString(request["status"]) + "'");
+                addUpdateField(updateFields, params, "status", request["status"].get_ref<const std::string&>());
             }
             
-            if (updates.empty()) {
+            if (params.empty()) {
                 return "{\"error\":\"没有要更新的字段\"}";
             }
+            params.emplace_back(id);
             
-            std::string updateFields;
-            for (size_t i = 0; i < updates.size(); ++i) {
-                if (i > 0) updateFields += ", ";
-                updateFields += updates[i];
-            }
-            
-            std::string query = "UPDATE orders SET " + updateFields +
-                               ", updated_at = NOW() WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("UPDATE orders SET " + updateFields + ", updated_at = NOW() WHERE id = ?", params)) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"订单更新成功\"}";
                 } else {
                     return "{\"error\":\"订单不存在\"}";
@@ -550,6 +673,11 @@ bool Processor::init() {
     
     registerProcessor("order.updateStatus", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             std::string status = request.value("status", "");
             
@@ -557,11 +685,8 @@ bool Processor::init() {
                 return "{\"error\":\"订单ID和状态不能为空\"}";
             }
             
-            std::string query = "UPDATE orders SET status = '" + DBManager::getInstance().escapeString(status) +
-                               "', updated_at = NOW() WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("UPDATE orders SET status = ?, updated_at = NOW() WHERE id = ?", {status, id})) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"订单状态更新成功\"}";
                 } else {
                     return "{\"error\":\"订单不存在\"}";
@@ -576,15 +701,18 @@ bool Processor::init() {
     
     registerProcessor("order.delete", [](const nlohmann::json& request) -> std::string {
         try {
+            DBConnectionPool::Handle db = DBConnectionPool::getInstance().acquire();
+            if (!db) {
+                return "{\"error\":\"数据库连接繁忙，请稍后重试\"}";
+            }
+            
             std::string id = request["id"];
             if (id.empty()) {
                 return "{\"error\":\"订单ID不能为空\"}";
             }
             
-            std::string query = "DELETE FROM orders WHERE id = " + id;
-            
-            if (DBManager::getInstance().executeQuery(query)) {
-                if (DBManager::getInstance().getAffectedRows() > 0) {
+            if (db->executePrepared("DELETE FROM orders WHERE id = ?", {id})) {
+                if (db->getAffectedRows() > 0) {
                     return "{\"success\":true,\"message\":\"订单删除成功\"}";
                 } else {
                     return "{\"error\":\"订单不存在\"}";
@@ -612,6 +740,8 @@ std::string Processor::processRequest(const std::string& requestType, const nloh
     // 查找对应的处理函数
     auto it = processors.find(requestType);
     if (it != processors.end()) {
+        HistogramTimer timer(requestDuration.get(requestType));
+        ScopedSpan span("ap.handler", requestType);
         try {
             std::string response = it->second(requestData);
             
@@ -639,6 +769,21 @@ void Processor::registerProcessor(const std::string& requestType, ProcessFunc pr
     LOG_SYSTEM("Processor", "注册处理函数", requestType);
 }
 
+bool Processor::parsePageRequest(const nlohmann::json& request, PageRequest& page, std::string& error) const {
+    if (!readCountParam(request, "limit", defaultPageLimit, page.limit) || page.limit == 0) {
+        error = "{\"error\":\"分页参数limit必须是正整数\"}";
+        return false;
+    }
+    if (!readCountParam(request, "after_id", 0, page.afterId)) {
+        error = "{\"error\":\"分页参数after_id必须是非负整数\"}";
+        return false;
+    }
+    
+    // 服务端限制单页条数，避免一次返回整张表
+    page.limit = std::min(page.limit, static_cast<long long>(maxPageLimit));
+    return true;
+}
+
 bool Processor::startService(int port) {
     if (running) {
         LOG_WARNING_CTX("服务已经在运行中", LogContext("", "", "", "port:" + std::to_string(servicePort)));
@@ -648,7 +793,7 @@ bool Processor::startService(int port) {
     LOG_SYSTEM("Processor", "启动服务", "端口: " + std::to_string(port));
     
     // 创建套接字
-    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    int serverSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     if (serverSocket < 0) {
         LOG_ERROR_DETAIL("", "SocketError", "创建套接字失败", "errno: " + std::to_string(errno));
         return false;
@@ -676,19 +821,44 @@ bool Processor::startService(int port) {
     }
     
     // 监听连接
-    if (listen(serverSocket, 10) < 0) {
+    if (listen(serverSocket, SOMAXCONN) < 0) {
         LOG_ERROR_DETAIL("", "ListenError", "监听连接失败", "errno: " + std::to_string(errno));
         close(serverSocket);
         return false;
     }
     
+    // 创建epoll实例和工作线程唤醒用的eventfd
+    epollFd = epoll_create1(0);
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (epollFd < 0 || wakeFd < 0) {
+        LOG_ERROR_DETAIL("", "EpollError", "创建epoll实例失败", "errno: " + std::to_string(errno));
+        if (epollFd >= 0) close(epollFd);
+        if (wakeFd >= 0) close(wakeFd);
+        epollFd = wakeFd = -1;
+        close(serverSocket);
+        return false;
+    }
+    
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = serverSocket;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, serverSocket, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    
+    // 工作线程数默认与数据库连接池上限一致，更多的线程只会在连接池上排队
+    int workerThreads = Config::getInstance().getInt("ap.workers", DBConnectionPool::getInstance().getMaxSize());
+    int queueLimit = Config::getInstance().getInt("ap.queue_limit", 256);
+    workers.start(workerThreads, queueLimit > 0 ? static_cast<size_t>(queueLimit) : 1);
+    
     // 保存端口
     servicePort = port;
+    keepAliveTimeout = Config::getInstance().getInt("ap.keepalive_timeout", 120);
     running = true;
     
     // 启动服务线程
-    std::thread serviceThread(&Processor::serviceLoop, this, serverSocket);
-    serviceThread.detach();
+    serviceThread = std::thread(&Processor::serviceLoop, this, serverSocket);
     
     LOG_SYSTEM("Processor", "服务启动成功", "监听端口: " + std::to_string(port));
     return true;
@@ -699,6 +869,17 @@ void Processor::stopService() {
     LOG_SYSTEM("Processor", "服务停止", "端口: " + std::to_string(servicePort));
 }
 
+void Processor::waitForStop() {
+    if (serviceThread.joinable()) {
+        serviceThread.join();
+    }
+}
+
+Processor::~Processor() {
+    running = false;
+    waitForStop();
+}
+
 bool Processor::isRunning()
 {
     return this->running;
@@ -706,86 +887,547 @@ bool Processor::isRunning()
 
 void Processor::serviceLoop(int serverSocket)
 {
-    struct sockaddr_in clientAddr;
-    socklen_t clientAddrLen = sizeof(clientAddr);
-    
     LOG_SYSTEM("ServiceLoop", "服务循环启动", "等待客户端连接");
     
+    struct epoll_event events[MAX_EVENTS];
+    time_t lastIdleCheck = time(nullptr);
+    
     while (running) {
-        // 接受连接
-        int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+        // 超时时间1秒以便检查运行状态和空闲连接；有等待发送间隔的按行请求时缩短
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, pendingLines.empty() ? 1000 : LINE_IDLE_GAP_MS);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR_DETAIL("", "EpollError", "epoll_wait失败", "errno: " + std::to_string(errno));
+            break;
+        }
+        
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == serverSocket) {
+                acceptConnections(serverSocket);
+            } else if (fd == wakeFd) {
+                uint64_t value;
+                while (read(wakeFd, &value, sizeof(value)) > 0) {
+                }
+                processCompletions();
+            } else {
+                handleSessionEvent(fd, events[i].events);
+            }
+        }
+        
+        if (!pendingLines.empty()) {
+            checkPendingLines();
+        }
+        
+        time_t now = time(nullptr);
+        if (now != lastIdleCheck) {
+            closeIdleSessions();
+            lastIdleCheck = now;
+        }
+    }
+    
+    // 等待已提交的请求处理完成，再关闭所有连接
+    workers.stop();
+    completions.clear();
+    pendingLines.clear();
+    for (const auto& pair : sessions) {
+        close(pair.first);
+    }
+    sessions.clear();
+    activeConnections.set(0);
+    close(serverSocket);
+    close(wakeFd);
+    close(epollFd);
+    wakeFd = epollFd = -1;
+    LOG_SYSTEM("ServiceLoop", "服务循环结束", "服务器套接字已关闭");
+}
+
+void Processor::acceptConnections(int serverSocket)
+{
+    while (true) {
+        struct sockaddr_in clientAddr;
+        socklen_t clientAddrLen = sizeof(clientAddr);
+        
+        int clientSocket = accept4(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen, SOCK_NONBLOCK);
         if (clientSocket < 0) {
-            if (running) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && running) {
                 LOG_ERROR_DETAIL("", "AcceptError", "接受连接失败", "errno: " + std::to_string(errno));
             }
+            return;
+        }
+        
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = clientSocket;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientSocket, &event) < 0) {
+            LOG_ERROR_DETAIL("", "EpollError", "添加连接到epoll失败", "errno: " + std::to_string(errno));
+            close(clientSocket);
             continue;
         }
         
         // 获取客户端IP地址
         char clientIpStr[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &clientAddr.sin_addr, clientIpStr, INET_ADDRSTRLEN);
-        std::string clientIp(clientIpStr);
         
-        LOG_DEBUG_CTX("接受新连接", LogContext("", clientIp, "", ""));
+        Session& session = sessions[clientSocket];
+        session.id = nextSessionId++;
+        session.clientIp = clientIpStr;
+        session.readBuffer.clear();
+        session.httpParser.reset();
+        session.writeBuffer.clear();
+        session.writePos = 0;
+        session.lastActivity = time(nullptr);
+        session.lastReceive = Trace::now();
+        session.protocol = SessionProtocol::UNKNOWN;
+        session.inFlight = 0;
+        session.wantWrite = false;
+        session.closeAfterWrite = false;
+        acceptedConnections.inc();
+        activeConnections.add(1);
+        
+        LOG_DEBUG_CTX("接受新连接", LogContext("", session.clientIp, "", ""));
+    }
+}
+
+void Processor::handleSessionEvent(int clientSocket, uint32_t events)
+{
+    auto it = sessions.find(clientSocket);
+    if (it == sessions.end()) {
+        return;
+    }
+    
+    Session& session = it->second;
+    if ((events & EPOLLOUT) && !flushSession(clientSocket, session)) {
+        closeSession(clientSocket);
+        return;
+    }
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !readSession(clientSocket, session)) {
+        closeSession(clientSocket);
+    }
+}
+
+bool Processor::readSession(int clientSocket, Session& session)
+{
+    const std::string& clientIp = session.clientIp;
+    
+    // 接收请求，大请求分多次到达时在缓冲区中累积
+    char buffer[16384];
+    ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+    if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return true;
+    }
+    if (bytesRead <= 0) {
+        LOG_DEBUG_CTX("客户端连接关闭或接收失败", LogContext("", clientIp));
+        return false;
+    }
+    
+    session.lastActivity = time(nullptr);
+    session.lastReceive = Trace::now();
+    session.readBuffer.append(buffer, bytesRead);
+    LOG_DEBUG_CTX("收到请求数据, 字节数: " + std::to_string(bytesRead), LogContext("", clientIp));
+    
+    // 帧以魔数开头，JSON不可能以该字节开头，据此兼容尚未升级的DISP；
+    // 以'G'开头的是指标采集的HTTP GET请求
+    if (session.protocol == SessionProtocol::UNKNOWN) {
+        uint8_t first = static_cast<uint8_t>(session.readBuffer[0]);
+        if (first == (ApProtocol::MAGIC >> 8)) {
+            session.protocol = SessionProtocol::FRAME;
+        } else if (first == 'G') {
+            session.protocol = SessionProtocol::HTTP;
+        } else {
+            session.protocol = SessionProtocol::LINE;
+        }
+    }
+    
+    bool ok;
+    if (session.protocol == SessionProtocol::FRAME) {
+        ok = handleFrames(clientSocket, session);
+    } else if (session.protocol == SessionProtocol::HTTP) {
+        ok = handleHttp(session);
+    } else {
+        ok = handleLines(clientSocket, session);
+    }
+    return ok && flushSession(clientSocket, session);
+}
+
+bool Processor::handleFrames(int clientSocket, Session& session)
+{
+    const std::string& clientIp = session.clientIp;
+    
+    // 依次处理缓冲区中的完整帧：业务请求交给工作线程，响应带回请求帧的ID，可以乱序返回
+    size_t offset = 0;
+    while (offset < session.readBuffer.length()) {
+        ApProtocol::Frame frame;
+        size_t consumed = 0;
+        ApProtocol::DecodeResult result = ApProtocol::decode(session.readBuffer.data() + offset,
+                                                             session.readBuffer.length() - offset,
+                                                             frame, consumed);
+        if (result == ApProtocol::DecodeResult::INCOMPLETE) {
+            break;
+        }
+        if (result == ApProtocol::DecodeResult::INVALID) {
+            LOG_ERROR_DETAIL("", "ProtocolError", "请求帧格式错误", "客户端: " + clientIp);
+            return false;
+        }
+        offset += consumed;
+        
+        if (frame.version > ApProtocol::VERSION) {
+            // 对端版本较新：头部布局不变，回复本端支持的版本，由对端决定是否降级
+            ApProtocol::encode(session.writeBuffer, ApProtocol::FrameType::ERROR, frame.requestId,
+                               "{\"error\":\"不支持的协议版本\",\"version\":" + std::to_string(frame.version) +
+                               ",\"supported\":" + std::to_string(ApProtocol::VERSION) + "}");
+        } else if (frame.type == ApProtocol::FrameType::PING) {
+            ApProtocol::encode(session.writeBuffer, ApProtocol::FrameType::PONG, frame.requestId, "", frame.version);
+        } else if (frame.type == ApProtocol::FrameType::REQUEST) {
+            dispatchRequest(clientSocket, session, std::move(frame.payload), frame.requestId, frame.version);
+        } else {
+            ApProtocol::encode(session.writeBuffer, ApProtocol::FrameType::ERROR, frame.requestId,
+                               "{\"error\":\"不支持的帧类型\",\"type\":" +
+                               std::to_string(static_cast<int>(frame.type)) + "}", frame.version);
+        }
+    }
+    
+    session.readBuffer.erase(0, offset);
+    return true;
+}
+
+bool Processor::handleLines(int clientSocket, Session& session)
+{
+    // 按行协议没有请求ID，响应必须按请求顺序返回，因此每个连接同时只处理一个请求
+    if (session.inFlight > 0 || session.closeAfterWrite) {
+        return true;
+    }
+    
+    size_t messageEnd = session.readBuffer.find('\n');
+    if (messageEnd != std::string::npos) {
+        std::string request = session.readBuffer.substr(0, messageEnd);
+        session.readBuffer.erase(0, messageEnd + 1);
+        dispatchRequest(clientSocket, session, std::move(request), 0, 0);
+        return true;
+    }
+    
+    if (session.readBuffer.empty()) {
+        return true;
+    }
+    if (session.readBuffer.length() > ApProtocol::MAX_PAYLOAD_SIZE) {
+        LOG_ERROR_DETAIL("", "ProtocolError", "按行请求超过长度上限",
+                         "客户端: " + session.clientIp + ", 字节数: " + std::to_string(session.readBuffer.length()));
+        return false;
+    }
+    
+    // 兼容旧版DISP：请求不带消息结束符，发送响应后关闭连接。每次收到数据都解析整个缓冲区的代价
+    // 随请求长度平方增长，因此等对端停止发送LINE_IDLE_GAP_MS后再由checkPendingLines解析一次
+    pendingLines.insert(clientSocket);
+    return true;
+}
+
+void Processor::checkPendingLines()
+{
+    int64_t now = Trace::now();
+    std::vector<int> ready;
+    for (auto it = pendingLines.begin(); it != pendingLines.end();) {
+        auto sessionIt = sessions.find(*it);
+        if (sessionIt == sessions.end()) {
+            it = pendingLines.erase(it);
+            continue;
+        }
+        if (now - sessionIt->second.lastReceive >= static_cast<int64_t>(LINE_IDLE_GAP_MS) * 1000000) {
+            ready.push_back(*it);
+            it = pendingLines.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    
+    for (int fd : ready) {
+        Session& session = sessions[fd];
+        // 已在处理上一条请求时，完成后由processCompletions再次调用handleLines
+        if (session.inFlight > 0 || session.closeAfterWrite || session.readBuffer.empty() ||
+            !nlohmann::json::accept(session.readBuffer)) {
+            continue;
+        }
+        std::string request;
+        request.swap(session.readBuffer);
+        session.closeAfterWrite = true;
+        dispatchRequest(fd, session, std::move(request), 0, 0);
+        if (!flushSession(fd, session)) {
+            closeSession(fd);
+        }
+    }
+}
+
+bool Processor::handleHttp(Session& session)
+{
+    if (session.closeAfterWrite) {
+        return true;
+    }
+    
+    HttpParser& parser = session.httpParser;
+    HttpParser::Result result = parser.parse(session.readBuffer);
+    if (result == HttpParser::Result::INCOMPLETE) {
+        return true;
+    }
+    
+    // 只支持GET /api/metrics和/api/admin/traces（trace.admin_enabled启用时），在事件循环线程中完成，不占用工作线程
+    std::string status = "200 OK";
+    std::string contentType = MetricsRegistry::CONTENT_TYPE;
+    std::string body;
+    if (result == HttpParser::Result::ERROR) {
+        status = std::to_string(parser.errorStatus()) + " " + HttpParser::reasonPhrase(parser.errorStatus());
+        contentType = "application/json";
+        body = "{\"error\":\"" + std::string(parser.errorMessage()) + "\"}";
+    } else {
+        const HttpRequest& request = parser.request();
+        if (request.method == "GET" && request.path == "/api/metrics") {
+            body = MetricsRegistry::getInstance().exportPrometheus();
+        } else if (request.method == "GET" && request.path == "/api/admin/traces" &&
+                   TraceCollector::getInstance().isAdminEnabled()) {
+            contentType = "application/json";
+            body = TraceCollector::getInstance().handleAdminRequest(request);
+        } else {
+            status = "404 Not Found";
+            contentType = "application/json";
+            body = "{\"error\":\"未找到\"}";
+        }
+    }
+    
+    session.writeBuffer += "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: " + contentType + "\r\n"
+                           "Content-Length: " + std::to_string(body.length()) + "\r\n"
+                           "Connection: close\r\n\r\n";
+    session.writeBuffer += body;
+    session.readBuffer.clear();
+    session.closeAfterWrite = true;
+    return true;
+}
+
+void Processor::dispatchRequest(int clientSocket, Session& session, std::string request,
+                                uint32_t frameId, uint8_t version)
+{
+    bool framed = session.protocol == SessionProtocol::FRAME;
+    bool terminate = !session.closeAfterWrite;
+    uint64_t sessionId = session.id;
+    std::string clientIp = session.clientIp;
+    
+    auto encodeResponse = [framed, terminate, frameId, version](const std::string& response) {
+        if (framed) {
+            return ApProtocol::encode(ApProtocol::FrameType::RESPONSE, frameId, response, version);
+        }
+        return terminate ? response + "\n" : response;
+    };
+    
+    int64_t enqueued = Trace::now();
+    bool accepted = workers.submit([this, clientSocket, sessionId, clientIp, encodeResponse, enqueued,
+                                    request = std::move(request)]() {
+        // 请求ID在解析请求后才知道，先记录各阶段，结束时再设置
+        std::unique_ptr<Trace> trace;
+        if (TraceCollector::getInstance().isEnabled()) {
+            trace.reset(new Trace(enqueued));
+            trace->addSpan("ap.queue", enqueued, Trace::now());
+        }
+        CurrentTrace current(trace.get());
         
-        // 处理客户端请求
-        const int bufferSize = 4096;
-        char buffer[bufferSize];
+        std::string requestId;
+        std::string response = handleMessage(request, clientIp, requestId);
+        std::string data;
+        {
+            ScopedSpan span("ap.serialize");
+            data = encodeResponse(response);
+        }
         
-        // 接收请求
-        ssize_t bytesRead = recv(clientSocket, buffer, bufferSize - 1, 0);
-        if (bytesRead <= 0) {
-            LOG_DEBUG_CTX("客户端连接关闭或接收失败", LogContext("", clientIp));
-            close(clientSocket);
+        if (trace) {
+            trace->setRequestId(requestId);
+            trace->finish();
+            TraceCollector::getInstance().submit(std::move(trace));
+        }
+        postCompletion(Completion{clientSocket, sessionId, std::move(data)});
+    });
+    
+    if (accepted) {
+        session.inFlight++;
+        return;
+    }
+    
+    // 拒绝策略：队列已满时立即返回繁忙响应，由DISP转告客户端稍后重试。
+    // 帧协议以ERROR帧返回，DISP据code回复503；按行协议没有区分错误的方式，只能作为普通响应返回
+    LOG_WARNING_CTX_LIMITED("请求队列已满，拒绝请求 (队列深度: " + std::to_string(workers.queueDepth()) + ")",
+                            LogContext("", clientIp), 1);
+    rejectedRequests.inc();
+    const std::string busy = "{\"error\":\"服务繁忙，请稍后重试\",\"code\":503}";
+    if (framed) {
+        ApProtocol::encode(session.writeBuffer, ApProtocol::FrameType::ERROR, frameId, busy, version);
+    } else {
+        session.writeBuffer.append(encodeResponse(busy));
+    }
+}
+
+void Processor::postCompletion(Completion completion)
+{
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        completions.push_back(std::move(completion));
+    }
+    
+    uint64_t value = 1;
+    ssize_t written = write(wakeFd, &value, sizeof(value));
+    (void)written;
+}
+
+void Processor::processCompletions()
+{
+    std::vector<Completion> ready;
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        ready.swap(completions);
+    }
+    
+    for (auto& completion : ready) {
+        // 连接可能已经关闭，fd也可能已被新连接复用
+        auto it = sessions.find(completion.fd);
+        if (it == sessions.end() || it->second.id != completion.sessionId) {
             continue;
         }
         
-        // 确保字符串以null结尾
-        buffer[bytesRead] = '\0';
+        Session& session = it->second;
+        session.inFlight--;
+        session.lastActivity = time(nullptr);
+        if (session.writeBuffer.empty()) {
+            session.writeBuffer = std::move(completion.data);  // 没有积压时直接接管响应缓冲区
+        } else {
+            session.writeBuffer.append(completion.data);
+        }
         
-        // 解析JSON请求
-        std::string request(buffer);
-        std::string response;
-        std::string requestId;
+        // 按行协议在上一个响应完成后才处理下一条请求
+        if (session.protocol == SessionProtocol::LINE) {
+            handleLines(completion.fd, session);
+        }
         
-        LOG_DEBUG_CTX("收到请求数据, 字节数: " + std::to_string(bytesRead), LogContext("", clientIp));
+        if (!flushSession(completion.fd, session)) {
+            closeSession(completion.fd);
+        }
+    }
+}
+
+bool Processor::flushSession(int clientSocket, Session& session)
+{
+    while (session.writePos < session.writeBuffer.length()) {
+        ssize_t bytesSent = send(clientSocket, session.writeBuffer.data() + session.writePos,
+                                 session.writeBuffer.length() - session.writePos, MSG_NOSIGNAL);
+        if (bytesSent > 0) {
+            session.writePos += bytesSent;
+            continue;
+        }
+        if (bytesSent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满，等待可写事件
+            if (!session.wantWrite) {
+                struct epoll_event event;
+                memset(&event, 0, sizeof(event));
+                event.events = EPOLLIN | EPOLLOUT;
+                event.data.fd = clientSocket;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, clientSocket, &event);
+                session.wantWrite = true;
+            }
+            return true;
+        }
         
-        try {
-            nlohmann::json jsonRequest = nlohmann::json::parse(request);
-            std::string requestType = jsonRequest.value("type", "unknown");
-            requestId = jsonRequest.value("request_id", generateRequestId());
-            
-            LOG_REQUEST(requestId, "JSON", requestType, clientIp);
-            LOG_DEBUG_CTX("请求内容: " + request, LogContext(requestId, clientIp));
-            
-            // 处理请求
-            response = processRequest(requestType, jsonRequest);
-            
-            LOG_DEBUG_CTX("响应内容: " + response, LogContext(requestId, clientIp));
-            
-        } catch (const nlohmann::json::parse_error& e) {
-            requestId = generateRequestId();
-            LOG_ERROR_DETAIL(requestId, "JSONParseError", "JSON解析错误",
-                           "客户端: " + clientIp + ", 错误: " + std::string(e.what()));
-            LOG_DEBUG_CTX("原始请求数据: " + request, LogContext(requestId, clientIp));
-            response = "{\"error\":\"JSON解析错误\",\"details\":\"" + std::string(e.what()) + "\"}";
+        LOG_ERROR_DETAIL("", "SendError", "发送响应失败",
+                         "客户端: " + session.clientIp + ", errno: " + std::to_string(errno));
+        return false;
+    }
+    
+    if (session.writePos > 0) {
+        LOG_DEBUG_CTX("响应发送成功, 字节数: " + std::to_string(session.writePos), LogContext("", session.clientIp));
+        session.writeBuffer.clear();
+        session.writePos = 0;
+    }
+    
+    if (session.wantWrite) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = clientSocket;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, clientSocket, &event);
+        session.wantWrite = false;
+    }
+    
+    return !(session.closeAfterWrite && session.inFlight == 0);
+}
+
+void Processor::closeSession(int clientSocket)
+{
+    auto it = sessions.find(clientSocket);
+    if (it == sessions.end()) {
+        return;
+    }
+    
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, clientSocket, nullptr);
+    close(clientSocket);
+    pendingLines.erase(clientSocket);
+    LOG_DEBUG_CTX("连接关闭", LogContext("", it->second.clientIp));
+    sessions.erase(it);
+    activeConnections.add(-1);
+}
+
+void Processor::closeIdleSessions()
+{
+    // 关闭空闲超时的长连接，仍有请求在处理中的连接不算空闲
+    time_t now = time(nullptr);
+    std::vector<int> idle;
+    for (const auto& pair : sessions) {
+        if (pair.second.inFlight == 0 && now - pair.second.lastActivity > keepAliveTimeout) {
+            idle.push_back(pair.first);
         }
+    }
+    
+    for (int fd : idle) {
+        LOG_DEBUG_CTX("长连接空闲超时，关闭连接", LogContext("", sessions[fd].clientIp));
+        closeSession(fd);
+    }
+}
+
+std::string Processor::handleMessage(const std::string& request, const std::string& clientIp, std::string& requestId)
+{
+    std::string response;
+    
+    try {
+        nlohmann::json jsonRequest;
+        {
+            ScopedSpan span("ap.parse");
+            jsonRequest = nlohmann::json::parse(request);
+        }
+        std::string requestType = jsonRequest.value("type", "unknown");
         
-        // 发送响应
-        ssize_t bytesSent = send(clientSocket, response.c_str(), response.length(), 0);
-        if (bytesSent < 0) {
-            LOG_ERROR_DETAIL(requestId, "SendError", "发送响应失败",
-                           "客户端: " + clientIp + ", errno: " + std::to_string(errno));
-        } else {
-            LOG_DEBUG_CTX("响应发送成功, 字节数: " + std::to_string(bytesSent), LogContext(requestId, clientIp));
+        // DISP连接池的存活探测
+        if (requestType == "ping") {
+            return "{\"type\":\"pong\"}";
         }
         
-        // 关闭连接
-        close(clientSocket);
-        LOG_DEBUG_CTX("连接关闭", LogContext(requestId, clientIp));
+        requestId = jsonRequest.value("request_id", generateRequestId());
+        
+        LOG_REQUEST(requestId, "JSON", requestType, clientIp);
+        LOG_DEBUG_CTX("请求内容: " + request, LogContext(requestId, clientIp));
+        
+        // 处理请求
+        response = processRequest(requestType, jsonRequest);
+        
+        LOG_DEBUG_CTX("响应内容: " + response, LogContext(requestId, clientIp));
+        
+    } catch (const nlohmann::json::parse_error& e) {
+        requestId = generateRequestId();
+        LOG_ERROR_DETAIL(requestId, "JSONParseError", "JSON解析错误",
+                       "客户端: " + clientIp + ", 错误: " + std::string(e.what()));
+        LOG_DEBUG_CTX("原始请求数据: " + request, LogContext(requestId, clientIp));
+        response = "{\"error\":\"JSON解析错误\",\"details\":\"" + std::string(e.what()) + "\"}";
     }
     
-    // 关闭服务器套接字
-    close(serverSocket);
-    LOG_SYSTEM("ServiceLoop", "服务循环结束", "服务器套接字已关闭");
-}
\ No newline at end of file
+    return response;
+}
@@ -0,0 +1,244 @@
+#include "ap/result_set.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+namespace {
+    // 读取固定位数的数字，遇到非数字返回false
+    bool parseDigits(const char*& p, const char* end, int count, int& value) {
+        value = 0;
+        for (int i = 0; i < count; ++i) {
+            if (p >= end || *p < '0' || *p > '9') {
+                return false;
+            }
+            value = value * 10 + (*p++ - '0');
+        }
+        return true;
+    }
+
+    bool expect(const char*& p, const char* end, char c) {
+        if (p >= end || *p != c) {
+            return false;
+        }
+        ++p;
+        return true;
+    }
+}
+
+ResultSet::ResultSet() : columns(0) {
+}
+
+void ResultSet::reset(size_t columnCount) {
+    buffer.clear();
+    offsets.clear();
+    lengths.clear();
+    nullBitmap.clear();
+    columnNames.assign(columnCount, std::string());
+    columns = columnCount;
+}
+
+void ResultSet::reserve(size_t rows, size_t bytes) {
+    size_t cells = rows * columns;
+    buffer.reserve(bytes + cells);  // 每个值后的'\0'
+    offsets.reserve(cells);
+    lengths.reserve(cells);
+    nullBitmap.reserve((cells + 63) / 64);
+}
+
+void ResultSet::setColumnName(size_t column, const std::string& name) {
+    columnNames[column] = name;
+}
+
+size_t ResultSet::findColumn(std::string_view name) const {
+    for (size_t i = 0; i < columnNames.size(); ++i) {
+        if (columnNames[i] == name) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+size_t ResultSet::addCell(size_t length) {
+    // 偏移量用32位保存，单个结果集的数据不能超过4GB
+    if (buffer.size() + length + 1 > UINT32_MAX) {
+        throw std::length_error("查询结果超过4GB");
+    }
+
+    size_t cell = lengths.size();
+    offsets.push_back(static_cast<uint32_t>(buffer.size()));
+    lengths.push_back(static_cast<uint32_t>(length));
+    if (cell % 64 == 0) {
+        nullBitmap.push_back(0);
+    }
+    return cell;
+}
+
+void ResultSet::appendValue(const char* data, size_t length) {
+    addCell(length);
+    buffer.append(data, length);
+    buffer.push_back('\0');
+}
+
+char* ResultSet::appendValue(size_t length) {
+    addCell(length);
+    size_t offset = buffer.size();
+    buffer.resize(offset + length + 1);
+    return &buffer[offset];
+}
+
+void ResultSet::appendNull() {
+    size_t cell = addCell(0);
+    buffer.push_back('\0');
+    nullBitmap[cell / 64] |= uint64_t(1) << (cell % 64);
+}
+
+long long ResultSet::getInt(size_t row, size_t column, long long defaultValue) const {
+    if (isNull(row, column)) {
+        return defaultValue;
+    }
+
+    std::string_view value = get(row, column);
+    char* end = nullptr;
+    errno = 0;
+    long long result = strtoll(value.data(), &end, 10);  // 值以'\0'结尾
+    if (end == value.data() || end != value.data() + value.size() || errno == ERANGE) {
+        return defaultValue;
+    }
+    return result;
+}
+
+double ResultSet::getDouble(size_t row, size_t column, double defaultValue) const {
+    if (isNull(row, column)) {
+        return defaultValue;
+    }
+
+    std::string_view value = get(row, column);
+    char* end = nullptr;
+    double result = strtod(value.data(), &end);
+    if (end == value.data() || end != value.data() + value.size()) {
+        return defaultValue;
+    }
+    return result;
+}
+
+bool ResultSet::getDecimal(size_t row, size_t column, int scale, long long& value) const {
+    if (isNull(row, column) || scale < 0 || scale > 18) {
+        return false;
+    }
+
+    std::string_view text = get(row, column);
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+
+    // 整数部分和小数部分按scale位拼接成一个整数，超出的小数位只看第一位做四舍五入
+    unsigned long long result = 0;
+    auto appendDigit = [&result](unsigned digit) {
+        return !__builtin_mul_overflow(result, 10ULL, &result) && !__builtin_add_overflow(result, digit, &result);
+    };
+    bool digits = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (!appendDigit(static_cast<unsigned>(*p++ - '0'))) {
+            return false;
+        }
+        digits = true;
+    }
+
+    int fraction = 0;
+    bool roundUp = false;
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (fraction < scale) {
+                if (!appendDigit(static_cast<unsigned>(*p - '0'))) {
+                    return false;
+                }
+                fraction++;
+            } else if (fraction == scale) {
+                roundUp = *p >= '5';
+                fraction++;  // 只看第一位多余的小数
+            }
+            ++p;
+            digits = true;
+        }
+    }
+    if (!digits || p != end) {
+        return false;
+    }
+
+    for (int i = std::min(fraction, scale); i < scale; ++i) {
+        if (!appendDigit(0)) {
+            return false;
+        }
+    }
+    if (result > static_cast<unsigned long long>(LLONG_MAX)) {
+        return false;
+    }
+    if (roundUp) {
+        result++;
+    }
+    if (result > static_cast<unsigned long long>(LLONG_MAX)) {
+        return false;
+    }
+
+    value = negative ? -static_cast<long long>(result) : static_cast<long long>(result);
+    return true;
+}
+
+bool ResultSet::getDateTime(size_t row, size_t column, std::tm& value) const {
+    if (isNull(row, column)) {
+        return false;
+    }
+
+    std::string_view text = get(row, column);
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    std::tm result = {};
+    int year, month, day;
+    if (!parseDigits(p, end, 4, year) || !expect(p, end, '-') ||
+        !parseDigits(p, end, 2, month) || !expect(p, end, '-') ||
+        !parseDigits(p, end, 2, day)) {
+        return false;
+    }
+
+    int hour = 0, minute = 0, second = 0;
+    if (p < end) {
+        if (!expect(p, end, ' ') ||
+            !parseDigits(p, end, 2, hour) || !expect(p, end, ':') ||
+            !parseDigits(p, end, 2, minute) || !expect(p, end, ':') ||
+            !parseDigits(p, end, 2, second)) {
+            return false;
+        }
+        // 忽略DATETIME(n)的小数秒
+        if (p < end && *p == '.') {
+            ++p;
+            while (p < end && *p >= '0' && *p <= '9') {
+                ++p;
+            }
+        }
+        if (p != end) {
+            return false;
+        }
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    result.tm_year = year - 1900;
+    result.tm_mon = month - 1;
+    result.tm_mday = day;
+    result.tm_hour = hour;
+    result.tm_min = minute;
+    result.tm_sec = second;
+    result.tm_isdst = -1;
+    value = result;
+    return true;
+}
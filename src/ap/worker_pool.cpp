@@ -0,0 +1,88 @@
+#include "ap/worker_pool.h"
+#include "common/logger_enhanced.h"
+
+WorkerPool::WorkerPool() : maxQueue(0), accepting(false), rejected(0) {
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(int threadCount, size_t queueLimit) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (accepting) {
+        return;
+    }
+
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    maxQueue = queueLimit > 0 ? queueLimit : 1;
+    accepting = true;
+
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+
+    LOG_SYSTEM("WorkerPool", "工作线程池启动",
+               "线程数: " + std::to_string(threadCount) + ", 队列上限: " + std::to_string(maxQueue));
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!accepting && threads.empty()) {
+            return;
+        }
+        accepting = false;
+    }
+    queueCv.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+
+    LOG_SYSTEM("WorkerPool", "工作线程池停止", "累计拒绝任务数: " + std::to_string(rejected));
+}
+
+bool WorkerPool::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!accepting || tasks.size() >= maxQueue) {
+            rejected++;
+            return false;
+        }
+        tasks.push_back(std::move(task));
+    }
+    queueCv.notify_one();
+    return true;
+}
+
+size_t WorkerPool::queueDepth() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return tasks.size();
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait(lock, [this]() { return !accepting || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;  // 已停止且队列已清空
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("工作线程执行任务时发生异常: " + std::string(e.what()));
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include "common/ap_protocol.h"
+#include <arpa/inet.h>
+#include <cstring>
+
+namespace ApProtocol {
+
+void encode(std::string& out, FrameType type, uint32_t requestId,
+            const std::string& payload, uint8_t version) {
+    char header[HEADER_SIZE];
+    uint16_t magic = htons(MAGIC);
+    uint32_t id = htonl(requestId);
+    uint32_t length = htonl(static_cast<uint32_t>(payload.length()));
+
+    memcpy(header, &magic, 2);
+    header[2] = static_cast<char>(version);
+    header[3] = static_cast<char>(type);
+    memcpy(header + 4, &id, 4);
+    memcpy(header + 8, &length, 4);
+
+    out.reserve(out.length() + HEADER_SIZE + payload.length());
+    out.append(header, HEADER_SIZE);
+    out.append(payload);
+}
+
+std::string encode(FrameType type, uint32_t requestId,
+                   const std::string& payload, uint8_t version) {
+    std::string out;
+    encode(out, type, requestId, payload, version);
+    return out;
+}
+
+DecodeResult decodeHeader(const char* data, size_t size, Frame& frame, uint32_t& length) {
+    if (size < 2) {
+        return DecodeResult::INCOMPLETE;
+    }
+    if (!startsWithMagic(data, size)) {
+        return DecodeResult::INVALID;
+    }
+    if (size < HEADER_SIZE) {
+        return DecodeResult::INCOMPLETE;
+    }
+
+    uint32_t id;
+    memcpy(&id, data + 4, 4);
+    memcpy(&length, data + 8, 4);
+    length = ntohl(length);
+
+    if (length > MAX_PAYLOAD_SIZE) {
+        return DecodeResult::INVALID;
+    }
+
+    frame.version = static_cast<uint8_t>(data[2]);
+    frame.type = static_cast<FrameType>(static_cast<uint8_t>(data[3]));
+    frame.requestId = ntohl(id);
+    return DecodeResult::COMPLETE;
+}
+
+DecodeResult decode(const char* data, size_t size, Frame& frame, size_t& consumed) {
+    uint32_t length = 0;
+    DecodeResult result = decodeHeader(data, size, frame, length);
+    if (result != DecodeResult::COMPLETE) {
+        return result;
+    }
+    if (size - HEADER_SIZE < length) {
+        return DecodeResult::INCOMPLETE;
+    }
+
+    frame.payload.assign(data + HEADER_SIZE, length);
+    consumed = HEADER_SIZE + length;
+    return DecodeResult::COMPLETE;
+}
+
+bool startsWithMagic(const char* data, size_t size) {
+    if (size < 2) {
+        return false;
+    }
+    uint16_t magic;
+    memcpy(&magic, data, 2);
+    return ntohs(magic) == MAGIC;
+}
+
+} // namespace ApProtocol
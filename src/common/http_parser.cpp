@@ -0,0 +1,334 @@
+#include "common/http_parser.h"
+#include "common/utils.h"
+#include <cstring>
+
+namespace {
+    // RFC 7230 token字符：方法名和头部名称只能由这些字符组成
+    struct TokenTable {
+        bool allowed[256];
+
+        TokenTable() : allowed() {
+            for (int c = '0'; c <= '9'; ++c) allowed[c] = true;
+            for (int c = 'a'; c <= 'z'; ++c) allowed[c] = true;
+            for (int c = 'A'; c <= 'Z'; ++c) allowed[c] = true;
+            for (const char* p = "!#$%&'*+-.^_`|~"; *p; ++p) {
+                allowed[static_cast<unsigned char>(*p)] = true;
+            }
+        }
+    };
+
+    const TokenTable tokenTable;
+
+    bool isToken(std::string_view text) {
+        if (text.empty()) {
+            return false;
+        }
+        for (char c : text) {
+            if (!tokenTable.allowed[static_cast<unsigned char>(c)]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    char toLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // ASCII不区分大小写比较，lower必须是小写
+    bool equalsLower(std::string_view text, std::string_view lower) {
+        if (text.length() != lower.length()) {
+            return false;
+        }
+        for (size_t i = 0; i < text.length(); ++i) {
+            if (toLower(text[i]) != lower[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.length() != b.length()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.length(); ++i) {
+            if (toLower(a[i]) != toLower(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string_view trimSpaces(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (const HttpHeader& entry : headers) {
+        if (equalsIgnoreCase(entry.name, name)) {
+            return entry.value;
+        }
+    }
+    return std::string_view();
+}
+
+bool HttpRequest::queryParam(std::string_view name, std::string& value) const {
+    // 同名参数出现多次时取最后一个
+    bool found = false;
+    std::string_view rest = query;
+    while (!rest.empty()) {
+        size_t end = rest.find('&');
+        std::string_view pair = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+
+        size_t equals = pair.find('=');
+        std::string_view key = pair.substr(0, equals);
+        bool matched;
+        if (key.find_first_of("%+") != std::string_view::npos) {
+            matched = Utils::urlDecode(std::string(key)) == name;
+        } else {
+            matched = key == name;
+        }
+        if (matched) {
+            value = equals == std::string_view::npos
+                    ? std::string() : Utils::urlDecode(std::string(pair.substr(equals + 1)));
+            found = true;
+        }
+    }
+    return found;
+}
+
+HttpParser::HttpParser() {
+    headerRanges.reserve(16);
+    current.headers.reserve(16);
+    reset();
+}
+
+void HttpParser::reset() {
+    state = State::REQUEST_LINE;
+    lineStart = 0;
+    scanPos = 0;
+    messageStart = 0;
+    bodyStart = 0;
+    contentLength = 0;
+    messageEnd = 0;
+    hasContentLength = false;
+    http10 = false;
+    connectionToken = 0;
+    methodRange = targetRange = versionRange = Range{0, 0};
+    headerRanges.clear();
+    status = 0;
+    error = "";
+
+    current.method = current.target = current.path = current.query = current.version = std::string_view();
+    current.body = current.raw = std::string_view();
+    current.headers.clear();
+    current.keepAlive = false;
+}
+
+const char* HttpParser::reasonPhrase(int statusCode) {
+    switch (statusCode) {
+        case 400: return "Bad Request";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 505: return "HTTP Version Not Supported";
+        default: return "Error";
+    }
+}
+
+HttpParser::Result HttpParser::fail(int statusCode, const char* message) {
+    state = State::ERROR;
+    status = statusCode;
+    error = message;
+    return Result::ERROR;
+}
+
+HttpParser::Result HttpParser::parse(const char* data, size_t length) {
+    // 请求行和头部逐行处理，memchr查找换行；半行数据只记下扫描位置，下次从该位置继续
+    while (state == State::REQUEST_LINE || state == State::HEADERS) {
+        const void* found = scanPos < length ? memchr(data + scanPos, '\n', length - scanPos) : nullptr;
+        if (!found) {
+            scanPos = length;
+            if (length > MAX_HEADER_SIZE) {
+                return fail(431, "请求头部过大");
+            }
+            return Result::INCOMPLETE;
+        }
+
+        size_t newline = static_cast<const char*>(found) - data;
+        size_t begin = lineStart;
+        size_t end = newline;
+        if (end > begin && data[end - 1] == '\r') {
+            --end;
+        }
+        lineStart = scanPos = newline + 1;
+        if (lineStart > MAX_HEADER_SIZE) {
+            return fail(431, "请求头部过大");
+        }
+
+        if (state == State::REQUEST_LINE) {
+            // 忽略请求之前的空行（部分客户端在POST请求体后多发一个CRLF）
+            if (end == begin) {
+                messageStart = lineStart;
+                continue;
+            }
+            if (!parseRequestLine(data, begin, end)) {
+                return Result::ERROR;
+            }
+            state = State::HEADERS;
+        } else if (end == begin) {
+            bodyStart = lineStart;
+            state = State::BODY;
+        } else if (!parseHeaderLine(data, begin, end)) {
+            return Result::ERROR;
+        }
+    }
+
+    if (state == State::BODY) {
+        if (length - bodyStart < contentLength) {
+            return Result::INCOMPLETE;
+        }
+        messageEnd = bodyStart + contentLength;
+        state = State::COMPLETE;
+    }
+
+    if (state == State::COMPLETE) {
+        // 缓冲区地址可能在两次调用之间变化，每次都按偏移重新生成视图
+        buildRequest(data);
+        return Result::COMPLETE;
+    }
+    return Result::ERROR;
+}
+
+bool HttpParser::parseRequestLine(const char* data, size_t begin, size_t end) {
+    std::string_view line(data + begin, end - begin);
+    size_t firstSpace = line.find(' ');
+    size_t secondSpace = firstSpace == std::string_view::npos ? firstSpace : line.find(' ', firstSpace + 1);
+    if (secondSpace == std::string_view::npos) {
+        fail(400, "请求行格式错误");
+        return false;
+    }
+
+    std::string_view method = line.substr(0, firstSpace);
+    std::string_view target = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    std::string_view version = line.substr(secondSpace + 1);
+
+    if (!isToken(method)) {
+        fail(400, "请求方法无效");
+        return false;
+    }
+    if (target.empty()) {
+        fail(400, "请求目标为空");
+        return false;
+    }
+    for (char c : target) {
+        if (static_cast<unsigned char>(c) <= 0x20 || c == 0x7f) {
+            fail(400, "请求目标包含非法字符");
+            return false;
+        }
+    }
+    if (version == "HTTP/1.0") {
+        http10 = true;
+    } else if (version != "HTTP/1.1") {
+        fail(version.substr(0, 5) == "HTTP/" ? 505 : 400, "不支持的HTTP版本");
+        return false;
+    }
+
+    methodRange = Range{begin, method.length()};
+    targetRange = Range{begin + firstSpace + 1, target.length()};
+    versionRange = Range{begin + secondSpace + 1, version.length()};
+    return true;
+}
+
+bool HttpParser::parseHeaderLine(const char* data, size_t begin, size_t end) {
+    if (headerRanges.size() >= MAX_HEADERS) {
+        fail(431, "请求头部过多");
+        return false;
+    }
+    if (data[begin] == ' ' || data[begin] == '\t') {
+        fail(400, "不支持头部折行");
+        return false;
+    }
+
+    std::string_view line(data + begin, end - begin);
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || !isToken(line.substr(0, colon))) {
+        fail(400, "请求头部格式错误");
+        return false;
+    }
+
+    std::string_view name = line.substr(0, colon);
+    std::string_view value = trimSpaces(line.substr(colon + 1));
+    headerRanges.push_back(HeaderRange{Range{begin, name.length()},
+                                       Range{static_cast<size_t>(value.data() - data), value.length()}});
+
+    if (equalsLower(name, "content-length")) {
+        if (value.empty()) {
+            fail(400, "Content-Length无效");
+            return false;
+        }
+        size_t parsed = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') {
+                fail(400, "Content-Length无效");
+                return false;
+            }
+            parsed = parsed * 10 + static_cast<size_t>(c - '0');
+            if (parsed > MAX_BODY_SIZE) {
+                fail(413, "请求体过大");
+                return false;
+            }
+        }
+        if (hasContentLength && parsed != contentLength) {
+            fail(400, "Content-Length重复且不一致");
+            return false;
+        }
+        contentLength = parsed;
+        hasContentLength = true;
+    } else if (equalsLower(name, "transfer-encoding")) {
+        fail(501, "不支持分块编码的请求体");
+        return false;
+    } else if (equalsLower(name, "connection")) {
+        // 逗号分隔的选项，close优先
+        std::string_view rest = value;
+        while (!rest.empty()) {
+            size_t comma = rest.find(',');
+            std::string_view option = trimSpaces(rest.substr(0, comma));
+            rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+            if (equalsLower(option, "close")) {
+                connectionToken = 1;
+            } else if (equalsLower(option, "keep-alive") && connectionToken == 0) {
+                connectionToken = 2;
+            }
+        }
+    }
+    return true;
+}
+
+void HttpParser::buildRequest(const char* data) {
+    current.method = view(data, methodRange);
+    current.target = view(data, targetRange);
+    current.version = view(data, versionRange);
+
+    size_t question = current.target.find('?');
+    current.path = current.target.substr(0, question);
+    current.query = question == std::string_view::npos ? std::string_view() : current.target.substr(question + 1);
+
+    current.headers.clear();
+    for (const HeaderRange& range : headerRanges) {
+        current.headers.push_back(HttpHeader{view(data, range.name), view(data, range.value)});
+    }
+
+    current.body = std::string_view(data + bodyStart, contentLength);
+    current.raw = std::string_view(data + messageStart, messageEnd - messageStart);
+    current.keepAlive = connectionToken == 0 ? !http10 : connectionToken == 2;
+}
@@ -0,0 +1,36 @@
+#include "common/json_writer.h"
+
+void JsonWriter::appendString(std::string& out, std::string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+
+    out.reserve(out.size() + text.size() + 2);
+    out += '"';
+
+    // 连续的普通字符整段追加，只有需要转义的字符单独处理
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out.append(text.data() + start, i - start);
+        start = i + 1;
+
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char escaped[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0x0f]};
+                out.append(escaped, sizeof(escaped));
+            }
+        }
+    }
+    out.append(text.data() + start, text.size() - start);
+    out += '"';
+}
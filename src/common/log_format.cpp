@@ -0,0 +1,309 @@
+#include "common/log_format.h"
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace LogFormat {
+
+const char MAGIC[8] = {'A', 'P', 'L', 'O', 'G', 'B', 'I', '1'};
+
+namespace {
+    template <typename T>
+    void appendPod(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool readPod(const char*& p, const char* end, T& value) {
+        if (static_cast<size_t>(end - p) < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return true;
+    }
+
+    bool readBytes(const char*& p, const char* end, size_t length, std::string_view& value) {
+        if (static_cast<size_t>(end - p) < length) {
+            return false;
+        }
+        value = std::string_view(p, length);
+        p += length;
+        return true;
+    }
+
+    // 按下标取参数，类型不符或不存在时返回空值，渲染时不因参数缺失而失败
+    std::string_view textArg(const Arg* args, size_t count, size_t index) {
+        return index < count && args[index].type == Arg::STRING ? args[index].text : std::string_view();
+    }
+
+    long long intArg(const Arg* args, size_t count, size_t index) {
+        return index < count && args[index].type == Arg::INT ? args[index].intValue : 0;
+    }
+
+    double doubleArg(const Arg* args, size_t count, size_t index) {
+        return index < count && args[index].type == Arg::DOUBLE ? args[index].doubleValue : 0;
+    }
+
+    void appendMillis(std::string& out, double millis) {
+        char buffer[32];
+        int length = snprintf(buffer, sizeof(buffer), "%.2fms", millis);
+        out.append(buffer, length);
+    }
+
+    void appendText(std::string& out, std::string_view text) {
+        out.append(text.data(), text.size());
+    }
+
+    // 内容非空时追加前缀和内容
+    void appendOptional(std::string& out, const char* prefix, std::string_view text) {
+        if (!text.empty()) {
+            out += prefix;
+            appendText(out, text);
+        }
+    }
+}
+
+void encode(std::string& out, uint16_t event, int level, int64_t timestamp, uint32_t threadId,
+            const std::string_view* context, const Arg* args, size_t count) {
+    size_t start = out.size();
+    appendPod<uint32_t>(out, 0);  // 长度最后回填
+    appendPod<uint16_t>(out, event);
+    appendPod<uint8_t>(out, static_cast<uint8_t>(level));
+    appendPod<uint8_t>(out, static_cast<uint8_t>(count));
+    appendPod<int64_t>(out, timestamp);
+    appendPod<uint32_t>(out, threadId);
+
+    for (size_t i = 0; i < CONTEXT_FIELDS; ++i) {
+        size_t length = std::min<size_t>(context[i].size(), UINT16_MAX);
+        appendPod<uint16_t>(out, static_cast<uint16_t>(length));
+        out.append(context[i].data(), length);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const Arg& arg = args[i];
+        appendPod<uint8_t>(out, arg.type);
+        switch (arg.type) {
+            case Arg::INT:
+                appendPod<int64_t>(out, arg.intValue);
+                break;
+            case Arg::DOUBLE:
+                appendPod<double>(out, arg.doubleValue);
+                break;
+            case Arg::STRING:
+                appendPod<uint32_t>(out, static_cast<uint32_t>(arg.text.size()));
+                out.append(arg.text.data(), arg.text.size());
+                break;
+        }
+    }
+
+    uint32_t length = static_cast<uint32_t>(out.size() - start);
+    memcpy(&out[start], &length, sizeof(length));
+}
+
+DecodeResult decode(const char* data, size_t size, Record& record, size_t& consumed) {
+    uint32_t length;
+    if (size < sizeof(length)) {
+        return DecodeResult::INCOMPLETE;
+    }
+    memcpy(&length, data, sizeof(length));
+    if (length < HEADER_SIZE || length > MAX_RECORD_SIZE) {
+        return DecodeResult::INVALID;
+    }
+    if (size < length) {
+        return DecodeResult::INCOMPLETE;
+    }
+
+    const char* p = data + sizeof(length);
+    const char* end = data + length;
+
+    uint8_t level, count;
+    readPod(p, end, record.event);
+    readPod(p, end, level);
+    readPod(p, end, count);
+    readPod(p, end, record.timestamp);
+    readPod(p, end, record.threadId);
+    record.level = level;
+
+    for (size_t i = 0; i < CONTEXT_FIELDS; ++i) {
+        uint16_t fieldLength;
+        if (!readPod(p, end, fieldLength) || !readBytes(p, end, fieldLength, record.context[i])) {
+            return DecodeResult::INVALID;
+        }
+    }
+
+    record.args.clear();
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t type;
+        if (!readPod(p, end, type)) {
+            return DecodeResult::INVALID;
+        }
+
+        if (type == Arg::INT) {
+            int64_t value;
+            if (!readPod(p, end, value)) {
+                return DecodeResult::INVALID;
+            }
+            record.args.emplace_back(static_cast<long long>(value));
+        } else if (type == Arg::DOUBLE) {
+            double value;
+            if (!readPod(p, end, value)) {
+                return DecodeResult::INVALID;
+            }
+            record.args.emplace_back(value);
+        } else if (type == Arg::STRING) {
+            uint32_t textLength;
+            std::string_view text;
+            if (!readPod(p, end, textLength) || !readBytes(p, end, textLength, text)) {
+                return DecodeResult::INVALID;
+            }
+            record.args.emplace_back(text);
+        } else {
+            return DecodeResult::INVALID;
+        }
+    }
+
+    if (p != end) {
+        return DecodeResult::INVALID;
+    }
+
+    consumed = length;
+    return DecodeResult::COMPLETE;
+}
+
+std::string render(uint16_t event, const Arg* args, size_t count) {
+    std::string out;
+    switch (event) {
+        case TEXT:
+            appendText(out, textArg(args, count, 0));
+            break;
+
+        case REQUEST:
+            out += "🌐 HTTP请求 [";
+            appendText(out, textArg(args, count, 0));
+            out += "] ";
+            appendText(out, textArg(args, count, 1));
+            appendOptional(out, " 来自 ", textArg(args, count, 2));
+            break;
+
+        case RESPONSE:
+            out += "📤 HTTP响应 [";
+            out += std::to_string(intArg(args, count, 0));
+            out += "]";
+            appendOptional(out, " ", textArg(args, count, 1));
+            if (doubleArg(args, count, 2) > 0) {
+                out += " (";
+                appendMillis(out, doubleArg(args, count, 2));
+                out += ")";
+            }
+            break;
+
+        case API_CALL:
+            out += "🔗 API调用 [";
+            appendText(out, textArg(args, count, 0));
+            out += ".";
+            appendText(out, textArg(args, count, 1));
+            out += "]";
+            appendOptional(out, " 参数: ", textArg(args, count, 2));
+            break;
+
+        case DATABASE: {
+            out += "🗄️  数据库操作 [";
+            appendText(out, textArg(args, count, 0));
+            out += "] 表: ";
+            appendText(out, textArg(args, count, 1));
+            if (doubleArg(args, count, 3) > 0) {
+                out += " (";
+                appendMillis(out, doubleArg(args, count, 3));
+                out += ")";
+            }
+            std::string_view query = textArg(args, count, 2);
+            if (query.length() < 200) {
+                appendOptional(out, " SQL: ", query);
+            }
+            break;
+        }
+
+        case ERROR_DETAIL:
+            out += "❌ 错误 [";
+            appendText(out, textArg(args, count, 0));
+            out += "] ";
+            appendText(out, textArg(args, count, 1));
+            break;
+
+        case PERFORMANCE:
+            out += "⚡ 性能监控 [";
+            appendText(out, textArg(args, count, 0));
+            out += "] ";
+            appendMillis(out, doubleArg(args, count, 1));
+            appendOptional(out, " ", textArg(args, count, 2));
+            break;
+
+        case SYSTEM:
+            out += "🔧 系统事件 [";
+            appendText(out, textArg(args, count, 0));
+            out += "] ";
+            appendText(out, textArg(args, count, 1));
+            appendOptional(out, " ", textArg(args, count, 2));
+            break;
+
+        default:
+            // 未知事件（新版本写入的日志）按原始参数输出
+            out += "[event ";
+            out += std::to_string(event);
+            out += "]";
+            for (size_t i = 0; i < count; ++i) {
+                out += " ";
+                if (args[i].type == Arg::STRING) {
+                    appendText(out, args[i].text);
+                } else if (args[i].type == Arg::INT) {
+                    out += std::to_string(args[i].intValue);
+                } else {
+                    out += std::to_string(args[i].doubleValue);
+                }
+            }
+            break;
+    }
+    return out;
+}
+
+const char* levelName(int level) {
+    switch (level) {
+        case 0:  return "DEBUG";
+        case 1:  return "INFO";
+        case 2:  return "WARNING";
+        case 3:  return "ERROR";
+        case 4:  return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+const char* eventName(uint16_t event) {
+    switch (event) {
+        case TEXT:         return "text";
+        case REQUEST:      return "request";
+        case RESPONSE:     return "response";
+        case API_CALL:     return "api_call";
+        case DATABASE:     return "database";
+        case ERROR_DETAIL: return "error";
+        case PERFORMANCE:  return "performance";
+        case SYSTEM:       return "system";
+        case ANCHOR:       return "anchor";
+        default:           return "unknown";
+    }
+}
+
+int64_t monotonicNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int64_t realtimeNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}
@@ -7,19 +7,115 @@
 #include <sys/stat.h>
 #include <filesystem>
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <functional>
 #include <thread>
+#include <vector>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+namespace {
+    const size_t WRITE_BATCH = 128;                                  // 写线程每批最多写出的日志条数
+    const std::chrono::milliseconds WRITER_IDLE_WAIT(100);           // 写线程空闲时的最长等待
+    const std::chrono::seconds DROP_REPORT_INTERVAL(1);              // 报告丢弃条数的最短间隔
+    const char NEWLINE[] = "\n";
+    const char COLOR_RESET_NEWLINE[] = "\033[0m\n";
+
+    // 内核线程ID，每个线程只取一次
+    uint32_t currentThreadId() {
+        thread_local uint32_t threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+        return threadId;
+    }
+
+    iovec makeIovec(const char* data, size_t length) {
+        iovec iov;
+        iov.iov_base = const_cast<char*>(data);
+        iov.iov_len = length;
+        return iov;
+    }
+
+    // 写出全部iovec，处理部分写入和IOV_MAX限制，返回写出的字节数
+    size_t writeFully(int fd, std::vector<iovec>& iovs) {
+        size_t total = 0;
+        size_t index = 0;
+        while (index < iovs.size()) {
+            int count = static_cast<int>(std::min<size_t>(iovs.size() - index, IOV_MAX));
+            ssize_t written = writev(fd, &iovs[index], count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            total += written;
+
+            // 跳过已完整写出的部分，剩余部分从断开处继续
+            size_t remaining = static_cast<size_t>(written);
+            while (index < iovs.size() && remaining >= iovs[index].iov_len) {
+                remaining -= iovs[index].iov_len;
+                index++;
+            }
+            if (remaining > 0) {
+                iovs[index].iov_base = static_cast<char*>(iovs[index].iov_base) + remaining;
+                iovs[index].iov_len -= remaining;
+            }
+        }
+        return total;
+    }
+}
+
+LogRateLimiter::LogRateLimiter(const char* file, int line, int perSecond)
+    : interval(1000000000LL / (perSecond > 0 ? perSecond : 1)), theoreticalTime(0), suppressed(0) {
+    // 只保留文件名部分
+    const char* name = strrchr(file, '/');
+    site = std::string(name ? name + 1 : file) + ":" + std::to_string(line);
+    EnhancedLogger::getInstance().registerLimiter(this);
+}
+
+LogRateLimiter::~LogRateLimiter() {
+    EnhancedLogger::getInstance().unregisterLimiter(this);
+}
+
+bool LogRateLimiter::allow() {
+    // 理论放行时间超前当前时间1秒以上（即1秒内已放行perSecond条）时拒绝
+    const int64_t tolerance = 1000000000LL;
+    int64_t now = LogFormat::monotonicNanos();
+    int64_t theoretical = theoreticalTime.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t base = std::max(theoretical, now);
+        if (base - now >= tolerance) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (theoreticalTime.compare_exchange_weak(theoretical, base + interval, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
 
 EnhancedLogger::EnhancedLogger() 
-    : currentLevel(LogLevel::INFO), consoleOutput(true), colorOutput(true),
-      logDirectory("logs"), logBaseName("app"), processName("Unknown") {
+    : currentLevel(LogLevel::INFO), logFd(-1), logFileSize(0), consoleOutput(true), colorOutput(true),
+      binaryFormat(false), logDirectory("logs"), logBaseName("app"), processName("Unknown"),
+      asyncMode(false), asyncProducers(0), writerRunning(false), writerIdle(false), writtenCount(0),
+      overflowPolicy(LogOverflowPolicy::BLOCK), reportedDropped(0),
+      requestSampleRate(1), sampledOut(0), nextSuppressedReport(0),
+      suppressedReportInterval(10LL * 1000000000) {
+    for (auto& count : droppedCounts) {
+        count.store(0);
+    }
     // 确保日志目录存在
     createLogDirectory(logDirectory);
 }
 
 EnhancedLogger::~EnhancedLogger() {
-    if (logFile.is_open()) {
-        logFile.close();
+    stopAsync();
+    if (logFd >= 0) {
+        close(logFd);
     }
 }
 
@@ -35,8 +131,9 @@ void EnhancedLogger::setLogLevel(LogLevel level) {
 void EnhancedLogger::setLogFile(const std::string& filename) {
     std::lock_guard<std::mutex> lock(logMutex);
     
-    if (logFile.is_open()) {
-        logFile.close();
+    if (logFd >= 0) {
+        close(logFd);
+        logFd = -1;
     }
     
     // 解析文件名，提取目录和基本文件名
@@ -67,8 +164,7 @@ void EnhancedLogger::setLogFile(const std::string& filename) {
     currentLogFilename = generateLogFilename(logBaseName);
     
     // 打开日志文件
-    logFile.open(currentLogFilename, std::ios::app);
-    if (!logFile.is_open()) {
+    if (!openLogFile()) {
         std::cerr << "无法打开日志文件: " << currentLogFilename << std::endl;
     } else {
         std::cout << "[" << processName << "] 日志将写入: " << currentLogFilename << std::endl;
@@ -76,7 +172,13 @@ void EnhancedLogger::setLogFile(const std::string& filename) {
 }
 
 void EnhancedLogger::setProcessName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(logMutex);
     processName = name;
+    
+    // 二进制日志的进程名记录在锚点中，之后的记录按新进程名解码
+    if (binaryFormat && logFd >= 0) {
+        writeAnchor();
+    }
 }
 
 void EnhancedLogger::enableConsoleOutput(bool enable) {
@@ -87,6 +189,170 @@ void EnhancedLogger::enableColorOutput(bool enable) {
     colorOutput = enable;
 }
 
+void EnhancedLogger::setFileFormat(LogFileFormat format) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    
+    bool binary = format == LogFileFormat::BINARY;
+    if (binary == binaryFormat) {
+        return;
+    }
+    binaryFormat = binary;
+    
+    // 已经打开的文件换成对应格式的新文件，旧文件还没有内容时删除
+    if (logFd >= 0) {
+        close(logFd);
+        logFd = -1;
+        if (logFileSize == 0) {
+            unlink(currentLogFilename.c_str());
+        }
+        currentLogFilename = generateLogFilename(logBaseName);
+        if (!openLogFile()) {
+            std::cerr << "无法打开日志文件: " << currentLogFilename << std::endl;
+        } else {
+            std::cout << "[" << processName << "] 日志将写入: " << currentLogFilename << std::endl;
+        }
+    }
+}
+
+void EnhancedLogger::startAsync(size_t queueSize, LogOverflowPolicy policy) {
+    if (asyncMode) {
+        return;
+    }
+    
+    queue.reset(new MpscQueue<LogRecord>(queueSize));
+    overflowPolicy = policy;
+    writtenCount = 0;
+    writerRunning = true;
+    writerThread = std::thread(&EnhancedLogger::writerLoop, this);
+    asyncMode = true;
+}
+
+void EnhancedLogger::stopAsync() {
+    if (!asyncMode) {
+        return;
+    }
+    
+    // 先切回同步写，等已看到异步模式的线程入队完成（写线程仍在运行，队列满时也能腾出空间），
+    // 再让写线程写完队列中剩余的日志后退出
+    asyncMode = false;
+    while (asyncProducers.load() > 0) {
+        std::this_thread::yield();
+    }
+    writerRunning = false;
+    wakeWriter();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    
+    // 切换期间仍按异步模式入队的日志由当前线程写出。生产者占用槽位后还没写入时tryPop失败，
+    // 此时停下会丢掉它和排在后面的日志，因此等到已入队的全部写出为止
+    std::lock_guard<std::mutex> lock(logMutex);
+    LogRecord record;
+    while (queue->poppedCount() < queue->pushedCount()) {
+        if (queue->tryPop(record)) {
+            writeRecords(&record, 1);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    reportDropped();
+}
+
+void EnhancedLogger::flush() {
+    if (!asyncMode) {
+        return;  // 同步模式直接写入文件描述符，没有缓冲
+    }
+    
+    size_t target = queue->pushedCount();
+    while (writtenCount.load() < target && writerRunning) {
+        wakeWriter();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+uint64_t EnhancedLogger::getDroppedCount() const {
+    uint64_t total = 0;
+    for (const auto& count : droppedCounts) {
+        total += count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t EnhancedLogger::getDroppedCount(LogLevel level) const {
+    return droppedCounts[static_cast<int>(level)].load(std::memory_order_relaxed);
+}
+
+void EnhancedLogger::setRequestSampling(int everyN) {
+    requestSampleRate = everyN > 1 ? everyN : 1;
+}
+
+bool EnhancedLogger::sampleRequest(const std::string& requestId) {
+    int everyN = requestSampleRate.load(std::memory_order_relaxed);
+    if (everyN <= 1 || std::hash<std::string>()(requestId) % everyN == 0) {
+        return true;
+    }
+    sampledOut.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void EnhancedLogger::setSuppressedReportInterval(int seconds) {
+    suppressedReportInterval = static_cast<int64_t>(seconds > 0 ? seconds : 1) * 1000000000;
+}
+
+void EnhancedLogger::registerLimiter(LogRateLimiter* limiter) {
+    std::lock_guard<std::mutex> lock(limiterMutex);
+    limiters.push_back(limiter);
+}
+
+void EnhancedLogger::unregisterLimiter(LogRateLimiter* limiter) {
+    std::lock_guard<std::mutex> lock(limiterMutex);
+    limiters.erase(std::remove(limiters.begin(), limiters.end(), limiter), limiters.end());
+}
+
+bool EnhancedLogger::collectSuppressed(std::vector<std::string>& messages) {
+    // 只有一个线程能抢到本次汇总
+    int64_t now = LogFormat::monotonicNanos();
+    int64_t next = nextSuppressedReport.load(std::memory_order_relaxed);
+    if (now < next || !nextSuppressedReport.compare_exchange_strong(next, now + suppressedReportInterval.load())) {
+        return false;
+    }
+    if (next == 0) {
+        return false;  // 第一次调用只设定起始时间
+    }
+    
+    std::string period = std::to_string(suppressedReportInterval.load() / 1000000000) + "秒";
+    {
+        std::lock_guard<std::mutex> lock(limiterMutex);
+        for (LogRateLimiter* limiter : limiters) {
+            uint64_t count = limiter->takeSuppressed();
+            if (count > 0) {
+                messages.push_back("🔇 日志限流 [" + limiter->getSite() + "] 最近" + period +
+                                   "内抑制了 " + std::to_string(count) + " 条日志");
+            }
+        }
+    }
+    
+    uint64_t sampled = sampledOut.exchange(0, std::memory_order_relaxed);
+    if (sampled > 0) {
+        messages.push_back("🔇 请求日志按1/" + std::to_string(requestSampleRate.load()) + "采样，最近" +
+                           period + "内跳过了 " + std::to_string(sampled) + " 条");
+    }
+    return !messages.empty();
+}
+
+bool EnhancedLogger::parseOverflowPolicy(const std::string& value, LogOverflowPolicy& policy) {
+    if (value == "block") {
+        policy = LogOverflowPolicy::BLOCK;
+    } else if (value == "drop") {
+        policy = LogOverflowPolicy::DROP;
+    } else if (value == "drop_debug") {
+        policy = LogOverflowPolicy::DROP_DEBUG;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void EnhancedLogger::debug(const std::string& message, const LogContext& context) {
     log(LogLevel::DEBUG, message, context);
 }
@@ -109,65 +375,36 @@ void EnhancedLogger::fatal(const std::string& message, const LogContext& context
 
 void EnhancedLogger::logRequest(const std::string& requestId, const std::string& method, 
                                const std::string& path, const std::string& clientIp) {
-    LogContext context(requestId, clientIp);
-    std::stringstream ss;
-    ss << "🌐 HTTP请求 [" << method << "] " << path;
-    if (!clientIp.empty()) {
-        ss << " 来自 " << clientIp;
-    }
-    info(ss.str(), context);
+    LogFormat::Arg args[] = {method, path, clientIp};
+    logEvent(LogLevel::INFO, LogFormat::REQUEST, args, 3, LogContext(requestId, clientIp));
 }
 
 void EnhancedLogger::logResponse(const std::string& requestId, int statusCode, 
                                 const std::string& message, double responseTime) {
-    LogContext context(requestId);
-    std::stringstream ss;
-    ss << "📤 HTTP响应 [" << statusCode << "]";
-    if (!message.empty()) {
-        ss << " " << message;
-    }
-    if (responseTime > 0) {
-        ss << " (" << std::fixed << std::setprecision(2) << responseTime << "ms)";
-    }
-    
-    if (statusCode >= 400) {
-        error(ss.str(), context);
-    } else {
-        info(ss.str(), context);
-    }
+    LogFormat::Arg args[] = {statusCode, message, responseTime};
+    logEvent(statusCode >= 400 ? LogLevel::ERROR : LogLevel::INFO,
+             LogFormat::RESPONSE, args, 3, LogContext(requestId));
 }
 
 void EnhancedLogger::logApiCall(const std::string& requestId, const std::string& apiType,
                                const std::string& operation, const std::string& params) {
-    LogContext context(requestId, "", "", operation);
-    std::stringstream ss;
-    ss << "🔗 API调用 [" << apiType << "." << operation << "]";
-    if (!params.empty()) {
-        ss << " 参数: " << params;
-    }
-    debug(ss.str(), context);
+    LogFormat::Arg args[] = {apiType, operation, params};
+    logEvent(LogLevel::DEBUG, LogFormat::API_CALL, args, 3, LogContext(requestId, "", "", operation));
 }
 
 void EnhancedLogger::logDatabase(const std::string& requestId, const std::string& operation,
                                 const std::string& table, const std::string& query, double execTime) {
-    LogContext context(requestId);
-    std::stringstream ss;
-    ss << "🗄️  数据库操作 [" << operation << "] 表: " << table;
-    if (execTime > 0) {
-        ss << " (" << std::fixed << std::setprecision(2) << execTime << "ms)";
-    }
-    if (!query.empty() && query.length() < 200) {
-        ss << " SQL: " << query;
-    }
-    debug(ss.str(), context);
+    // 过长的SQL不输出
+    std::string_view shortQuery = query.length() < 200 ? std::string_view(query) : std::string_view();
+    LogFormat::Arg args[] = {operation, table, shortQuery, execTime};
+    logEvent(LogLevel::DEBUG, LogFormat::DATABASE, args, 4, LogContext(requestId));
 }
 
 void EnhancedLogger::logError(const std::string& requestId, const std::string& errorType,
                              const std::string& errorMessage, const std::string& stackTrace) {
     LogContext context(requestId);
-    std::stringstream ss;
-    ss << "❌ 错误 [" << errorType << "] " << errorMessage;
-    error(ss.str(), context);
+    LogFormat::Arg args[] = {errorType, errorMessage};
+    logEvent(LogLevel::ERROR, LogFormat::ERROR_DETAIL, args, 2, context);
     
     if (!stackTrace.empty()) {
         error("堆栈跟踪: " + stackTrace, context);
@@ -176,121 +413,339 @@ void EnhancedLogger::logError(const std::string& requestId, const std::string& e
 
 void EnhancedLogger::logPerformance(const std::string& operation, double duration, 
                                    const std::string& details) {
-    std::stringstream ss;
-    ss << "⚡ 性能监控 [" << operation << "] " 
-       << std::fixed << std::setprecision(2) << duration << "ms";
-    if (!details.empty()) {
-        ss << " " << details;
-    }
-    
-    if (duration > 1000) {  // 超过1秒警告
-        warning(ss.str());
-    } else {
-        debug(ss.str());
-    }
+    LogFormat::Arg args[] = {operation, duration, details};
+    // 超过1秒警告
+    logEvent(duration > 1000 ? LogLevel::WARNING : LogLevel::DEBUG,
+             LogFormat::PERFORMANCE, args, 3, LogContext());
 }
 
 void EnhancedLogger::logSystem(const std::string& component, const std::string& event,
                               const std::string& details) {
-    std::stringstream ss;
-    ss << "🔧 系统事件 [" << component << "] " << event;
-    if (!details.empty()) {
-        ss << " " << details;
-    }
-    info(ss.str());
+    LogFormat::Arg args[] = {component, event, details};
+    logEvent(LogLevel::INFO, LogFormat::SYSTEM, args, 3, LogContext());
 }
 
 void EnhancedLogger::log(LogLevel level, const std::string& message, const LogContext& context) {
-    if (level < currentLevel) {
+    LogFormat::Arg arg(message);
+    logEvent(level, LogFormat::TEXT, &arg, 1, context);
+}
+
+void EnhancedLogger::logEvent(LogLevel level, uint16_t event, const LogFormat::Arg* args, size_t count,
+                              const LogContext& context) {
+    if (!isEnabled(level)) {
         return;
     }
     
-    std::string formattedMessage = formatLogMessage(level, message, context);
+    LogRecord record;
+    makeRecord(record, level, event, args, count, context);
     
-    std::lock_guard<std::mutex> lock(logMutex);
+    if (asyncMode) {
+        // 先登记再确认一次：stopAsync切回同步写之后，要么这里看到同步模式，要么它等这次入队完成
+        asyncProducers.fetch_add(1);
+        if (asyncMode) {
+            enqueue(record);
+            asyncProducers.fetch_sub(1);
+            if (level == LogLevel::FATAL) {
+                flush();  // 致命错误后进程可能马上退出，等待写出
+            }
+            return;
+        }
+        asyncProducers.fetch_sub(1);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        writeRecords(&record, 1);
+    }
     
-    // 输出到控制台
-    if (consoleOutput) {
-        std::string consoleMessage = formattedMessage;
-        if (colorOutput) {
-            consoleMessage = levelToColorString(level) + formattedMessage + "\033[0m";
+    // 同步模式没有写线程，由写日志的线程顺带输出限流汇总
+    std::vector<std::string> summaries;
+    if (collectSuppressed(summaries)) {
+        for (const std::string& summary : summaries) {
+            log(LogLevel::WARNING, summary);
+        }
+    }
+}
+
+void EnhancedLogger::makeRecord(LogRecord& record, LogLevel level, uint16_t event,
+                                const LogFormat::Arg* args, size_t count, const LogContext& context) {
+    record.level = level;
+    
+    // 二进制格式只保存事件ID和参数，只有需要输出到控制台时才渲染文本
+    if (!binaryFormat || consoleOutput) {
+        record.text = formatLogMessage(level, LogFormat::render(event, args, count), context);
+    }
+    if (binaryFormat) {
+        std::string_view fields[LogFormat::CONTEXT_FIELDS] = {
+            context.requestId, context.clientIp, context.userId, context.operation
+        };
+        LogFormat::encode(record.binary, event, static_cast<int>(level), LogFormat::monotonicNanos(),
+                          currentThreadId(), fields, args, count);
+    }
+}
+
+void EnhancedLogger::enqueue(LogRecord& record) {
+    int spins = 0;
+    while (!queue->tryPush(record)) {
+        if (overflowPolicy == LogOverflowPolicy::DROP ||
+            (overflowPolicy == LogOverflowPolicy::DROP_DEBUG && record.level == LogLevel::DEBUG)) {
+            droppedCounts[static_cast<int>(record.level)].fetch_add(1, std::memory_order_relaxed);
+            return;
         }
         
-        if (level == LogLevel::ERROR || level == LogLevel::FATAL) {
-            std::cerr << consoleMessage << std::endl;
+        // 等待写线程腾出空间，先让出CPU几次，仍然满再短暂休眠
+        wakeWriter();
+        if (++spins < 16) {
+            std::this_thread::yield();
         } else {
-            std::cout << consoleMessage << std::endl;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
     }
     
-    // 输出到文件
-    if (logFile.is_open()) {
-        logFile << formattedMessage << std::endl;
-        logFile.flush();
+    // 与writerLoop中的屏障配对：写线程要么看到新日志，要么在这里被看到正在等待
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerIdle.load(std::memory_order_relaxed)) {
+        wakeWriter();
+    }
+}
+
+void EnhancedLogger::wakeWriter() {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wakeCv.notify_one();
+}
+
+void EnhancedLogger::writerLoop() {
+    std::vector<LogRecord> batch(WRITE_BATCH);
+    auto lastReport = std::chrono::steady_clock::now();
+    
+    for (;;) {
+        size_t count = 0;
+        while (count < WRITE_BATCH && queue->tryPop(batch[count])) {
+            count++;
+        }
+        
+        if (count > 0) {
+            std::lock_guard<std::mutex> lock(logMutex);
+            writeRecords(batch.data(), count);
+            writtenCount.fetch_add(count);
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= DROP_REPORT_INTERVAL) {
+            lastReport = now;
+            std::lock_guard<std::mutex> lock(logMutex);
+            reportDropped();
+            
+            // 限流汇总直接写出，写线程不能向自己的队列入队
+            std::vector<std::string> summaries;
+            if (collectSuppressed(summaries)) {
+                for (const std::string& summary : summaries) {
+                    LogFormat::Arg arg(summary);
+                    LogRecord record;
+                    makeRecord(record, LogLevel::WARNING, LogFormat::TEXT, &arg, 1, LogContext());
+                    writeRecords(&record, 1);
+                }
+            }
+        }
+        
+        if (count == WRITE_BATCH) {
+            continue;  // 队列中可能还有积压，继续写
+        }
+        if (!writerRunning) {
+            // 停止前再确认一次队列已空
+            if (count == 0) {
+                break;
+            }
+            continue;
+        }
+        if (count > 0) {
+            continue;
+        }
+        
+        writerIdle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCv.wait_for(lock, WRITER_IDLE_WAIT, [this] {
+                return !writerRunning || queue->pushedCount() != writtenCount.load();
+            });
+        }
+        writerIdle.store(false, std::memory_order_relaxed);
+    }
+}
+
+void EnhancedLogger::writeRecords(const LogRecord* records, size_t count) {
+    if (logFd < 0 && !currentLogFilename.empty()) {
+        // 如果日志文件未打开但有文件名，尝试重新打开
+        openLogFile();
+    }
+    
+    std::vector<iovec> fileIovs;
+    std::vector<iovec> stdoutIovs;
+    std::vector<iovec> stderrIovs;
+    if (logFd >= 0) {
+        fileIovs.reserve(count * 2);
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        const LogRecord& record = records[i];
+        
+        // 输出到控制台
+        if (consoleOutput && !record.text.empty()) {
+            std::vector<iovec>& iovs = (record.level == LogLevel::ERROR || record.level == LogLevel::FATAL)
+                                       ? stderrIovs : stdoutIovs;
+            if (colorOutput) {
+                const char* color = levelToColorString(record.level);
+                iovs.push_back(makeIovec(color, strlen(color)));
+                iovs.push_back(makeIovec(record.text.data(), record.text.size()));
+                iovs.push_back(makeIovec(COLOR_RESET_NEWLINE, sizeof(COLOR_RESET_NEWLINE) - 1));
+            } else {
+                iovs.push_back(makeIovec(record.text.data(), record.text.size()));
+                iovs.push_back(makeIovec(NEWLINE, 1));
+            }
+        }
+        
+        // 输出到文件
+        if (logFd < 0) {
+            continue;
+        }
+        if (binaryFormat) {
+            if (!record.binary.empty()) {
+                fileIovs.push_back(makeIovec(record.binary.data(), record.binary.size()));
+            }
+        } else if (!record.text.empty()) {
+            fileIovs.push_back(makeIovec(record.text.data(), record.text.size()));
+            fileIovs.push_back(makeIovec(NEWLINE, 1));
+        }
+    }
+    
+    if (!stdoutIovs.empty()) {
+        writeFully(STDOUT_FILENO, stdoutIovs);
+    }
+    if (!stderrIovs.empty()) {
+        writeFully(STDERR_FILENO, stderrIovs);
+    }
+    if (!fileIovs.empty()) {
+        logFileSize += writeFully(logFd, fileIovs);
         
         // 检查日志文件大小，如果需要则轮转
         checkAndRotateLogFile();
-    } else if (!currentLogFilename.empty()) {
-        // 如果日志文件未打开但有文件名，尝试重新打开
-        logFile.open(currentLogFilename, std::ios::app);
-        if (logFile.is_open()) {
-            logFile << formattedMessage << std::endl;
-            logFile.flush();
+    }
+}
+
+void EnhancedLogger::reportDropped() {
+    uint64_t total = getDroppedCount();
+    if (total == reportedDropped) {
+        return;
+    }
+    
+    std::stringstream ss;
+    ss << "日志队列已满，累计丢弃 " << total << " 条日志（本次新增 " << (total - reportedDropped) << " 条";
+    for (LogLevel level : {LogLevel::DEBUG, LogLevel::INFO, LogLevel::WARNING, LogLevel::ERROR, LogLevel::FATAL}) {
+        uint64_t count = getDroppedCount(level);
+        if (count > 0) {
+            ss << "，" << levelToString(level) << " " << count;
         }
     }
+    ss << "）";
+    reportedDropped = total;
+    
+    std::string message = ss.str();
+    LogFormat::Arg arg(message);
+    LogRecord record;
+    makeRecord(record, LogLevel::WARNING, LogFormat::TEXT, &arg, 1, LogContext());
+    writeRecords(&record, 1);
 }
 
 std::string EnhancedLogger::formatLogMessage(LogLevel level, const std::string& message, const LogContext& context) const {
-    std::stringstream ss;
+    std::string line;
+    line.reserve(64 + processName.size() + context.requestId.size() + context.clientIp.size() +
+                 context.userId.size() + context.operation.size() + message.size());
     
     // 时间戳
-    ss << getCurrentTime();
+    appendCurrentTime(line);
     
     // 进程名和线程ID
-    ss << " [" << processName << "/" << getThreadId() << "]";
+    line += " [";
+    line += processName;
+    line += '/';
+    line += getThreadId();
+    line += ']';
     
-    // 日志级别
-    ss << " [" << std::setw(7) << std::left << levelToString(level) << "]";
+    // 日志级别，左对齐补足7个字符
+    const char* levelName = levelToString(level);
+    size_t levelLength = strlen(levelName);
+    line += " [";
+    line.append(levelName, levelLength);
+    if (levelLength < 7) {
+        line.append(7 - levelLength, ' ');
+    }
+    line += ']';
     
     // 请求ID（如果有）
     if (!context.requestId.empty()) {
-        ss << " [ReqID:" << context.requestId << "]";
+        line += " [ReqID:";
+        line += context.requestId;
+        line += ']';
     }
     
     // 客户端IP（如果有）
     if (!context.clientIp.empty()) {
-        ss << " [IP:" << context.clientIp << "]";
+        line += " [IP:";
+        line += context.clientIp;
+        line += ']';
     }
     
     // 用户ID（如果有）
     if (!context.userId.empty()) {
-        ss << " [User:" << context.userId << "]";
+        line += " [User:";
+        line += context.userId;
+        line += ']';
     }
     
     // 操作类型（如果有）
     if (!context.operation.empty()) {
-        ss << " [Op:" << context.operation << "]";
+        line += " [Op:";
+        line += context.operation;
+        line += ']';
     }
     
     // 消息内容
-    ss << " " << message;
+    line += ' ';
+    line += message;
     
-    return ss.str();
+    return line;
 }
 
-std::string EnhancedLogger::getCurrentTime() const {
+void EnhancedLogger::appendCurrentTime(std::string& out) const {
+    // 每个线程缓存当前秒的"YYYY-MM-DD HH:MM:SS"，秒数变化时才调用localtime_r重新格式化，
+    // 同一秒内只追加毫秒，避免localtime在多线程下争用libc的时区锁
+    struct SecondCache {
+        time_t second = -1;
+        char text[20];
+        size_t length = 0;
+    };
+    thread_local SecondCache cache;
+    
     auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    time_t second = static_cast<time_t>(ms / 1000);
+    int millis = static_cast<int>(ms % 1000);
     
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
+    if (second != cache.second) {
+        std::tm local;
+        localtime_r(&second, &local);
+        cache.length = strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &local);
+        cache.second = second;
+    }
     
-    return ss.str();
+    char suffix[4] = {'.', static_cast<char>('0' + millis / 100),
+                      static_cast<char>('0' + millis / 10 % 10), static_cast<char>('0' + millis % 10)};
+    out.append(cache.text, cache.length);
+    out.append(suffix, sizeof(suffix));
 }
 
-std::string EnhancedLogger::levelToString(LogLevel level) const {
+const char* EnhancedLogger::levelToString(LogLevel level) const {
     switch (level) {
         case LogLevel::DEBUG:   return "DEBUG";
         case LogLevel::INFO:    return "INFO";
@@ -301,7 +756,7 @@ std::string EnhancedLogger::levelToString(LogLevel level) const {
     }
 }
 
-std::string EnhancedLogger::levelToColorString(LogLevel level) const {
+const char* EnhancedLogger::levelToColorString(LogLevel level) const {
     switch (level) {
         case LogLevel::DEBUG:   return "\033[36m";  // 青色
         case LogLevel::INFO:    return "\033[32m";  // 绿色
@@ -312,42 +767,69 @@ std::string EnhancedLogger::levelToColorString(LogLevel level) const {
     }
 }
 
-std::string EnhancedLogger::getThreadId() const {
-    std::stringstream ss;
-    ss << std::this_thread::get_id();
-    std::string threadId = ss.str();
-    
-    // 只保留后6位以简化显示
-    if (threadId.length() > 6) {
-        threadId = threadId.substr(threadId.length() - 6);
-    }
+const std::string& EnhancedLogger::getThreadId() const {
+    // 每个线程只格式化一次
+    thread_local std::string threadId = [] {
+        std::stringstream ss;
+        ss << std::this_thread::get_id();
+        std::string id = ss.str();
+        
+        // 只保留后6位以简化显示
+        if (id.length() > 6) {
+            id = id.substr(id.length() - 6);
+        }
+        return id;
+    }();
     
     return threadId;
 }
 
-bool EnhancedLogger::checkAndRotateLogFile() {
-    if (!logFile.is_open() || currentLogFilename.empty()) {
+bool EnhancedLogger::openLogFile() {
+    logFd = open(currentLogFilename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (logFd < 0) {
         return false;
     }
     
-    // 获取当前文件大小
-    logFile.flush();
+    // 追加到已有文件时从现有大小开始累计
     struct stat fileStat;
-    if (stat(currentLogFilename.c_str(), &fileStat) != 0) {
+    logFileSize = fstat(logFd, &fileStat) == 0 ? static_cast<size_t>(fileStat.st_size) : 0;
+    
+    if (binaryFormat) {
+        writeAnchor();
+    }
+    return true;
+}
+
+void EnhancedLogger::writeAnchor() {
+    // 新文件先写入魔数，之后是同一时刻的系统时间和单调时钟，解码时据此换算时间
+    std::string header;
+    if (logFileSize == 0) {
+        header.append(LogFormat::MAGIC, LogFormat::MAGIC_SIZE);
+    }
+    std::string_view fields[LogFormat::CONTEXT_FIELDS];
+    LogFormat::Arg args[] = {static_cast<long long>(LogFormat::realtimeNanos()), processName};
+    LogFormat::encode(header, LogFormat::ANCHOR, 0, LogFormat::monotonicNanos(),
+                      currentThreadId(), fields, args, 2);
+    std::vector<iovec> iovs{makeIovec(header.data(), header.size())};
+    logFileSize += writeFully(logFd, iovs);
+}
+
+bool EnhancedLogger::checkAndRotateLogFile() {
+    if (logFd < 0 || currentLogFilename.empty()) {
         return false;
     }
     
     // 检查文件大小是否超过限制
-    if (static_cast<size_t>(fileStat.st_size) >= maxLogFileSize) {
+    if (logFileSize >= maxLogFileSize) {
         // 关闭当前日志文件
-        logFile.close();
+        close(logFd);
+        logFd = -1;
         
         // 生成新的日志文件名
         currentLogFilename = generateLogFilename(logBaseName);
         
         // 打开新的日志文件
-        logFile.open(currentLogFilename, std::ios::app);
-        if (!logFile.is_open()) {
+        if (!openLogFile()) {
             std::cerr << "无法打开新的日志文件: " << currentLogFilename << std::endl;
             return false;
         }
@@ -372,11 +854,13 @@ std::string EnhancedLogger::generateLogFilename(const std::string& baseFilename)
     // 获取当前时间作为文件名的一部分
     auto now = std::chrono::system_clock::now();
     auto time_t_now = std::chrono::system_clock::to_time_t(now);
+    std::tm local;
+    localtime_r(&time_t_now, &local);
     
     std::stringstream ss;
     ss << logDirectory << "/" << baseFilename << "_";
-    ss << std::put_time(std::localtime(&time_t_now), "%Y%m%d_%H%M%S");
-    ss << ".log";
+    ss << std::put_time(&local, "%Y%m%d_%H%M%S");
+    ss << (binaryFormat ? ".bin" : ".log");
     
     return ss.str();
 }
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "common/metrics.h"
+#include <stdexcept>
+#include <cstdio>
+
+const char* const Counter::TYPE_NAME = "counter";
+const char* const Gauge::TYPE_NAME = "gauge";
+const char* const Histogram::TYPE_NAME = "histogram";
+const char* const MetricsRegistry::CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+namespace {
+    // 导出的直方图边界（微秒），从100微秒到10秒
+    const uint64_t EXPORT_BOUNDS[] = {
+        100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+        100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+    };
+    const size_t EXPORT_BOUND_COUNT = sizeof(EXPORT_BOUNDS) / sizeof(EXPORT_BOUNDS[0]);
+
+    // 每个内部桶折算到的导出边界下标：桶内最大值不超过该边界，EXPORT_BOUND_COUNT表示只计入+Inf。
+    // 跨越边界的内部桶整体计入更大的边界，误差不超过一个内部桶的宽度
+    struct BucketMapping {
+        size_t bound[Histogram::BUCKETS];
+
+        BucketMapping() {
+            for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+                uint64_t maxValue = Histogram::bucketUpperBound(i) - 1;
+                size_t j = 0;
+                while (j < EXPORT_BOUND_COUNT && maxValue > EXPORT_BOUNDS[j]) {
+                    ++j;
+                }
+                bound[i] = j;
+            }
+        }
+    };
+
+    const BucketMapping& bucketMapping() {
+        static const BucketMapping mapping;
+        return mapping;
+    }
+
+    void appendSample(std::string& out, const std::string& name, const char* suffix,
+                      const std::string& labels, const char* extraLabel, const char* value) {
+        out += name;
+        out += suffix;
+        if (!labels.empty() || extraLabel) {
+            out += '{';
+            out += labels;
+            if (extraLabel) {
+                if (!labels.empty()) {
+                    out += ',';
+                }
+                out += extraLabel;
+            }
+            out += '}';
+        }
+        out += ' ';
+        out += value;
+        out += '\n';
+    }
+
+    void appendSample(std::string& out, const std::string& name, const char* suffix,
+                      const std::string& labels, const char* extraLabel, unsigned long long value) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%llu", value);
+        appendSample(out, name, suffix, labels, extraLabel, buffer);
+    }
+
+    // HELP文本只需转义反斜杠和换行
+    void appendHelp(std::string& out, const std::string& help) {
+        for (char c : help) {
+            if (c == '\\') {
+                out += "\\\\";
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+    }
+}
+
+Counter::Counter() {
+    for (Shard& shard : shards) {
+        shard.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Counter::appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const {
+    appendSample(out, name, "", labels, nullptr, static_cast<unsigned long long>(value()));
+}
+
+void Gauge::appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value()));
+    appendSample(out, name, "", labels, nullptr, buffer);
+}
+
+Histogram::Histogram() : shards(new Shard[METRIC_SHARDS]) {
+    for (size_t i = 0; i < METRIC_SHARDS; ++i) {
+        for (auto& bucket : shards[i].buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        shards[i].count.store(0, std::memory_order_relaxed);
+        shards[i].sum.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index + 1;
+    }
+    size_t exponent = index / SUB_BUCKETS + 2;
+    uint64_t subBucket = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + subBucket + 1) << (exponent - 3);
+}
+
+void Histogram::snapshot(Snapshot& result) const {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        result.buckets[i] = 0;
+    }
+    result.count = 0;
+    result.sumMicros = 0;
+
+    for (size_t s = 0; s < METRIC_SHARDS; ++s) {
+        const Shard& shard = shards[s];
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        result.count += shard.count.load(std::memory_order_relaxed);
+        result.sumMicros += shard.sum.load(std::memory_order_relaxed);
+    }
+}
+
+void Histogram::appendPrometheus(std::string& out, const std::string& name, const std::string& labels) const {
+    Snapshot data;
+    snapshot(data);
+
+    uint64_t boundCounts[EXPORT_BOUND_COUNT + 1] = {};
+    const BucketMapping& mapping = bucketMapping();
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        boundCounts[mapping.bound[i]] += data.buckets[i];
+        total += data.buckets[i];
+    }
+
+    // 桶计数按累计值输出；各分片分别读取，+Inf和_count使用桶的合计以保持一致
+    uint64_t cumulative = 0;
+    for (size_t j = 0; j < EXPORT_BOUND_COUNT; ++j) {
+        cumulative += boundCounts[j];
+        char le[32];
+        snprintf(le, sizeof(le), "le=\"%g\"", static_cast<double>(EXPORT_BOUNDS[j]) / 1e6);
+        appendSample(out, name, "_bucket", labels, le, static_cast<unsigned long long>(cumulative));
+    }
+    appendSample(out, name, "_bucket", labels, "le=\"+Inf\"", static_cast<unsigned long long>(total));
+
+    char sum[32];
+    snprintf(sum, sizeof(sum), "%.6f", static_cast<double>(data.sumMicros) / 1e6);
+    appendSample(out, name, "_sum", labels, nullptr, sum);
+    appendSample(out, name, "_count", labels, nullptr, static_cast<unsigned long long>(total));
+}
+
+std::string MetricFamilyBase::formatLabel(std::string_view value) const {
+    std::string label = labelName + "=\"";
+    for (char c : value) {
+        if (c == '\\') {
+            label += "\\\\";
+        } else if (c == '"') {
+            label += "\\\"";
+        } else if (c == '\n') {
+            label += "\\n";
+        } else {
+            label += c;
+        }
+    }
+    label += '"';
+    return label;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+template <typename T>
+MetricFamily<T>& MetricsRegistry::getOrCreate(const std::string& name, const std::string& help,
+                                              const std::string& labelName) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& family : families) {
+        if (family->getName() == name) {
+            MetricFamily<T>* existing = dynamic_cast<MetricFamily<T>*>(family.get());
+            if (!existing) {
+                throw std::logic_error("指标类型冲突: " + name);
+            }
+            return *existing;
+        }
+    }
+
+    MetricFamily<T>* family = new MetricFamily<T>(name, help, labelName);
+    families.emplace_back(family);
+    return *family;
+}
+
+MetricFamily<Counter>& MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                                const std::string& labelName) {
+    return getOrCreate<Counter>(name, help, labelName);
+}
+
+MetricFamily<Gauge>& MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                                            const std::string& labelName) {
+    return getOrCreate<Gauge>(name, help, labelName);
+}
+
+MetricFamily<Histogram>& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                                    const std::string& labelName) {
+    return getOrCreate<Histogram>(name, help, labelName);
+}
+
+void MetricsRegistry::addCollector(std::function<void()> collector) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    collectors.push_back(std::move(collector));
+}
+
+std::string MetricsRegistry::exportPrometheus() {
+    std::vector<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        pending = collectors;
+    }
+    // 采集函数可能更新或注册指标，不能持有注册表锁调用
+    for (const auto& collector : pending) {
+        collector();
+    }
+
+    std::string out;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& family : families) {
+        out += "# HELP ";
+        out += family->getName();
+        out += ' ';
+        appendHelp(out, family->getHelp());
+        out += "\n# TYPE ";
+        out += family->getName();
+        out += ' ';
+        out += family->getType();
+        out += '\n';
+        family->appendSamples(out);
+    }
+    return out;
+}
@@ -0,0 +1,243 @@
+#include "common/trace.h"
+#include "common/json_writer.h"
+#include "common/http_parser.h"
+#include <algorithm>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#include <cstdio>
+
+namespace {
+    thread_local Trace* currentTrace = nullptr;
+
+    uint32_t currentThreadId() {
+        thread_local uint32_t threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+        return threadId;
+    }
+
+    int64_t realtimeNanos() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // 纳秒换算为毫秒，保留到微秒
+    double toMillis(int64_t nanos) {
+        return static_cast<double>(nanos / 1000) / 1000.0;
+    }
+
+    // 系统时间纳秒格式化为"YYYY-MM-DD HH:MM:SS.mmm"（本地时间）
+    std::string formatWallTime(int64_t nanos) {
+        time_t seconds = static_cast<time_t>(nanos / 1000000000);
+        std::tm local;
+        localtime_r(&seconds, &local);
+
+        char buffer[32];
+        size_t length = strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        snprintf(buffer + length, sizeof(buffer) - length, ".%03d", static_cast<int>((nanos / 1000000) % 1000));
+        return buffer;
+    }
+}
+
+Trace::Trace(int64_t start) : start(start), end(start), wallStart(realtimeNanos() - (now() - start)) {
+    spans.reserve(8);
+}
+
+int64_t Trace::now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void Trace::addSpan(const char* name, int64_t spanStart, int64_t spanEnd, std::string_view detail) {
+    if (detail.length() > MAX_DETAIL) {
+        detail = detail.substr(0, MAX_DETAIL);
+    }
+    spans.push_back(Span{name, spanStart, spanEnd, currentThreadId(), std::string(detail)});
+}
+
+void Trace::finish() {
+    end = now();
+    std::stable_sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+        return a.start < b.start;
+    });
+}
+
+Trace* Trace::current() {
+    return currentTrace;
+}
+
+void Trace::setCurrent(Trace* trace) {
+    currentTrace = trace;
+}
+
+ScopedSpan::ScopedSpan(Trace* trace, const char* name, std::string_view detail)
+    : trace(trace), name(name), start(0) {
+    if (trace) {
+        start = Trace::now();
+        this->detail.assign(detail.data(), std::min(detail.length(), Trace::MAX_DETAIL));
+    }
+}
+
+ScopedSpan::~ScopedSpan() {
+    if (trace) {
+        trace->addSpan(name, start, Trace::now(), detail);
+    }
+}
+
+TraceCollector& TraceCollector::getInstance() {
+    static TraceCollector instance;
+    return instance;
+}
+
+void TraceCollector::configure(const std::string& processName, bool enabled, int slowThresholdMs, size_t capacity) {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    this->processName = processName;
+    this->capacity = capacity > 0 ? capacity : 1;
+    ring.clear();
+    nextSlot = 0;
+    slowThreshold.store(static_cast<int64_t>(slowThresholdMs) * 1000000, std::memory_order_relaxed);
+    this->enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceCollector::submit(std::unique_ptr<Trace> trace) {
+    if (!trace || trace->getRequestId().empty() ||
+        trace->getDuration() < slowThreshold.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::shared_ptr<const Trace> kept(std::move(trace));
+    std::lock_guard<std::mutex> lock(ringMutex);
+    if (ring.size() < capacity) {
+        ring.push_back(std::move(kept));
+    } else {
+        ring[nextSlot] = std::move(kept);
+    }
+    nextSlot = (nextSlot + 1) % capacity;
+}
+
+std::vector<std::shared_ptr<const Trace>> TraceCollector::collect(const std::string& requestId) const {
+    std::vector<std::shared_ptr<const Trace>> traces;
+    std::lock_guard<std::mutex> lock(ringMutex);
+    for (size_t i = 0; i < ring.size(); ++i) {
+        // nextSlot之前的一条是最新的
+        const auto& trace = ring[(nextSlot + ring.size() - 1 - i) % ring.size()];
+        if (requestId.empty() || trace->getRequestId() == requestId) {
+            traces.push_back(trace);
+        }
+    }
+    return traces;
+}
+
+std::string TraceCollector::handleAdminRequest(const HttpRequest& request) const {
+    std::string requestId;
+    std::string format;
+    request.queryParam("request_id", requestId);
+    request.queryParam("format", format);
+    if (format == "chrome") {
+        return exportChrome(requestId);
+    }
+    return exportJson(requestId);
+}
+
+std::string TraceCollector::exportJson(const std::string& requestId) const {
+    std::vector<std::shared_ptr<const Trace>> traces = collect(requestId);
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        name = processName;
+    }
+
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("process").value(name);
+    writer.key("enabled").value(isEnabled());
+    writer.key("slow_threshold_ms").value(static_cast<long long>(slowThreshold.load(std::memory_order_relaxed) / 1000000));
+    writer.key("traces").beginArray();
+    for (const auto& trace : traces) {
+        writer.beginObject();
+        writer.key("request_id").value(trace->getRequestId());
+        writer.key("start").value(formatWallTime(trace->toWallTime(trace->getStart())));
+        writer.key("duration_ms").value(toMillis(trace->getDuration()));
+        writer.key("spans").beginArray();
+        for (const Trace::Span& span : trace->getSpans()) {
+            writer.beginObject();
+            writer.key("name").value(span.name);
+            writer.key("offset_ms").value(toMillis(span.start - trace->getStart()));
+            writer.key("duration_ms").value(toMillis(span.end - span.start));
+            writer.key("thread").value(span.threadId);
+            if (!span.detail.empty()) {
+                writer.key("detail").value(span.detail);
+            }
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+    return out;
+}
+
+std::string TraceCollector::exportChrome(const std::string& requestId) const {
+    std::vector<std::shared_ptr<const Trace>> traces = collect(requestId);
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        name = processName;
+    }
+    long long pid = getpid();
+
+    // Complete事件（ph=X）：ts为系统时间微秒，同一线程上时间包含的事件显示为嵌套
+    std::string out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.key("displayTimeUnit").value("ms");
+    writer.key("traceEvents").beginArray();
+
+    writer.beginObject();
+    writer.key("name").value("process_name");
+    writer.key("ph").value("M");
+    writer.key("pid").value(pid);
+    writer.key("args").beginObject().key("name").value(name).endObject();
+    writer.endObject();
+
+    for (const auto& trace : traces) {
+        const std::vector<Trace::Span>& spans = trace->getSpans();
+        uint32_t requestThread = spans.empty() ? 0 : spans.back().threadId;
+
+        writer.beginObject();
+        writer.key("name").value("request");
+        writer.key("cat").value(name);
+        writer.key("ph").value("X");
+        writer.key("ts").value(static_cast<long long>(trace->toWallTime(trace->getStart()) / 1000));
+        writer.key("dur").value(static_cast<double>(trace->getDuration()) / 1000.0);
+        writer.key("pid").value(pid);
+        writer.key("tid").value(requestThread);
+        writer.key("args").beginObject().key("request_id").value(trace->getRequestId()).endObject();
+        writer.endObject();
+
+        for (const Trace::Span& span : spans) {
+            writer.beginObject();
+            writer.key("name").value(span.name);
+            writer.key("cat").value(name);
+            writer.key("ph").value("X");
+            writer.key("ts").value(static_cast<long long>(trace->toWallTime(span.start) / 1000));
+            writer.key("dur").value(static_cast<double>(span.end - span.start) / 1000.0);
+            writer.key("pid").value(pid);
+            writer.key("tid").value(span.threadId);
+            writer.key("args").beginObject();
+            writer.key("request_id").value(trace->getRequestId());
+            if (!span.detail.empty()) {
+                writer.key("detail").value(span.detail);
+            }
+            writer.endObject();
+            writer.endObject();
+        }
+    }
+
+    writer.endArray();
+    writer.endObject();
+    return out;
+}
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cctype>
 #include <ctime>
 #include <chrono>
 #include <sys/stat.h>
@@ -181,4 +182,26 @@ std::string escapeJson(const std::string& input) {
     return oss.str();
 }
 
+// URL处理函数
+std::string urlDecode(const std::string& input) {
+    std::string result;
+    result.reserve(input.size());
+    
+    for (size_t i = 0; i < input.size(); ++i) {
+        char c = input[i];
+        if (c == '+') {
+            result += ' ';
+        } else if (c == '%' && i + 2 < input.size() &&
+                   isxdigit(static_cast<unsigned char>(input[i + 1])) &&
+                   isxdigit(static_cast<unsigned char>(input[i + 2]))) {
+            result += static_cast<char>(std::stoi(input.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            result += c;
+        }
+    }
+    
+    return result;
+}
+
 } // namespace Utils
\ No newline at end of file
@@ -0,0 +1,357 @@
+#include "disp/ap_client.h"
+#include "disp/ap_connection_pool.h"
+#include "common/logger_enhanced.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+void ApClient::fail(ApCall& call, const std::string& errorType, const std::string& message,
+                    const std::string& details, const std::string& errorResponse) {
+    LOG_ERROR_DETAIL(call.requestId, errorType, message, details);
+    call.success = false;
+    call.errorType = errorType;
+    call.response = errorResponse;
+}
+
+int ApClient::httpStatus(const ApCall& call) {
+    if (call.success) {
+        return 200;
+    }
+    if (call.errorType == "BusyError") {
+        return 503;
+    }
+    return call.errorType == "TimeoutError" ? 504 : 502;
+}
+
+std::atomic<int> ApClient::protocolVersion(ApProtocol::VERSION);
+std::atomic<uint32_t> ApClient::nextWireId(1);
+
+void ApClient::setProtocolVersion(int version) {
+    protocolVersion = version <= 0 ? 0 : ApProtocol::VERSION;
+    LOG_SYSTEM("ApClient", "设置AP通信协议",
+               version <= 0 ? "按行JSON（兼容旧版AP）" : "帧协议 v" + std::to_string(ApProtocol::VERSION));
+}
+
+bool ApClient::isLineProtocol() {
+    return protocolVersion == 0;
+}
+
+std::string ApClient::encodeRequest(ApCall& call, ApProtocol::FrameType type) {
+    if (isLineProtocol()) {
+        // JSON序列化结果中不会出现原始换行符，换行符即消息边界
+        std::string request;
+        request.reserve(call.payload.length() + 1);
+        request.append(call.payload);
+        request.push_back('\n');
+        return request;
+    }
+
+    call.wireId = nextWireId.fetch_add(1, std::memory_order_relaxed);
+    return ApProtocol::encode(type, call.wireId, call.payload);
+}
+
+ApProtocol::DecodeResult ApClient::decodeResponse(ApCall& call, std::string& buffer) {
+    if (isLineProtocol()) {
+        size_t end = buffer.find('\n');
+        if (end == std::string::npos) {
+            return ApProtocol::DecodeResult::INCOMPLETE;
+        }
+        call.response.assign(buffer, 0, end);
+        call.success = true;
+        buffer.erase(0, end + 1);
+        return ApProtocol::DecodeResult::COMPLETE;
+    }
+
+    ApProtocol::Frame frame;
+    size_t consumed = 0;
+    ApProtocol::DecodeResult result = ApProtocol::decode(buffer.data(), buffer.length(), frame, consumed);
+    if (result == ApProtocol::DecodeResult::INCOMPLETE) {
+        return result;
+    }
+    if (result == ApProtocol::DecodeResult::INVALID) {
+        fail(call, "ProtocolError", "AP响应帧格式错误", "已接收字节数: " + std::to_string(buffer.length()),
+             "{\"error\":\"接收响应失败\"}");
+        return result;
+    }
+    buffer.erase(0, consumed);
+
+    if (frame.requestId != call.wireId) {
+        fail(call, "ProtocolError", "AP响应帧请求ID不匹配",
+             "期望: " + std::to_string(call.wireId) + ", 实际: " + std::to_string(frame.requestId),
+             "{\"error\":\"接收响应失败\"}");
+        return ApProtocol::DecodeResult::INVALID;
+    }
+
+    switch (frame.type) {
+        case ApProtocol::FrameType::RESPONSE:
+        case ApProtocol::FrameType::PONG:
+            call.response = std::move(frame.payload);
+            call.success = true;
+            return ApProtocol::DecodeResult::COMPLETE;
+        case ApProtocol::FrameType::ERROR: {
+            // AP无法处理该请求（如协议版本不支持或请求队列已满），连接本身仍然可用
+            nlohmann::json error = nlohmann::json::parse(frame.payload, nullptr, false);
+            if (error.is_object() && error.value("code", 0) == 503) {
+                fail(call, "BusyError", "AP繁忙，拒绝请求", frame.payload, frame.payload);
+            } else {
+                fail(call, "ProtocolError", "AP返回协议错误", frame.payload,
+                     "{\"error\":\"处理服务协议错误\",\"details\":" + frame.payload + "}");
+            }
+            return ApProtocol::DecodeResult::COMPLETE;
+        }
+        default:
+            fail(call, "ProtocolError", "AP返回未知类型的帧",
+                 "type: " + std::to_string(static_cast<int>(frame.type)),
+                 "{\"error\":\"接收响应失败\"}");
+            return ApProtocol::DecodeResult::INVALID;
+    }
+}
+
+bool ApClient::peekResponseLength(const ApCall& call, const std::string& buffer, uint32_t& length) {
+    if (isLineProtocol()) {
+        return false;
+    }
+
+    ApProtocol::Frame frame;
+    return ApProtocol::decodeHeader(buffer.data(), buffer.length(), frame, length) == ApProtocol::DecodeResult::COMPLETE &&
+           frame.type == ApProtocol::FrameType::RESPONSE && frame.requestId == call.wireId;
+}
+
+int ApClient::connectNonBlocking(ApCall& call) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        fail(call, "SocketError", "创建socket失败", "errno: " + std::to_string(errno),
+             "{\"error\":\"创建连接失败\",\"details\":\"socket creation failed\"}");
+        return -1;
+    }
+
+    struct sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(call.port);
+
+    if (inet_pton(AF_INET, call.host.c_str(), &serverAddr.sin_addr) <= 0) {
+        fail(call, "AddressError", "IP地址转换失败", "host: " + call.host,
+             "{\"error\":\"无效的服务器地址\",\"host\":\"" + call.host + "\"}");
+        close(sockfd);
+        return -1;
+    }
+
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    if (flags < 0 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        fail(call, "SocketError", "设置非阻塞模式失败", "errno: " + std::to_string(errno),
+             "{\"error\":\"创建连接失败\",\"details\":\"fcntl failed\"}");
+        close(sockfd);
+        return -1;
+    }
+
+    if (connect(sockfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0 && errno != EINPROGRESS) {
+        fail(call, "ConnectionError", "连接AP服务失败",
+             "host: " + call.host + ":" + std::to_string(call.port) + ", errno: " + std::to_string(errno),
+             "{\"error\":\"连接处理服务失败\",\"endpoint\":\"" + call.host + ":" + std::to_string(call.port) + "\"}");
+        close(sockfd);
+        return -1;
+    }
+
+    return sockfd;
+}
+
+int ApClient::openConnection(ApCall& call, bool& reused) {
+    int sockfd = ApConnectionPool::getInstance().acquire(call.host, call.port);
+    if (sockfd >= 0) {
+        reused = true;
+        LOG_DEBUG_CTX("复用AP连接 (fd=" + std::to_string(sockfd) + ")", LogContext(call.requestId, call.clientIp));
+        return sockfd;
+    }
+
+    reused = false;
+    return connectNonBlocking(call);
+}
+
+bool ApClient::checkConnected(ApCall& call, int sockfd) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+        error = errno;
+    }
+
+    if (error != 0) {
+        fail(call, "ConnectionError", "连接AP服务失败",
+             "host: " + call.host + ":" + std::to_string(call.port) + ", errno: " + std::to_string(error),
+             "{\"error\":\"连接处理服务失败\",\"endpoint\":\"" + call.host + ":" + std::to_string(call.port) + "\"}");
+        return false;
+    }
+
+    return true;
+}
+
+void ApClient::releaseConnection(const ApCall& call, int sockfd) {
+    ApConnectionPool::getInstance().release(call.host, call.port, sockfd);
+}
+
+bool ApClient::waitFor(int sockfd, short events, std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            return false;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = sockfd;
+        pfd.events = events;
+        pfd.revents = 0;
+
+        int result = poll(&pfd, 1, static_cast<int>(remaining));
+        if (result > 0) {
+            return true;
+        }
+        if (result == 0 || errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+ApClient::ExchangeResult ApClient::exchange(ApCall& call, ApProtocol::FrameType type, int sockfd, bool reused,
+                                            bool& reusable, std::chrono::steady_clock::time_point deadline) {
+    reusable = false;
+
+    // 1. 等待非阻塞连接完成
+    if (!reused) {
+        if (!waitFor(sockfd, POLLOUT, deadline)) {
+            fail(call, "TimeoutError", "连接AP服务超时", "host: " + call.host + ":" + std::to_string(call.port),
+                 "{\"error\":\"连接处理服务失败\",\"endpoint\":\"" + call.host + ":" + std::to_string(call.port) + "\"}");
+            return ExchangeResult::FAILED;
+        }
+        if (!checkConnected(call, sockfd)) {
+            return ExchangeResult::FAILED;
+        }
+        LOG_DEBUG_CTX("成功连接到AP服务", LogContext(call.requestId, call.clientIp, "",
+                      call.host + ":" + std::to_string(call.port)));
+    }
+
+    // 2. 发送请求
+    std::string request = encodeRequest(call, type);
+    size_t totalSent = 0;
+    while (totalSent < request.length()) {
+        ssize_t bytesSent = send(sockfd, request.c_str() + totalSent, request.length() - totalSent, MSG_NOSIGNAL);
+        if (bytesSent > 0) {
+            totalSent += bytesSent;
+        } else if (bytesSent < 0 && errno == EINTR) {
+            continue;
+        } else if (bytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!waitFor(sockfd, POLLOUT, deadline)) {
+                fail(call, "TimeoutError", "发送请求超时", "已发送字节数: " + std::to_string(totalSent),
+                     "{\"error\":\"发送请求失败\"}");
+                return ExchangeResult::FAILED;
+            }
+        } else if (reused && totalSent == 0) {
+            return ExchangeResult::RETRY;
+        } else {
+            fail(call, "SendError", "发送请求失败", "errno: " + std::to_string(errno),
+                 "{\"error\":\"发送请求失败\"}");
+            return ExchangeResult::FAILED;
+        }
+    }
+
+    LOG_DEBUG_CTX("请求发送成功, 字节数: " + std::to_string(totalSent), LogContext(call.requestId, call.clientIp));
+
+    // 3. 接收响应直到收到完整消息，响应大小不受单次读取限制
+    std::string buffer;
+    char chunk[16384];
+    while (true) {
+        ssize_t bytesReceived = recv(sockfd, chunk, sizeof(chunk), 0);
+        if (bytesReceived > 0) {
+            buffer.append(chunk, bytesReceived);
+            ApProtocol::DecodeResult decoded = decodeResponse(call, buffer);
+            if (decoded == ApProtocol::DecodeResult::INVALID) {
+                return ExchangeResult::FAILED;
+            }
+            if (decoded == ApProtocol::DecodeResult::COMPLETE) {
+                reusable = buffer.empty();
+                return call.success ? ExchangeResult::SUCCESS : ExchangeResult::FAILED;
+            }
+        } else if (bytesReceived == 0) {
+            if (!buffer.empty() && isLineProtocol()) {
+                // 旧版AP发送完响应后直接关闭连接，不带消息结束符
+                call.response = std::move(buffer);
+                call.success = true;
+                return ExchangeResult::SUCCESS;
+            }
+            if (reused && buffer.empty()) {
+                return ExchangeResult::RETRY;
+            }
+            fail(call, "ReceiveError", "接收响应失败",
+                 buffer.empty() ? "AP关闭连接且未返回数据" : "AP关闭连接，响应不完整",
+                 "{\"error\":\"接收响应失败\"}");
+            return ExchangeResult::FAILED;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (!waitFor(sockfd, POLLIN, deadline)) {
+                fail(call, "TimeoutError", "接收响应超时", "已接收字节数: " + std::to_string(buffer.length()),
+                     "{\"error\":\"接收响应失败\"}");
+                return ExchangeResult::FAILED;
+            }
+        } else if (reused && buffer.empty()) {
+            return ExchangeResult::RETRY;
+        } else {
+            fail(call, "ReceiveError", "接收响应失败", "errno: " + std::to_string(errno),
+                 "{\"error\":\"接收响应失败\"}");
+            return ExchangeResult::FAILED;
+        }
+    }
+}
+
+bool ApClient::forward(ApCall& call) {
+    call.apStart = std::chrono::high_resolution_clock::now();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(CALL_TIMEOUT_SEC);
+
+    // 复用的连接可能已被AP关闭，此时换新连接重试一次
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = false;
+        int sockfd = attempt == 0 ? openConnection(call, reused) : connectNonBlocking(call);
+        if (sockfd < 0) {
+            return false;
+        }
+
+        bool reusable = false;
+        ExchangeResult result = exchange(call, ApProtocol::FrameType::REQUEST, sockfd, reused, reusable, deadline);
+        if (result == ExchangeResult::SUCCESS) {
+            LOG_DEBUG_CTX("收到AP响应, 字节数: " + std::to_string(call.response.length()),
+                          LogContext(call.requestId, call.clientIp));
+            if (reusable) {
+                releaseConnection(call, sockfd);
+            } else {
+                close(sockfd);
+            }
+            return true;
+        }
+
+        close(sockfd);
+        if (result == ExchangeResult::FAILED) {
+            return false;
+        }
+
+        LOG_WARNING_CTX("复用的AP连接已失效，重新连接", LogContext(call.requestId, call.clientIp));
+    }
+
+    return false;
+}
+
+bool ApClient::probe(int sockfd) {
+    ApCall call;
+    call.requestId = "probe";
+    call.payload = "{\"type\":\"ping\"}";
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PROBE_TIMEOUT_MS);
+    bool reusable = false;
+    ExchangeResult result = exchange(call, ApProtocol::FrameType::PING, sockfd, true, reusable, deadline);
+    return result == ExchangeResult::SUCCESS && reusable;
+}
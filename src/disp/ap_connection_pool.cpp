@@ -0,0 +1,181 @@
+#include "disp/ap_connection_pool.h"
+#include "disp/ap_client.h"
+#include "common/logger_enhanced.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <chrono>
+
+ApConnectionPool::ApConnectionPool()
+    : maxIdlePerEndpoint(16), idleTimeout(60), probeInterval(15), maintaining(false) {
+}
+
+ApConnectionPool::~ApConnectionPool() {
+    stopMaintenance();
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    for (auto& pair : idle) {
+        for (const auto& conn : pair.second) {
+            close(conn.fd);
+        }
+    }
+    idle.clear();
+}
+
+ApConnectionPool& ApConnectionPool::getInstance() {
+    static ApConnectionPool instance;
+    return instance;
+}
+
+void ApConnectionPool::configure(int maxIdle, int idleTimeoutSec, int probeIntervalSec) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    maxIdlePerEndpoint = maxIdle > 0 ? maxIdle : 0;
+    idleTimeout = idleTimeoutSec > 0 ? idleTimeoutSec : 60;
+    probeInterval = probeIntervalSec > 0 ? probeIntervalSec : 15;
+
+    LOG_SYSTEM("ApConnectionPool", "配置连接池",
+               "每端点最大空闲连接: " + std::to_string(maxIdlePerEndpoint) +
+               ", 空闲超时: " + std::to_string(idleTimeout) + "秒" +
+               ", 探测间隔: " + std::to_string(probeInterval) + "秒");
+}
+
+void ApConnectionPool::startMaintenance() {
+    if (maintaining.exchange(true)) {
+        return;
+    }
+    maintenanceThread = std::thread(&ApConnectionPool::maintenanceLoop, this);
+}
+
+void ApConnectionPool::stopMaintenance() {
+    if (!maintaining.exchange(false)) {
+        return;
+    }
+    maintenanceCv.notify_all();
+    if (maintenanceThread.joinable()) {
+        maintenanceThread.join();
+    }
+}
+
+std::string ApConnectionPool::endpointKey(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+bool ApConnectionPool::isAlive(int fd) const {
+    // 空闲连接上不应有可读数据：读到EOF说明对端已关闭，读到数据说明连接状态已不可信
+    char byte;
+    ssize_t result = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+int ApConnectionPool::acquire(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    auto it = idle.find(endpointKey(host, port));
+    if (it == idle.end()) {
+        return -1;
+    }
+
+    // 优先使用最近归还的连接
+    std::vector<IdleConnection>& conns = it->second;
+    while (!conns.empty()) {
+        IdleConnection conn = conns.back();
+        conns.pop_back();
+
+        if (isAlive(conn.fd)) {
+            return conn.fd;
+        }
+
+        LOG_DEBUG("丢弃已失效的AP连接 (fd=" + std::to_string(conn.fd) + ", " + it->first + ")");
+        close(conn.fd);
+    }
+
+    return -1;
+}
+
+void ApConnectionPool::release(const std::string& host, int port, int fd) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        std::vector<IdleConnection>& conns = idle[endpointKey(host, port)];
+        if (conns.size() < static_cast<size_t>(maxIdlePerEndpoint)) {
+            time_t now = time(nullptr);
+            conns.push_back(IdleConnection{fd, now, now});
+            return;
+        }
+    }
+
+    // 连接池已满
+    close(fd);
+}
+
+size_t ApConnectionPool::idleCount() const {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    size_t count = 0;
+    for (const auto& pair : idle) {
+        count += pair.second.size();
+    }
+    return count;
+}
+
+void ApConnectionPool::maintenanceLoop() {
+    LOG_SYSTEM("ApConnectionPool", "维护线程启动", "");
+
+    while (maintaining) {
+        {
+            std::unique_lock<std::mutex> lock(maintenanceMutex);
+            maintenanceCv.wait_for(lock, std::chrono::seconds(1), [this]() { return !maintaining; });
+        }
+        if (!maintaining) {
+            break;
+        }
+        maintain();
+    }
+
+    LOG_SYSTEM("ApConnectionPool", "维护线程结束", "");
+}
+
+void ApConnectionPool::maintain() {
+    time_t now = time(nullptr);
+    std::vector<std::pair<std::string, IdleConnection>> toProbe;
+    int reaped = 0;
+
+    // 1. 在锁内回收超时的空闲连接，取出需要探测的连接
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        for (auto& pair : idle) {
+            std::vector<IdleConnection> keep;
+            for (const auto& conn : pair.second) {
+                if (now - conn.lastUsed >= idleTimeout) {
+                    close(conn.fd);
+                    reaped++;
+                } else if (now - conn.lastProbed >= probeInterval) {
+                    toProbe.emplace_back(pair.first, conn);
+                } else {
+                    keep.push_back(conn);
+                }
+            }
+            pair.second.swap(keep);
+        }
+    }
+
+    if (reaped > 0) {
+        LOG_DEBUG("回收空闲AP连接: " + std::to_string(reaped));
+    }
+
+    // 2. 在锁外发送探测请求，存活的连接放回连接池
+    for (auto& item : toProbe) {
+        if (!ApClient::probe(item.second.fd)) {
+            LOG_WARNING("AP连接探测失败，关闭连接 (fd=" + std::to_string(item.second.fd) + ", " + item.first + ")");
+            close(item.second.fd);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(poolMutex);
+        std::vector<IdleConnection>& conns = idle[item.first];
+        if (conns.size() < static_cast<size_t>(maxIdlePerEndpoint)) {
+            // 保留lastUsed，只探测不使用的连接仍按空闲超时回收
+            conns.push_back(IdleConnection{item.second.fd, item.second.lastUsed, time(nullptr)});
+        } else {
+            close(item.second.fd);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#include "disp/buffer_pool.h"
+
+const size_t BufferPool::CLASS_SIZES[BufferPool::CLASS_COUNT] = {4096, 16 * 1024, 64 * 1024};
+const size_t BufferPool::CLASS_LIMITS[BufferPool::CLASS_COUNT] = {1024, 256, 64};
+
+BufferPool::BufferPool() : bytes(0) {
+    // 预留列表空间，归还时不再扩容
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        pools[i].reserve(CLASS_LIMITS[i]);
+    }
+}
+
+void BufferPool::acquire(std::string& buffer, size_t minCapacity) {
+    if (buffer.capacity() >= minCapacity) {
+        return;
+    }
+
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        if (CLASS_SIZES[i] < minCapacity) {
+            continue;
+        }
+        if (pools[i].empty()) {
+            // 该档没有空闲缓冲区，按档位大小分配，归还后进入池中
+            buffer.reserve(CLASS_SIZES[i]);
+            return;
+        }
+        std::string& pooled = pools[i].back();
+        bytes -= pooled.capacity();
+        pooled.append(buffer);
+        buffer.swap(pooled);
+        pools[i].pop_back();
+        return;
+    }
+
+    // 超过最大一档的不经过池
+    buffer.reserve(minCapacity);
+}
+
+void BufferPool::release(std::string& buffer) {
+    buffer.clear();
+    size_t capacity = buffer.capacity();
+
+    // 归入容量不超过缓冲区的最大一档；小于最小一档、超过最大一档两倍或该档已满的直接释放
+    for (size_t i = CLASS_COUNT; i-- > 0;) {
+        if (capacity < CLASS_SIZES[i]) {
+            continue;
+        }
+        if (capacity <= CLASS_SIZES[CLASS_COUNT - 1] * 2 && pools[i].size() < CLASS_LIMITS[i]) {
+            bytes += capacity;
+            pools[i].emplace_back();
+            pools[i].back().swap(buffer);
+            return;
+        }
+        break;
+    }
+    std::string().swap(buffer);
+}
@@ -0,0 +1,221 @@
+#include "disp/http_dispatcher.h"
+#include "disp/http_response.h"
+#include "common/logger_enhanced.h"
+#include <chrono>
+
+const std::string HttpDispatcher::JSON_TYPE = "application/json";
+
+HttpDispatcher::Response::Response(int status, std::string body, const std::string* type)
+    : statusBlock(&HttpResponse::statusBlock(status)), statusCode(status), content(std::move(body)),
+      contentType(type) {
+}
+
+HttpDispatcher::Response HttpDispatcher::Response::options() {
+    static const std::string noType;
+    Response response(200, std::string(), &noType);
+    response.statusBlock = &HttpResponse::optionsBlock();
+    return response;
+}
+
+HttpDispatcher::HttpDispatcher(const std::string& serverName)
+    : name(serverName), writeTimeout(60), requestHeaderTimeout(10), keepAliveTimeout(15), maxKeepAliveRequests(1000),
+      keepAliveHeader("Connection: keep-alive\r\nKeep-Alive: timeout=15\r\n"),
+      connectionTimeouts(MetricsRegistry::getInstance().counter(
+          "disp_connection_timeouts_total", "因超时关闭的客户端连接数", "reason")) {
+}
+
+void HttpDispatcher::addRoute(const std::string& pattern, IServer::RequestHandler handler,
+                              const std::string& contentType) {
+    router.add("*", pattern, static_cast<int>(routeTable.size()));
+    routeTable.push_back(Route{handler, contentType, nullptr, nullptr});
+    LOG_INFO(name + "注册路由: " + pattern);
+}
+
+void HttpDispatcher::addForwardRoute(const std::string& method, const std::string& pattern,
+                                     IServer::ForwardPrepare prepare, IServer::ForwardComplete complete) {
+    router.add(method, pattern, static_cast<int>(routeTable.size()));
+    routeTable.push_back(Route{nullptr, JSON_TYPE, prepare, complete});
+    LOG_INFO(name + "注册转发路由: " + method + " " + pattern);
+}
+
+void HttpDispatcher::setTimeout(int timeoutSec) {
+    writeTimeout = timeoutSec;
+    LOG_INFO(name + "设置超时时间: " + std::to_string(timeoutSec) + "秒");
+}
+
+void HttpDispatcher::setHeaderTimeout(int timeoutSec) {
+    requestHeaderTimeout = timeoutSec > 0 ? timeoutSec : writeTimeout;
+    LOG_INFO(name + "设置请求头部超时: " + std::to_string(requestHeaderTimeout) + "秒");
+}
+
+void HttpDispatcher::setKeepAlive(int idleTimeoutSec, int maxRequests) {
+    keepAliveTimeout = idleTimeoutSec > 0 ? idleTimeoutSec : 0;
+    maxKeepAliveRequests = maxRequests > 0 ? maxRequests : 0;
+    keepAliveHeader = "Connection: keep-alive\r\nKeep-Alive: timeout=" + std::to_string(keepAliveTimeout) + "\r\n";
+    LOG_INFO(name + "设置长连接: 空闲超时" + std::to_string(keepAliveTimeout) + "秒, 每个连接最多" +
+             (maxKeepAliveRequests > 0 ? std::to_string(maxKeepAliveRequests) + "个请求" : std::string("不限请求数")));
+}
+
+bool HttpDispatcher::keepAlive(const HttpRequest& request, int requestCount, bool running) const {
+    return request.keepAlive && keepAliveTimeout > 0 && running &&
+           (maxKeepAliveRequests == 0 || requestCount < maxKeepAliveRequests);
+}
+
+bool HttpDispatcher::shouldLinger(const std::string& readBuffer, const HttpParser& parser) {
+    return readBuffer.length() > parser.consumed() || parser.request().keepAlive;
+}
+
+void HttpDispatcher::appendHeaders(std::string& out, const Response& response, bool keepAlive) const {
+    HttpResponse::appendHeaders(out, *response.contentType, connectionHeader(keepAlive));
+    HttpResponse::appendContentLength(out, response.content.length());
+}
+
+const std::string& HttpDispatcher::connectionHeader(bool keepAlive) const {
+    static const std::string closeHeader = "Connection: close\r\n";
+    return keepAlive ? keepAliveHeader : closeHeader;
+}
+
+HttpDispatcher::Dispatch HttpDispatcher::dispatch(const HttpRequest& request) const {
+    Dispatch result;
+
+    // 处理OPTIONS请求（预检请求）
+    if (request.method == "OPTIONS") {
+        result.response = Response::options();
+        return result;
+    }
+
+    int routeIndex = -1;
+    Router::MatchResult matched = router.match(request.method, request.path, routeIndex, result.params);
+    if (matched == Router::MatchResult::NOT_FOUND) {
+        LOG_WARNING("未找到路由: " + std::string(request.path));
+        result.response = Response(404, "{\"error\":\"未找到\"}");
+        return result;
+    }
+    if (matched == Router::MatchResult::METHOD_NOT_ALLOWED) {
+        LOG_WARNING("路由不支持该方法: " + std::string(request.method) + " " + std::string(request.path));
+        result.response = Response(405, "{\"error\":\"不支持的请求方法\"}");
+        return result;
+    }
+
+    // 转发路由：AP调用由服务器在事件循环中异步完成
+    const Route& route = routeTable[routeIndex];
+    if (route.prepare) {
+        result.route = &route;
+        return result;
+    }
+
+    try {
+        result.response = Response(200, route.handler(request, result.params), &route.contentType);
+    } catch (const std::exception& e) {
+        LOG_ERROR("处理请求时发生异常: " + std::string(e.what()));
+        result.response = Response(500, "{\"error\":\"内部服务器错误\"}");
+    }
+    return result;
+}
+
+HttpDispatcher::Response HttpDispatcher::reject(const HttpParser& parser, int fd) {
+    LOG_WARNING_LIMITED("请求格式错误 (fd=" + std::to_string(fd) + "): " + parser.errorMessage(), 10);
+    return Response(parser.errorStatus(), "{\"error\":\"" + std::string(parser.errorMessage()) + "\"}");
+}
+
+bool HttpDispatcher::prepareForward(const Route& route, const HttpRequest& request, const RouteParams& params,
+                                    ApCall& call, Response& response) {
+    std::string content;
+    bool forward;
+    try {
+        forward = route.prepare(request, params, content, call);
+    } catch (const std::exception& e) {
+        LOG_ERROR("处理请求时发生异常: " + std::string(e.what()));
+        response = Response(500, "{\"error\":\"内部服务器错误\"}");
+        return false;
+    }
+    if (!forward) {
+        // 无需调用AP，直接响应
+        response = Response(200, std::move(content));
+        return false;
+    }
+
+    LOG_INFO_CTX("开始转发请求到AP", LogContext(call.requestId, call.clientIp, "",
+                 call.requestType + "@" + call.host + ":" + std::to_string(call.port)));
+    call.apStart = std::chrono::high_resolution_clock::now();
+    return true;
+}
+
+HttpDispatcher::Response HttpDispatcher::completeForward(const IServer::ForwardComplete& complete, ApCall& call) {
+    try {
+        std::string content = complete(call);
+        return Response(ApClient::httpStatus(call), std::move(content));
+    } catch (const std::exception& e) {
+        LOG_ERROR("处理请求时发生异常: " + std::string(e.what()));
+        return Response(500, "{\"error\":\"内部服务器错误\"}");
+    }
+}
+
+bool HttpDispatcher::shouldRetry(const ApCall& call, bool reused, bool received) {
+    if (!reused || received) {
+        return false;
+    }
+    LOG_WARNING_CTX("复用的AP连接已失效，重新连接", LogContext(call.requestId, call.clientIp));
+    return true;
+}
+
+void HttpDispatcher::failTimeout(ApCall& call) {
+    ApClient::fail(call, "TimeoutError", "AP调用超时",
+                   "host: " + call.host + ":" + std::to_string(call.port),
+                   "{\"error\":\"接收响应失败\"}");
+}
+
+int64_t HttpDispatcher::clientTimeoutMs(ClientState state, bool buffered) const {
+    int64_t delaySec;
+    switch (state) {
+        case ClientState::READING_REQUEST:
+            // 没有缓存的后续请求时是空闲的长连接，否则按头部超时等待后续请求到齐
+            delaySec = buffered ? requestHeaderTimeout : keepAliveTimeout;
+            break;
+        case ClientState::PROCESSING:
+            return -1;
+        case ClientState::WRITING_RESPONSE:
+            delaySec = writeTimeout;
+            break;
+        default:
+            delaySec = LINGER_TIMEOUT;
+            break;
+    }
+    return delaySec * 1000;
+}
+
+void HttpDispatcher::recordTimeout(ClientState state, bool buffered, int requestCount, bool headersComplete,
+                                   int fd, int reactorId) {
+    const char* reason;
+    bool expected = false;
+    switch (state) {
+        case ClientState::READING_REQUEST:
+            if (!buffered && requestCount > 0) {
+                reason = "keepalive";
+                expected = true;
+            } else {
+                reason = headersComplete ? "body" : "header";
+            }
+            break;
+        case ClientState::WRITING_RESPONSE:
+            reason = "write";
+            break;
+        case ClientState::CLOSING:
+            reason = "linger";
+            expected = true;
+            break;
+        default:
+            reason = "processing";
+            break;
+    }
+    connectionTimeouts.get(reason).inc();
+
+    // 空闲长连接和延迟关闭到期是正常情况，其余说明客户端过慢（可能是慢速攻击）
+    std::string message = "连接超时关闭 (fd=" + std::to_string(fd) + ", reactor=" + std::to_string(reactorId) +
+                          ", 原因=" + reason + ")";
+    if (expected) {
+        LOG_DEBUG(message);
+    } else {
+        LOG_INFO_LIMITED(message, 10);
+    }
+}
@@ -0,0 +1,145 @@
+#include "disp/http_response.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <ctime>
+#include <map>
+#include <mutex>
+
+namespace {
+
+const char* const CORS_HEADERS =
+    "Access-Control-Allow-Origin: *\r\n"
+    "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, PATCH, OPTIONS\r\n"
+    "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
+
+const size_t MAX_PARTS = 8;
+
+struct StatusBlocks {
+    static const int COUNT = 12;
+    int codes[COUNT] = {200, 400, 404, 405, 413, 431, 500, 501, 502, 503, 504, 505};
+    std::string blocks[COUNT];
+
+    StatusBlocks() {
+        const char* reasons[COUNT] = {
+            "OK", "Bad Request", "Not Found", "Method Not Allowed", "Payload Too Large",
+            "Request Header Fields Too Large", "Internal Server Error", "Not Implemented",
+            "Bad Gateway", "Service Unavailable", "Gateway Timeout", "HTTP Version Not Supported"
+        };
+        for (int i = 0; i < COUNT; ++i) {
+            blocks[i] = build(codes[i], reasons[i]);
+        }
+    }
+
+    static std::string build(int code, const char* reason) {
+        std::string block;
+        block.append("HTTP/1.1 ").append(std::to_string(code)).append(" ").append(reason).append("\r\n");
+        block.append(CORS_HEADERS);
+        return block;
+    }
+};
+
+}  // namespace
+
+const std::string& HttpResponse::statusBlock(int statusCode) {
+    static const StatusBlocks table;
+    for (int i = 0; i < StatusBlocks::COUNT; ++i) {
+        if (table.codes[i] == statusCode) {
+            return table.blocks[i];
+        }
+    }
+
+    // 表外的状态码按需生成并缓存（map节点地址不变，返回的引用一直有效），不能当作200发出
+    static std::mutex extraMutex;
+    static std::map<int, std::string> extra;
+    std::lock_guard<std::mutex> lock(extraMutex);
+    auto it = extra.find(statusCode);
+    if (it == extra.end()) {
+        it = extra.emplace(statusCode, StatusBlocks::build(statusCode, statusCode >= 400 ? "Error" : "Unknown")).first;
+    }
+    return it->second;
+}
+
+const std::string& HttpResponse::optionsBlock() {
+    static const std::string block = std::string("HTTP/1.1 200 OK\r\n") + CORS_HEADERS +
+                                     "Access-Control-Max-Age: 86400\r\n";
+    return block;
+}
+
+const std::string& HttpResponse::dateHeader() {
+    thread_local time_t cachedSecond = 0;
+    thread_local std::string cached;
+
+    time_t now = time(nullptr);
+    if (now != cachedSecond) {
+        struct tm tmValue;
+        gmtime_r(&now, &tmValue);
+        char buffer[64];
+        size_t length = strftime(buffer, sizeof(buffer), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tmValue);
+        cached.assign(buffer, length);
+        cachedSecond = now;
+    }
+    return cached;
+}
+
+void HttpResponse::appendHeaders(std::string& out, const std::string& contentType, const std::string& connection) {
+    if (!contentType.empty()) {
+        out.append("Content-Type: ").append(contentType).append("\r\n");
+    }
+    out.append(dateHeader());
+    out.append(connection);
+}
+
+void HttpResponse::appendContentLength(std::string& out, size_t length) {
+    out.append("Content-Length: ").append(std::to_string(length)).append("\r\n\r\n");
+}
+
+ssize_t HttpResponse::send(int fd, const Part* parts, size_t count) {
+    struct iovec iov[MAX_PARTS];
+    size_t iovCount = fillIov(parts, count, iov, MAX_PARTS);
+    if (iovCount == 0) {
+        return 0;
+    }
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovCount;
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent > 0) {
+        advance(parts, count, static_cast<size_t>(sent));
+    }
+    return sent;
+}
+
+size_t HttpResponse::fillIov(const Part* parts, size_t count, struct iovec* iov, size_t maxIov) {
+    size_t iovCount = 0;
+    for (size_t i = 0; i < count && iovCount < maxIov; ++i) {
+        if (parts[i].data && *parts[i].pos < parts[i].data->length()) {
+            iov[iovCount].iov_base = const_cast<char*>(parts[i].data->data() + *parts[i].pos);
+            iov[iovCount].iov_len = parts[i].data->length() - *parts[i].pos;
+            ++iovCount;
+        }
+    }
+    return iovCount;
+}
+
+void HttpResponse::advance(const Part* parts, size_t count, size_t sent) {
+    // 按顺序把发送的字节数分摊到各段
+    for (size_t i = 0; i < count && sent > 0; ++i) {
+        if (!parts[i].data) {
+            continue;
+        }
+        size_t left = parts[i].data->length() - *parts[i].pos;
+        size_t consumed = sent < left ? sent : left;
+        *parts[i].pos += consumed;
+        sent -= consumed;
+    }
+}
+
+bool HttpResponse::complete(const Part* parts, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (parts[i].data && *parts[i].pos < parts[i].data->length()) {
+            return false;
+        }
+    }
+    return true;
+}
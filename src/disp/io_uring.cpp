@@ -0,0 +1,276 @@
+#include "disp/io_uring.h"
+
+#if DISP_HAS_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+int sysSetup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+int sysRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+}  // namespace
+
+IoUring::IoUring()
+    : ringFd(-1), features(0),
+      sqRing(MAP_FAILED), sqRingSize(0), cqRing(MAP_FAILED), cqRingSize(0), sqes(nullptr), sqesSize(0),
+      sqHead(nullptr), sqTail(nullptr), sqMask(0), sqEntries(0), sqArray(nullptr), sqeTail(0), sqeSubmitted(0),
+      cqHead(nullptr), cqTail(nullptr), cqMask(0), cqes(nullptr),
+      bufRing(nullptr), bufRingSize(0), bufferBase(nullptr), bufferAreaSize(0), bufferSize(0), bufferMask(0),
+      bufferTail(0) {
+    memset(opSupported, 0, sizeof(opSupported));
+}
+
+IoUring::~IoUring() {
+    destroy();
+}
+
+bool IoUring::fail(const std::string& what, int err) {
+    lastError = what + ": " + strerror(err);
+    return false;
+}
+
+bool IoUring::init(unsigned entries, unsigned cqMultiple) {
+    destroy();
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * (cqMultiple > 0 ? cqMultiple : 1);
+    ringFd = sysSetup(entries, &params);
+    if (ringFd < 0) {
+        return fail("io_uring_setup失败", errno);
+    }
+    features = params.features;
+
+    // 提交队列和完成队列的环（支持时共用一次映射）以及提交队列项数组
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = (features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap && cqRingSize > sqRingSize) {
+        sqRingSize = cqRingSize;
+    }
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        int err = errno;
+        destroy();
+        return fail("映射提交队列失败", err);
+    }
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                      IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            int err = errno;
+            destroy();
+            return fail("映射完成队列失败", err);
+        }
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqeArea = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                         IORING_OFF_SQES);
+    if (sqeArea == MAP_FAILED) {
+        int err = errno;
+        destroy();
+        return fail("映射提交队列项失败", err);
+    }
+    sqes = static_cast<struct io_uring_sqe*>(sqeArea);
+
+    char* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqeTail = sqeSubmitted = *sqTail;
+
+    char* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // 查询支持的操作码，内核不支持查询时按全部不支持处理
+    size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    char probeBuffer[sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)];
+    memset(probeBuffer, 0, probeSize);
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(probeBuffer);
+    if (sysRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        for (unsigned i = 0; i < probe->ops_len && i < 256; ++i) {
+            opSupported[probe->ops[i].op] = (probe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+        }
+    }
+    return true;
+}
+
+void IoUring::destroy() {
+    // 先关闭环形队列（内核取消所有未完成的请求），再解除缓冲区的映射
+    if (ringFd >= 0) {
+        close(ringFd);
+        ringFd = -1;
+    }
+    if (bufRing) {
+        munmap(bufRing, bufRingSize);
+        bufRing = nullptr;
+    }
+    if (bufferBase) {
+        munmap(bufferBase, bufferAreaSize);
+        bufferBase = nullptr;
+    }
+    if (sqes) {
+        munmap(sqes, sqesSize);
+        sqes = nullptr;
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    cqRing = MAP_FAILED;
+    if (sqRing != MAP_FAILED) {
+        munmap(sqRing, sqRingSize);
+        sqRing = MAP_FAILED;
+    }
+}
+
+bool IoUring::supports(uint8_t opcode) const {
+    return opSupported[opcode] != 0;
+}
+
+struct io_uring_sqe* IoUring::getSqe() {
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqeTail - head >= sqEntries) {
+        submit();
+        head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (sqeTail - head >= sqEntries) {
+            return nullptr;
+        }
+    }
+    unsigned index = sqeTail & sqMask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    ++sqeTail;
+    return sqe;
+}
+
+bool IoUring::reserve(unsigned count) {
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqEntries - (sqeTail - head) < count) {
+        submit();
+        head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    }
+    return sqEntries - (sqeTail - head) >= count;
+}
+
+int IoUring::submit() {
+    unsigned toSubmit = sqeTail - sqeSubmitted;
+    if (toSubmit == 0) {
+        return 0;
+    }
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+    int ret = sysEnter(ringFd, toSubmit, 0, 0, nullptr, 0);
+    if (ret < 0) {
+        return -errno;
+    }
+    sqeSubmitted += static_cast<unsigned>(ret);
+    return ret;
+}
+
+int IoUring::submitAndWait(int timeoutMs) {
+    unsigned toSubmit = sqeTail - sqeSubmitted;
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+
+    // 已有完成项时只提交不等待
+    bool ready = *cqHead != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    int ret = sysEnter(ringFd, toSubmit, ready ? 0 : 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                       &arg, sizeof(arg));
+    if (ret < 0) {
+        int err = errno;
+        return (err == ETIME || err == EINTR) ? 0 : -err;
+    }
+    sqeSubmitted += static_cast<unsigned>(ret);
+    return ret;
+}
+
+bool IoUring::registerSparseFiles(unsigned count) {
+    struct io_uring_rsrc_register reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.nr = count;
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (sysRegister(ringFd, IORING_REGISTER_FILES2, &reg, sizeof(reg)) < 0) {
+        return fail("注册文件表失败", errno);
+    }
+    return true;
+}
+
+bool IoUring::setupBufferRing(uint16_t groupId, unsigned count, unsigned size) {
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return fail("缓冲区环大小必须是2的幂", EINVAL);
+    }
+
+    bufferAreaSize = static_cast<size_t>(count) * size;
+    void* area = mmap(nullptr, bufferAreaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        return fail("分配接收缓冲区失败", errno);
+    }
+    bufferBase = static_cast<char*>(area);
+    bufferSize = size;
+
+    bufRingSize = count * sizeof(struct io_uring_buf);
+    void* ring = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        return fail("分配缓冲区环失败", errno);
+    }
+    bufRing = static_cast<struct io_uring_buf*>(ring);
+    // 注册时内核固定环所在的页，须先写入使页面实际分配
+    memset(bufRing, 0, bufRingSize);
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing);
+    reg.ring_entries = count;
+    reg.bgid = groupId;
+    if (sysRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return fail("注册缓冲区环失败", errno);
+    }
+
+    bufferMask = count - 1;
+    bufferTail = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+    return true;
+}
+
+void IoUring::recycleBuffer(uint16_t bufferId) {
+    struct io_uring_buf* buf = &bufRing[bufferTail & bufferMask];
+    buf->addr = reinterpret_cast<uint64_t>(bufferBase + static_cast<size_t>(bufferId) * bufferSize);
+    buf->len = bufferSize;
+    buf->bid = bufferId;
+    ++bufferTail;
+    // 尾部与第一项的保留字段重叠，写入缓冲区项之后再发布
+    __atomic_store_n(&bufRing[0].resv, bufferTail, __ATOMIC_RELEASE);
+}
+
+#endif // DISP_HAS_IO_URING
@@ -1,11 +1,16 @@
 #include "disp/server_factory.h"
 #include "disp/request_handler.h"
+#include "disp/ap_client.h"
+#include "disp/ap_connection_pool.h"
 #include "common/config.h"
 #include "common/logger_enhanced.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include <iostream>
 #include <signal.h>
 #include <unistd.h>
 #include <memory>
+#include <thread>
 
 // 全局服务器对象，用于信号处理
 std::unique_ptr<IServer> g_server = nullptr;
@@ -18,6 +23,21 @@ void signalHandler(int signum) {
     }
 }
 
+// 解析反应堆数量配置，"auto"表示按CPU核数
+int parseReactorCount(const std::string& value) {
+    if (value == "auto") {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 0 ? static_cast<int>(cores) : 1;
+    }
+    try {
+        int count = std::stoi(value);
+        return count > 0 ? count : 1;
+    } catch (const std::exception&) {
+        LOG_ERROR("disp.reactors配置无效: " + value + "，使用单反应堆");
+        return 1;
+    }
+}
+
 int main(int argc, char* argv[]) {
     // 设置日志
     EnhancedLogger::getInstance().setLogFile("logs/disp");
@@ -28,11 +48,40 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // 日志文件格式和控制台输出（二进制格式用logdecode工具查看）
+    EnhancedLogger::getInstance().enableConsoleOutput(Config::getInstance().getBool("log.console", true));
+    if (Config::getInstance().getString("log.format", "text") == "binary") {
+        EnhancedLogger::getInstance().setFileFormat(LogFileFormat::BINARY);
+    }
+    
+    // 过载保护：成功请求的日志按1/N采样，刷屏的日志按调用点限流，定期汇总被跳过的条数
+    EnhancedLogger::getInstance().setRequestSampling(Config::getInstance().getInt("log.sample.requests", 1));
+    EnhancedLogger::getInstance().setSuppressedReportInterval(Config::getInstance().getInt("log.rate_limit.report_interval", 10));
+    
+    // 异步日志：业务线程只负责格式化和入队，由后台线程批量写出
+    if (Config::getInstance().getBool("log.async", false)) {
+        LogOverflowPolicy policy = LogOverflowPolicy::DROP_DEBUG;
+        std::string policyName = Config::getInstance().getString("log.overflow_policy", "drop_debug");
+        if (!EnhancedLogger::parseOverflowPolicy(policyName, policy)) {
+            LOG_ERROR("log.overflow_policy配置无效: " + policyName + "，使用drop_debug");
+        }
+        EnhancedLogger::getInstance().startAsync(Config::getInstance().getInt("log.queue_size", 65536), policy);
+    }
+    
+    // 请求追踪：总耗时超过阈值的请求保留各阶段耗时，通过/api/admin/traces查看
+    TraceCollector::getInstance().configure("DISP",
+        Config::getInstance().getBool("trace.enabled", false),
+        Config::getInstance().getInt("trace.slow_threshold_ms", 100),
+        Config::getInstance().getInt("trace.buffer_size", 100));
+    TraceCollector::getInstance().setAdminEnabled(Config::getInstance().getBool("trace.admin_enabled", false));
+    
     // 获取配置
     int port = Config::getInstance().getInt("disp.port", 8080);
     int maxConnections = Config::getInstance().getInt("disp.max_connections", 1000);
     int timeout = Config::getInstance().getInt("disp.timeout", 60);
     bool useEpoll = Config::getInstance().getBool("disp.use_epoll", true);
+    std::string serverType = Config::getInstance().getString("disp.server_type", "");
+    int reactors = parseReactorCount(Config::getInstance().getString("disp.reactors", "1"));
     
     // 初始化请求处理器
     if (!RequestHandler::getInstance().init()) {
@@ -40,8 +89,17 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // 使用工厂创建服务器
-    g_server = ServerFactory::createServer(useEpoll, port);
+    // 配置DISP→AP通信协议和长连接池
+    ApClient::setProtocolVersion(Config::getInstance().getInt("ap.protocol.version", ApProtocol::VERSION));
+    ApConnectionPool::getInstance().configure(
+        Config::getInstance().getInt("ap.pool.size", 16),
+        Config::getInstance().getInt("ap.pool.idle_timeout", 60),
+        Config::getInstance().getInt("ap.pool.probe_interval", 15));
+    ApConnectionPool::getInstance().startMaintenance();
+    
+    // 使用工厂创建服务器：配置了disp.server_type时按类型创建，否则按disp.use_epoll
+    g_server = serverType.empty() ? ServerFactory::createServer(useEpoll, port)
+                                  : ServerFactory::createServer(serverType, port);
     if (!g_server) {
         LOG_ERROR("创建服务器失败");
         return 1;
@@ -50,36 +108,61 @@ int main(int argc, char* argv[]) {
     // 配置服务器参数
     g_server->setMaxConnections(maxConnections);
     g_server->setTimeout(timeout);
+    g_server->setIoThreads(reactors);
+    g_server->setStreamThreshold(Config::getInstance().getInt("disp.stream_threshold", 64 * 1024));
+    g_server->setKeepAlive(Config::getInstance().getInt("disp.keepalive_timeout", 15),
+                           Config::getInstance().getInt("disp.keepalive_max_requests", 1000));
+    g_server->setHeaderTimeout(Config::getInstance().getInt("disp.header_timeout", 10));
+    g_server->setRegisteredFiles(Config::getInstance().getBool("disp.uring_registered_files", false));
+    g_server->setWorkerPool(Config::getInstance().getInt("disp.workers", 32),
+                            static_cast<size_t>(Config::getInstance().getInt("disp.queue_limit", 256)));
     
     LOG_INFO("服务器配置: 类型=" + g_server->getServerType() +
              ", 端口=" + std::to_string(port) +
              ", 最大连接数=" + std::to_string(maxConnections) +
-             ", 超时时间=" + std::to_string(timeout) + "秒");
+             ", 超时时间=" + std::to_string(timeout) + "秒" +
+             ", 反应堆数量=" + std::to_string(reactors));
     
     // 注册信号处理
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
     
     // 注册路由
-    g_server->setRoute("/api/health", [](const std::string& request) -> std::string {
+    g_server->setRoute("/api/health", [](const HttpRequest& request, const RouteParams&) -> std::string {
         return RequestHandler::getInstance().handleRequest("/api/health", request);
     });
     
-    g_server->setRoute("/api/version", [](const std::string& request) -> std::string {
+    g_server->setRoute("/api/version", [](const HttpRequest& request, const RouteParams&) -> std::string {
         return RequestHandler::getInstance().handleRequest("/api/version", request);
     });
     
-    g_server->setRoute("/api/user", [](const std::string& request) -> std::string {
-        return RequestHandler::getInstance().handleRequest("/api/user", request);
-    });
-    
-    g_server->setRoute("/api/order", [](const std::string& request) -> std::string {
-        return RequestHandler::getInstance().handleRequest("/api/order", request);
+    // 运行指标，Prometheus文本格式
+    Gauge& activeConnections = MetricsRegistry::getInstance().gauge(
+        "disp_active_connections", "DISP当前的客户端连接数").get();
+    MetricsRegistry::getInstance().addCollector([gauge = &activeConnections]() {
+        gauge->set(g_server->getCurrentConnections());
     });
+    g_server->setRoute("/api/metrics", [](const HttpRequest&, const RouteParams&) -> std::string {
+        return MetricsRegistry::getInstance().exportPrometheus();
+    }, MetricsRegistry::CONTENT_TYPE);
+    // 追踪查询接口没有访问控制，只在显式启用时注册，由防火墙或反向代理限制来源
+    if (TraceCollector::getInstance().isAdminEnabled()) {
+        g_server->setRoute("/api/admin/traces", [](const HttpRequest& request, const RouteParams&) -> std::string {
+            return TraceCollector::getInstance().handleAdminRequest(request);
+        });
+        LOG_WARNING("已在DISP端口启用/api/admin/traces，该接口没有访问控制，请限制来源");
+    }
     
-    g_server->setRoute("/api/product", [](const std::string& request) -> std::string {
-        return RequestHandler::getInstance().handleRequest("/api/product", request);
-    });
+    // 业务路由转发到AP，EpollServer在事件循环中异步完成AP调用
+    for (const RequestHandler::ApRoute& route : RequestHandler::apRoutes()) {
+        g_server->setForwardRoute(route.method, route.pattern,
+            [&route](const HttpRequest& request, const RouteParams& params, std::string& content, ApCall& call) -> bool {
+                return RequestHandler::getInstance().prepareRequest(route, request, params, content, call);
+            },
+            [](ApCall& call) -> std::string {
+                return RequestHandler::getInstance().completeRequest(call);
+            });
+    }
     
     // 启动服务器
     if (!g_server->start()) {
@@ -95,6 +178,9 @@ int main(int argc, char* argv[]) {
         sleep(1);
     }
     
+    ApConnectionPool::getInstance().stopMaintenance();
+    
     LOG_INFO("Disp服务器已停止");
+    EnhancedLogger::getInstance().stopAsync();
     return 0;
 }
\ No newline at end of file
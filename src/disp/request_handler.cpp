@@ -1,26 +1,30 @@
 #include "disp/request_handler.h"
 #include "common/logger_enhanced.h"
 #include "common/config.h"
-#include "common/utils.h"
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
 #include <sstream>
-#include <regex>
+#include <charconv>
 #include <nlohmann/json.hpp>
 #include <chrono>
 #include <random>
 
+RequestHandler::RequestHandler()
+    : requestDuration(MetricsRegistry::getInstance().histogram(
+          "disp_request_duration_seconds", "DISP请求处理耗时（含AP调用）", "route")),
+      apCallDuration(MetricsRegistry::getInstance().histogram(
+          "disp_ap_call_duration_seconds", "DISP调用AP的耗时", "type")),
+      apCallFailures(MetricsRegistry::getInstance().counter(
+          "disp_ap_call_failures_total", "调用AP失败（连接、超时或协议错误）的次数", "type")) {
+}
+
 RequestHandler& RequestHandler::getInstance() {
     static RequestHandler instance;
     return instance;
 }
 
 std::string RequestHandler::generateRequestId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(1000, 9999);
+    // 多个反应堆/工作线程会并发调用，随机数生成器按线程独立
+    thread_local std::mt19937 gen(std::random_device{}());
+    thread_local std::uniform_int_distribution<> dis(1000, 9999);
     
     auto now = std::chrono::system_clock::now();
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
@@ -49,11 +53,11 @@ bool RequestHandler::init() {
     }
     
     // 注册一些默认处理函数
-    registerHandler("/api/health", [](const std::string&) -> std::string {
+    registerHandler("/api/health", [](const HttpRequest&) -> std::string {
         return "{\"status\":\"ok\",\"timestamp\":\"" + std::to_string(std::time(nullptr)) + "\"}";
     });
     
-    registerHandler("/api/version", [](const std::string&) -> std::string {
+    registerHandler("/api/version", [](const HttpRequest&) -> std::string {
         return "{\"version\":\"1.0.0\",\"service\":\"DISP\"}";
     });
     
@@ -61,81 +65,147 @@ bool RequestHandler::init() {
     return true;
 }
 
-std::string RequestHandler::handleRequest(const std::string& path, const std::string& requestData) {
+const std::vector<RequestHandler::ApRoute>& RequestHandler::apRoutes() {
+    // 不带{id}的更新、删除保留给在请求体中携带id的旧客户端
+    static const std::vector<ApRoute> routes = {
+        {"GET",    "/api/user",                "user",    "user.list"},
+        {"POST",   "/api/user",                "user",    "user.create"},
+        {"PUT",    "/api/user",                "user",    "user.update"},
+        {"DELETE", "/api/user",                "user",    "user.delete"},
+        {"GET",    "/api/user/{id}",           "user",    "user.get"},
+        {"PUT",    "/api/user/{id}",           "user",    "user.update"},
+        {"DELETE", "/api/user/{id}",           "user",    "user.delete"},
+        
+        {"GET",    "/api/order",               "order",   "order.list"},
+        {"POST",   "/api/order",               "order",   "order.create"},
+        {"PUT",    "/api/order",               "order",   "order.update"},
+        {"PATCH",  "/api/order",               "order",   "order.update"},
+        {"DELETE", "/api/order",               "order",   "order.delete"},
+        {"GET",    "/api/order/{id}",          "order",   "order.get"},
+        {"PUT",    "/api/order/{id}",          "order",   "order.update"},
+        {"PATCH",  "/api/order/{id}",          "order",   "order.update"},
+        {"DELETE", "/api/order/{id}",          "order",   "order.delete"},
+        {"PATCH",  "/api/order/{id}/status",   "order",   "order.updateStatus"},
+        
+        {"GET",    "/api/product",             "product", "product.list"},
+        {"POST",   "/api/product",             "product", "product.create"},
+        {"PUT",    "/api/product",             "product", "product.update"},
+        {"DELETE", "/api/product",             "product", "product.delete"},
+        {"GET",    "/api/product/{id}",        "product", "product.get"},
+        {"PUT",    "/api/product/{id}",        "product", "product.update"},
+        {"DELETE", "/api/product/{id}",        "product", "product.delete"},
+    };
+    return routes;
+}
+
+void RequestHandler::beginRequest(const std::string& route, const HttpRequest& httpRequest, ApCall& call) {
     // 生成请求ID用于追踪
-    std::string requestId = generateRequestId();
-    std::string clientIp = extractClientIp(requestData);
-    
-    auto startTime = std::chrono::high_resolution_clock::now();
-    
-    // 解析HTTP请求获取方法
-    HttpRequest httpRequest = parseHttpRequest(requestData);
+    call.requestId = generateRequestId();
+    call.clientIp = extractClientIp(httpRequest);
+    call.path = route;
+    call.requestStart = std::chrono::high_resolution_clock::now();
     
     // 记录请求日志
-    LOG_REQUEST(requestId, httpRequest.method, path, clientIp);
+    LOG_REQUEST(call.requestId, std::string(httpRequest.method), std::string(httpRequest.path), call.clientIp);
+}
+
+void RequestHandler::finishRequest(const ApCall& call, int statusCode) {
+    // 计算响应时间
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - call.requestStart);
+    requestDuration.get(call.path).observe(endTime - call.requestStart);
+    
+    // 记录响应日志
+    LOG_RESPONSE(call.requestId, statusCode, "", duration.count());
+}
+
+std::string RequestHandler::handleRequest(const std::string& path, const HttpRequest& httpRequest) {
+    ApCall call;
+    beginRequest(path, httpRequest, call);
     
     std::string response;
     int statusCode = 200;
     
     try {
-        // 检查是否有直接处理函数
         auto it = handlers.find(path);
         if (it != handlers.end()) {
-            LOG_INFO_CTX("使用本地处理函数", LogContext(requestId, clientIp, "", path));
-            response = it->second(requestData);
+            LOG_INFO_CTX("使用本地处理函数", LogContext(call.requestId, call.clientIp, "", path));
+            response = it->second(httpRequest);
         } else {
-            // 需要转发到AP处理
-            response = handleApiRequest(requestId, path, requestData, clientIp);
+            statusCode = 404;
+            LOG_WARNING_CTX("未注册本地处理函数", LogContext(call.requestId, call.clientIp, "", path));
+            response = "{\"error\":\"未找到\"}";
         }
     } catch (const std::exception& e) {
         statusCode = 500;
         response = "{\"error\":\"处理请求时发生异常\",\"message\":\"" + std::string(e.what()) + "\"}";
-        LOG_ERROR_DETAIL(requestId, "RequestProcessing", "处理请求异常", e.what());
+        LOG_ERROR_DETAIL(call.requestId, "RequestProcessing", "处理请求异常", e.what());
     }
     
-    // 计算响应时间
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+    finishRequest(call, statusCode);
+    return response;
+}
+
+bool RequestHandler::prepareRequest(const ApRoute& route, const HttpRequest& httpRequest, const RouteParams& params,
+                                    std::string& response, ApCall& call) {
+    beginRequest(route.pattern, httpRequest, call);
+    call.requestType = route.requestType;
     
-    // 记录响应日志
-    LOG_RESPONSE(requestId, statusCode, "", duration.count());
+    int statusCode = 200;
     
-    return response;
+    try {
+        if (prepareApiRequest(route, httpRequest, params, response, call)) {
+            // 需要转发到AP处理，响应日志在completeRequest中记录
+            return true;
+        }
+    } catch (const std::exception& e) {
+        statusCode = 500;
+        response = "{\"error\":\"处理请求时发生异常\",\"message\":\"" + std::string(e.what()) + "\"}";
+        LOG_ERROR_DETAIL(call.requestId, "RequestProcessing", "处理请求异常", e.what());
+    }
+    
+    finishRequest(call, statusCode);
+    return false;
 }
 
-std::string RequestHandler::handleApiRequest(const std::string& requestId, const std::string& path, 
-                                           const std::string& requestData, const std::string& clientIp) {
-    // 解析HTTP请求
-    HttpRequest httpRequest = parseHttpRequest(requestData);
-    
-    // 根据路径确定AP端点和请求类型
-    std::string apType;
-    std::string requestType;
-    
-    if (path.find("/api/user") == 0) {
-        apType = "user";
-        requestType = determineUserRequestType(httpRequest.method, path);
-    } else if (path.find("/api/order") == 0) {
-        apType = "order";
-        requestType = determineOrderRequestType(httpRequest.method, path);
-    } else if (path.find("/api/product") == 0) {
-        apType = "product";
-        requestType = determineProductRequestType(httpRequest.method, path);
-    } else {
-        LOG_WARNING_CTX("未知的API路径", LogContext(requestId, clientIp, "", path));
-        return "{\"error\":\"未知的API路径\",\"path\":\"" + path + "\"}";
+std::string RequestHandler::completeRequest(ApCall& call) {
+    auto endTime = std::chrono::high_resolution_clock::now();
+    
+    // 计算AP调用时间
+    auto apDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - call.apStart);
+    apCallDuration.get(call.requestType).observe(endTime - call.apStart);
+    if (!call.success) {
+        apCallFailures.get(call.requestType).inc();
     }
+    LOG_PERFORMANCE("AP调用", apDuration.count(),
+                    call.requestType + " -> " + call.host + ":" + std::to_string(call.port));
     
-    LOG_API_CALL(requestId, apType, requestType, "路径: " + path);
+    if (call.success) {
+        LOG_DEBUG_CTX("AP响应内容: " + call.response, LogContext(call.requestId, call.clientIp));
+    }
+    
+    // 计算响应时间并记录响应日志
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - call.requestStart);
+    requestDuration.get(call.path).observe(endTime - call.requestStart);
+    // 按服务器实际返回的状态码记录，失败和超时的调用不会被采样跳过
+    LOG_RESPONSE(call.requestId, ApClient::httpStatus(call), "", duration.count());
+    
+    return call.response;
+}
+
+bool RequestHandler::prepareApiRequest(const ApRoute& route, const HttpRequest& httpRequest,
+                                       const RouteParams& params, std::string& response, ApCall& call) {
+    LOG_API_CALL(call.requestId, route.service, call.requestType, "路径: " + std::string(httpRequest.path));
     
     // 转发到对应的AP
-    auto endpointIt = apEndpoints.find(apType);
+    auto endpointIt = apEndpoints.find(route.service);
     if (endpointIt != apEndpoints.end()) {
-        return forwardToAp(requestId, endpointIt->second, requestType, httpRequest, clientIp);
+        return buildApCall(endpointIt->second, httpRequest, params, response, call);
     }
     
-    LOG_WARNING_CTX("未找到对应的AP端点", LogContext(requestId, clientIp, "", apType));
-    return "{\"error\":\"未找到对应的处理服务\",\"service\":\"" + apType + "\"}";
+    LOG_WARNING_CTX("未找到对应的AP端点", LogContext(call.requestId, call.clientIp, "", route.service));
+    response = "{\"error\":\"未找到对应的处理服务\",\"service\":\"" + std::string(route.service) + "\"}";
+    return false;
 }
 
 void RequestHandler::registerHandler(const std::string& path, HandlerFunc handler) {
@@ -143,12 +213,22 @@ void RequestHandler::registerHandler(const std::string& path, HandlerFunc handle
     LOG_SYSTEM("RequestHandler", "注册处理函数", path);
 }
 
-std::string RequestHandler::forwardToAp(const std::string& requestId, const std::string& apEndpoint, 
-                                       const std::string& requestType, const HttpRequest& httpRequest, 
-                                       const std::string& clientIp) {
-    auto startTime = std::chrono::high_resolution_clock::now();
-    
-    LOG_INFO_CTX("开始转发请求到AP", LogContext(requestId, clientIp, "", requestType + "@" + apEndpoint));
+bool RequestHandler::buildApCall(const std::string& apEndpoint, const HttpRequest& httpRequest,
+                                 const RouteParams& params, std::string& response, ApCall& call) {
+    const std::string& requestId = call.requestId;
+    const std::string& clientIp = call.clientIp;
+    
+    // 路径中的ID参数必须是非负整数
+    std::string_view idText = params.get("id");
+    if (!idText.empty()) {
+        int id = 0;
+        auto parsed = std::from_chars(idText.data(), idText.data() + idText.length(), id);
+        if (parsed.ec != std::errc() || parsed.ptr != idText.data() + idText.length() || id < 0) {
+            LOG_WARNING_CTX("路径参数ID无效: " + std::string(idText), LogContext(requestId, clientIp));
+            response = "{\"error\":\"无效的ID\"}";
+            return false;
+        }
+    }
     
     // 解析AP端点（格式：http://localhost:8081）
     std::string host = "127.0.0.1";  // 直接使用IP地址
@@ -177,15 +257,18 @@ std::string RequestHandler::forwardToAp(const std::string& requestId, const std:
         }
     }
     
+    call.host = host;
+    call.port = port;
+    
     // 构造符合AP期望格式的JSON请求
     nlohmann::json messageJson;
-    messageJson["type"] = requestType;
+    messageJson["type"] = call.requestType;
     messageJson["request_id"] = requestId;  // 添加请求ID
     
     // 解析请求体中的JSON数据并合并到请求中
     if (!httpRequest.body.empty()) {
         try {
-            nlohmann::json bodyJson = nlohmann::json::parse(httpRequest.body);
+            nlohmann::json bodyJson = nlohmann::json::parse(httpRequest.body.begin(), httpRequest.body.end());
             for (auto& item : bodyJson.items()) {
                 messageJson[item.key()] = item.value();
             }
@@ -195,219 +278,43 @@ std::string RequestHandler::forwardToAp(const std::string& requestId, const std:
         }
     }
     
-    // 提取路径中的ID参数
-    std::regex idPattern(R"(/api/\w+/(\d+))");
-    std::smatch matches;
-    if (std::regex_search(httpRequest.path, matches, idPattern)) {
-        messageJson["id"] = std::stoi(matches[1].str());
-        LOG_DEBUG_CTX("提取路径参数ID: " + matches[1].str(), LogContext(requestId, clientIp));
-    }
-    
-    std::string jsonRequest = messageJson.dump();
-    LOG_DEBUG_CTX("AP请求JSON: " + jsonRequest, LogContext(requestId, clientIp));
-    
-    // 使用socket连接AP
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        LOG_ERROR_DETAIL(requestId, "SocketError", "创建socket失败", "errno: " + std::to_string(errno));
-        return "{\"error\":\"创建连接失败\",\"details\":\"socket creation failed\"}";
+    // 路径中的ID参数，与其他字段一样按字符串传给AP
+    if (!idText.empty()) {
+        messageJson["id"] = std::string(idText);
+        LOG_DEBUG_CTX("提取路径参数ID: " + std::string(idText), LogContext(requestId, clientIp));
     }
     
-    struct sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(port);
-    
-    if (inet_pton(AF_INET, host.c_str(), &serverAddr.sin_addr) <= 0) {
-        LOG_ERROR_DETAIL(requestId, "AddressError", "IP地址转换失败", "host: " + host);
-        close(sockfd);
-        return "{\"error\":\"无效的服务器地址\",\"host\":\"" + host + "\"}";
-    }
-    
-    // 设置连接超时
-    struct timeval timeout;
-    timeout.tv_sec = 5;  // 5秒超时
-    timeout.tv_usec = 0;
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-    
-    if (connect(sockfd, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        LOG_ERROR_DETAIL(requestId, "ConnectionError", "连接AP服务失败", 
-                        "host: " + host + ":" + std::to_string(port) + ", errno: " + std::to_string(errno));
-        close(sockfd);
-        return "{\"error\":\"连接处理服务失败\",\"endpoint\":\"" + host + ":" + std::to_string(port) + "\"}";
-    }
-    
-    LOG_DEBUG_CTX("成功连接到AP服务", LogContext(requestId, clientIp, "", host + ":" + std::to_string(port)));
-    
-    // 发送请求
-    ssize_t bytesSent = send(sockfd, jsonRequest.c_str(), jsonRequest.length(), 0);
-    if (bytesSent < 0) {
-        LOG_ERROR_DETAIL(requestId, "SendError", "发送请求失败", "errno: " + std::to_string(errno));
-        close(sockfd);
-        return "{\"error\":\"发送请求失败\"}";
-    }
-    
-    LOG_DEBUG_CTX("请求发送成功, 字节数: " + std::to_string(bytesSent), LogContext(requestId, clientIp));
-    
-    // 接收响应
-    char buffer[4096];
-    ssize_t bytesReceived = recv(sockfd, buffer, sizeof(buffer) - 1, 0);
-    std::string response;
-    
-    if (bytesReceived > 0) {
-        buffer[bytesReceived] = '\0';
-        response = std::string(buffer);
-        LOG_DEBUG_CTX("收到AP响应, 字节数: " + std::to_string(bytesReceived), LogContext(requestId, clientIp));
-        LOG_DEBUG_CTX("AP响应内容: " + response, LogContext(requestId, clientIp));
-    } else {
-        LOG_ERROR_DETAIL(requestId, "ReceiveError", "接收响应失败", "errno: " + std::to_string(errno));
-        response = "{\"error\":\"接收响应失败\"}";
-    }
-    
-    close(sockfd);
-    
-    // 计算AP调用时间
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-    
-    LOG_PERFORMANCE("AP调用", duration.count(), requestType + " -> " + host + ":" + std::to_string(port));
-    
-    return response;
-}
-
-std::string RequestHandler::extractClientIp(const std::string& requestData) {
-    // 简单的IP提取逻辑，从HTTP头部提取
-    std::istringstream stream(requestData);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        if (line.find("X-Forwarded-For:") != std::string::npos) {
-            size_t pos = line.find(":") + 1;
-            std::string ip = line.substr(pos);
-            ip.erase(0, ip.find_first_not_of(" \t"));
-            ip.erase(ip.find_last_not_of(" \t\r\n") + 1);
-            return ip;
-        }
-        if (line.find("X-Real-IP:") != std::string::npos) {
-            size_t pos = line.find(":") + 1;
-            std::string ip = line.substr(pos);
-            ip.erase(0, ip.find_first_not_of(" \t"));
-            ip.erase(ip.find_last_not_of(" \t\r\n") + 1);
-            return ip;
+    // 列表请求的分页参数来自查询字符串，由AP校验并限制单页条数
+    if (call.requestType.size() > 5 && call.requestType.compare(call.requestType.size() - 5, 5, ".list") == 0) {
+        std::string value;
+        for (const char* name : {"limit", "after_id"}) {
+            if (httpRequest.queryParam(name, value)) {
+                messageJson[name] = value;
+            }
         }
     }
     
-    return "127.0.0.1";  // 默认本地IP
+    call.payload = messageJson.dump();
+    LOG_DEBUG_CTX("AP请求JSON: " + call.payload, LogContext(requestId, clientIp));
+    return true;
 }
 
-// 解析HTTP请求
-RequestHandler::HttpRequest RequestHandler::parseHttpRequest(const std::string& request) {
-    HttpRequest httpRequest;
-    
-    std::istringstream stream(request);
-    std::string line;
-    
-    // 解析请求行
-    if (std::getline(stream, line)) {
-        std::istringstream requestLine(line);
-        std::string version;
-        requestLine >> httpRequest.method >> httpRequest.path >> version;
-        
-        // 解析查询参数
-        size_t queryPos = httpRequest.path.find('?');
-        if (queryPos != std::string::npos) {
-            httpRequest.query = httpRequest.path.substr(queryPos + 1);
-            httpRequest.path = httpRequest.path.substr(0, queryPos);
-        }
-    }
-    
-    // 解析头部
-    while (std::getline(stream, line) && line != "\r" && !line.empty()) {
-        size_t colonPos = line.find(':');
-        if (colonPos != std::string::npos) {
-            std::string key = line.substr(0, colonPos);
-            std::string value = line.substr(colonPos + 1);
-            
-            // 去除前后空白
-            key.erase(0, key.find_first_not_of(" \t"));
-            key.erase(key.find_last_not_of(" \t\r\n") + 1);
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t\r\n") + 1);
-            
-            httpRequest.headers[key] = value;
-        }
-    }
-    
-    // 解析请求体
-    std::ostringstream bodyStream;
-    while (std::getline(stream, line)) {
-        bodyStream << line << "\n";
-    }
-    httpRequest.body = bodyStream.str();
-    
-    // 去除末尾的换行符
-    if (!httpRequest.body.empty() && httpRequest.body.back() == '\n') {
-        httpRequest.body.pop_back();
-    }
+std::string RequestHandler::forwardToAp(ApCall& call) {
+    LOG_INFO_CTX("开始转发请求到AP", LogContext(call.requestId, call.clientIp, "",
+                 call.requestType + "@" + call.host + ":" + std::to_string(call.port)));
     
-    return httpRequest;
-}
-
-// 确定用户请求类型
-std::string RequestHandler::determineUserRequestType(const std::string& method, const std::string& path) {
-    if (method == "GET") {
-        std::regex idPattern(R"(/api/user/(\d+))");
-        if (std::regex_match(path, idPattern)) {
-            return "user.get";
-        }
-        return "user.list";
-    } else if (method == "POST") {
-        return "user.create";
-    } else if (method == "PUT") {
-        return "user.update";
-    } else if (method == "DELETE") {
-        return "user.delete";
-    }
-    return "user.unknown";
+    ApClient::forward(call);
+    return call.response;
 }
 
-// 确定订单请求类型
-std::string RequestHandler::determineOrderRequestType(const std::string& method, const std::string& path) {
-    if (method == "GET") {
-        std::regex idPattern(R"(/api/order/(\d+))");
-        if (std::regex_match(path, idPattern)) {
-            return "order.get";
-        }
-        return "order.list";
-    } else if (method == "POST") {
-        return "order.create";
-    } else if (method == "PUT") {
-        return "order.update";
-    } else if (method == "PATCH") {
-        if (path.find("/status") != std::string::npos) {
-            return "order.updateStatus";
+std::string RequestHandler::extractClientIp(const HttpRequest& request) {
+    // 经过代理时从转发头部取客户端IP
+    for (const char* name : {"X-Forwarded-For", "X-Real-IP"}) {
+        std::string_view ip = request.header(name);
+        if (!ip.empty()) {
+            return std::string(ip);
         }
-        return "order.update";
-    } else if (method == "DELETE") {
-        return "order.delete";
     }
-    return "order.unknown";
+    
+    return "127.0.0.1";  // 默认本地IP
 }
-
-// 确定产品请求类型
-std::string RequestHandler::determineProductRequestType(const std::string& method, const std::string& path) {
-    if (method == "GET") {
-        std::regex idPattern(R"(/api/product/(\d+))");
-        if (std::regex_match(path, idPattern)) {
-            return "product.get";
-        }
-        return "product.list";
-    } else if (method == "POST") {
-        return "product.create";
-    } else if (method == "PUT") {
-        return "product.update";
-    } else if (method == "DELETE") {
-        return "product.delete";
-    }
-    return "product.unknown";
-}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "disp/router.h"
+#include <stdexcept>
+
+void Router::add(const std::string& method, const std::string& pattern, int value) {
+    if (pattern.empty() || pattern[0] != '/') {
+        throw std::invalid_argument("路由模式必须以'/'开头: " + pattern);
+    }
+
+    std::string_view rest(pattern);
+    if (rest.length() > 1 && rest.back() == '/') {
+        rest.remove_suffix(1);
+    }
+
+    int node = 0;
+    size_t paramCount = 0;
+    while (!rest.empty()) {
+        if (rest[0] == '{') {
+            // 参数必须占据一个完整的路径段
+            size_t close = rest.find('}');
+            size_t offset = rest.data() - pattern.data();
+            if (close == std::string_view::npos || close == 1 || pattern[offset - 1] != '/' ||
+                (close + 1 < rest.length() && rest[close + 1] != '/')) {
+                throw std::invalid_argument("路由参数格式错误: " + pattern);
+            }
+            if (++paramCount > RouteParams::MAX_PARAMS) {
+                throw std::invalid_argument("路由参数过多: " + pattern);
+            }
+            node = insertParam(node, rest.substr(1, close - 1), pattern);
+            rest.remove_prefix(close + 1);
+        } else {
+            std::string_view text = rest.substr(0, rest.find('{'));
+            if (text.find('}') != std::string_view::npos) {
+                throw std::invalid_argument("路由参数格式错误: " + pattern);
+            }
+            node = insertStatic(node, text);
+            rest.remove_prefix(text.length());
+        }
+    }
+
+    Node& target = nodes[node];
+    if (method == "*") {
+        target.anyMethod = value;
+        return;
+    }
+    for (auto& entry : target.methods) {
+        if (entry.first == method) {
+            entry.second = value;
+            return;
+        }
+    }
+    target.methods.emplace_back(method, value);
+}
+
+int Router::insertStatic(int node, std::string_view text) {
+    // nodes扩容后引用失效，全程按下标访问
+    while (!text.empty()) {
+        size_t slot = nodes[node].childFirst.find(text[0]);
+        if (slot == std::string::npos) {
+            Node child;
+            child.prefix.assign(text.data(), text.length());
+            nodes.push_back(std::move(child));
+            int index = static_cast<int>(nodes.size() - 1);
+            nodes[node].children.push_back(index);
+            nodes[node].childFirst.push_back(text[0]);
+            return index;
+        }
+
+        int child = nodes[node].children[slot];
+        const std::string& prefix = nodes[child].prefix;
+        size_t common = 0;
+        while (common < prefix.length() && common < text.length() && prefix[common] == text[common]) {
+            ++common;
+        }
+
+        // 只有部分前缀相同：公共部分拆成中间节点，原节点保留剩余部分挂在其下
+        if (common < prefix.length()) {
+            Node middle;
+            middle.prefix = prefix.substr(0, common);
+            middle.childFirst.push_back(prefix[common]);
+            middle.children.push_back(child);
+            nodes[child].prefix.erase(0, common);
+            nodes.push_back(std::move(middle));
+            child = static_cast<int>(nodes.size() - 1);
+            nodes[node].children[slot] = child;
+        }
+
+        node = child;
+        text.remove_prefix(common);
+    }
+    return node;
+}
+
+int Router::insertParam(int node, std::string_view name, const std::string& pattern) {
+    int child = nodes[node].paramChild;
+    if (child >= 0) {
+        if (nodes[child].paramName != name) {
+            throw std::invalid_argument("路由参数名称与已注册的模式冲突: " + pattern);
+        }
+        return child;
+    }
+
+    Node param;
+    param.paramName.assign(name.data(), name.length());
+    nodes.push_back(std::move(param));
+    child = static_cast<int>(nodes.size() - 1);
+    nodes[node].paramChild = child;
+    return child;
+}
+
+Router::MatchResult Router::match(std::string_view method, std::string_view path, int& value,
+                                  RouteParams& params) const {
+    params.count = 0;
+    if (path.length() > 1 && path.back() == '/') {
+        path.remove_suffix(1);
+    }
+
+    int found = -1;
+    if (path.empty() || !matchNode(0, path, 0, params, found)) {
+        return MatchResult::NOT_FOUND;
+    }
+
+    const Node& node = nodes[found];
+    for (const auto& entry : node.methods) {
+        if (entry.first == method) {
+            value = entry.second;
+            return MatchResult::FOUND;
+        }
+    }
+    if (node.anyMethod >= 0) {
+        value = node.anyMethod;
+        return MatchResult::FOUND;
+    }
+    return MatchResult::METHOD_NOT_ALLOWED;
+}
+
+bool Router::matchNode(int index, std::string_view path, size_t pos, RouteParams& params, int& found) const {
+    const Node& node = nodes[index];
+    if (pos == path.length()) {
+        if (node.methods.empty() && node.anyMethod < 0) {
+            return false;
+        }
+        found = index;
+        return true;
+    }
+
+    size_t slot = node.childFirst.find(path[pos]);
+    if (slot != std::string::npos) {
+        int child = node.children[slot];
+        const std::string& prefix = nodes[child].prefix;
+        if (path.compare(pos, prefix.length(), prefix) == 0 &&
+            matchNode(child, path, pos + prefix.length(), params, found)) {
+            return true;
+        }
+    }
+
+    if (node.paramChild >= 0 && params.count < RouteParams::MAX_PARAMS) {
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) {
+            end = path.length();
+        }
+        if (end > pos) {
+            size_t saved = params.count;
+            params.params[params.count++] = RouteParams::Param{nodes[node.paramChild].paramName,
+                                                               path.substr(pos, end - pos)};
+            if (matchNode(node.paramChild, path, end, params, found)) {
+                return true;
+            }
+            params.count = saved;
+        }
+    }
+    return false;
+}
@@ -5,14 +5,18 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/eventfd.h>
 #include <errno.h>
 #include <cstring>
-#include <sstream>
 #include <algorithm>
 
 EpollServer::EpollServer(int port) 
-    : port(port), maxConnections(1000), connectionTimeout(60),
-      epollFd(-1), serverSocket(-1), running(false) {
+    : port(port), maxConnections(1000), reactorCount(1), streamThreshold(64 * 1024), dispatcher("EpollServer"),
+      running(false), totalConnections(0),
+      acceptedConnections(MetricsRegistry::getInstance().counter(
+          "disp_connections_accepted_total", "已接受的客户端连接数").get()),
+      rejectedConnections(MetricsRegistry::getInstance().counter(
+          "disp_connections_rejected_total", "达到最大连接数后拒绝的客户端连接数").get()) {
 }
 
 EpollServer::~EpollServer() {
@@ -25,8 +29,29 @@ void EpollServer::setMaxConnections(int maxConn) {
 }
 
 void EpollServer::setTimeout(int timeoutSec) {
-    connectionTimeout = timeoutSec;
-    LOG_INFO("EpollServer设置超时时间: " + std::to_string(timeoutSec) + "秒");
+    dispatcher.setTimeout(timeoutSec);
+}
+
+void EpollServer::setHeaderTimeout(int timeoutSec) {
+    dispatcher.setHeaderTimeout(timeoutSec);
+}
+
+void EpollServer::setIoThreads(int threads) {
+    reactorCount = threads > 0 ? threads : 1;
+    LOG_INFO("EpollServer设置反应堆数量: " + std::to_string(reactorCount));
+}
+
+void EpollServer::setStreamThreshold(size_t bytes) {
+    streamThreshold = bytes;
+    LOG_INFO("EpollServer设置流式响应阈值: " + std::to_string(bytes) + "字节");
+}
+
+void EpollServer::setKeepAlive(int idleTimeoutSec, int maxRequests) {
+    dispatcher.setKeepAlive(idleTimeoutSec, maxRequests);
+}
+
+int EpollServer::getCurrentConnections() const {
+    return totalConnections.load();
 }
 
 bool EpollServer::start() {
@@ -35,26 +60,110 @@ bool EpollServer::start() {
         return true;
     }
     
+    // 1. 为每个反应堆创建独立的监听socket和epoll实例
+    reactors.clear();
+    for (int i = 0; i < reactorCount; ++i) {
+        auto reactor = std::make_unique<Reactor>(i);
+        if (!setupReactor(*reactor)) {
+            LOG_ERROR("初始化反应堆失败 (reactor=" + std::to_string(i) + ")");
+            teardownReactor(*reactor);
+            for (auto& created : reactors) {
+                teardownReactor(*created);
+            }
+            reactors.clear();
+            return false;
+        }
+        reactors.push_back(std::move(reactor));
+    }
+    
+    running = true;
+    LOG_INFO("Epoll服务器已启动，监听端口: " + std::to_string(port) + 
+             "，最大连接数: " + std::to_string(maxConnections) +
+             "，反应堆数量: " + std::to_string(reactorCount));
+    
+    // 2. 启动其余反应堆线程，0号反应堆在当前线程运行
+    for (size_t i = 1; i < reactors.size(); ++i) {
+        Reactor* reactor = reactors[i].get();
+        reactor->thread = std::thread([this, reactor]() {
+            eventLoop(*reactor);
+        });
+    }
+    
+    eventLoop(*reactors[0]);
+    
+    // 3. 事件循环退出后等待其他反应堆结束并释放资源
+    for (auto& reactor : reactors) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+    }
+    for (auto& reactor : reactors) {
+        teardownReactor(*reactor);
+    }
+    reactors.clear();
+    
+    LOG_INFO("Epoll服务器已停止");
+    return true;
+}
+
+void EpollServer::stop() {
+    if (!running) {
+        return;
+    }
+    
+    running = false;
+    
+    // 唤醒所有反应堆，由各自的线程关闭连接（stop可能在信号处理函数中调用，这里只做eventfd写入）
+    for (auto& reactor : reactors) {
+        if (reactor->wakeFd >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = write(reactor->wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+bool EpollServer::isRunning() const {
+    return running;
+}
+
+void EpollServer::setRoute(const std::string& pattern, RequestHandler handler, const std::string& contentType) {
+    dispatcher.addRoute(pattern, handler, contentType);
+}
+
+void EpollServer::setForwardRoute(const std::string& method, const std::string& pattern,
+                                  ForwardPrepare prepare, ForwardComplete complete) {
+    dispatcher.addForwardRoute(method, pattern, prepare, complete);
+}
+
+int EpollServer::createListenSocket(bool reusePort) {
     // 1. 创建服务器socket
-    serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
         LOG_ERROR("创建服务器套接字失败: " + std::string(strerror(errno)));
-        return false;
+        return -1;
     }
     
     // 2. 设置socket选项
     int opt = 1;
-    if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
         LOG_ERROR("设置SO_REUSEADDR失败: " + std::string(strerror(errno)));
-        close(serverSocket);
-        return false;
+        close(listenFd);
+        return -1;
+    }
+    
+    // 多反应堆模式下每个反应堆绑定同一端口，由内核在监听socket之间分发新连接
+    if (reusePort && setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        LOG_ERROR("设置SO_REUSEPORT失败: " + std::string(strerror(errno)));
+        close(listenFd);
+        return -1;
     }
     
     // 3. 设置非阻塞模式
-    if (!setNonBlocking(serverSocket)) {
+    if (!setNonBlocking(listenFd)) {
         LOG_ERROR("设置服务器socket非阻塞模式失败");
-        close(serverSocket);
-        return false;
+        close(listenFd);
+        return -1;
     }
     
     // 4. 绑定地址
@@ -64,88 +173,94 @@ bool EpollServer::start() {
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(port);
     
-    if (bind(serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
         LOG_ERROR("绑定地址失败: " + std::string(strerror(errno)));
-        close(serverSocket);
-        return false;
+        close(listenFd);
+        return -1;
     }
     
     // 5. 开始监听
-    if (listen(serverSocket, LISTEN_BACKLOG) < 0) {
+    if (listen(listenFd, LISTEN_BACKLOG) < 0) {
         LOG_ERROR("监听失败: " + std::string(strerror(errno)));
-        close(serverSocket);
+        close(listenFd);
+        return -1;
+    }
+    
+    return listenFd;
+}
+
+bool EpollServer::setupReactor(Reactor& reactor) {
+    reactor.listenFd = createListenSocket(reactorCount > 1);
+    if (reactor.listenFd < 0) {
         return false;
     }
     
-    // 6. 创建epoll实例
-    epollFd = epoll_create1(EPOLL_CLOEXEC);
-    if (epollFd < 0) {
+    // 创建epoll实例
+    reactor.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor.epollFd < 0) {
         LOG_ERROR("创建epoll实例失败: " + std::string(strerror(errno)));
-        close(serverSocket);
         return false;
     }
     
-    // 7. 将服务器socket添加到epoll
-    if (!addToEpoll(serverSocket, EPOLLIN)) {
-        LOG_ERROR("将服务器socket添加到epoll失败");
-        close(epollFd);
-        close(serverSocket);
+    // 创建唤醒用的eventfd
+    reactor.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor.wakeFd < 0) {
+        LOG_ERROR("创建eventfd失败: " + std::string(strerror(errno)));
         return false;
     }
     
-    running = true;
-    LOG_INFO("Epoll服务器已启动，监听端口: " + std::to_string(port) + 
-             "，最大连接数: " + std::to_string(maxConnections));
-    
-    // 8. 启动事件循环
-    eventLoop();
+    // 将监听socket和eventfd添加到epoll
+    if (!addToEpoll(reactor.epollFd, reactor.listenFd, EPOLLIN) ||
+        !addToEpoll(reactor.epollFd, reactor.wakeFd, EPOLLIN)) {
+        LOG_ERROR("将服务器socket添加到epoll失败");
+        return false;
+    }
     
     return true;
 }
 
-void EpollServer::stop() {
-    if (!running) {
-        return;
+void EpollServer::teardownReactor(Reactor& reactor) {
+    // 放弃进行中的AP调用
+    for (auto& pair : reactor.upstreams) {
+        close(pair.first);
     }
+    reactor.upstreams.clear();
     
-    running = false;
+    // 关闭该反应堆的所有客户端连接
+    reactor.clients.forEach([this, &reactor](ClientConnection* conn) {
+        close(conn->fd);
+        reactor.timers.cancel(conn->timer);
+        releaseBuffers(reactor, conn);
+    });
+    totalConnections -= static_cast<int>(reactor.clients.size());
+    reactor.clients.clear();
+    reactor.connectionCount = 0;
     
-    // 关闭所有客户端连接
-    for (auto& pair : clients) {
-        close(pair.first);
+    if (reactor.wakeFd >= 0) {
+        close(reactor.wakeFd);
+        reactor.wakeFd = -1;
     }
-    clients.clear();
     
-    // 关闭epoll和服务器socket
-    if (epollFd >= 0) {
-        close(epollFd);
-        epollFd = -1;
+    if (reactor.epollFd >= 0) {
+        close(reactor.epollFd);
+        reactor.epollFd = -1;
     }
     
-    if (serverSocket >= 0) {
-        close(serverSocket);
-        serverSocket = -1;
+    if (reactor.listenFd >= 0) {
+        close(reactor.listenFd);
+        reactor.listenFd = -1;
     }
-    
-    LOG_INFO("Epoll服务器已停止");
 }
 
-bool EpollServer::isRunning() const {
-    return running;
-}
-
-void EpollServer::setRoute(const std::string& path, RequestHandler handler) {
-    routes[path] = handler;
-    LOG_INFO("EpollServer注册路由: " + path);
-}
-
-void EpollServer::eventLoop() {
+void EpollServer::eventLoop(Reactor& reactor) {
     struct epoll_event events[MAX_EVENTS];
-    time_t lastCleanup = time(nullptr);
+    
+    LOG_DEBUG("反应堆事件循环启动 (reactor=" + std::to_string(reactor.id) + ")");
     
     while (running) {
-        // 等待事件，超时时间1秒
-        int nfds = epoll_wait(epollFd, events, MAX_EVENTS, 1000);
+        // 等待事件，最多等到下一个定时器到期
+        int timeout = reactor.timers.nextTimeout(TimerWheel::nowMs(), MAX_WAIT_MS);
+        int nfds = epoll_wait(reactor.epollFd, events, MAX_EVENTS, timeout);
         
         if (nfds < 0) {
             if (errno == EINTR) {
@@ -160,11 +275,19 @@ void EpollServer::eventLoop() {
             int fd = events[i].data.fd;
             uint32_t eventMask = events[i].events;
             
-            if (fd == serverSocket) {
+            if (fd == reactor.listenFd) {
                 // 新连接到达
                 if (eventMask & EPOLLIN) {
-                    acceptNewConnection();
+                    acceptNewConnection(reactor);
                 }
+            } else if (fd == reactor.wakeFd) {
+                // stop()唤醒，清空计数后由while条件退出
+                uint64_t value;
+                ssize_t ignored = read(reactor.wakeFd, &value, sizeof(value));
+                (void)ignored;
+            } else if (!reactor.clients.find(fd)) {
+                // AP连接事件（客户端连接按fd直接查表，其余的按AP连接处理）
+                handleUpstreamEvent(reactor, fd, eventMask);
             } else {
                 // 客户端事件
                 bool shouldClose = false;
@@ -174,49 +297,53 @@ void EpollServer::eventLoop() {
                     shouldClose = true;
                 } else if (eventMask & EPOLLIN) {
                     // 可读事件
-                    if (!handleRead(fd)) {
+                    if (!handleRead(reactor, fd)) {
                         shouldClose = true;
                     }
                 } else if (eventMask & EPOLLOUT) {
                     // 可写事件
-                    if (!handleWrite(fd)) {
+                    if (!handleWrite(reactor, fd)) {
                         shouldClose = true;
+                    } else {
+                        resumeStream(reactor, fd);
+                        shouldClose = !continueAfterResponse(reactor, fd);
                     }
                 }
                 
                 if (shouldClose) {
-                    closeConnection(fd);
+                    closeConnection(reactor, fd);
                 }
             }
         }
         
-        // 定期清理超时连接
-        time_t now = time(nullptr);
-        if (now - lastCleanup >= 10) {  // 每10秒清理一次
-            cleanupTimeoutConnections();
-            lastCleanup = now;
-        }
+        // 处理到期的连接和AP调用超时
+        reactor.timers.advance(TimerWheel::nowMs(), [this, &reactor](TimerWheel::Timer& timer) {
+            handleTimer(reactor, timer);
+        });
     }
+    
+    LOG_DEBUG("反应堆事件循环结束 (reactor=" + std::to_string(reactor.id) + ")");
 }
 
-bool EpollServer::acceptNewConnection() {
+bool EpollServer::acceptNewConnection(Reactor& reactor) {
     while (true) {
         struct sockaddr_in clientAddr;
         socklen_t clientAddrLen = sizeof(clientAddr);
         
-        int clientFd = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+        int clientFd = accept(reactor.listenFd, (struct sockaddr*)&clientAddr, &clientAddrLen);
         if (clientFd < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 // 没有更多连接可接受
                 break;
             }
-            LOG_ERROR("接受连接失败: " + std::string(strerror(errno)));
+            LOG_ERROR_LIMITED("接受连接失败: " + std::string(strerror(errno)), 1);
             return false;
         }
         
-        // 检查连接数限制
-        if (clients.size() >= static_cast<size_t>(maxConnections)) {
-            LOG_WARNING("达到最大连接数限制，拒绝新连接");
+        // 检查连接数限制（所有反应堆共享）
+        if (totalConnections.load() >= maxConnections) {
+            LOG_WARNING_LIMITED("达到最大连接数限制，拒绝新连接", 1);
+            rejectedConnections.inc();
             close(clientFd);
             continue;
         }
@@ -229,47 +356,76 @@ bool EpollServer::acceptNewConnection() {
         }
         
         // 添加到epoll监听
-        if (!addToEpoll(clientFd, EPOLLIN | EPOLLET)) {  // 边缘触发模式
+        if (!addToEpoll(reactor.epollFd, clientFd, EPOLLIN | EPOLLET)) {  // 边缘触发模式
             LOG_ERROR("将客户端socket添加到epoll失败");
             close(clientFd);
             continue;
         }
         
-        // 创建客户端连接对象
-        clients[clientFd] = std::make_unique<ClientConnection>(clientFd);
+        // 从对象池取出客户端连接对象，在头部超时内没有收到请求则关闭
+        ClientConnection* conn = reactor.clients.acquire(clientFd);
+        reactor.timers.schedule(conn->timer, dispatcher.headerTimeout() * 1000LL);
+        reactor.connectionCount++;
+        totalConnections++;
+        acceptedConnections.inc();
         
         // 记录新连接
         char clientIp[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &clientAddr.sin_addr, clientIp, INET_ADDRSTRLEN);
-        LOG_INFO("新连接建立: " + std::string(clientIp) + ":" + 
-                std::to_string(ntohs(clientAddr.sin_port)) + 
-                " (fd=" + std::to_string(clientFd) + ")");
+        LOG_INFO_LIMITED("新连接建立: " + std::string(clientIp) + ":" + 
+                         std::to_string(ntohs(clientAddr.sin_port)) + 
+                         " (fd=" + std::to_string(clientFd) + 
+                         ", reactor=" + std::to_string(reactor.id) + ")", 20);
     }
     
     return true;
 }
 
-bool EpollServer::handleRead(int clientFd) {
-    auto it = clients.find(clientFd);
-    if (it == clients.end()) {
+bool EpollServer::handleRead(Reactor& reactor, int clientFd) {
+    ClientConnection* conn = reactor.clients.find(clientFd);
+    if (!conn) {
         return false;
     }
     
-    ClientConnection* conn = it->second.get();
-    conn->lastActivity = time(nullptr);
-    
     char buffer[BUFFER_SIZE];
     while (true) {
+        // 先处理缓冲区中已到达的请求：流水线中的请求按顺序处理，前一个响应发送完毕后才解析下一个
+        while (conn->state == ClientState::READING_REQUEST && !conn->readBuffer.empty()) {
+            int64_t parseStart = Trace::now();
+            HttpParser::Result result = conn->parser.parse(conn->readBuffer);
+            if (result == HttpParser::Result::INCOMPLETE) {
+                // 头部的超时从请求开始计算，不因收到数据而延长；接收请求体期间按连接超时，每次收到数据后重新计时
+                if (conn->parser.headersComplete()) {
+                    reactor.timers.schedule(conn->timer, dispatcher.connectionTimeout() * 1000LL);
+                }
+                break;
+            }
+            bool open = result == HttpParser::Result::ERROR ? rejectRequest(reactor, conn)
+                                                            : processCompleteRequest(reactor, conn, parseStart);
+            if (!open) {
+                return false;
+            }
+        }
+        
+        // 等待AP响应或发送响应期间只缓存后续请求，积压过多时暂停读取，数据留在内核中由TCP流量控制限制客户端，
+        // 响应发送完毕后重新读取
+        if (conn->state != ClientState::READING_REQUEST && conn->readBuffer.length() >= PIPELINE_BUFFER_LIMIT) {
+            return true;
+        }
+        
         ssize_t bytesRead = recv(clientFd, buffer, sizeof(buffer), 0);
         
         if (bytesRead > 0) {
-            // 成功读取数据
-            conn->readBuffer.append(buffer, bytesRead);
-            
-            // 检查是否接收到完整的HTTP请求
-            if (isRequestComplete(conn->readBuffer)) {
-                return processCompleteRequest(clientFd);
+            // 最后一个响应已发出，丢弃客户端后续数据直到对方关闭
+            if (conn->state == ClientState::CLOSING) {
+                continue;
+            }
+            // 空闲的长连接上开始新的请求，改为按头部超时计时
+            if (conn->state == ClientState::READING_REQUEST && conn->readBuffer.empty() && conn->requestCount > 0) {
+                reactor.timers.schedule(conn->timer, dispatcher.headerTimeout() * 1000LL);
             }
+            reactor.buffers.acquire(conn->readBuffer, BUFFER_SIZE);
+            conn->readBuffer.append(buffer, bytesRead);
         } else if (bytesRead == 0) {
             // 客户端关闭连接
             LOG_DEBUG("客户端关闭连接 (fd=" + std::to_string(clientFd) + ")");
@@ -278,33 +434,37 @@ bool EpollServer::handleRead(int clientFd) {
             // 读取错误
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 // 没有更多数据可读，这是正常的
-                break;
+                return true;
+            } else if (errno == EINTR) {
+                continue;
             } else {
                 LOG_ERROR("读取客户端数据失败: " + std::string(strerror(errno)));
                 return false;
             }
         }
     }
-    
-    return true;
 }
 
-bool EpollServer::handleWrite(int clientFd) {
-    auto it = clients.find(clientFd);
-    if (it == clients.end()) {
+bool EpollServer::handleWrite(Reactor& reactor, int clientFd) {
+    ClientConnection* conn = reactor.clients.find(clientFd);
+    if (!conn) {
         return false;
     }
     
-    ClientConnection* conn = it->second.get();
-    conn->lastActivity = time(nullptr);
+    // 头部片段、写缓冲区和响应体以一次sendmsg发出，响应体不复制到写缓冲区
+    const HttpResponse::Part parts[] = {
+        {conn->statusBlock, &conn->statusPos},
+        {&conn->writeBuffer, &conn->writePos},
+        {&conn->body, &conn->bodyPos}
+    };
+    const size_t partCount = sizeof(parts) / sizeof(parts[0]);
+    bool progressed = false;
     
-    while (conn->writePos < conn->writeBuffer.length()) {
-        ssize_t bytesWritten = send(clientFd, 
-                                   conn->writeBuffer.c_str() + conn->writePos,
-                                   conn->writeBuffer.length() - conn->writePos, 0);
+    while (!HttpResponse::complete(parts, partCount)) {
+        ssize_t bytesWritten = HttpResponse::send(clientFd, parts, partCount);
         
         if (bytesWritten > 0) {
-            conn->writePos += bytesWritten;
+            progressed = true;
         } else if (bytesWritten == 0) {
             // 无法写入更多数据
             break;
@@ -319,194 +479,585 @@ bool EpollServer::handleWrite(int clientFd) {
         }
     }
     
+    // 发送有进展时重新计时，客户端长时间不读取响应才算超时
+    if (progressed) {
+        reactor.timers.schedule(conn->timer, dispatcher.connectionTimeout() * 1000LL);
+    }
+    
     // 检查是否发送完毕
-    if (conn->writePos >= conn->writeBuffer.length()) {
-        // 发送完毕，关闭连接或切换为读模式
-        if (conn->keepAlive) {
-            // 保持连接，重置状态
-            conn->readBuffer.clear();
+    if (HttpResponse::complete(parts, partCount)) {
+        // 流式响应尚未结束，等待AP后续数据
+        if (conn->upstreamFd >= 0) {
             conn->writeBuffer.clear();
             conn->writePos = 0;
+            return true;
+        }
+        
+        finishTrace(conn);
+        
+        // 发送完毕，关闭连接或切换为读模式
+        if (conn->keepAlive) {
+            // 保持连接：丢弃已处理的请求，之后的数据属于下一个请求，由调用方继续处理
+            // 缓冲区归还到池中，空闲的长连接不占用缓冲区
+            conn->readBuffer.erase(0, conn->parser.consumed());
+            if (conn->readBuffer.empty()) {
+                reactor.buffers.release(conn->readBuffer);
+            }
+            conn->parser.reset();
+            reactor.buffers.release(conn->writeBuffer);
+            reactor.buffers.release(conn->body);
+            conn->statusBlock = nullptr;
             conn->state = ClientState::READING_REQUEST;
+            armClientTimer(reactor, conn);
             
             // 切换为只监听读事件
-            return modifyEpoll(clientFd, EPOLLIN | EPOLLET);
-        } else {
-            // 关闭连接
-            return false;
+            return modifyEpoll(reactor.epollFd, clientFd, EPOLLIN | EPOLLET);
+        }
+        
+        // 客户端可能还在发送后续请求（流水线或达到单连接请求数上限），此时直接close()会因接收缓冲区
+        // 有未读数据而发送RST，客户端可能丢失尚未读取的响应。先关闭写方向，读取并丢弃剩余数据，
+        // 客户端关闭或超过HttpDispatcher::LINGER_TIMEOUT后再关闭连接
+        if (HttpDispatcher::shouldLinger(conn->readBuffer, conn->parser)) {
+            shutdown(clientFd, SHUT_WR);
+            releaseBuffers(reactor, conn);
+            conn->state = ClientState::CLOSING;
+            armClientTimer(reactor, conn);
+            return modifyEpoll(reactor.epollFd, clientFd, EPOLLIN | EPOLLET);
         }
+        
+        // 关闭连接
+        return false;
     }
     
     return true;
 }
 
-bool EpollServer::processCompleteRequest(int clientFd) {
-    auto it = clients.find(clientFd);
-    if (it == clients.end()) {
-        return false;
+bool EpollServer::continueAfterResponse(Reactor& reactor, int clientFd) {
+    ClientConnection* conn = reactor.clients.find(clientFd);
+    if (!conn) {
+        return true;  // 流式转发失败时连接已在resumeStream中关闭
     }
     
-    ClientConnection* conn = it->second.get();
+    // 保持连接时处理已缓存的后续请求，延迟关闭时丢弃客户端数据；两种情况都需要重新读取，
+    // 边缘触发模式下发送响应期间到达的数据不会再产生事件
+    ClientState state = conn->state;
+    if (state == ClientState::READING_REQUEST || state == ClientState::CLOSING) {
+        return handleRead(reactor, clientFd);
+    }
+    return true;
+}
+
+bool EpollServer::processCompleteRequest(Reactor& reactor, ClientConnection* conn, int64_t parseStart) {
+    const HttpRequest& request = conn->parser.request();
+    conn->requestCount++;
+    conn->keepAlive = dispatcher.keepAlive(request, conn->requestCount, running);
     
-    // 处理HTTP请求
-    std::string response = processRequest(conn->readBuffer);
+    HttpDispatcher::Dispatch dispatch = dispatcher.dispatch(request);
+    if (!dispatch.route) {
+        return beginResponse(reactor, conn, std::move(dispatch.response));
+    }
     
-    // 准备响应
-    conn->writeBuffer = response;
+    // 转发路由：AP调用在事件循环中异步完成，只有转发的请求有请求ID，需要追踪
+    if (TraceCollector::getInstance().isEnabled()) {
+        conn->trace.reset(new Trace(parseStart));
+        conn->trace->addSpan("http.parse", parseStart, Trace::now());
+    }
+    return startForward(reactor, conn, *dispatch.route, dispatch.params);
+}
+
+bool EpollServer::rejectRequest(Reactor& reactor, ClientConnection* conn) {
+    conn->keepAlive = false;
+    return beginResponse(reactor, conn, HttpDispatcher::reject(conn->parser, conn->fd));
+}
+
+bool EpollServer::beginResponse(Reactor& reactor, ClientConnection* conn, HttpDispatcher::Response response) {
+    // 状态行和CORS头部取预先生成的片段，动态头部写入从池中取出的写缓冲区，响应体移入连接
+    conn->statusBlock = response.statusBlock;
+    conn->writeBuffer.clear();
+    reactor.buffers.acquire(conn->writeBuffer, RESPONSE_HEADER_RESERVE);
+    dispatcher.appendHeaders(conn->writeBuffer, response, conn->keepAlive);
+    conn->body = std::move(response.content);
+    return sendResponse(reactor, conn);
+}
+
+bool EpollServer::sendResponse(Reactor& reactor, ClientConnection* conn) {
+    conn->statusPos = 0;
     conn->writePos = 0;
+    conn->bodyPos = 0;
     conn->state = ClientState::WRITING_RESPONSE;
+    armClientTimer(reactor, conn);
+    if (conn->trace) {
+        conn->writeStart = Trace::now();
+    }
     
     // 切换为监听写事件
-    if (!modifyEpoll(clientFd, EPOLLOUT | EPOLLET)) {
+    if (!modifyEpoll(reactor.epollFd, conn->fd, EPOLLOUT | EPOLLET)) {
         return false;
     }
     
     // 立即尝试发送一些数据
-    return handleWrite(clientFd);
+    return handleWrite(reactor, conn->fd);
 }
 
-void EpollServer::closeConnection(int clientFd) {
-    removeFromEpoll(clientFd);
-    close(clientFd);
-    clients.erase(clientFd);
+void EpollServer::finishTrace(ClientConnection* conn) {
+    if (!conn->trace) {
+        return;
+    }
     
-    LOG_DEBUG("关闭连接 (fd=" + std::to_string(clientFd) + ")");
+    // 中途断开的请求没有发送响应，同样提交，慢请求往往伴随客户端超时断开
+    if (conn->writeStart > 0) {
+        conn->trace->addSpan("http.write", conn->writeStart, Trace::now());
+    }
+    conn->trace->finish();
+    TraceCollector::getInstance().submit(std::move(conn->trace));
+    conn->writeStart = 0;
 }
 
-void EpollServer::cleanupTimeoutConnections() {
-    time_t now = time(nullptr);
-    std::vector<int> timeoutFds;
+bool EpollServer::startForward(Reactor& reactor, ClientConnection* conn, const HttpDispatcher::Route& route,
+                               const RouteParams& params) {
+    auto upstream = std::make_unique<UpstreamConnection>(conn->fd, &route.complete);
     
-    for (const auto& pair : clients) {
-        if (now - pair.second->lastActivity > connectionTimeout) {
-            timeoutFds.push_back(pair.first);
-        }
+    ApCall& call = upstream->call;
+    Trace* trace = conn->trace.get();
+    int64_t routeStart = Trace::now();
+    
+    HttpDispatcher::Response response;
+    bool forward = HttpDispatcher::prepareForward(route, conn->parser.request(), params, call, response);
+    if (trace) {
+        trace->setRequestId(call.requestId);
+        trace->addSpan("route", routeStart, Trace::now(), call.requestType);
+    }
+    if (!forward) {
+        return beginResponse(reactor, conn, std::move(response));
     }
     
-    for (int fd : timeoutFds) {
-        LOG_INFO("清理超时连接 (fd=" + std::to_string(fd) + ")");
-        closeConnection(fd);
+    // 优先复用连接池中的连接，否则发起非阻塞连接，并与客户端连接注册到同一个epoll实例
+    upstream->trace = trace;
+    upstream->phaseStart = Trace::now();
+    bool reused = false;
+    int upstreamFd = ApClient::openConnection(call, reused);
+    if (upstreamFd < 0) {
+        return beginResponse(reactor, conn, HttpDispatcher::completeForward(route.complete, call));
     }
+    
+    if (!addToEpoll(reactor.epollFd, upstreamFd, EPOLLIN | EPOLLOUT | EPOLLET)) {
+        close(upstreamFd);
+        ApClient::fail(call, "ConnectionError", "将AP连接添加到epoll失败", "",
+                       "{\"error\":\"连接处理服务失败\",\"endpoint\":\"" + call.host + ":" + std::to_string(call.port) + "\"}");
+        return beginResponse(reactor, conn, HttpDispatcher::completeForward(route.complete, call));
+    }
+    
+    upstream->fd = upstreamFd;
+    upstream->reused = reused;
+    upstream->connected = reused;
+    if (trace && reused) {
+        int64_t now = Trace::now();
+        trace->addSpan("ap.connect", upstream->phaseStart, now, "reused");
+        upstream->phaseStart = now;
+    }
+    upstream->writeBuffer = ApClient::encodeRequest(call);
+    upstream->deadline.fd = upstreamFd;
+    reactor.timers.schedule(upstream->deadline, ApClient::CALL_TIMEOUT_SEC * 1000LL);
+    
+    // 客户端连接等待AP响应，超时由AP调用的截止时间控制
+    conn->state = ClientState::PROCESSING;
+    armClientTimer(reactor, conn);
+    conn->upstreamFd = upstreamFd;
+    reactor.upstreams[upstreamFd] = std::move(upstream);
+    
+    return true;
 }
 
-bool EpollServer::isRequestComplete(const std::string& buffer) {
-    // 简单的HTTP请求完整性检查
-    // 查找请求结束标记 "\r\n\r\n"
-    size_t headerEnd = buffer.find("\r\n\r\n");
-    if (headerEnd == std::string::npos) {
-        return false;  // 还没有收到完整的HTTP头部
+void EpollServer::handleUpstreamEvent(Reactor& reactor, int upstreamFd, uint32_t events) {
+    auto it = reactor.upstreams.find(upstreamFd);
+    if (it == reactor.upstreams.end()) {
+        return;
     }
     
-    // 检查Content-Length头部
-    std::string lowerBuffer = buffer;
-    std::transform(lowerBuffer.begin(), lowerBuffer.end(), lowerBuffer.begin(), ::tolower);
+    UpstreamConnection* upstream = it->second.get();
+    ApCall& call = upstream->call;
     
-    size_t contentLengthPos = lowerBuffer.find("content-length:");
-    if (contentLengthPos != std::string::npos) {
-        // 提取Content-Length值
-        size_t valueStart = contentLengthPos + 15;
-        size_t lineEnd = buffer.find("\r\n", valueStart);
-        if (lineEnd != std::string::npos) {
-            std::string lengthStr = buffer.substr(valueStart, lineEnd - valueStart);
-            lengthStr.erase(0, lengthStr.find_first_not_of(" \t"));
-            lengthStr.erase(lengthStr.find_last_not_of(" \t") + 1);
+    // 1. 等待非阻塞连接完成
+    if (!upstream->connected) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+        if (!ApClient::checkConnected(call, upstreamFd)) {
+            finishForward(reactor, upstreamFd, false);
+            return;
+        }
+        upstream->connected = true;
+        if (upstream->trace) {
+            int64_t now = Trace::now();
+            upstream->trace->addSpan("ap.connect", upstream->phaseStart, now);
+            upstream->phaseStart = now;
+        }
+        LOG_DEBUG_CTX("成功连接到AP服务", LogContext(call.requestId, call.clientIp, "",
+                      call.host + ":" + std::to_string(call.port)));
+    }
+    
+    // 2. 发送请求
+    while (upstream->writePos < upstream->writeBuffer.length()) {
+        ssize_t bytesSent = send(upstreamFd, upstream->writeBuffer.c_str() + upstream->writePos,
+                                 upstream->writeBuffer.length() - upstream->writePos, MSG_NOSIGNAL);
+        if (bytesSent > 0) {
+            upstream->writePos += bytesSent;
+        } else if (bytesSent < 0 && errno == EINTR) {
+            continue;
+        } else if (bytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;  // 等待下一次可写事件
+        } else {
+            failUpstream(reactor, upstreamFd, "SendError", "发送请求失败", "errno: " + std::to_string(errno),
+                         "{\"error\":\"发送请求失败\"}");
+            return;
+        }
+    }
+    
+    // 3. 接收响应直到收到完整消息
+    char buffer[BUFFER_SIZE];
+    while (true) {
+        // 流式转发时客户端积压过多则暂停读取，客户端发送后由resumeStream继续
+        if (upstream->streaming) {
+            ClientConnection* conn = reactor.clients.find(upstream->clientFd);
+            if (conn->writeBuffer.length() - conn->writePos >= STREAM_HIGH_WATER) {
+                upstream->paused = true;
+                return;
+            }
+        }
+        
+        ssize_t bytesReceived = recv(upstreamFd, buffer, sizeof(buffer), 0);
+        if (bytesReceived > 0) {
+            upstream->readBuffer.append(buffer, bytesReceived);
+            if (upstream->streaming || startStream(reactor, upstream)) {
+                if (!relayStream(reactor, upstreamFd)) {
+                    return;  // 响应已转发完毕或连接已关闭
+                }
+                continue;
+            }
             
-            try {
-                int contentLength = std::stoi(lengthStr);
-                size_t bodyStart = headerEnd + 4;
-                size_t actualBodyLength = buffer.length() - bodyStart;
-                
-                return actualBodyLength >= static_cast<size_t>(contentLength);
-            } catch (const std::exception&) {
-                // 无效的Content-Length，假设请求完整
-                return true;
+            ApProtocol::DecodeResult decoded = ApClient::decodeResponse(call, upstream->readBuffer);
+            if (decoded == ApProtocol::DecodeResult::INVALID) {
+                finishForward(reactor, upstreamFd, false);
+                return;
+            }
+            if (decoded == ApProtocol::DecodeResult::COMPLETE) {
+                LOG_DEBUG_CTX("收到AP响应, 字节数: " + std::to_string(call.response.length()),
+                              LogContext(call.requestId, call.clientIp));
+                finishForward(reactor, upstreamFd, upstream->readBuffer.empty());
+                return;
             }
+        } else if (bytesReceived == 0) {
+            if (!upstream->readBuffer.empty() && ApClient::isLineProtocol()) {
+                // 旧版AP发送完响应后直接关闭连接，不带消息结束符
+                call.response = std::move(upstream->readBuffer);
+                call.success = true;
+                finishForward(reactor, upstreamFd, false);
+            } else {
+                failUpstream(reactor, upstreamFd, "ReceiveError", "接收响应失败",
+                             upstream->readBuffer.empty() ? "AP关闭连接且未返回数据" : "AP关闭连接，响应不完整",
+                             "{\"error\":\"接收响应失败\"}");
+            }
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;  // 等待更多数据
+        } else {
+            failUpstream(reactor, upstreamFd, "ReceiveError", "接收响应失败", "errno: " + std::to_string(errno),
+                         "{\"error\":\"接收响应失败\"}");
+            return;
         }
     }
+}
+
+void EpollServer::failUpstream(Reactor& reactor, int upstreamFd, const std::string& errorType,
+                               const std::string& message, const std::string& details,
+                               const std::string& errorResponse) {
+    auto it = reactor.upstreams.find(upstreamFd);
+    if (it == reactor.upstreams.end()) {
+        return;
+    }
+    
+    UpstreamConnection* upstream = it->second.get();
+    if (HttpDispatcher::shouldRetry(upstream->call, upstream->reused,
+                                    !upstream->readBuffer.empty() || upstream->streaming)) {
+        if (retryForward(reactor, upstreamFd)) {
+            return;
+        }
+        finishForward(reactor, upstreamFd, false);
+        return;
+    }
     
-    // 没有Content-Length头部，假设请求完整
+    ApClient::fail(upstream->call, errorType, message, details, errorResponse);
+    finishForward(reactor, upstreamFd, false);
+}
+
+bool EpollServer::retryForward(Reactor& reactor, int upstreamFd) {
+    auto it = reactor.upstreams.find(upstreamFd);
+    UpstreamConnection* upstream = it->second.get();
+    
+    int newFd = ApClient::connectNonBlocking(upstream->call);
+    if (newFd < 0) {
+        return false;  // 错误响应已设置
+    }
+    
+    if (!addToEpoll(reactor.epollFd, newFd, EPOLLIN | EPOLLOUT | EPOLLET)) {
+        close(newFd);
+        ApClient::fail(upstream->call, "ConnectionError", "将AP连接添加到epoll失败", "",
+                       "{\"error\":\"连接处理服务失败\"}");
+        return false;
+    }
+    
+    // 关闭失效的连接，用新连接替换
+    removeFromEpoll(reactor.epollFd, upstreamFd);
+    close(upstreamFd);
+    
+    std::unique_ptr<UpstreamConnection> moved = std::move(it->second);
+    reactor.upstreams.erase(it);
+    
+    if (moved->trace) {
+        int64_t now = Trace::now();
+        moved->trace->addSpan("ap.retry", moved->phaseStart, now, "复用的连接已失效");
+        moved->phaseStart = now;
+    }
+    moved->fd = newFd;
+    moved->deadline.fd = newFd;   // 截止时间不变
+    moved->reused = false;
+    moved->connected = false;
+    moved->writePos = 0;
+    moved->readBuffer.clear();
+    
+    ClientConnection* conn = reactor.clients.find(moved->clientFd);
+    if (conn) {
+        conn->upstreamFd = newFd;
+    }
+    reactor.upstreams[newFd] = std::move(moved);
     return true;
 }
 
-std::string EpollServer::processRequest(const std::string& request) {
-    // 解析请求路径和方法
-    std::string method, path;
-    parseRequest(request, method, path);
+void EpollServer::finishForward(Reactor& reactor, int upstreamFd, bool reusable) {
+    auto it = reactor.upstreams.find(upstreamFd);
+    if (it == reactor.upstreams.end()) {
+        return;
+    }
+    
+    std::unique_ptr<UpstreamConnection> upstream = std::move(it->second);
+    reactor.upstreams.erase(it);
+    removeFromEpoll(reactor.epollFd, upstreamFd);
     
-    // 处理OPTIONS请求（预检请求）
-    if (method == "OPTIONS") {
-        return createOptionsResponse();
+    // 完整收到响应的连接归还连接池，其余直接关闭
+    if (reusable) {
+        ApClient::releaseConnection(upstream->call, upstreamFd);
+    } else {
+        close(upstreamFd);
     }
     
-    // 查找对应的处理函数
-    auto it = routes.find(path);
-    if (it != routes.end()) {
+    // 客户端可能已经断开
+    ClientConnection* conn = reactor.clients.find(upstream->clientFd);
+    if (!conn) {
+        return;
+    }
+    
+    conn->upstreamFd = -1;
+    if (upstream->trace) {
+        upstream->trace->addSpan(upstream->connected ? "ap.wait" : "ap.connect", upstream->phaseStart,
+                                 Trace::now(), upstream->call.success ? "" : "failed");
+    }
+    
+    if (upstream->streaming) {
+        // 响应已通过分块编码发出，这里只记录调用结果；中途失败时响应头已发出，只能关闭连接
         try {
-            // 调用处理函数
-            std::string content = it->second(request);
-            return createResponse(content);
+            (*upstream->complete)(upstream->call);
         } catch (const std::exception& e) {
             LOG_ERROR("处理请求时发生异常: " + std::string(e.what()));
-            return createResponse("{\"error\":\"内部服务器错误\"}", 500);
         }
+        if (!upstream->call.success || !handleWrite(reactor, conn->fd) ||
+            !continueAfterResponse(reactor, upstream->clientFd)) {
+            closeConnection(reactor, upstream->clientFd);
+        }
+        return;
+    }
+    
+    HttpDispatcher::Response response;
+    {
+        ScopedSpan span(upstream->trace, "serialize");
+        response = HttpDispatcher::completeForward(*upstream->complete, upstream->call);
+    }
+    if (!beginResponse(reactor, conn, std::move(response)) || !continueAfterResponse(reactor, upstream->clientFd)) {
+        closeConnection(reactor, upstream->clientFd);
+    }
+}
+
+bool EpollServer::startStream(Reactor& reactor, UpstreamConnection* upstream) {
+    uint32_t length = 0;
+    if (streamThreshold == 0 || !ApClient::peekResponseLength(upstream->call, upstream->readBuffer, length) ||
+        length < streamThreshold) {
+        return false;
+    }
+    
+    ClientConnection* conn = reactor.clients.find(upstream->clientFd);
+    if (!conn) {
+        return false;
+    }
+    
+    LOG_DEBUG_CTX("AP响应较大，以分块编码流式转发, 字节数: " + std::to_string(length),
+                  LogContext(upstream->call.requestId, upstream->call.clientIp));
+    
+    upstream->readBuffer.erase(0, ApProtocol::HEADER_SIZE);
+    upstream->streaming = true;
+    upstream->streamRemaining = length;
+    
+    // 响应长度虽然已知，但负载边收边发，仍使用分块编码以便中途出错时客户端能发现响应不完整
+    conn->statusBlock = &HttpResponse::statusBlock(200);
+    conn->statusPos = 0;
+    conn->writeBuffer.clear();
+    reactor.buffers.acquire(conn->writeBuffer, STREAM_BUFFER_RESERVE);
+    HttpResponse::appendHeaders(conn->writeBuffer, HttpDispatcher::JSON_TYPE, dispatcher.connectionHeader(conn->keepAlive));
+    conn->writeBuffer.append("Transfer-Encoding: chunked\r\n\r\n");
+    conn->writePos = 0;
+    conn->body.clear();
+    conn->bodyPos = 0;
+    conn->state = ClientState::WRITING_RESPONSE;
+    armClientTimer(reactor, conn);
+    if (conn->trace) {
+        conn->writeStart = Trace::now();
+    }
+    return modifyEpoll(reactor.epollFd, conn->fd, EPOLLOUT | EPOLLET);
+}
+
+bool EpollServer::relayStream(Reactor& reactor, int upstreamFd) {
+    UpstreamConnection* upstream = reactor.upstreams[upstreamFd].get();
+    ClientConnection* conn = reactor.clients.find(upstream->clientFd);
+    
+    size_t length = std::min(upstream->readBuffer.length(), static_cast<size_t>(upstream->streamRemaining));
+    if (length > 0) {
+        appendChunk(conn, upstream->readBuffer.data(), length);
+        upstream->readBuffer.erase(0, length);
+        upstream->streamRemaining -= length;
+        reactor.timers.schedule(upstream->deadline, ApClient::CALL_TIMEOUT_SEC * 1000LL);  // 持续收到数据时不算超时
+    }
+    
+    if (upstream->streamRemaining == 0) {
+        conn->writeBuffer.append("0\r\n\r\n");
+        upstream->call.success = true;
+        LOG_DEBUG_CTX("AP响应流式转发完成", LogContext(upstream->call.requestId, upstream->call.clientIp));
+        finishForward(reactor, upstreamFd, upstream->readBuffer.empty());
+        return false;
     }
     
-    // 未找到对应的路由
-    LOG_WARNING("未找到路由: " + path);
-    return createResponse("{\"error\":\"未找到\"}", 404);
+    if (!handleWrite(reactor, conn->fd)) {
+        closeConnection(reactor, conn->fd);  // 同时取消AP调用
+        return false;
+    }
+    return true;
 }
 
-void EpollServer::parseRequest(const std::string& request, std::string& method, std::string& path) {
-    std::istringstream iss(request);
-    std::string version;
-    iss >> method >> path >> version;
+void EpollServer::resumeStream(Reactor& reactor, int clientFd) {
+    ClientConnection* conn = reactor.clients.find(clientFd);
+    if (!conn || conn->upstreamFd < 0) {
+        return;
+    }
+    
+    auto upstreamIt = reactor.upstreams.find(conn->upstreamFd);
+    if (upstreamIt == reactor.upstreams.end() || !upstreamIt->second->paused) {
+        return;
+    }
     
-    // 移除查询参数
-    size_t pos = path.find('?');
-    if (pos != std::string::npos) {
-        path = path.substr(0, pos);
+    // 积压降到一半以下再继续读取，避免在高水位附近反复暂停
+    if (conn->writeBuffer.length() - conn->writePos >= STREAM_HIGH_WATER / 2) {
+        return;
     }
+    
+    upstreamIt->second->paused = false;
+    handleUpstreamEvent(reactor, conn->upstreamFd, EPOLLIN);
 }
 
-std::string EpollServer::createOptionsResponse() {
-    std::ostringstream oss;
-    oss << "HTTP/1.1 200 OK\r\n";
-    oss << "Access-Control-Allow-Origin: *\r\n";
-    oss << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, PATCH, OPTIONS\r\n";
-    oss << "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    oss << "Access-Control-Max-Age: 86400\r\n";
-    oss << "Content-Length: 0\r\n";
-    oss << "Connection: close\r\n";
-    oss << "\r\n";
+void EpollServer::appendChunk(ClientConnection* conn, const char* data, size_t length) {
+    // 已发送的部分超过一半时整理缓冲区，避免流式转发期间缓冲区无限增长
+    if (conn->writePos > 0 && conn->writePos >= conn->writeBuffer.length() / 2) {
+        conn->writeBuffer.erase(0, conn->writePos);
+        conn->writePos = 0;
+    }
     
-    return oss.str();
+    char sizeLine[16];
+    int sizeLength = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", length);
+    conn->writeBuffer.append(sizeLine, sizeLength);
+    conn->writeBuffer.append(data, length);
+    conn->writeBuffer.append("\r\n", 2);
+}
+
+void EpollServer::closeUpstream(Reactor& reactor, int upstreamFd) {
+    if (reactor.upstreams.erase(upstreamFd) > 0) {
+        removeFromEpoll(reactor.epollFd, upstreamFd);
+        close(upstreamFd);
+        LOG_DEBUG("取消AP调用 (fd=" + std::to_string(upstreamFd) + ")");
+    }
 }
 
-std::string EpollServer::createResponse(const std::string& content, int statusCode, const std::string& contentType) {
-    std::string status;
-    switch (statusCode) {
-        case 200: status = "200 OK"; break;
-        case 400: status = "400 Bad Request"; break;
-        case 404: status = "404 Not Found"; break;
-        case 500: status = "500 Internal Server Error"; break;
-        default: status = "200 OK";
+void EpollServer::handleUpstreamTimeout(Reactor& reactor, int upstreamFd) {
+    HttpDispatcher::failTimeout(reactor.upstreams[upstreamFd]->call);
+    finishForward(reactor, upstreamFd, false);
+}
+
+void EpollServer::closeConnection(Reactor& reactor, int clientFd) {
+    // 客户端断开时取消进行中的AP调用
+    ClientConnection* conn = reactor.clients.find(clientFd);
+    if (conn) {
+        if (conn->upstreamFd >= 0) {
+            closeUpstream(reactor, conn->upstreamFd);
+        }
+        finishTrace(conn);
+        // 连接对象放回池中复用，定时器和缓冲区需要先行归还
+        reactor.timers.cancel(conn->timer);
+        releaseBuffers(reactor, conn);
+    }
+    
+    removeFromEpoll(reactor.epollFd, clientFd);
+    close(clientFd);
+    if (reactor.clients.release(clientFd)) {
+        reactor.connectionCount--;
+        totalConnections--;
     }
     
-    std::ostringstream oss;
-    oss << "HTTP/1.1 " << status << "\r\n";
-    oss << "Content-Type: " << contentType << "\r\n";
-    oss << "Content-Length: " << content.length() << "\r\n";
-    oss << "Connection: close\r\n";
-    oss << "Access-Control-Allow-Origin: *\r\n";
-    oss << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, PATCH, OPTIONS\r\n";
-    oss << "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    oss << "\r\n";
-    oss << content;
+    LOG_DEBUG("关闭连接 (fd=" + std::to_string(clientFd) + ")");
+}
+
+void EpollServer::armClientTimer(Reactor& reactor, ClientConnection* conn) {
+    int64_t delayMs = dispatcher.clientTimeoutMs(conn->state, !conn->readBuffer.empty());
+    if (delayMs < 0) {
+        reactor.timers.cancel(conn->timer);
+        return;
+    }
+    reactor.timers.schedule(conn->timer, delayMs);
+}
+
+void EpollServer::handleTimer(Reactor& reactor, TimerWheel::Timer& timer) {
+    // 客户端连接和AP调用的fd互不重复，定时器在连接关闭或对象析构时取消，到期时对象一定存在
+    if (reactor.upstreams.count(timer.fd) > 0) {
+        handleUpstreamTimeout(reactor, timer.fd);
+        return;
+    }
     
-    return oss.str();
+    ClientConnection* conn = reactor.clients.find(timer.fd);
+    if (conn) {
+        handleClientTimeout(reactor, conn);
+    }
+}
+
+void EpollServer::handleClientTimeout(Reactor& reactor, ClientConnection* conn) {
+    dispatcher.recordTimeout(conn->state, !conn->readBuffer.empty(), conn->requestCount,
+                             conn->parser.headersComplete(), conn->fd, reactor.id);
+    closeConnection(reactor, conn->fd);
+}
+
+void EpollServer::releaseBuffers(Reactor& reactor, ClientConnection* conn) {
+    reactor.buffers.release(conn->readBuffer);
+    reactor.buffers.release(conn->writeBuffer);
+    reactor.buffers.release(conn->body);
+    conn->statusBlock = nullptr;
 }
 
-bool EpollServer::addToEpoll(int fd, uint32_t events) {
+bool EpollServer::addToEpoll(int epollFd, int fd, uint32_t events) {
     struct epoll_event ev;
     ev.events = events;
     ev.data.fd = fd;
@@ -519,7 +1070,7 @@ bool EpollServer::addToEpoll(int fd, uint32_t events) {
     return true;
 }
 
-bool EpollServer::modifyEpoll(int fd, uint32_t events) {
+bool EpollServer::modifyEpoll(int epollFd, int fd, uint32_t events) {
     struct epoll_event ev;
     ev.events = events;
     ev.data.fd = fd;
@@ -532,7 +1083,7 @@ bool EpollServer::modifyEpoll(int fd, uint32_t events) {
     return true;
 }
 
-bool EpollServer::removeFromEpoll(int fd) {
+bool EpollServer::removeFromEpoll(int epollFd, int fd) {
     if (epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr) < 0) {
         LOG_ERROR("从epoll删除fd失败: " + std::string(strerror(errno)));
         return false;
@@ -1,6 +1,7 @@
 #include "disp/server_factory.h"
 #include "disp/threaded_server.h"
 #include "disp/server_epoll.h"
+#include "disp/server_uring.h"
 #include "common/logger_enhanced.h"
 #include <algorithm>
 
@@ -14,6 +15,20 @@ std::unique_ptr<IServer> ServerFactory::createServer(ServerType type, int port)
             LOG_INFO("创建EpollServer实例 (端口: " + std::to_string(port) + ")");
             return std::make_unique<EpollServer>(port);
             
+        case ServerType::IO_URING: {
+#if DISP_HAS_IO_URING
+            std::string reason;
+            if (IoUringServer::isSupported(&reason)) {
+                LOG_INFO("创建IoUringServer实例 (端口: " + std::to_string(port) + ")");
+                return std::make_unique<IoUringServer>(port);
+            }
+            LOG_WARNING("当前内核不支持io_uring服务器（" + reason + "），回退到EpollServer");
+#else
+            LOG_WARNING("编译时系统头文件不支持io_uring服务器，回退到EpollServer");
+#endif
+            return createServer(ServerType::EPOLL, port);
+        }
+            
         default:
             LOG_ERROR("未知的服务器类型");
             return nullptr;
@@ -28,8 +43,10 @@ std::unique_ptr<IServer> ServerFactory::createServer(const std::string& typeStr,
         return createServer(ServerType::THREADED, port);
     } else if (lowerTypeStr == "epoll") {
         return createServer(ServerType::EPOLL, port);
+    } else if (lowerTypeStr == "io_uring" || lowerTypeStr == "iouring" || lowerTypeStr == "uring") {
+        return createServer(ServerType::IO_URING, port);
     } else {
-        LOG_ERROR("无效的服务器类型字符串: " + typeStr + "，支持的类型: threaded, epoll");
+        LOG_ERROR("无效的服务器类型字符串: " + typeStr + "，支持的类型: threaded, epoll, io_uring");
         LOG_INFO("回退到默认的ThreadedServer");
         return createServer(ServerType::THREADED, port);
     }
@@ -0,0 +1,1071 @@
+#include "disp/server_uring.h"
+
+#if DISP_HAS_IO_URING
+
+#include "common/logger_enhanced.h"
+#include "common/trace.h"
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/utsname.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+bool probeSupport(std::string& failure) {
+    // 多次接收和按fd取消请求需要6.0，操作码查询反映不出这些功能，按内核版本判断
+    struct utsname name;
+    int major = 0;
+    int minor = 0;
+    if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2 || major < 6) {
+        failure = "需要Linux 6.0及以上，当前内核: " + std::string(name.release);
+        return false;
+    }
+
+    IoUring ring;
+    if (!ring.init(8)) {
+        failure = ring.error();
+        return false;
+    }
+    if (!ring.hasFeature(IORING_FEAT_EXT_ARG)) {
+        failure = "内核不支持带超时的等待（IORING_FEAT_EXT_ARG）";
+        return false;
+    }
+    const uint8_t ops[] = {
+        IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_SENDMSG, IORING_OP_SHUTDOWN,
+        IORING_OP_READ, IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL, IORING_OP_CLOSE
+    };
+    for (uint8_t op : ops) {
+        if (!ring.supports(op)) {
+            failure = "内核不支持io_uring操作码" + std::to_string(op);
+            return false;
+        }
+    }
+    if (!ring.setupBufferRing(0, 8, 64)) {
+        failure = ring.error();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+IoUringServer::IoUringServer(int port)
+    : port(port), maxConnections(1000), reactorCount(1), streamThreshold(0), registeredFiles(false),
+      dispatcher("IoUringServer"), running(false), totalConnections(0),
+      acceptedConnections(MetricsRegistry::getInstance().counter(
+          "disp_connections_accepted_total", "已接受的客户端连接数").get()),
+      rejectedConnections(MetricsRegistry::getInstance().counter(
+          "disp_connections_rejected_total", "达到最大连接数后拒绝的客户端连接数").get()) {
+}
+
+IoUringServer::~IoUringServer() {
+    stop();
+}
+
+bool IoUringServer::isSupported(std::string* reason) {
+    static std::string failure;
+    static const bool supported = probeSupport(failure);
+    if (!supported && reason) {
+        *reason = failure;
+    }
+    return supported;
+}
+
+void IoUringServer::setMaxConnections(int maxConn) {
+    maxConnections = maxConn;
+    LOG_INFO("IoUringServer设置最大连接数: " + std::to_string(maxConn));
+}
+
+void IoUringServer::setTimeout(int timeoutSec) {
+    dispatcher.setTimeout(timeoutSec);
+}
+
+void IoUringServer::setHeaderTimeout(int timeoutSec) {
+    dispatcher.setHeaderTimeout(timeoutSec);
+}
+
+void IoUringServer::setIoThreads(int threads) {
+    reactorCount = threads > 0 ? threads : 1;
+    LOG_INFO("IoUringServer设置反应堆数量: " + std::to_string(reactorCount));
+}
+
+void IoUringServer::setStreamThreshold(size_t bytes) {
+    streamThreshold = bytes;
+}
+
+void IoUringServer::setKeepAlive(int idleTimeoutSec, int maxRequests) {
+    dispatcher.setKeepAlive(idleTimeoutSec, maxRequests);
+}
+
+void IoUringServer::setRegisteredFiles(bool enabled) {
+    registeredFiles = enabled;
+    LOG_INFO("IoUringServer设置注册文件: " + std::string(enabled ? "启用" : "禁用"));
+}
+
+int IoUringServer::getCurrentConnections() const {
+    return totalConnections.load();
+}
+
+bool IoUringServer::start() {
+    if (running) {
+        LOG_WARNING("io_uring服务器已经在运行中");
+        return true;
+    }
+
+    // 1. 为每个反应堆创建独立的监听socket和环形队列
+    reactors.clear();
+    for (int i = 0; i < reactorCount; ++i) {
+        auto reactor = std::make_unique<UringReactor>(i);
+        if (!setupReactor(*reactor)) {
+            LOG_ERROR("初始化反应堆失败 (reactor=" + std::to_string(i) + ")");
+            teardownReactor(*reactor);
+            for (auto& created : reactors) {
+                teardownReactor(*created);
+            }
+            reactors.clear();
+            return false;
+        }
+        reactors.push_back(std::move(reactor));
+    }
+
+    // 尚未实现的功能：配置了也不生效，提示运维改用EpollServer
+    if (streamThreshold > 0) {
+        LOG_WARNING("io_uring服务器不支持流式转发，disp.stream_threshold = " + std::to_string(streamThreshold) +
+                    "不生效，大响应仍完整缓存后发送；需要时使用server_type = epoll，否则设为0");
+    }
+    if (TraceCollector::getInstance().isEnabled()) {
+        LOG_WARNING("io_uring服务器不支持请求追踪，trace.enabled配置不生效，需要时使用server_type = epoll");
+    }
+
+    running = true;
+    LOG_INFO("io_uring服务器已启动，监听端口: " + std::to_string(port) +
+             "，最大连接数: " + std::to_string(maxConnections) +
+             "，反应堆数量: " + std::to_string(reactorCount) +
+             "，注册文件: " + (reactors[0]->fixedFiles ? "启用" : "禁用"));
+
+    // 2. 启动其余反应堆线程，0号反应堆在当前线程运行
+    for (size_t i = 1; i < reactors.size(); ++i) {
+        UringReactor* reactor = reactors[i].get();
+        reactor->thread = std::thread([this, reactor]() {
+            eventLoop(*reactor);
+        });
+    }
+
+    eventLoop(*reactors[0]);
+
+    // 3. 事件循环退出后等待其他反应堆结束并释放资源
+    for (auto& reactor : reactors) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+    }
+    for (auto& reactor : reactors) {
+        teardownReactor(*reactor);
+    }
+    reactors.clear();
+
+    LOG_INFO("io_uring服务器已停止");
+    return true;
+}
+
+void IoUringServer::stop() {
+    if (!running) {
+        return;
+    }
+
+    running = false;
+
+    // 唤醒所有反应堆（stop可能在信号处理函数中调用，这里只做eventfd写入）
+    for (auto& reactor : reactors) {
+        if (reactor->wakeFd >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = write(reactor->wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+bool IoUringServer::isRunning() const {
+    return running;
+}
+
+void IoUringServer::setRoute(const std::string& pattern, RequestHandler handler, const std::string& contentType) {
+    dispatcher.addRoute(pattern, handler, contentType);
+}
+
+void IoUringServer::setForwardRoute(const std::string& method, const std::string& pattern,
+                                    ForwardPrepare prepare, ForwardComplete complete) {
+    dispatcher.addForwardRoute(method, pattern, prepare, complete);
+}
+
+int IoUringServer::createListenSocket(bool reusePort) {
+    // 监听socket不需要非阻塞，接受连接由内核在连接到达时完成
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        LOG_ERROR("创建服务器套接字失败: " + std::string(strerror(errno)));
+        return -1;
+    }
+
+    int opt = 1;
+    if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        LOG_ERROR("设置SO_REUSEADDR失败: " + std::string(strerror(errno)));
+        close(listenFd);
+        return -1;
+    }
+
+    // 多反应堆模式下每个反应堆绑定同一端口，由内核在监听socket之间分发新连接
+    if (reusePort && setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        LOG_ERROR("设置SO_REUSEPORT失败: " + std::string(strerror(errno)));
+        close(listenFd);
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        LOG_ERROR("绑定地址失败: " + std::string(strerror(errno)));
+        close(listenFd);
+        return -1;
+    }
+
+    if (listen(listenFd, LISTEN_BACKLOG) < 0) {
+        LOG_ERROR("监听失败: " + std::string(strerror(errno)));
+        close(listenFd);
+        return -1;
+    }
+
+    return listenFd;
+}
+
+bool IoUringServer::setupReactor(UringReactor& reactor) {
+    reactor.listenFd = createListenSocket(reactorCount > 1);
+    if (reactor.listenFd < 0) {
+        return false;
+    }
+
+    if (!reactor.ring.init(RING_ENTRIES)) {
+        LOG_ERROR("创建io_uring失败: " + reactor.ring.error());
+        return false;
+    }
+
+    if (!reactor.ring.setupBufferRing(RECV_BUFFER_GROUP, RECV_BUFFER_COUNT, BUFFER_SIZE)) {
+        LOG_ERROR("创建接收缓冲区环失败: " + reactor.ring.error());
+        return false;
+    }
+
+    // 注册文件表的大小受RLIMIT_NOFILE限制，失败时使用普通文件描述符
+    if (registeredFiles) {
+        if (reactor.ring.registerSparseFiles(static_cast<unsigned>(maxConnections + FILE_TABLE_RESERVE))) {
+            reactor.fixedFiles = true;
+        } else {
+            LOG_WARNING("注册文件表失败，客户端连接使用普通文件描述符: " + reactor.ring.error());
+        }
+    }
+
+    reactor.wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (reactor.wakeFd < 0) {
+        LOG_ERROR("创建eventfd失败: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    return true;
+}
+
+void IoUringServer::teardownReactor(UringReactor& reactor) {
+    // 先关闭环形队列：内核取消进行中的请求并关闭注册文件表中的连接，之后再释放请求引用的对象
+    reactor.ring.destroy();
+
+    for (auto& pair : reactor.upstreams) {
+        close(pair.first);
+    }
+    reactor.upstreams.clear();
+
+    reactor.clients.forEach([this, &reactor](UringConnection* conn) {
+        if (!reactor.fixedFiles) {
+            close(conn->fd);
+        }
+        reactor.timers.cancel(conn->timer);
+        releaseBuffers(reactor, conn);
+    });
+    totalConnections -= static_cast<int>(reactor.clients.size());
+    reactor.clients.clear();
+    reactor.connectionCount = 0;
+
+    if (reactor.wakeFd >= 0) {
+        close(reactor.wakeFd);
+        reactor.wakeFd = -1;
+    }
+
+    if (reactor.listenFd >= 0) {
+        close(reactor.listenFd);
+        reactor.listenFd = -1;
+    }
+}
+
+void IoUringServer::eventLoop(UringReactor& reactor) {
+    LOG_DEBUG("反应堆事件循环启动 (reactor=" + std::to_string(reactor.id) + ")");
+
+    if (!armAccept(reactor) || !armWake(reactor)) {
+        LOG_ERROR("提交接受连接请求失败 (reactor=" + std::to_string(reactor.id) + ")");
+        return;
+    }
+
+    while (running) {
+        // 提交本轮产生的请求并等待完成项，最多等到下一个定时器到期
+        int64_t now = TimerWheel::nowMs();
+        int timeout = std::min(reactor.timers.nextTimeout(now, MAX_WAIT_MS),
+                               reactor.deadlines.nextTimeout(now, MAX_WAIT_MS));
+        int ret = reactor.ring.submitAndWait(timeout);
+        if (ret < 0 && ret != -EBUSY && ret != -EAGAIN) {
+            // EBUSY：完成队列溢出，处理完已有的完成项后重试
+            LOG_ERROR("io_uring_enter失败: " + std::string(strerror(-ret)));
+            break;
+        }
+
+        reactor.ring.forEachCqe([this, &reactor](const struct io_uring_cqe& cqe) {
+            handleCompletion(reactor, cqe);
+        });
+
+        // 处理到期的连接超时和AP调用截止时间
+        now = TimerWheel::nowMs();
+        reactor.timers.advance(now, [this, &reactor](TimerWheel::Timer& timer) {
+            UringConnection* conn = reactor.clients.find(timer.fd);
+            if (conn) {
+                handleClientTimeout(reactor, conn);
+            }
+        });
+        reactor.deadlines.advance(now, [this, &reactor](TimerWheel::Timer& timer) {
+            handleUpstreamTimeout(reactor, timer.fd);
+        });
+    }
+
+    LOG_DEBUG("反应堆事件循环结束 (reactor=" + std::to_string(reactor.id) + ")");
+}
+
+void IoUringServer::handleCompletion(UringReactor& reactor, const struct io_uring_cqe& cqe) {
+    Op op = static_cast<Op>(cqe.user_data >> 32);
+    int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+
+    switch (op) {
+        case Op::ACCEPT:
+            handleAccept(reactor, cqe);
+            break;
+        case Op::WAKE:
+            // stop()唤醒时由while条件退出
+            if (running) {
+                armWake(reactor);
+            }
+            break;
+        case Op::CLIENT_RECV:
+        case Op::CLIENT_SEND:
+        case Op::CLIENT_SHUTDOWN:
+            handleClientCompletion(reactor, op, fd, cqe);
+            break;
+        case Op::UPSTREAM_CONNECT:
+        case Op::UPSTREAM_SEND:
+        case Op::UPSTREAM_RECV:
+            handleUpstreamCompletion(reactor, op, fd, cqe);
+            break;
+        default:
+            break;
+    }
+
+    // 接收的数据已在处理时复制出来，缓冲区放回环中
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        reactor.ring.recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+    }
+}
+
+bool IoUringServer::armAccept(UringReactor& reactor) {
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = reactor.listenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    if (reactor.fixedFiles) {
+        // 新连接直接放入注册文件表，由内核分配槽位，完成项的结果为槽位编号
+        sqe->file_index = IORING_FILE_INDEX_ALLOC;
+    } else {
+        sqe->accept_flags = SOCK_CLOEXEC;
+    }
+    sqe->user_data = tag(Op::ACCEPT, reactor.listenFd);
+    reactor.accepting = true;
+    return true;
+}
+
+bool IoUringServer::armWake(UringReactor& reactor) {
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = reactor.wakeFd;
+    sqe->addr = reinterpret_cast<uint64_t>(&reactor.wakeValue);
+    sqe->len = sizeof(reactor.wakeValue);
+    sqe->off = static_cast<uint64_t>(-1);
+    sqe->user_data = tag(Op::WAKE, reactor.wakeFd);
+    return true;
+}
+
+void IoUringServer::handleAccept(UringReactor& reactor, const struct io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        reactor.accepting = false;
+    }
+
+    if (cqe.res < 0) {
+        if (cqe.res == -ENFILE && reactor.fixedFiles) {
+            LOG_WARNING_LIMITED("注册文件表已满，暂时无法接受新连接", 1);
+        } else if (cqe.res != -ECANCELED) {
+            LOG_ERROR_LIMITED("接受连接失败: " + std::string(strerror(-cqe.res)), 1);
+        }
+    } else {
+        int clientFd = cqe.res;
+
+        // 检查连接数限制（所有反应堆共享）
+        if (totalConnections.load() >= maxConnections) {
+            LOG_WARNING_LIMITED("达到最大连接数限制，拒绝新连接", 1);
+            rejectedConnections.inc();
+            closeClientFd(reactor, clientFd);
+        } else {
+            // 从对象池取出客户端连接对象，在头部超时内没有收到请求则关闭
+            UringConnection* conn = reactor.clients.acquire(clientFd);
+            reactor.timers.schedule(conn->timer, dispatcher.headerTimeout() * 1000LL);
+            reactor.connectionCount++;
+            totalConnections++;
+            acceptedConnections.inc();
+            LOG_INFO_LIMITED("新连接建立 (fd=" + std::to_string(clientFd) +
+                             ", reactor=" + std::to_string(reactor.id) + ")", 20);
+
+            if (!armRecv(reactor, conn)) {
+                closeConnection(reactor, conn);
+            }
+        }
+    }
+
+    // 多次接受连接的请求因出错结束时重新提交
+    if (!reactor.accepting && running && !armAccept(reactor)) {
+        LOG_ERROR_LIMITED("重新提交接受连接请求失败", 1);
+    }
+}
+
+void IoUringServer::handleClientCompletion(UringReactor& reactor, Op op, int clientFd,
+                                           const struct io_uring_cqe& cqe) {
+    UringConnection* conn = reactor.clients.find(clientFd);
+    if (!conn) {
+        return;
+    }
+
+    // 多次接收的请求在最后一个完成项（不带F_MORE）后结束
+    bool finished = !(cqe.flags & IORING_CQE_F_MORE);
+    if (finished) {
+        conn->pendingOps--;
+        if (op == Op::CLIENT_RECV) {
+            conn->receiving = false;
+            conn->recvCancelled = false;
+        }
+    }
+
+    if (conn->closing) {
+        if (conn->pendingOps == 0) {
+            releaseConnection(reactor, conn);
+        }
+        return;
+    }
+
+    // shutdown的结果不需要处理：失败时连接随后关闭，发送出错时被取消
+    bool open = true;
+    if (op == Op::CLIENT_RECV) {
+        open = handleRecv(reactor, conn, cqe);
+    } else if (op == Op::CLIENT_SEND) {
+        open = handleSend(reactor, conn, cqe);
+    }
+    if (!open) {
+        closeConnection(reactor, conn);
+    }
+}
+
+bool IoUringServer::armRecv(UringReactor& reactor, UringConnection* conn) {
+    // 等待AP响应或发送响应期间只缓存后续请求，积压过多时不再接收，数据留在内核中由TCP流量控制限制客户端，
+    // 响应发送完毕后重新提交
+    if (conn->receiving ||
+        (conn->state != ClientState::READING_REQUEST && conn->readBuffer.length() >= PIPELINE_BUFFER_LIMIT)) {
+        return true;
+    }
+
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        LOG_ERROR_LIMITED("提交接收请求失败：提交队列已满", 1);
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT | (reactor.fixedFiles ? IOSQE_FIXED_FILE : 0);
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = tag(Op::CLIENT_RECV, conn->fd);
+    conn->receiving = true;
+    conn->pendingOps++;
+    return true;
+}
+
+bool IoUringServer::handleRecv(UringReactor& reactor, UringConnection* conn, const struct io_uring_cqe& cqe) {
+    if (cqe.res > 0) {
+        // 最后一个响应已发出，丢弃客户端后续数据直到对方关闭
+        if (conn->state != ClientState::CLOSING) {
+            // 空闲的长连接上开始新的请求，改为按头部超时计时
+            if (conn->state == ClientState::READING_REQUEST && conn->readBuffer.empty() &&
+                conn->requestCount > 0) {
+                reactor.timers.schedule(conn->timer, dispatcher.headerTimeout() * 1000LL);
+            }
+            uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            reactor.buffers.acquire(conn->readBuffer, BUFFER_SIZE);
+            conn->readBuffer.append(reactor.ring.buffer(bufferId), cqe.res);
+            if (!processBuffered(reactor, conn)) {
+                return false;
+            }
+        }
+    } else if (cqe.res == 0) {
+        // 客户端关闭连接
+        LOG_DEBUG("客户端关闭连接 (fd=" + std::to_string(conn->fd) + ")");
+        return false;
+    } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+        // ENOBUFS：缓冲区环暂时用完；ECANCELED：积压过多被取消。其余为读取错误
+        LOG_ERROR("读取客户端数据失败: " + std::string(strerror(-cqe.res)));
+        return false;
+    }
+
+    // 多次接收的请求已结束时按需重新提交
+    return armRecv(reactor, conn);
+}
+
+bool IoUringServer::processBuffered(UringReactor& reactor, UringConnection* conn) {
+    // 流水线中的请求按顺序处理，前一个响应发送完毕后才解析下一个
+    while (conn->state == ClientState::READING_REQUEST && !conn->readBuffer.empty()) {
+        HttpParser::Result result = conn->parser.parse(conn->readBuffer);
+        if (result == HttpParser::Result::INCOMPLETE) {
+            // 头部的超时从请求开始计算，不因收到数据而延长；接收请求体期间按连接超时，每次收到数据后重新计时
+            if (conn->parser.headersComplete()) {
+                reactor.timers.schedule(conn->timer, dispatcher.connectionTimeout() * 1000LL);
+            }
+            break;
+        }
+        bool open = result == HttpParser::Result::ERROR ? rejectRequest(reactor, conn)
+                                                        : processCompleteRequest(reactor, conn);
+        if (!open) {
+            return false;
+        }
+    }
+
+    // 积压过多时取消多次接收，响应发送完毕后由armRecv重新提交
+    if (conn->receiving && !conn->recvCancelled && conn->state != ClientState::READING_REQUEST &&
+        conn->readBuffer.length() >= PIPELINE_BUFFER_LIMIT) {
+        struct io_uring_sqe* sqe = reactor.ring.getSqe();
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = tag(Op::CLIENT_RECV, conn->fd);
+            sqe->user_data = tag(Op::IGNORE, conn->fd);
+            conn->recvCancelled = true;
+        }
+    }
+    return true;
+}
+
+bool IoUringServer::submitSend(UringReactor& reactor, UringConnection* conn) {
+    // 头部片段、写缓冲区和响应体以一次sendmsg提交，MSG_WAITALL使内核发完全部数据后才产生完成项
+    const HttpResponse::Part parts[] = {
+        {conn->statusBlock, &conn->statusPos},
+        {&conn->writeBuffer, &conn->writePos},
+        {&conn->body, &conn->bodyPos}
+    };
+    size_t iovCount = HttpResponse::fillIov(parts, sizeof(parts) / sizeof(parts[0]), conn->iov, 3);
+    memset(&conn->msg, 0, sizeof(conn->msg));
+    conn->msg.msg_iov = conn->iov;
+    conn->msg.msg_iovlen = iovCount;
+
+    // 最后一个响应之后链接shutdown，发送完毕由内核接着关闭写方向；链接的请求须在同一次提交中
+    bool last = !conn->keepAlive;
+    if (!reactor.ring.reserve(last ? 2 : 1)) {
+        LOG_ERROR_LIMITED("提交发送请求失败：提交队列已满", 1);
+        return false;
+    }
+    uint8_t fileFlag = reactor.fixedFiles ? IOSQE_FIXED_FILE : 0;
+
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = conn->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&conn->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->flags = fileFlag | (last ? IOSQE_IO_LINK : 0);
+    sqe->user_data = tag(Op::CLIENT_SEND, conn->fd);
+    conn->pendingOps++;
+
+    if (last) {
+        sqe = reactor.ring.getSqe();
+        sqe->opcode = IORING_OP_SHUTDOWN;
+        sqe->fd = conn->fd;
+        sqe->len = SHUT_WR;
+        sqe->flags = fileFlag;
+        sqe->user_data = tag(Op::CLIENT_SHUTDOWN, conn->fd);
+        conn->pendingOps++;
+    }
+    return true;
+}
+
+bool IoUringServer::handleSend(UringReactor& reactor, UringConnection* conn, const struct io_uring_cqe& cqe) {
+    if (cqe.res < 0) {
+        LOG_ERROR("发送数据失败: " + std::string(strerror(-cqe.res)));
+        return false;
+    }
+
+    const HttpResponse::Part parts[] = {
+        {conn->statusBlock, &conn->statusPos},
+        {&conn->writeBuffer, &conn->writePos},
+        {&conn->body, &conn->bodyPos}
+    };
+    const size_t partCount = sizeof(parts) / sizeof(parts[0]);
+    HttpResponse::advance(parts, partCount, static_cast<size_t>(cqe.res));
+
+    // 只发出部分数据（被信号中断等），链接的shutdown已被取消，重新提交剩余部分
+    if (!HttpResponse::complete(parts, partCount)) {
+        reactor.timers.schedule(conn->timer, dispatcher.connectionTimeout() * 1000LL);
+        return submitSend(reactor, conn);
+    }
+
+    if (conn->keepAlive) {
+        // 保持连接：丢弃已处理的请求，之后的数据属于下一个请求；缓冲区归还到池中，空闲的长连接不占用缓冲区
+        conn->readBuffer.erase(0, conn->parser.consumed());
+        if (conn->readBuffer.empty()) {
+            reactor.buffers.release(conn->readBuffer);
+        }
+        conn->parser.reset();
+        reactor.buffers.release(conn->writeBuffer);
+        reactor.buffers.release(conn->body);
+        conn->statusBlock = nullptr;
+        conn->state = ClientState::READING_REQUEST;
+        armClientTimer(reactor, conn);
+
+        // 处理已缓存的后续请求，接收因积压被取消时重新提交
+        if (!processBuffered(reactor, conn)) {
+            return false;
+        }
+        return armRecv(reactor, conn);
+    }
+
+    // 写方向已由链接的shutdown关闭。客户端可能还在发送后续请求，读取并丢弃剩余数据，客户端关闭或超时后再关闭
+    if (HttpDispatcher::shouldLinger(conn->readBuffer, conn->parser)) {
+        releaseBuffers(reactor, conn);
+        conn->state = ClientState::CLOSING;
+        armClientTimer(reactor, conn);
+        return armRecv(reactor, conn);
+    }
+
+    return false;
+}
+
+bool IoUringServer::processCompleteRequest(UringReactor& reactor, UringConnection* conn) {
+    const HttpRequest& request = conn->parser.request();
+    conn->requestCount++;
+    conn->keepAlive = dispatcher.keepAlive(request, conn->requestCount, running);
+
+    // 转发路由：AP调用在事件循环中异步完成
+    HttpDispatcher::Dispatch dispatch = dispatcher.dispatch(request);
+    if (dispatch.route) {
+        return startForward(reactor, conn, *dispatch.route, dispatch.params);
+    }
+    return beginResponse(reactor, conn, std::move(dispatch.response));
+}
+
+bool IoUringServer::rejectRequest(UringReactor& reactor, UringConnection* conn) {
+    conn->keepAlive = false;
+    return beginResponse(reactor, conn, HttpDispatcher::reject(conn->parser, conn->fd));
+}
+
+bool IoUringServer::beginResponse(UringReactor& reactor, UringConnection* conn, HttpDispatcher::Response response) {
+    // 状态行和CORS头部取预先生成的片段，动态头部写入从池中取出的写缓冲区，响应体移入连接
+    conn->statusBlock = response.statusBlock;
+    conn->writeBuffer.clear();
+    reactor.buffers.acquire(conn->writeBuffer, RESPONSE_HEADER_RESERVE);
+    dispatcher.appendHeaders(conn->writeBuffer, response, conn->keepAlive);
+    conn->body = std::move(response.content);
+    return sendResponse(reactor, conn);
+}
+
+bool IoUringServer::sendResponse(UringReactor& reactor, UringConnection* conn) {
+    conn->statusPos = 0;
+    conn->writePos = 0;
+    conn->bodyPos = 0;
+    conn->state = ClientState::WRITING_RESPONSE;
+    armClientTimer(reactor, conn);
+    return submitSend(reactor, conn);
+}
+
+void IoUringServer::releaseBuffers(UringReactor& reactor, UringConnection* conn) {
+    reactor.buffers.release(conn->readBuffer);
+    reactor.buffers.release(conn->writeBuffer);
+    reactor.buffers.release(conn->body);
+    conn->statusBlock = nullptr;
+}
+
+bool IoUringServer::startForward(UringReactor& reactor, UringConnection* conn, const HttpDispatcher::Route& route,
+                                 const RouteParams& params) {
+    auto upstream = std::make_unique<UringUpstream>(conn->fd, &route.complete);
+    ApCall& call = upstream->call;
+
+    HttpDispatcher::Response response;
+    if (!HttpDispatcher::prepareForward(route, conn->parser.request(), params, call, response)) {
+        return beginResponse(reactor, conn, std::move(response));
+    }
+
+    // 优先复用连接池中的连接（直接发送），否则发起非阻塞连接并等待可写
+    bool reused = false;
+    int upstreamFd = ApClient::openConnection(call, reused);
+    if (upstreamFd < 0) {
+        return beginResponse(reactor, conn, HttpDispatcher::completeForward(route.complete, call));
+    }
+
+    upstream->fd = upstreamFd;
+    upstream->reused = reused;
+    upstream->writeBuffer = ApClient::encodeRequest(call);
+    upstream->deadline.fd = upstreamFd;
+    UringUpstream* pending = upstream.get();
+    if (!(reused ? submitUpstreamSend(reactor, pending) : submitUpstreamConnect(reactor, pending))) {
+        close(upstreamFd);
+        ApClient::fail(call, "ConnectionError", "提交AP请求失败", "",
+                       "{\"error\":\"连接处理服务失败\",\"endpoint\":\"" + call.host + ":" + std::to_string(call.port) + "\"}");
+        return beginResponse(reactor, conn, HttpDispatcher::completeForward(route.complete, call));
+    }
+    reactor.deadlines.schedule(pending->deadline, ApClient::CALL_TIMEOUT_SEC * 1000LL);
+
+    // 客户端连接等待AP响应，超时由AP调用的截止时间控制
+    conn->state = ClientState::PROCESSING;
+    armClientTimer(reactor, conn);
+    conn->upstreamFd = upstreamFd;
+    reactor.upstreams[upstreamFd] = std::move(upstream);
+
+    return true;
+}
+
+bool IoUringServer::submitUpstreamConnect(UringReactor& reactor, UringUpstream* upstream) {
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = upstream->fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = tag(Op::UPSTREAM_CONNECT, upstream->fd);
+    upstream->pendingOps++;
+    return true;
+}
+
+bool IoUringServer::submitUpstreamSend(UringReactor& reactor, UringUpstream* upstream) {
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = upstream->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(upstream->writeBuffer.data() + upstream->writePos);
+    sqe->len = static_cast<uint32_t>(upstream->writeBuffer.length() - upstream->writePos);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = tag(Op::UPSTREAM_SEND, upstream->fd);
+    upstream->pendingOps++;
+    return true;
+}
+
+bool IoUringServer::submitUpstreamRecv(UringReactor& reactor, UringUpstream* upstream) {
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = upstream->fd;
+    sqe->len = BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = tag(Op::UPSTREAM_RECV, upstream->fd);
+    upstream->pendingOps++;
+    return true;
+}
+
+void IoUringServer::handleUpstreamCompletion(UringReactor& reactor, Op op, int upstreamFd,
+                                             const struct io_uring_cqe& cqe) {
+    auto it = reactor.upstreams.find(upstreamFd);
+    if (it == reactor.upstreams.end()) {
+        return;
+    }
+
+    UringUpstream* upstream = it->second.get();
+    upstream->pendingOps--;
+
+    // 已放弃的调用：请求结束后关闭socket
+    if (upstream->abandoned) {
+        if (upstream->pendingOps == 0) {
+            close(upstreamFd);
+            reactor.upstreams.erase(it);
+        }
+        return;
+    }
+
+    ApCall& call = upstream->call;
+
+    // 1. 非阻塞连接完成，开始发送请求
+    if (op == Op::UPSTREAM_CONNECT) {
+        if (!ApClient::checkConnected(call, upstreamFd)) {
+            finishForward(reactor, upstream, false);
+            return;
+        }
+        LOG_DEBUG_CTX("成功连接到AP服务", LogContext(call.requestId, call.clientIp, "",
+                      call.host + ":" + std::to_string(call.port)));
+        if (!submitUpstreamSend(reactor, upstream)) {
+            failUpstream(reactor, upstream, "SendError", "发送请求失败", "提交队列已满",
+                         "{\"error\":\"发送请求失败\"}");
+        }
+        return;
+    }
+
+    // 2. 请求发送完毕后开始接收响应
+    if (op == Op::UPSTREAM_SEND) {
+        if (cqe.res < 0) {
+            failUpstream(reactor, upstream, "SendError", "发送请求失败", "errno: " + std::to_string(-cqe.res),
+                         "{\"error\":\"发送请求失败\"}");
+            return;
+        }
+        upstream->writePos += static_cast<size_t>(cqe.res);
+        bool submitted = upstream->writePos < upstream->writeBuffer.length() ? submitUpstreamSend(reactor, upstream)
+                                                                            : submitUpstreamRecv(reactor, upstream);
+        if (!submitted) {
+            failUpstream(reactor, upstream, "SendError", "发送请求失败", "提交队列已满",
+                         "{\"error\":\"发送请求失败\"}");
+        }
+        return;
+    }
+
+    // 3. 接收响应直到收到完整消息
+    if (cqe.res > 0) {
+        uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        upstream->readBuffer.append(reactor.ring.buffer(bufferId), cqe.res);
+
+        ApProtocol::DecodeResult decoded = ApClient::decodeResponse(call, upstream->readBuffer);
+        if (decoded == ApProtocol::DecodeResult::INVALID) {
+            finishForward(reactor, upstream, false);
+            return;
+        }
+        if (decoded == ApProtocol::DecodeResult::COMPLETE) {
+            LOG_DEBUG_CTX("收到AP响应, 字节数: " + std::to_string(call.response.length()),
+                          LogContext(call.requestId, call.clientIp));
+            finishForward(reactor, upstream, upstream->readBuffer.empty());
+            return;
+        }
+    } else if (cqe.res == 0) {
+        if (!upstream->readBuffer.empty() && ApClient::isLineProtocol()) {
+            // 旧版AP发送完响应后直接关闭连接，不带消息结束符
+            call.response = std::move(upstream->readBuffer);
+            call.success = true;
+            finishForward(reactor, upstream, false);
+        } else {
+            failUpstream(reactor, upstream, "ReceiveError", "接收响应失败",
+                         upstream->readBuffer.empty() ? "AP关闭连接且未返回数据" : "AP关闭连接，响应不完整",
+                         "{\"error\":\"接收响应失败\"}");
+        }
+        return;
+    } else if (cqe.res != -ENOBUFS) {
+        failUpstream(reactor, upstream, "ReceiveError", "接收响应失败", "errno: " + std::to_string(-cqe.res),
+                     "{\"error\":\"接收响应失败\"}");
+        return;
+    }
+
+    if (!submitUpstreamRecv(reactor, upstream)) {
+        failUpstream(reactor, upstream, "ReceiveError", "接收响应失败", "提交队列已满",
+                     "{\"error\":\"接收响应失败\"}");
+    }
+}
+
+void IoUringServer::failUpstream(UringReactor& reactor, UringUpstream* upstream, const std::string& errorType,
+                                 const std::string& message, const std::string& details,
+                                 const std::string& errorResponse) {
+    if (HttpDispatcher::shouldRetry(upstream->call, upstream->reused, !upstream->readBuffer.empty())) {
+        if (!retryForward(reactor, upstream)) {
+            finishForward(reactor, upstream, false);
+        }
+        return;
+    }
+
+    ApClient::fail(upstream->call, errorType, message, details, errorResponse);
+    finishForward(reactor, upstream, false);
+}
+
+bool IoUringServer::retryForward(UringReactor& reactor, UringUpstream* upstream) {
+    int newFd = ApClient::connectNonBlocking(upstream->call);
+    if (newFd < 0) {
+        return false;  // 错误响应已设置
+    }
+
+    // 关闭失效的连接（没有进行中的请求），用新连接替换，截止时间不变
+    int oldFd = upstream->fd;
+    auto it = reactor.upstreams.find(oldFd);
+    std::unique_ptr<UringUpstream> moved = std::move(it->second);
+    reactor.upstreams.erase(it);
+    close(oldFd);
+
+    moved->fd = newFd;
+    moved->deadline.fd = newFd;
+    moved->reused = false;
+    moved->writePos = 0;
+    moved->readBuffer.clear();
+
+    UringConnection* conn = reactor.clients.find(moved->clientFd);
+    if (conn) {
+        conn->upstreamFd = newFd;
+    }
+    reactor.upstreams[newFd] = std::move(moved);
+
+    if (!submitUpstreamConnect(reactor, upstream)) {
+        ApClient::fail(upstream->call, "ConnectionError", "提交AP请求失败", "", "{\"error\":\"连接处理服务失败\"}");
+        finishForward(reactor, upstream, false);
+    }
+    return true;
+}
+
+void IoUringServer::finishForward(UringReactor& reactor, UringUpstream* upstream, bool reusable) {
+    // 客户端连接关闭时会先放弃AP调用，这里连接一定存在
+    UringConnection* conn = reactor.clients.find(upstream->clientFd);
+    HttpDispatcher::Response response;
+    if (conn) {
+        conn->upstreamFd = -1;
+        response = HttpDispatcher::completeForward(*upstream->complete, upstream->call);
+    }
+
+    releaseUpstream(reactor, upstream, reusable);
+
+    if (conn && !beginResponse(reactor, conn, std::move(response))) {
+        closeConnection(reactor, conn);
+    }
+}
+
+void IoUringServer::releaseUpstream(UringReactor& reactor, UringUpstream* upstream, bool reusable) {
+    reactor.deadlines.cancel(upstream->deadline);
+    int upstreamFd = upstream->fd;
+
+    // 请求仍在进行（客户端断开或超时），取消后等其结束再关闭socket
+    if (upstream->pendingOps > 0) {
+        upstream->abandoned = true;
+        cancelRequests(reactor, upstreamFd, false);
+        LOG_DEBUG("取消AP调用 (fd=" + std::to_string(upstreamFd) + ")");
+        return;
+    }
+
+    // 完整收到响应的连接归还连接池，其余直接关闭
+    if (reusable) {
+        ApClient::releaseConnection(upstream->call, upstreamFd);
+    } else {
+        close(upstreamFd);
+    }
+    reactor.upstreams.erase(upstreamFd);
+}
+
+void IoUringServer::handleUpstreamTimeout(UringReactor& reactor, int upstreamFd) {
+    auto it = reactor.upstreams.find(upstreamFd);
+    if (it == reactor.upstreams.end()) {
+        return;
+    }
+
+    HttpDispatcher::failTimeout(it->second->call);
+    finishForward(reactor, it->second.get(), false);
+}
+
+void IoUringServer::closeConnection(UringReactor& reactor, UringConnection* conn) {
+    if (conn->closing) {
+        return;
+    }
+    conn->closing = true;
+
+    // 客户端断开时放弃进行中的AP调用
+    if (conn->upstreamFd >= 0) {
+        auto it = reactor.upstreams.find(conn->upstreamFd);
+        if (it != reactor.upstreams.end()) {
+            releaseUpstream(reactor, it->second.get(), false);
+        }
+        conn->upstreamFd = -1;
+    }
+    reactor.timers.cancel(conn->timer);
+
+    // 内核中的请求还引用着连接的缓冲区，取消后等全部结束再释放
+    if (conn->pendingOps > 0) {
+        cancelRequests(reactor, conn->fd, reactor.fixedFiles);
+        return;
+    }
+    releaseConnection(reactor, conn);
+}
+
+void IoUringServer::releaseConnection(UringReactor& reactor, UringConnection* conn) {
+    int clientFd = conn->fd;
+    releaseBuffers(reactor, conn);
+    closeClientFd(reactor, clientFd);
+    if (reactor.clients.release(clientFd)) {
+        reactor.connectionCount--;
+        totalConnections--;
+    }
+
+    LOG_DEBUG("关闭连接 (fd=" + std::to_string(clientFd) + ")");
+}
+
+void IoUringServer::cancelRequests(UringReactor& reactor, int fd, bool fixed) {
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        LOG_ERROR_LIMITED("提交取消请求失败：提交队列已满", 1);
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL |
+                        (fixed ? IORING_ASYNC_CANCEL_FD_FIXED : 0);
+    sqe->user_data = tag(Op::IGNORE, fd);
+}
+
+void IoUringServer::closeClientFd(UringReactor& reactor, int clientFd) {
+    if (!reactor.fixedFiles) {
+        close(clientFd);
+        return;
+    }
+
+    // 注册文件表中的连接只能由内核关闭，槽位随后可再分配
+    struct io_uring_sqe* sqe = reactor.ring.getSqe();
+    if (!sqe) {
+        LOG_ERROR_LIMITED("提交关闭请求失败：提交队列已满", 1);
+        return;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = static_cast<uint32_t>(clientFd) + 1;
+    sqe->user_data = tag(Op::IGNORE, clientFd);
+}
+
+void IoUringServer::armClientTimer(UringReactor& reactor, UringConnection* conn) {
+    int64_t delayMs = dispatcher.clientTimeoutMs(conn->state, !conn->readBuffer.empty());
+    if (delayMs < 0) {
+        reactor.timers.cancel(conn->timer);
+        return;
+    }
+    reactor.timers.schedule(conn->timer, delayMs);
+}
+
+void IoUringServer::handleClientTimeout(UringReactor& reactor, UringConnection* conn) {
+    dispatcher.recordTimeout(conn->state, !conn->readBuffer.empty(), conn->requestCount,
+                             conn->parser.headersComplete(), conn->fd, reactor.id);
+    closeConnection(reactor, conn);
+}
+
+#endif // DISP_HAS_IO_URING
@@ -2,13 +2,18 @@
 #include "common/logger_enhanced.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <cstring>
-#include <sstream>
+#include <cerrno>
 
 ThreadedServer::ThreadedServer(int port) 
-    : port(port), maxConnections(100), connectionTimeout(60),
-      serverSocket(-1), running(false), currentConnections(0) {
+    : port(port), maxConnections(100), connectionTimeout(60), workerThreads(32), workerQueueLimit(256),
+      serverSocket(-1), running(false), currentConnections(0),
+      acceptedConnections(MetricsRegistry::getInstance().counter(
+          "disp_connections_accepted_total", "已接受的客户端连接数").get()),
+      rejectedConnections(MetricsRegistry::getInstance().counter(
+          "disp_connections_rejected_total", "达到最大连接数后拒绝的客户端连接数").get()) {
 }
 
 ThreadedServer::~ThreadedServer() {
@@ -58,11 +63,13 @@ bool ThreadedServer::start() {
     
     running = true;
     
-    // 启动接受连接的线程
+    // 先启动工作线程池，再启动接受连接的线程
+    workers.start(workerThreads, workerQueueLimit);
     acceptThread = std::thread(&ThreadedServer::acceptLoop, this);
     
     LOG_INFO("ThreadedServer已启动，监听端口: " + std::to_string(port) + 
-             "，最大连接数: " + std::to_string(maxConnections));
+             "，最大连接数: " + std::to_string(maxConnections) +
+             "，工作线程数: " + std::to_string(workerThreads));
     
     return true;
 }
@@ -74,10 +81,9 @@ void ThreadedServer::stop() {
     
     running = false;
     
-    // 关闭服务器套接字
+    // 关闭读写唤醒阻塞在accept中的接受线程（仅close不会唤醒），线程结束后再关闭套接字
     if (serverSocket >= 0) {
-        close(serverSocket);
-        serverSocket = -1;
+        shutdown(serverSocket, SHUT_RDWR);
     }
     
     // 等待接受线程结束
@@ -85,14 +91,13 @@ void ThreadedServer::stop() {
         acceptThread.join();
     }
     
-    // 等待所有客户端线程结束
-    for (auto& thread : clientThreads) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    if (serverSocket >= 0) {
+        close(serverSocket);
+        serverSocket = -1;
     }
     
-    clientThreads.clear();
+    // 已接受的连接处理完后工作线程退出
+    workers.stop();
     
     LOG_INFO("ThreadedServer已停止");
 }
@@ -101,9 +106,18 @@ bool ThreadedServer::isRunning() const {
     return running;
 }
 
-void ThreadedServer::setRoute(const std::string& path, RequestHandler handler) {
-    routes[path] = handler;
-    LOG_INFO("ThreadedServer注册路由: " + path);
+void ThreadedServer::setRoute(const std::string& pattern, RequestHandler handler, const std::string& contentType) {
+    router.add("*", pattern, static_cast<int>(routeTable.size()));
+    routeTable.push_back(Route{handler, contentType, nullptr, nullptr});
+    LOG_INFO("ThreadedServer注册路由: " + pattern);
+}
+
+void ThreadedServer::setForwardRoute(const std::string& method, const std::string& pattern,
+                                     ForwardPrepare prepare, ForwardComplete complete) {
+    // 每个连接独占线程，在processRequest中同步完成AP调用
+    router.add(method, pattern, static_cast<int>(routeTable.size()));
+    routeTable.push_back(Route{nullptr, "application/json", prepare, complete});
+    LOG_INFO("ThreadedServer注册转发路由: " + method + " " + pattern);
 }
 
 void ThreadedServer::setMaxConnections(int maxConn) {
@@ -116,6 +130,12 @@ void ThreadedServer::setTimeout(int timeoutSec) {
     LOG_INFO("ThreadedServer设置超时时间: " + std::to_string(timeoutSec) + "秒");
 }
 
+void ThreadedServer::setWorkerPool(int threads, size_t queueLimit) {
+    workerThreads = threads;
+    workerQueueLimit = queueLimit;
+    LOG_INFO("ThreadedServer设置工作线程数: " + std::to_string(threads) + "，等待队列上限: " + std::to_string(queueLimit));
+}
+
 void ThreadedServer::acceptLoop() {
     struct sockaddr_in clientAddr;
     socklen_t clientAddrLen = sizeof(clientAddr);
@@ -124,125 +144,162 @@ void ThreadedServer::acceptLoop() {
         int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
         if (clientSocket < 0) {
             if (running) {
-                LOG_ERROR("接受连接失败: " + std::string(strerror(errno)));
+                LOG_ERROR_LIMITED("接受连接失败: " + std::string(strerror(errno)), 1);
             }
             continue;
         }
         
         // 检查连接数限制
         if (currentConnections >= maxConnections) {
-            LOG_WARNING("达到最大连接数限制，拒绝新连接");
+            LOG_WARNING_LIMITED("达到最大连接数限制，拒绝新连接", 1);
+            rejectedConnections.inc();
             close(clientSocket);
             continue;
         }
         
-        // 创建新线程处理客户端连接
+        // 工作线程阻塞读写，设置收发超时，避免不发送请求的客户端一直占用工作线程
+        struct timeval timeout;
+        timeout.tv_sec = connectionTimeout;
+        timeout.tv_usec = 0;
+        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        
+        // 提交给工作线程池处理
         currentConnections++;
-        clientThreads.emplace_back([this, clientSocket]() {
+        bool submitted = workers.submit([this, clientSocket]() {
             this->handleClient(clientSocket);
             this->currentConnections--;
         });
+        if (!submitted) {
+            currentConnections--;
+            LOG_WARNING_LIMITED("工作线程池等待队列已满，拒绝新连接", 1);
+            rejectedConnections.inc();
+            close(clientSocket);
+            continue;
+        }
+        acceptedConnections.inc();
     }
 }
 
 void ThreadedServer::handleClient(int clientSocket) {
     char buffer[BUFFER_SIZE];
+    std::string request;
+    HttpParser parser;
     
-    // 接收请求
-    ssize_t bytesRead = recv(clientSocket, buffer, BUFFER_SIZE - 1, 0);
-    if (bytesRead <= 0) {
-        close(clientSocket);
-        return;
+    // 接收请求，直到请求完整（请求体可能分多次到达）
+    HttpParser::Result result = HttpParser::Result::INCOMPLETE;
+    while (result == HttpParser::Result::INCOMPLETE) {
+        ssize_t bytesRead = recv(clientSocket, buffer, BUFFER_SIZE, 0);
+        if (bytesRead <= 0) {
+            close(clientSocket);
+            return;
+        }
+        request.append(buffer, bytesRead);
+        result = parser.parse(request);
     }
     
-    // 确保字符串以null结尾
-    buffer[bytesRead] = '\0';
-    
     // 处理请求
-    std::string request(buffer);
-    std::string response = processRequest(request);
+    Response response;
+    if (result == HttpParser::Result::COMPLETE) {
+        processRequest(parser.request(), response);
+    } else {
+        LOG_WARNING_LIMITED("请求格式错误: " + std::string(parser.errorMessage()), 10);
+        createResponse(response, "{\"error\":\"" + std::string(parser.errorMessage()) + "\"}",
+                       parser.errorStatus());
+    }
     
     // 发送响应
-    send(clientSocket, response.c_str(), response.length(), 0);
+    sendResponse(clientSocket, response);
     
     // 关闭连接
     close(clientSocket);
 }
 
-std::string ThreadedServer::processRequest(const std::string& request) {
-    // 解析请求路径和方法
-    std::string method, path;
-    this->parseRequest(request, method, path);
-    
+void ThreadedServer::processRequest(const HttpRequest& request, Response& response) {
     // 处理OPTIONS请求（预检请求）
-    if (method == "OPTIONS") {
-        return this->createOptionsResponse();
+    if (request.method == "OPTIONS") {
+        createOptionsResponse(response);
+        return;
     }
     
     // 查找对应的处理函数
-    auto it = routes.find(path);
-    if (it != routes.end()) {
+    int routeIndex = -1;
+    RouteParams params;
+    Router::MatchResult matched = router.match(request.method, request.path, routeIndex, params);
+    if (matched == Router::MatchResult::FOUND) {
+        const Route& route = routeTable[routeIndex];
+        std::string content;
+        int statusCode = 200;
         try {
-            // 调用处理函数
-            std::string content = it->second(request);
-            return createResponse(content);
+            if (route.prepare) {
+                // 转发路由：AP不可用或超时时以502/504返回
+                ApCall call;
+                if (route.prepare(request, params, content, call)) {
+                    ApClient::forward(call);
+                    content = route.complete(call);
+                    statusCode = ApClient::httpStatus(call);
+                }
+            } else {
+                // 调用处理函数
+                content = route.handler(request, params);
+            }
         } catch (const std::exception& e) {
             LOG_ERROR("处理请求时发生异常: " + std::string(e.what()));
-            return createResponse("{\"error\":\"内部服务器错误\"}", 500);
+            createResponse(response, "{\"error\":\"内部服务器错误\"}", 500);
+            return;
         }
+        createResponse(response, std::move(content), statusCode, route.contentType);
+        return;
+    }
+    
+    if (matched == Router::MatchResult::METHOD_NOT_ALLOWED) {
+        LOG_WARNING("路由不支持该方法: " + std::string(request.method) + " " + std::string(request.path));
+        createResponse(response, "{\"error\":\"不支持的请求方法\"}", 405);
+        return;
     }
     
     // 未找到对应的路由
-    LOG_WARNING("未找到路由: " + path);
-    return createResponse("{\"error\":\"未找到\"}", 404);
-}
-
-void ThreadedServer::parseRequest(const std::string& request, std::string& method, std::string& path) {
-    std::istringstream iss(request);
-    std::string version;
-    iss >> method >> path >> version;
-    
-    // 移除查询参数
-    size_t pos = path.find('?');
-    if (pos != std::string::npos) {
-        path = path.substr(0, pos);
-    }
-}
-
-std::string ThreadedServer::createOptionsResponse() {
-    std::ostringstream oss;
-    oss << "HTTP/1.1 200 OK\r\n";
-    oss << "Access-Control-Allow-Origin: *\r\n";
-    oss << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, PATCH, OPTIONS\r\n";
-    oss << "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    oss << "Access-Control-Max-Age: 86400\r\n";
-    oss << "Content-Length: 0\r\n";
-    oss << "Connection: close\r\n";
-    oss << "\r\n";
-    
-    return oss.str();
-}
-
-std::string ThreadedServer::createResponse(const std::string& content, int statusCode, const std::string& contentType) {
-    std::string status;
-    switch (statusCode) {
-        case 200: status = "200 OK"; break;
-        case 400: status = "400 Bad Request"; break;
-        case 404: status = "404 Not Found"; break;
-        case 500: status = "500 Internal Server Error"; break;
-        default: status = "200 OK";
-    }
-    
-    std::ostringstream oss;
-    oss << "HTTP/1.1 " << status << "\r\n";
-    oss << "Content-Type: " << contentType << "\r\n";
-    oss << "Content-Length: " << content.length() << "\r\n";
-    oss << "Connection: close\r\n";
-    oss << "Access-Control-Allow-Origin: *\r\n";
-    oss << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, PATCH, OPTIONS\r\n";
-    oss << "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    oss << "\r\n";
-    oss << content;
-    
-    return oss.str();
-}
\ No newline at end of file
+    LOG_WARNING("未找到路由: " + std::string(request.path));
+    createResponse(response, "{\"error\":\"未找到\"}", 404);
+}
+
+void ThreadedServer::createOptionsResponse(Response& response) {
+    static const std::string closeHeader = "Connection: close\r\n";
+    response.statusBlock = &HttpResponse::optionsBlock();
+    HttpResponse::appendHeaders(response.headers, "", closeHeader);
+    HttpResponse::appendContentLength(response.headers, 0);
+}
+
+void ThreadedServer::createResponse(Response& response, std::string content, int statusCode,
+                                    const std::string& contentType) {
+    static const std::string closeHeader = "Connection: close\r\n";
+    response.statusBlock = &HttpResponse::statusBlock(statusCode);
+    HttpResponse::appendHeaders(response.headers, contentType, closeHeader);
+    HttpResponse::appendContentLength(response.headers, content.length());
+    response.body = std::move(content);
+}
+
+bool ThreadedServer::sendResponse(int clientSocket, const Response& response) {
+    size_t statusPos = 0;
+    size_t headersPos = 0;
+    size_t bodyPos = 0;
+    const HttpResponse::Part parts[] = {
+        {response.statusBlock, &statusPos},
+        {&response.headers, &headersPos},
+        {&response.body, &bodyPos}
+    };
+    const size_t partCount = sizeof(parts) / sizeof(parts[0]);
+    
+    // 阻塞socket上一次sendmsg也可能只发出一部分（被信号中断等），循环直到发送完毕
+    while (!HttpResponse::complete(parts, partCount)) {
+        ssize_t sent = HttpResponse::send(clientSocket, parts, partCount);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            LOG_WARNING_LIMITED("发送响应失败: " + std::string(strerror(errno)), 10);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+#include "disp/timer_wheel.h"
+#include <chrono>
+
+TimerWheel::TimerWheel(int tickMs)
+    : tickMs(tickMs > 0 ? tickMs : 1), baseMs(nowMs()), nextTick(0), count(0) {
+}
+
+TimerWheel::~TimerWheel() {
+    // 剩余定时器只做标记，所属对象之后析构时不再访问时间轮
+    auto detach = [](Slot& slot) {
+        Timer* timer = slot.head.next;
+        while (timer != &slot.head) {
+            Timer* next = timer->next;
+            timer->prev = timer->next = nullptr;
+            timer->wheel = nullptr;
+            timer = next;
+        }
+        slot.head.prev = slot.head.next = &slot.head;
+    };
+    for (Slot& slot : level0) {
+        detach(slot);
+    }
+    for (auto& level : levels) {
+        for (Slot& slot : level) {
+            detach(slot);
+        }
+    }
+}
+
+int64_t TimerWheel::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TimerWheel::schedule(Timer& timer, int64_t delayMs) {
+    if (timer.wheel && timer.wheel != this) {
+        timer.wheel->cancel(timer);
+    }
+    if (timer.wheel) {
+        timer.unlink();
+    } else {
+        timer.wheel = this;
+        ++count;
+    }
+
+    // 向上取整，定时器不会早于指定时间到期
+    int64_t expireMs = nowMs() + (delayMs > 0 ? delayMs : 0) - baseMs;
+    timer.expireTick = static_cast<uint64_t>((expireMs + tickMs - 1) / tickMs);
+    insert(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.wheel == this) {
+        timer.unlink();
+        timer.wheel = nullptr;
+        --count;
+    }
+}
+
+void TimerWheel::insert(Timer& timer) {
+    uint64_t expire = timer.expireTick;
+    if (expire < nextTick) {
+        // 已经到期的放到下一个待处理的槽
+        append(level0[nextTick & (LEVEL0_SIZE - 1)], timer);
+        return;
+    }
+
+    uint64_t delta = expire - nextTick;
+    if (delta < LEVEL0_SIZE) {
+        append(level0[expire & (LEVEL0_SIZE - 1)], timer);
+        return;
+    }
+
+    if (delta > MAX_DELAY_TICKS) {
+        // 超出时间轮范围的按最大范围处理，到期时再判断
+        expire = nextTick + MAX_DELAY_TICKS;
+        timer.expireTick = expire;
+    }
+    for (int level = 0; level < LEVELS - 1; ++level) {
+        int shift = LEVEL0_BITS + LEVEL_BITS * level;
+        if (level == LEVELS - 2 || delta < (uint64_t(1) << (shift + LEVEL_BITS))) {
+            append(levels[level][(expire >> shift) & (LEVEL_SIZE - 1)], timer);
+            return;
+        }
+    }
+}
+
+void TimerWheel::cascade(int level, size_t index) {
+    Slot& slot = levels[level][index];
+    Timer* timer = slot.head.next;
+    slot.head.prev = slot.head.next = &slot.head;
+
+    // 按到期时间重新分配到下层
+    while (timer != &slot.head) {
+        Timer* next = timer->next;
+        insert(*timer);
+        timer = next;
+    }
+}
+
+int TimerWheel::nextTimeout(int64_t nowMs, int maxMs) const {
+    if (count == 0) {
+        return maxMs;
+    }
+
+    // 在第0层查找最近的非空槽；直到第0层转完一圈仍没有时，在进位时醒来下移上层的定时器。
+    // nextTick本身是进位点时，处理该刻度前先要下移上层，直接在该刻度醒来
+    uint64_t tick = nextTick;
+    if ((tick & (LEVEL0_SIZE - 1)) != 0) {
+        while (level0[tick & (LEVEL0_SIZE - 1)].empty()) {
+            if ((++tick & (LEVEL0_SIZE - 1)) == 0) {
+                break;
+            }
+        }
+    }
+
+    int64_t delay = baseMs + static_cast<int64_t>(tick) * tickMs - nowMs;
+    if (delay <= 0) {
+        return 0;
+    }
+    return delay < maxMs ? static_cast<int>(delay) : maxMs;
+}
@@ -0,0 +1,123 @@
+#include "disp/work_stealing_pool.h"
+#include "common/logger_enhanced.h"
+
+WorkStealingPool::WorkStealingPool()
+    : nextQueue(0), pending(0), active(0), maxQueue(0), accepting(false), rejected(0), stolen(0) {
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    stop();
+}
+
+void WorkStealingPool::start(int threadCount, size_t queueLimit) {
+    std::lock_guard<std::mutex> lock(idleMutex);
+    if (accepting) {
+        return;
+    }
+
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    maxQueue = queueLimit > 0 ? queueLimit : 1;
+    accepting = true;
+
+    for (int i = 0; i < threadCount; ++i) {
+        queues.emplace_back(new WorkQueue());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, static_cast<size_t>(i));
+    }
+
+    LOG_SYSTEM("WorkStealingPool", "连接处理线程池启动",
+               "线程数: " + std::to_string(threadCount) + ", 队列上限: " + std::to_string(maxQueue));
+}
+
+void WorkStealingPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (!accepting && threads.empty()) {
+            return;
+        }
+        accepting = false;
+    }
+    idleCv.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+    queues.clear();
+
+    LOG_SYSTEM("WorkStealingPool", "连接处理线程池停止",
+               "累计拒绝任务数: " + std::to_string(rejected) + ", 累计窃取任务数: " + std::to_string(stolen));
+}
+
+bool WorkStealingPool::submit(Task task) {
+    {
+        // 计数和入队都在idleMutex内完成，等待中的线程被唤醒后一定能取到任务
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (!accepting || pending >= maxQueue) {
+            rejected++;
+            return false;
+        }
+        WorkQueue& queue = *queues[nextQueue++ % queues.size()];
+        std::lock_guard<std::mutex> queueLock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        pending++;
+    }
+    idleCv.notify_one();
+    return true;
+}
+
+bool WorkStealingPool::takeTask(size_t index, Task& task) {
+    {
+        WorkQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            pending--;
+            return true;
+        }
+    }
+
+    // 从尾部窃取：队列头部的任务留给所属线程，减少两端的争用
+    for (size_t i = 1; i < queues.size(); ++i) {
+        WorkQueue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            pending--;
+            stolen++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    while (true) {
+        Task task;
+        if (!takeTask(index, task)) {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            if (pending == 0) {
+                if (!accepting) {
+                    return;  // 已停止且所有队列已清空
+                }
+                idleCv.wait(lock, [this]() { return pending > 0 || !accepting; });
+            }
+            continue;
+        }
+
+        active++;
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("连接处理线程执行任务时发生异常: " + std::string(e.what()));
+        }
+        active--;
+    }
+}
@@ -0,0 +1,252 @@
+#include "common/http_parser.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * HTTP请求解析微基准
+ * 用法: http_parser_bench [迭代次数]
+ * 对比HttpParser与原先的三次解析（EpollServer::isRequestComplete每次recv后小写复制整个缓冲区、
+ * EpollServer::parseRequest用istringstream取方法和路径、RequestHandler::parseHttpRequest用getline
+ * 复制全部头部）。每个场景分别按整包到达和按固定大小分片到达（模拟多次recv）计时
+ */
+
+namespace legacy {
+    // 以下三个函数保留替换前的实现，只用于对比
+
+    bool isRequestComplete(const std::string& buffer) {
+        size_t headerEnd = buffer.find("\r\n\r\n");
+        if (headerEnd == std::string::npos) {
+            return false;
+        }
+
+        std::string lowerBuffer = buffer;
+        std::transform(lowerBuffer.begin(), lowerBuffer.end(), lowerBuffer.begin(), ::tolower);
+
+        size_t contentLengthPos = lowerBuffer.find("content-length:");
+        if (contentLengthPos != std::string::npos) {
+            size_t valueStart = contentLengthPos + 15;
+            size_t lineEnd = buffer.find("\r\n", valueStart);
+            if (lineEnd != std::string::npos) {
+                std::string lengthStr = buffer.substr(valueStart, lineEnd - valueStart);
+                lengthStr.erase(0, lengthStr.find_first_not_of(" \t"));
+                lengthStr.erase(lengthStr.find_last_not_of(" \t") + 1);
+
+                try {
+                    int contentLength = std::stoi(lengthStr);
+                    size_t bodyStart = headerEnd + 4;
+                    size_t actualBodyLength = buffer.length() - bodyStart;
+                    return actualBodyLength >= static_cast<size_t>(contentLength);
+                } catch (const std::exception&) {
+                    return true;
+                }
+            }
+        }
+        return true;
+    }
+
+    void parseRequest(const std::string& request, std::string& method, std::string& path) {
+        std::istringstream iss(request);
+        std::string version;
+        iss >> method >> path >> version;
+
+        size_t pos = path.find('?');
+        if (pos != std::string::npos) {
+            path = path.substr(0, pos);
+        }
+    }
+
+    struct HttpRequest {
+        std::string method;
+        std::string path;
+        std::string query;
+        std::string body;
+        std::unordered_map<std::string, std::string> headers;
+    };
+
+    HttpRequest parseHttpRequest(const std::string& request) {
+        HttpRequest httpRequest;
+
+        std::istringstream stream(request);
+        std::string line;
+
+        if (std::getline(stream, line)) {
+            std::istringstream requestLine(line);
+            std::string version;
+            requestLine >> httpRequest.method >> httpRequest.path >> version;
+
+            size_t queryPos = httpRequest.path.find('?');
+            if (queryPos != std::string::npos) {
+                httpRequest.query = httpRequest.path.substr(queryPos + 1);
+                httpRequest.path = httpRequest.path.substr(0, queryPos);
+            }
+        }
+
+        while (std::getline(stream, line) && line != "\r" && !line.empty()) {
+            size_t colonPos = line.find(':');
+            if (colonPos != std::string::npos) {
+                std::string key = line.substr(0, colonPos);
+                std::string value = line.substr(colonPos + 1);
+
+                key.erase(0, key.find_first_not_of(" \t"));
+                key.erase(key.find_last_not_of(" \t\r\n") + 1);
+                value.erase(0, value.find_first_not_of(" \t"));
+                value.erase(value.find_last_not_of(" \t\r\n") + 1);
+
+                httpRequest.headers[key] = value;
+            }
+        }
+
+        std::ostringstream bodyStream;
+        while (std::getline(stream, line)) {
+            bodyStream << line << "\n";
+        }
+        httpRequest.body = bodyStream.str();
+        if (!httpRequest.body.empty() && httpRequest.body.back() == '\n') {
+            httpRequest.body.pop_back();
+        }
+        return httpRequest;
+    }
+}
+
+namespace {
+    struct Scenario {
+        const char* name;
+        std::string request;
+    };
+
+    std::vector<Scenario> makeScenarios() {
+        std::vector<Scenario> scenarios;
+
+        scenarios.push_back({"简单GET", "GET /api/user?limit=20 HTTP/1.1\r\nHost: localhost:8080\r\n\r\n"});
+
+        scenarios.push_back({"浏览器GET",
+            "GET /api/order?limit=50&after_id=1200 HTTP/1.1\r\n"
+            "Host: shop.example.com\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+            "Chrome/120.0.0.0 Safari/537.36\r\n"
+            "Accept: application/json, text/plain, */*\r\n"
+            "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+            "Accept-Encoding: gzip, deflate, br\r\n"
+            "Referer: https://shop.example.com/orders\r\n"
+            "Cookie: session=8f1c2a9e4b7d6c5a3e2f1b0a9c8d7e6f; theme=dark; lang=zh-CN\r\n"
+            "X-Forwarded-For: 203.0.113.42\r\n"
+            "X-Request-Source: web\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n"});
+
+        std::string body = "{\"user_id\":1001,\"items\":[";
+        for (int i = 0; i < 60; ++i) {
+            if (i > 0) {
+                body += ',';
+            }
+            body += "{\"product_id\":" + std::to_string(2000 + i) + ",\"quantity\":" + std::to_string(i % 5 + 1) +
+                    ",\"note\":\"请尽快发货\"}";
+        }
+        body += "]}";
+        scenarios.push_back({"POST 4KB",
+            "POST /api/order HTTP/1.1\r\n"
+            "Host: localhost:8080\r\n"
+            "Content-Type: application/json\r\n"
+            "Content-Length: " + std::to_string(body.length()) + "\r\n"
+            "\r\n" + body});
+
+        return scenarios;
+    }
+
+    // 与EpollServer的处理流程一致：数据按chunk大小追加到读缓冲区，每次追加后判断是否完整
+    size_t runLegacy(const std::string& request, size_t chunk) {
+        std::string buffer;
+        size_t checksum = 0;
+        for (size_t offset = 0; offset < request.length(); offset += chunk) {
+            buffer.append(request, offset, chunk);
+            if (legacy::isRequestComplete(buffer)) {
+                std::string method, path;
+                legacy::parseRequest(buffer, method, path);
+                legacy::HttpRequest parsed = legacy::parseHttpRequest(buffer);
+                checksum += method.length() + path.length() + parsed.headers.size() + parsed.body.length();
+                break;
+            }
+        }
+        return checksum;
+    }
+
+    size_t runParser(HttpParser& parser, const std::string& request, size_t chunk) {
+        std::string buffer;
+        size_t checksum = 0;
+        parser.reset();
+        for (size_t offset = 0; offset < request.length(); offset += chunk) {
+            buffer.append(request, offset, chunk);
+            if (parser.parse(buffer) == HttpParser::Result::COMPLETE) {
+                const HttpRequest& parsed = parser.request();
+                checksum += parsed.method.length() + parsed.path.length() + parsed.headers.size() + parsed.body.length();
+                break;
+            }
+        }
+        return checksum;
+    }
+
+    template <typename Func>
+    double measure(size_t iterations, size_t& checksum, Func func) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            checksum += func();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 200000;
+    if (argc > 1) {
+        if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+            std::cout << "用法: " << argv[0] << " [迭代次数]" << std::endl
+                      << "对比HttpParser与原先的三次解析，默认每个场景200000次" << std::endl;
+            return 0;
+        }
+        iterations = static_cast<size_t>(std::strtoul(argv[1], nullptr, 10));
+        if (iterations == 0) {
+            iterations = 1;
+        }
+    }
+
+    const size_t chunks[] = {0, 64};   // 0表示整包到达
+    HttpParser parser;
+    size_t checksum = 0;
+
+    printf("%-12s %8s %8s %14s %14s %8s\n", "场景", "字节", "分片", "原实现ns/次", "HttpParser ns/次", "加速比");
+    for (const Scenario& scenario : makeScenarios()) {
+        const std::string& request = scenario.request;
+        for (size_t chunk : chunks) {
+            size_t size = chunk == 0 ? request.length() : chunk;
+
+            // 两种实现的结果先校验一致
+            if (runLegacy(request, size) != runParser(parser, request, size)) {
+                std::cerr << scenario.name << ": 解析结果不一致" << std::endl;
+                return 1;
+            }
+
+            double legacyNs = measure(iterations, checksum, [&]() { return runLegacy(request, size); });
+            double parserNs = measure(iterations, checksum, [&]() { return runParser(parser, request, size); });
+
+            char chunkText[16];
+            snprintf(chunkText, sizeof(chunkText), "%s", chunk == 0 ? "整包" : std::to_string(chunk).c_str());
+            printf("%-12s %8zu %8s %14.0f %14.0f %7.1fx\n", scenario.name, request.length(), chunkText,
+                   legacyNs, parserNs, legacyNs / parserNs);
+        }
+    }
+
+    // 防止编译器把解析过程优化掉
+    if (checksum == 0) {
+        std::cerr << "checksum为0" << std::endl;
+    }
+    return 0;
+}
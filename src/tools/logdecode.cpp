@@ -0,0 +1,213 @@
+#include "common/log_format.h"
+#include "common/json_writer.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+/**
+ * 二进制日志解码工具
+ * 用法: logdecode [--json] [文件...]
+ * 不指定文件时从标准输入读取。默认输出与文本日志相同格式的行，--json输出JSON Lines
+ */
+
+namespace {
+    const size_t READ_CHUNK = 1024 * 1024;
+
+    // 当前文件的时钟锚点，由ANCHOR记录设置
+    struct Anchor {
+        int64_t realtime = 0;
+        int64_t monotonic = 0;
+        std::string processName = "Unknown";
+    };
+
+    const char* CONTEXT_TAGS[LogFormat::CONTEXT_FIELDS] = {"ReqID", "IP", "User", "Op"};
+    const char* CONTEXT_KEYS[LogFormat::CONTEXT_FIELDS] = {"request_id", "client_ip", "user_id", "operation"};
+
+    // 纳秒时间戳格式化为"YYYY-MM-DD HH:MM:SS.mmm"（本地时间）
+    std::string formatTime(int64_t nanos) {
+        time_t seconds = static_cast<time_t>(nanos / 1000000000);
+        int millis = static_cast<int>((nanos / 1000000) % 1000);
+        std::tm local;
+        localtime_r(&seconds, &local);
+
+        char buffer[32];
+        size_t length = strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        snprintf(buffer + length, sizeof(buffer) - length, ".%03d", millis);
+        return buffer;
+    }
+
+    void writeText(std::string& out, const LogFormat::Record& record, const Anchor& anchor,
+                   int64_t wallTime, const std::string& message) {
+        char level[16];
+        snprintf(level, sizeof(level), "%-7s", LogFormat::levelName(record.level));
+
+        out += formatTime(wallTime);
+        out += " [" + anchor.processName + "/" + std::to_string(record.threadId) + "]";
+        out += " [";
+        out += level;
+        out += "]";
+        for (size_t i = 0; i < LogFormat::CONTEXT_FIELDS; ++i) {
+            if (!record.context[i].empty()) {
+                out += " [";
+                out += CONTEXT_TAGS[i];
+                out += ":";
+                out.append(record.context[i].data(), record.context[i].size());
+                out += "]";
+            }
+        }
+        out += " ";
+        out += message;
+        out += "\n";
+    }
+
+    void writeJson(std::string& out, const LogFormat::Record& record, const Anchor& anchor,
+                   int64_t wallTime, const std::string& message) {
+        JsonWriter writer(out);
+        writer.beginObject();
+        writer.key("time").value(formatTime(wallTime));
+        writer.key("timestamp_ns").value(static_cast<long long>(wallTime));
+        writer.key("level").value(LogFormat::levelName(record.level));
+        writer.key("process").value(anchor.processName);
+        writer.key("thread").value(record.threadId);
+        writer.key("event").value(LogFormat::eventName(record.event));
+        for (size_t i = 0; i < LogFormat::CONTEXT_FIELDS; ++i) {
+            if (!record.context[i].empty()) {
+                writer.key(CONTEXT_KEYS[i]).value(record.context[i]);
+            }
+        }
+        writer.key("message").value(message);
+        writer.key("args").beginArray();
+        for (const LogFormat::Arg& arg : record.args) {
+            if (arg.type == LogFormat::Arg::STRING) {
+                writer.value(arg.text);
+            } else if (arg.type == LogFormat::Arg::INT) {
+                writer.value(arg.intValue);
+            } else {
+                writer.value(arg.doubleValue);
+            }
+        }
+        writer.endArray();
+        writer.endObject();
+        out += "\n";
+    }
+
+    // 解码一个文件，成功返回true
+    bool decodeFile(FILE* file, const std::string& name, bool json) {
+        std::string buffer;
+        std::string out;
+        size_t offset = 0;       // buffer中下一条记录的位置
+        size_t fileOffset = 0;   // buffer起始处在文件中的偏移，用于报错
+        bool headerChecked = false;
+        Anchor anchor;
+        LogFormat::Record record;
+
+        std::vector<char> chunk(READ_CHUNK);
+        for (;;) {
+            size_t bytes = fread(chunk.data(), 1, chunk.size(), file);
+            if (bytes == 0) {
+                break;
+            }
+            buffer.append(chunk.data(), bytes);
+
+            if (!headerChecked) {
+                if (buffer.size() < LogFormat::MAGIC_SIZE) {
+                    continue;
+                }
+                if (memcmp(buffer.data(), LogFormat::MAGIC, LogFormat::MAGIC_SIZE) != 0) {
+                    std::cerr << name << ": 不是二进制日志文件" << std::endl;
+                    return false;
+                }
+                offset = LogFormat::MAGIC_SIZE;
+                headerChecked = true;
+            }
+
+            for (;;) {
+                size_t consumed = 0;
+                LogFormat::DecodeResult result = LogFormat::decode(
+                    buffer.data() + offset, buffer.size() - offset, record, consumed);
+                if (result == LogFormat::DecodeResult::INCOMPLETE) {
+                    break;
+                }
+                if (result == LogFormat::DecodeResult::INVALID) {
+                    std::cout << out;
+                    std::cerr << name << ": 偏移 " << (fileOffset + offset) << " 处的记录已损坏" << std::endl;
+                    return false;
+                }
+                offset += consumed;
+
+                if (record.event == LogFormat::ANCHOR) {
+                    if (record.args.size() >= 2) {
+                        anchor.realtime = record.args[0].intValue;
+                        anchor.monotonic = record.timestamp;
+                        anchor.processName.assign(record.args[1].text.data(), record.args[1].text.size());
+                    }
+                    continue;
+                }
+
+                int64_t wallTime = anchor.realtime + (record.timestamp - anchor.monotonic);
+                std::string message = LogFormat::render(record.event, record.args.data(), record.args.size());
+                if (json) {
+                    writeJson(out, record, anchor, wallTime, message);
+                } else {
+                    writeText(out, record, anchor, wallTime, message);
+                }
+            }
+
+            // 输出已解码的部分，丢弃已处理的数据
+            std::cout << out;
+            out.clear();
+            buffer.erase(0, offset);
+            fileOffset += offset;
+            offset = 0;
+        }
+
+        if (!headerChecked) {
+            std::cerr << name << ": 不是二进制日志文件" << std::endl;
+            return false;
+        }
+        if (!buffer.empty()) {
+            std::cerr << name << ": 末尾有 " << buffer.size() << " 字节不完整的记录（可能仍在写入）" << std::endl;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            std::cout << "用法: " << argv[0] << " [--json] [文件...]" << std::endl
+                      << "将二进制日志（log.format = binary）转换为文本，--json输出JSON Lines，"
+                      << "不指定文件时从标准输入读取" << std::endl;
+            return 0;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+
+    if (files.empty()) {
+        return decodeFile(stdin, "<stdin>", json) ? 0 : 1;
+    }
+
+    bool success = true;
+    for (const std::string& name : files) {
+        FILE* file = fopen(name.c_str(), "rb");
+        if (!file) {
+            std::cerr << "无法打开文件: " << name << std::endl;
+            success = false;
+            continue;
+        }
+        success = decodeFile(file, name, json) && success;
+        fclose(file);
+    }
+    return success ? 0 : 1;
+}